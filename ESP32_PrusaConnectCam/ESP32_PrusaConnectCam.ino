@@ -43,6 +43,8 @@
 #include "micro_sd.h"
 #include "log.h"
 #include "connect.h"
+#include "snapshot_sink.h"
+#include "mqtt.h"
 #include "wifi_mngt.h"
 #include "serial_cfg.h"
 
@@ -80,6 +82,8 @@ void setup() {
   Server_LoadCfg();
   SystemCamera.LoadCameraCfgFromEeprom();
   Connect.LoadCfgFromEeprom();
+  SinkHttp.LoadCfgFromEeprom();
+  SinkMqtt.LoadCfgFromEeprom();
   SystemWifiMngt.LoadCfgFromEeprom();
 
   /* init WiFi mngt */
@@ -88,13 +92,16 @@ void setup() {
   /* init camera interface */
   SystemCamera.Init();
   SystemCamera.CapturePhoto();
-  SystemCamera.CaptureReturnFrameBuffer();
+
+  /* init pre-event ring */
+  SystemPreEvent.Init(SystemCamera.GetFrameSizeWidth(), SystemCamera.GetFrameSizeHeight());
 
   /* init WEB server */
   Server_InitWebServer();
 
   /* init class for communication with PrusaConnect */
   Connect.Init();
+  SnapshotSink_InitAll();
 
   /* init external temperature sensor */
   ExternalTemperatureSensor.Init();
@@ -113,15 +120,23 @@ void setup() {
 
   /* init tasks */
   SystemLog.AddEvent(LogLevel_Info, F("Start tasks"));
+  xTaskCreatePinnedToCore(System_TaskLogWriter, "LogWriter", 3000, NULL, 7, &Task_LogWriter, 0);                                /*function, description, stack size, parameters, priority, task handle, core*/
+  ESP_ERROR_CHECK(esp_task_wdt_add(Task_LogWriter));
   xTaskCreatePinnedToCore(System_TaskMain, "SystemNtpOtaUpdate", 5200, NULL, 1, &Task_SystemMain, 0);                           /*function, description, stack size, parameters, priority, task handle, core*/
   ESP_ERROR_CHECK(esp_task_wdt_add(Task_SystemMain));
   xTaskCreatePinnedToCore(System_TaskCaptureAndSendPhoto, "CaptureAndSendPhoto", 4400, NULL, 2, &Task_CapturePhotoAndSend, 0);  /*function, description, stack size, parameters, priority, task handle, core*/
   ESP_ERROR_CHECK(esp_task_wdt_add(Task_CapturePhotoAndSend));
+  xTaskCreatePinnedToCore(System_TaskSnapshotSink, "SendPhoto", 4400, &SinkConnect, 2, &Task_SendPhoto, 0);                     /*function, description, stack size, parameters, priority, task handle, core*/
+  ESP_ERROR_CHECK(esp_task_wdt_add(Task_SendPhoto));
+  SinkHttp.StartTask();                                                                                                         /* only when the local HTTP target is enabled */
+  SinkMqtt.StartTask();                                                                                                         /* only when the MQTT client is enabled */
   xTaskCreatePinnedToCore(System_TaskWifiManagement, "WiFiManagement", 2700, NULL, 3, &Task_WiFiManagement, 0);                 /*function, description, stack size, parameters, priority, task handle, core*/
   ESP_ERROR_CHECK(esp_task_wdt_add(Task_WiFiManagement));
 #if (true == ENABLE_SD_CARD)  
   xTaskCreatePinnedToCore(System_TaskSdCardCheck, "CheckMicroSdCard", 3000, NULL, 4, &Task_SdCardCheck, 0);                     /*function, description, stack size, parameters, priority, task handle, core*/
   ESP_ERROR_CHECK(esp_task_wdt_add(Task_SdCardCheck));
+  xTaskCreatePinnedToCore(System_TaskSnapshotSink, "SdCardWriter", 3500, &SinkSdCard, 2, &Task_SdCardWriter, 0);               /*function, description, stack size, parameters, priority, task handle, core*/
+  ESP_ERROR_CHECK(esp_task_wdt_add(Task_SdCardWriter));
 #endif
   xTaskCreatePinnedToCore(System_TaskSerialCfg, "CheckSerialConfiguration", 2300, NULL, 5, &Task_SerialCfg, 0);                 /*function, description, stack size, parameters, priority, task handle, core*/
   ESP_ERROR_CHECK(esp_task_wdt_add(Task_SerialCfg));
@@ -131,6 +146,8 @@ void setup() {
   ESP_ERROR_CHECK(esp_task_wdt_add(Task_SysLed));
   xTaskCreatePinnedToCore(System_TaskWiFiWatchdog, "WiFiWatchdog", 2200, NULL, 8, &Task_WiFiWatchdog, 0);                       /*function, description, stack size, parameters, priority, task handle, core*/
   ESP_ERROR_CHECK(esp_task_wdt_add(Task_WiFiWatchdog));
+  xTaskCreatePinnedToCore(System_TaskCameraCapture, "CameraCapture", 4600, NULL, 2, &Task_CameraCapture, 1);                    /*function, description, stack size, parameters, priority, task handle, core*/
+  ESP_ERROR_CHECK(esp_task_wdt_add(Task_CameraCapture));
   //xTaskCreatePinnedToCore(System_TaskSdCardRemove, "SdCardRemove", 3000, NULL, 9, &Task_SdCardFileRemove, 0);                   /*function, description, stack size, parameters, priority, task handle, core*/
   //esp_task_wdt_add(Task_SdCardFileRemove);
 
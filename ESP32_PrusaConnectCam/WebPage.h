@@ -223,6 +223,7 @@ const char page_config_html[] PROGMEM = R"rawliteral(
         <tr><td class="pc1">Connect Token</td><td ><input type="text" name="token" id=tokenid >&nbsp;<button class="btn_save" onclick="changeValue(encodeURIComponent(document.getElementById('tokenid').value), 'set_token?token=', 'config')">Save</button></td></tr>
         <tr><td class="pc1">Fingerprint</td><td class=pc2 id="fingerprint"></td></tr>
 		<tr><td class="pc1">Trigger Interval [s]</td><td ><input type="text" name="refresh" id=refreshid >&nbsp;<button class="btn_save" onclick="changeValue(document.getElementById('refreshid').value, 'set_int?refresh=', 'config')">Save</button></td></tr>
+		<tr><td class="pc1">Slower upload of static scene</td><td class="pc2"><label class="switch"><input type="checkbox" name="motion_cadence" id=motion_cadenceid onchange="changeValue(this.checked, 'set_bool?motion_cadence=', 'config')"><span class="checkbox_slider round"></span></label> <span id="status_motion_cadence"></span></td></tr>
 		<tr><td style="height: 1px;"></td><td style="height: 1px;"></td></tr>
 		<tr><td class="pc1">Image quality</td><td class="pc2">Low <input type="range" class="slider" name="photo_quality" id=photo_qualityid min="10" max="63" step="1" onchange="changeValue(this.value, 'set_int?photo_quality=', 'config')"> High</td></tr>
 		<tr>
@@ -238,6 +239,21 @@ const char page_config_html[] PROGMEM = R"rawliteral(
 				</select> <span class="pc1">pixels</span>
 			</td>
 		</tr>
+		<tr><td class="pc1">Stream quality</td><td class="pc2">Low <input type="range" class="slider" name="stream_quality" id=stream_qualityid min="10" max="63" step="1" onchange="changeValue(this.value, 'set_int?stream_quality=', 'config')"> High</td></tr>
+		<tr>
+			<td class="pc1">Stream resolution</td><td><label for="stream_framesize"></label>
+				<select class="select" id="stream_framesizeid" name="stream_framesize" onchange="changeValue(this.value, 'set_int?stream_framesize=', 'config')">
+					<option value="255">Same as photo</option>
+					<option value="0">320x240</option>
+					<option value="1">352x288</option>
+					<option value="2">640x480</option>
+					<option value="3">800x600</option>
+					<option value="4">1024x768</option>
+					<option value="5">1280x1024</option>
+					<option value="6">1600x1200</option>
+				</select> <span class="pc1">pixels</span>
+			</td>
+		</tr>
 		<tr><td style="height: 1px;"></td><td style="height: 1px;"></td></tr>
 		<tr><td class="pc1">Brightness</td><td class="pc2">Low <input type="range" class="slider" name="brightness" id=brightnessid min="-2" max="2" step="1" onchange="changeValue(this.value, 'set_int?brightness=', 'config')">High</td></tr>
 		<tr><td class="pc1">Contrast</td><td class="pc2">Low <input type="range" class="slider" name="contrast" id=contrastid min="-2" max="2" step="1" onchange="changeValue(this.value, 'set_int?contrast=', 'config')"> High</td></tr>
@@ -262,6 +278,7 @@ const char page_config_html[] PROGMEM = R"rawliteral(
 		<tr><td class="pc1">Flash duration</td><td class="pc2"><span id="flash_time_value"></span> ms</td></tr>
 		<tr><td style="height: 1px;"></td><td style="height: 1px;"></td></tr>
 		<tr><td class="pc1">Save images to micro SD</td><td class="pc2"><label class="switch"><input type="checkbox" name="timelaps" id=timelapsid onchange="changeValue(this.checked, 'set_bool?timelaps_enable=', 'config')"><span class="checkbox_slider round"></span></label> <span id="status_timelaps"></span></td></tr>
+		<tr><td class="pc1">Save images to one video file</td><td class="pc2"><label class="switch"><input type="checkbox" name="timelaps_avi" id=timelaps_aviid onchange="changeValue(this.checked, 'set_bool?timelaps_avi=', 'config')"><span class="checkbox_slider round"></span></label> <span id="status_timelaps_avi"></span></td></tr>
 		<tr><td style="height: 1px;"></td><td style="height: 1px;"></td></tr>
 	</table></center>
 	<center><button class="btn_collapsible">Advanced settings</button></center>
@@ -931,6 +948,8 @@ function get_data(val) {
 				document.getElementById('refreshid').value = obj.refreshInterval;
 				document.getElementById('photo_qualityid').value = obj.photoquality;
 				document.getElementById('framesizeid').value = obj.framesize;
+				document.getElementById('stream_framesizeid').value = obj.stream_framesize;
+				document.getElementById('stream_qualityid').value = (obj.stream_quality == 255) ? obj.photoquality : obj.stream_quality;
 				document.getElementById('brightnessid').value = obj.brightness;
 				document.getElementById('contrastid').value = obj.contrast;
 				document.getElementById('saturationid').value = obj.saturation;
@@ -956,6 +975,8 @@ function get_data(val) {
 				document.getElementById("flash_time_value").innerText = obj.flash_time;
 				document.getElementById("aec_value_value").innerText = obj.aec_value;
 				document.getElementById('timelapsid').checked = obj.timelaps;
+				document.getElementById('motion_cadenceid').checked = obj.motion_cadence;
+				document.getElementById('timelaps_aviid').checked = obj.timelaps_avi;
 				$("#status_hmirror").text((obj.hmirror == "true") ? "On" : "Off");
 				$("#status_vflip").text((obj.vflip == "true") ? "On" : "Off");
 				$("#status_lensc").text((obj.lensc == "true") ? "On" : "Off");
@@ -970,6 +991,8 @@ function get_data(val) {
 				$("#status_aec2").text((obj.aec2 == "true") ? "On" : "Off");
 				$("#status_gain_ctrl").text((obj.gain_ctrl == "true") ? "On" : "Off");
 				$("#status_timelaps").text((obj.timelaps == "true") ? "On" : "Off");
+				$("#status_motion_cadence").text((obj.motion_cadence == "true") ? "On" : "Off");
+				$("#status_timelaps_avi").text((obj.timelaps_avi == "true") ? "On" : "Off");
 				sliderCheck();
 			}
 
@@ -40,40 +40,39 @@ void Server_InitWebServer() {
     if (Server_CheckBasicAuth(request) == false)
       return;
 
-    if (SystemCamera.GetCameraCaptureSuccess() == false) {
+    /* the response holds a reference to the frame, a new capture does not overwrite it */
+    CameraFrame_t *frame = SystemCamera.GetPhotoFrame();
+    if ((SystemCamera.GetCameraCaptureSuccess() == false) || (frame == NULL)) {
+      SystemCamera.ReleaseFrame(frame);
       request->send(404, "text/plain", "Photo not found!");
       return;
     }
-    SystemCamera.SetPhotoSending(true);
 
-    SystemLog.AddEvent(LogLevel_Verbose, "Photo size: " + String(SystemCamera.GetPhotoFb()->len) + " bytes");
+    SystemLog.AddEvent(LogLevel_Verbose, "Photo size: " + String(frame->fb->len) + " bytes");
 
-    if (SystemCamera.GetPhotoExifData()->header != NULL) {
+    if (frame->ExifHeader != NULL) {
       /* send photo with exif data */
       SystemLog.AddEvent(LogLevel_Verbose, F("Send photo with EXIF data"));
-      size_t total_len = SystemCamera.GetPhotoExifData()->len + SystemCamera.GetPhotoFb()->len - SystemCamera.GetPhotoExifData()->offset;
-      auto response = request->beginChunkedResponse("image/jpg", [total_len](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
-        size_t len = 0;
-        if (index < SystemCamera.GetPhotoExifData()->len) {
-          len = min(maxLen, SystemCamera.GetPhotoExifData()->len - index);
-          memcpy(buffer, SystemCamera.GetPhotoExifData()->header + index, len);
-        } else {
-          size_t offset = index - SystemCamera.GetPhotoExifData()->len + SystemCamera.GetPhotoExifData()->offset;
-          len = min(maxLen, SystemCamera.GetPhotoFb()->len - offset);
-          memcpy(buffer, SystemCamera.GetPhotoFb()->buf + offset, len);
-        }
-        return len;
-      });
-      response->addHeader("Content-Length", String(total_len));
-      request->send(response);
-
     } else {
       /* send photo without exif data */
       SystemLog.AddEvent(LogLevel_Verbose, F("Send photo without EXIF data"));
-      request->send(200, "image/jpg", SystemCamera.GetPhotoFb()->buf, SystemCamera.GetPhotoFb()->len);
     }
+    request->send(new AsyncFrameResponse(&SystemCamera, frame, "image/jpg"));
+  });
+
+  /* route for the small preview of the last photo */
+  server.on("/thumb.jpg", HTTP_GET, [](AsyncWebServerRequest* request) {
+    SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: get thumbnail"));
+    if (Server_CheckBasicAuth(request) == false)
+      return;
 
-    SystemCamera.SetPhotoSending(false);
+    AsyncResponseStream *response = request->beginResponseStream("image/jpeg");
+    if (false == SystemThumbnail.Write(response)) {
+      delete response;
+      request->send(404, "text/plain", "Photo not found!");
+      return;
+    }
+    request->send(response);
   });
 
   /* route to jquery */
@@ -114,6 +113,168 @@ void Server_InitWebServer_JsonData() {
     request->send(200, F("text/plain"), Server_GetJsonData().c_str());
   });
 
+  /* route for json with camera frame subscribers */
+  server.on("/json_camera", HTTP_GET, [](AsyncWebServerRequest* request) {
+    SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: get json_camera"));
+    if (Server_CheckBasicAuth(request) == false)
+      return;
+
+    JsonDocument doc_json;
+    doc_json["frames_in_use"] = SystemCamera.GetFramesInUse();
+    doc_json["stream"] = SystemCamera.GetStreamStatus();
+    doc_json["photos"] = SystemCamera.GetPhotoCaptureCount();
+    doc_json["photo_stale_discards"] = SystemCamera.GetPhotoStaleDiscards();
+    doc_json["photo_buffer_skips"] = SystemCamera.GetPhotoBufferSkips();
+    doc_json["photo_latency"] = SystemCamera.GetPhotoLatency();
+    doc_json["photo_truncated"] = SystemCamera.GetPhotoTruncatedFrames();
+    doc_json["photo_corrupt"] = SystemCamera.GetPhotoCorruptFrames();
+    doc_json["stream_failed"] = SystemCamera.GetStreamFailedCaptures();
+    doc_json["motion_score"] = SystemCamera.GetMotionScore();
+    doc_json["motion_changes"] = SystemCamera.GetMotionChangeCount();
+    doc_json["motion_time_us"] = SystemCamera.GetMotionAnalysisTime();
+    doc_json["thumb_time_us"] = SystemThumbnail.GetGenerateTime();
+    doc_json["thumb_cache_hits"] = SystemThumbnail.GetCacheHits();
+    doc_json["preevent_frames"] = SystemPreEvent.GetFrameCount();
+    doc_json["preevent_max_frames"] = PREEVENT_MAX_FRAMES;
+    doc_json["preevent_bytes"] = SystemPreEvent.GetUsedBytes();
+    doc_json["preevent_budget"] = SystemPreEvent.GetMemorySize();
+    doc_json["preevent_duration_ms"] = SystemPreEvent.GetDuration();
+    doc_json["preevent_dropped"] = SystemPreEvent.GetDroppedFrames();
+    doc_json["preevent_saved"] = SystemPreEvent.GetDumpCount();
+    JsonArray subscribers = doc_json["subscribers"].to<JsonArray>();
+    for (uint8_t i = 0; i < CAMERA_MAX_SUBSCRIBERS; i++) {
+      CameraSubscriber_t sub;
+      if (SystemCamera.GetSubscriberInfo(i, &sub)) {
+        JsonObject item = subscribers.add<JsonObject>();
+        item["name"] = sub.Name;
+        item["channel"] = (CameraChannel_Stream == sub.Channel) ? "stream" : "photo";
+        item["delivered"] = sub.Delivered;
+        item["dropped"] = sub.Dropped;
+        if (CameraChannel_Stream == sub.Channel) {
+          item["fps"] = sub.Fps;
+          item["kbps"] = sub.Kbps;
+          item["congested"] = sub.Congested;
+        }
+      }
+    }
+    String string_json = "";
+    serializeJson(doc_json, string_json);
+
+    request->send(200, "application/json", string_json);
+  });
+
+  /* route for json with latency histograms of the capture stages */
+  server.on("/json_latency", HTTP_GET, [](AsyncWebServerRequest* request) {
+    SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: get json_latency"));
+    if (Server_CheckBasicAuth(request) == false)
+      return;
+
+    JsonDocument doc_json;
+    doc_json["enabled"] = LATENCY_STATS_ENABLE;
+    for (uint8_t i = 0; i < LatencyStage_Count; i++) {
+      LatencySummary_t summary;
+      if (SystemLatency.GetSummary((LatencyStage_enum)i, &summary)) {
+        JsonObject item = doc_json[SystemLatency.GetStageName((LatencyStage_enum)i)].to<JsonObject>();
+        item["count"] = summary.Count;
+        item["min_us"] = summary.Min;
+        item["p50_us"] = summary.P50;
+        item["p95_us"] = summary.P95;
+        item["max_us"] = summary.Max;
+      }
+    }
+    doc_json["log_queued"] = SystemLog.GetQueued();
+    doc_json["log_dropped"] = SystemLog.GetDropped();
+    doc_json["log_truncated"] = SystemLog.GetTruncated();
+    doc_json["log_queue_max_used"] = SystemLog.GetQueueHighWater();
+    String string_json = "";
+    serializeJson(doc_json, string_json);
+
+    /* the histograms are cleared after reading with the reset parameter */
+    if (request->hasParam("reset")) {
+      SystemLatency.Reset();
+    }
+
+    request->send(200, "application/json", string_json);
+  });
+
+  /* route for json with the statistics of the snapshot sinks */
+  server.on("/json_sinks", HTTP_GET, [](AsyncWebServerRequest* request) {
+    SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: get json_sinks"));
+    if (Server_CheckBasicAuth(request) == false)
+      return;
+
+    JsonDocument doc_json;
+    JsonArray sinks = doc_json["sinks"].to<JsonArray>();
+    for (uint8_t i = 0; i < SnapshotSink_GetCount(); i++) {
+      SnapshotSink *sink = SnapshotSink_Get(i);
+      SnapshotSinkStats_t stats;
+      sink->GetStats(&stats);
+      JsonObject item = sinks.add<JsonObject>();
+      item["name"] = sink->GetName();
+      item["enabled"] = sink->GetEnabled();
+      item["timeout_ms"] = sink->GetTimeout();
+      item["queue"] = sink->GetQueueCount();
+      item["queued"] = stats.Queued;
+      item["delivered"] = stats.Delivered;
+      item["failed"] = stats.Failed;
+      item["dropped"] = stats.Dropped;
+      item["slow"] = stats.Slow;
+      item["last_ms"] = stats.LastTime;
+      item["max_ms"] = stats.MaxTime;
+    }
+    doc_json["http_last_code"] = SinkHttp.GetLastHttpCode();
+    doc_json["mqtt_connected"] = SinkMqtt.GetConnected();
+    doc_json["mqtt_connects"] = SinkMqtt.GetConnects();
+    doc_json["mqtt_status_published"] = SinkMqtt.GetStatusPublished();
+    String string_json = "";
+    serializeJson(doc_json, string_json);
+
+    request->send(200, "application/json", string_json);
+  });
+
+  /* route for json with phase timing of the last uploads to backend */
+  server.on("/json_upload", HTTP_GET, [](AsyncWebServerRequest* request) {
+    SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: get json_upload"));
+    if (Server_CheckBasicAuth(request) == false)
+      return;
+
+    JsonDocument doc_json;
+    doc_json["tls_full_handshakes"] = Connect.GetTlsFullHandshakes();
+    doc_json["tls_resumed_handshakes"] = Connect.GetTlsResumedHandshakes();
+    doc_json["connection_reuses"] = Connect.GetConnectionReuses();
+    doc_json["tls_time_saved_ms"] = Connect.GetTlsTimeSaved();
+    doc_json["circuit_state"] = Connect.GetCircuitStateName();
+    doc_json["circuit_next_attempt_s"] = Connect.GetCircuitNextAttempt();
+    doc_json["spool_count"] = SystemSpool.GetCount();
+    doc_json["spool_bytes"] = SystemSpool.GetBytes();
+    doc_json["spool_spooled"] = SystemSpool.GetSpooled();
+    doc_json["spool_drained"] = SystemSpool.GetDrained();
+    doc_json["spool_drain_rate"] = SystemSpool.GetDrainRate();
+    doc_json["spool_dropped"] = SystemSpool.GetDropped();
+    JsonArray uploads = doc_json["uploads"].to<JsonArray>();
+    UploadTiming_t timing;
+    for (uint8_t i = 0; Connect.GetUploadTiming(i, &timing); i++) {
+      JsonObject item = uploads.add<JsonObject>();
+      item["uptime_ms"] = timing.Time;
+      item["type"] = (SendPhoto == timing.DataType) ? "photo" : ((SendSpoolPhoto == timing.DataType) ? "spool" : "info");
+      item["connection"] = (UploadConnectionReused == timing.Connection) ? "reused" : ((UploadConnectionResumed == timing.Connection) ? "resumed" : "full");
+      item["bytes"] = timing.Bytes;
+      item["sent_bytes"] = timing.SentBytes;
+      item["http_code"] = timing.HttpCode;
+      item["dns_us"] = timing.Dns;
+      item["tcp_us"] = timing.Tcp;
+      item["tls_us"] = timing.Tls;
+      item["header_us"] = timing.Header;
+      item["body_us"] = timing.Body;
+      item["body_kbps"] = (timing.Body > 0) ? (uint32_t)(((uint64_t)timing.SentBytes * 1000000) / timing.Body / 1024) : 0;
+      item["ttfb_us"] = timing.Ttfb;
+      item["total_us"] = timing.Total;
+    }
+    String string_json = "";
+    serializeJson(doc_json, string_json);
+    request->send(200, "application/json", string_json);
+  });
+
   /* route for json with wifi networks */
   server.on("/json_wifi", HTTP_GET, [](AsyncWebServerRequest* request) {
     SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: get json_wifi"));
@@ -443,6 +604,15 @@ void Server_InitWebServer_Actions() {
     request->send(200, "text/plain", "Take Photo");
   });
 
+  /* route for saving the pre-event frames */
+  server.on("/action_preevent", HTTP_GET, [](AsyncWebServerRequest* request) {
+    SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: /action_preevent save pre-event frames"));
+    if (Server_CheckBasicAuth(request) == false)
+      return;
+    SystemPreEvent.Trigger(PreEventTrigger_Http);
+    request->send(200, "text/plain", "Save pre-event frames");
+  });
+
   /* route for send photo to prusa backend */
   server.on("/action_send", HTTP_GET, [](AsyncWebServerRequest* request) {
     SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: /action_send send photo to cloud"));
@@ -517,6 +687,7 @@ void Server_InitWebServer_Actions() {
       return;
     request->send(200, F("text/html"), MSG_REBOOT_MCU);
     delay(100); /* wait for sending data */
+    SystemLog.Flush();
     ESP.restart();
   });
 
@@ -600,6 +771,23 @@ void Server_InitWebServer_Sets() {
       response = true;
     }
 
+    /* set stream frame size */
+    if (request->hasParam("stream_framesize")) {
+      SystemLog.AddEvent(LogLevel_Verbose, F("Set stream_framesize"));
+      SystemCamera.SetStreamFrameSize(request->getParam("stream_framesize")->value().toInt());
+      response_msg = MSG_SAVE_OK;
+      response = true;
+    }
+
+    /* set stream quality */
+    if (request->hasParam("stream_quality")) {
+      SystemLog.AddEvent(LogLevel_Verbose, F("Set stream_quality"));
+      uint8_t value = request->getParam("stream_quality")->value().toInt();
+      SystemCamera.SetStreamQuality((CAMERA_STREAM_SAME_AS_PHOTO == value) ? CAMERA_STREAM_SAME_AS_PHOTO : (73 - value));
+      response_msg = MSG_SAVE_OK;
+      response = true;
+    }
+
     /* set flash time */
     if (request->hasParam("flash_time")) {
       SystemLog.AddEvent(LogLevel_Verbose, F("Set flash_time"));
@@ -785,6 +973,13 @@ void Server_InitWebServer_Sets() {
       response = true;
     }
 
+    /* set motion cadence */
+    if (request->hasParam("motion_cadence")) {
+      SystemLog.AddEvent(LogLevel_Verbose, F("Set motion cadence"));
+      SystemCamera.SetMotionCadence(Server_TransfeStringToBool(request->getParam("motion_cadence")->value()));
+      response = true;
+    }
+
     /* set timelaps enable */
     if (request->hasParam("timelaps_enable")) {
       SystemLog.AddEvent(LogLevel_Verbose, F("Set timelaps enable"));
@@ -801,6 +996,13 @@ void Server_InitWebServer_Sets() {
       response = true;
     }
 
+    /* set timelaps AVI format */
+    if (request->hasParam("timelaps_avi")) {
+      SystemLog.AddEvent(LogLevel_Verbose, F("Set timelaps AVI format"));
+      Connect.SetTimeLapsAviStatus(Server_TransfeStringToBool(request->getParam("timelaps_avi")->value()));
+      response = true;
+    }
+
     /* set external temperature sensor enable */
     if (request->hasParam("extsens_enable")) {
       SystemLog.AddEvent(LogLevel_Verbose, F("Set enable ext temperature"));
@@ -837,6 +1039,64 @@ void Server_InitWebServer_Sets() {
     }
   });
 
+  /* route for set local HTTP target /set_sink_http?url=http://192.168.0.10:8123/api/webhook/cam&method=post */
+  server.on("/set_sink_http", HTTP_GET, [](AsyncWebServerRequest* request) {
+    SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: /set_sink_http"));
+    if (Server_CheckBasicAuth(request) == false)
+      return;
+    request->send(200, F("text/html"), MSG_SAVE_OK);
+
+    if (request->hasParam("url")) {
+      SinkHttp.SetUrl(request->getParam("url")->value());
+    }
+
+    if (request->hasParam("method")) {
+      String method = request->getParam("method")->value();
+      method.toLowerCase();
+      SinkHttp.SetMethod((method == "put") ? SinkHttpPut : ((method == "post") ? SinkHttpPost : SinkHttpDisabled));
+    }
+  });
+
+  /* route for set MQTT client /set_mqtt?enable=true&host=192.168.0.10&port=1883&user=cam&pass=secret&topic=&snapshot=true&qos=1 */
+  server.on("/set_mqtt", HTTP_GET, [](AsyncWebServerRequest* request) {
+    SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: /set_mqtt"));
+    if (Server_CheckBasicAuth(request) == false)
+      return;
+    request->send(200, F("text/html"), MSG_SAVE_OK);
+
+    if (request->hasParam("host")) {
+      SinkMqtt.SetHost(request->getParam("host")->value());
+    }
+
+    if (request->hasParam("port")) {
+      SinkMqtt.SetPort(request->getParam("port")->value().toInt());
+    }
+
+    if (request->hasParam("user")) {
+      SinkMqtt.SetUser(request->getParam("user")->value());
+    }
+
+    if (request->hasParam("pass")) {
+      SinkMqtt.SetPassword(request->getParam("pass")->value());
+    }
+
+    if (request->hasParam("topic")) {
+      SinkMqtt.SetTopic(request->getParam("topic")->value());
+    }
+
+    if (request->hasParam("snapshot")) {
+      SinkMqtt.SetSnapshot(Server_TransfeStringToBool(request->getParam("snapshot")->value()));
+    }
+
+    if (request->hasParam("qos")) {
+      SinkMqtt.SetQos(request->getParam("qos")->value().toInt());
+    }
+
+    if (request->hasParam("enable")) {
+      SinkMqtt.SetEnable(Server_TransfeStringToBool(request->getParam("enable")->value()));
+    }
+  });
+
   /* route for set WI-FI credentials */
   server.on("/wifi_cfg", HTTP_GET, [](AsyncWebServerRequest* request) {
     SystemLog.AddEvent(LogLevel_Verbose, F("WEB server: set WI-FI credentials"));
@@ -1185,8 +1445,11 @@ String Server_GetJsonData() {
   doc_json["token"] = Connect.GetToken();
   doc_json["fingerprint"] = Connect.GetFingerprint();
   doc_json["refreshInterval"] = String(Connect.GetRefreshInterval());
+  doc_json["motion_cadence"] = Server_TranslateBoolToString(SystemCamera.GetMotionCadence());
   doc_json["photoquality"] = String(73 - SystemCamera.GetPhotoQuality());
   doc_json["framesize"] = String(SystemCamera.GetFrameSize());
+  doc_json["stream_framesize"] = String(SystemCamera.GetStreamFrameSize());
+  doc_json["stream_quality"] = String((CAMERA_STREAM_SAME_AS_PHOTO == SystemCamera.GetStreamQuality()) ? CAMERA_STREAM_SAME_AS_PHOTO : (73 - SystemCamera.GetStreamQuality()));
   doc_json["brightness"] = String(SystemCamera.GetBrightness());
   doc_json["contrast"] = String(SystemCamera.GetContrast());
   doc_json["saturation"] = String(SystemCamera.GetSaturation());
@@ -1221,6 +1484,19 @@ String Server_GetJsonData() {
   doc_json["auth"] = Server_TranslateBoolToString(WebBasicAuth.EnableAuth);
   doc_json["auth_username"] = WebBasicAuth.UserName;
   doc_json["last_upload_status"] = Connect.GetBackendReceivedStatus();
+  doc_json["circuit_state"] = Connect.GetCircuitStateName();
+  doc_json["circuit_http_code"] = Connect.GetCircuitHttpCode();
+  doc_json["circuit_next_attempt"] = Connect.GetCircuitNextAttempt();
+  doc_json["sink_http_url"] = SinkHttp.GetUrl();
+  doc_json["sink_http_method"] = (SinkHttpPut == SinkHttp.GetMethod()) ? "put" : ((SinkHttpPost == SinkHttp.GetMethod()) ? "post" : "disabled");
+  doc_json["mqtt_enable"] = SinkMqtt.GetEnable();
+  doc_json["mqtt_host"] = SinkMqtt.GetHost();
+  doc_json["mqtt_port"] = SinkMqtt.GetPort();
+  doc_json["mqtt_user"] = SinkMqtt.GetUser();
+  doc_json["mqtt_topic"] = SinkMqtt.GetTopic();
+  doc_json["mqtt_snapshot"] = SinkMqtt.GetSnapshot();
+  doc_json["mqtt_qos"] = SinkMqtt.GetQos();
+  doc_json["mqtt_connected"] = SinkMqtt.GetConnected();
   doc_json["wifi_network_status"] = SystemWifiMngt.GetStaStatus();
   doc_json["log_level"] = String(SystemLog.GetLogLevel());
   doc_json["uptime"] = uptime;
@@ -1233,6 +1509,7 @@ String Server_GetJsonData() {
   doc_json["net_dns"] = SystemWifiMngt.GetNetStaticDns();
   doc_json["image_rotation"] = SystemCamera.GetCameraImageRotation();
   doc_json["timelaps"] = Server_TranslateBoolToString(Connect.GetTimeLapsPhotoSaveStatus());
+  doc_json["timelaps_avi"] = Server_TranslateBoolToString(Connect.GetTimeLapsAviStatus());
   doc_json["sd_status"] = (SystemLog.GetCardDetectedStatus() == true) ? F("Card detected") : F("No card detected");
   doc_json["sd_total"] = SystemLog.GetCardSizeMB();
   doc_json["sd_free_p"] = SystemLog.GetFreeSpacePercent();
@@ -1273,7 +1550,24 @@ bool Server_CheckBasicAuth(AsyncWebServerRequest* request) {
    @return void
 */
 void Server_streamJpg(AsyncWebServerRequest* request) {
-  AsyncJpegStreamResponse* response = new AsyncJpegStreamResponse(&SystemCamera, &SystemLog);
+  /* all clients share one captured frame, the count of clients is limited by frame buffers */
+  if (SystemCamera.GetStreamClients() >= STREAM_MAX_CLIENTS) {
+    SystemLog.AddEvent(LogLevel_Warning, F("Stream client limit reached: "), String(STREAM_MAX_CLIENTS));
+    request->send(503, "text/plain", "Stream client limit reached");
+    return;
+  }
+
+  /* optional caps of the client, /stream.mjpg?fps=5&maxkbps=800 */
+  uint8_t MaxFps = 0;
+  uint16_t MaxKbps = 0;
+  if (request->hasParam("fps")) {
+    MaxFps = constrain(request->getParam("fps")->value().toInt(), 0, UINT8_MAX);
+  }
+  if (request->hasParam("maxkbps")) {
+    MaxKbps = constrain(request->getParam("maxkbps")->value().toInt(), 0, UINT16_MAX);
+  }
+
+  AsyncJpegStreamResponse* response = new AsyncJpegStreamResponse(&SystemCamera, &SystemLog, MaxFps, MaxKbps);
   if (!response) {
     request->send(501);
     return;
@@ -31,7 +31,9 @@
 #include "connect.h"
 #include "wifi_mngt.h"
 #include "WebStream.h"
+#include "thumbnail.h"
 #include "ExternalTemperatureSensor.h"
+#include "mqtt.h"
 
 extern AsyncWebServer server;  ///< global variable for web server
 
@@ -12,11 +12,10 @@
 */
 #include "WebStream.h"
 
-#define PART_BOUNDARY "123456789000000000000987654321"                                          ///< Must be unique for each stream
 static const char *STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;   ///< content type for stream
-static const char *STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";                             ///< boundary for stream
-static const char *STREAM_PART = "Content-Type: %s\r\nContent-Length: %u\r\n\r\n";              ///< part for stream
-static const char *JPG_CONTENT_TYPE = "image/jpeg";                                           ///< content type for jpg
+
+AsyncJpegStreamResponse *AsyncJpegStreamResponse::Responses[STREAM_MAX_CLIENTS] = { NULL };
+SemaphoreHandle_t AsyncJpegStreamResponse::StreamMutex = xSemaphoreCreateRecursiveMutex();
 
 /**
  * @brief Construct a new Async Buffer Response:: Async Buffer Response object
@@ -89,16 +88,19 @@ size_t AsyncBufferResponse::_content(uint8_t *buffer, size_t maxLen, size_t inde
 /**
  * @brief Construct a new Async Frame Response:: Async Frame Response object
  * 
- * @param frame 
+ * @param i_cam 
+ * @param i_frame - frame with a reference for the response
  * @param contentType 
  */
-AsyncFrameResponse::AsyncFrameResponse(camera_fb_t *frame, const char *contentType) {
+AsyncFrameResponse::AsyncFrameResponse(Camera *i_cam, CameraFrame_t *i_frame, const char *contentType) {
   _callback = nullptr;
   _code = 200;
-  _contentLength = frame->len;
+  CameraFrame_GetView(i_frame, &view);
+  _contentLength = view.Len;
   _contentType = contentType;
   _index = 0;
-  fb = frame;
+  camera = i_cam;
+  frame = i_frame;
 }
 
 /**
@@ -106,8 +108,8 @@ AsyncFrameResponse::AsyncFrameResponse(camera_fb_t *frame, const char *contentTy
  * 
  */
 AsyncFrameResponse::~AsyncFrameResponse() {
-  if (fb != nullptr) {
-    esp_camera_fb_return(fb);
+  if (frame != nullptr) {
+    camera->ReleaseFrame(frame);
   }
 }
 
@@ -117,7 +119,7 @@ AsyncFrameResponse::~AsyncFrameResponse() {
  * @return bool
  */
 bool AsyncFrameResponse::_sourceValid() const {
-  return fb != nullptr;
+  return frame != nullptr;
 }
 
 /**
@@ -144,12 +146,12 @@ size_t AsyncFrameResponse::_fillBuffer(uint8_t *buf, size_t maxLen) {
  * @return size_t 
  */
 size_t AsyncFrameResponse::_content(uint8_t *buffer, size_t maxLen, size_t index) {
-  memcpy(buffer, fb->buf + index, maxLen);
-  if ((index + maxLen) == fb->len) {
-    esp_camera_fb_return(fb);
-    fb = nullptr;
+  size_t len = CameraFrame_CopyView(&view, buffer, index, maxLen);
+  if ((index + len) == _contentLength) {
+    camera->ReleaseFrame(frame);
+    frame = nullptr;
   }
-  return maxLen;
+  return len;
 }
 
 /**
@@ -157,8 +159,10 @@ size_t AsyncFrameResponse::_content(uint8_t *buffer, size_t maxLen, size_t index
  * 
  * @param i_cam 
  * @param i_log 
+ * @param i_MaxFps - frame rate cap, 0 = no cap
+ * @param i_MaxKbps - throughput cap [kbit/s], 0 = no cap
  */
-AsyncJpegStreamResponse::AsyncJpegStreamResponse(Camera *i_cam, Logs *i_log) {
+AsyncJpegStreamResponse::AsyncJpegStreamResponse(Camera *i_cam, Logs *i_log, uint8_t i_MaxFps, uint16_t i_MaxKbps) {
   _callback = nullptr;
   _code = 200;
   _contentLength = 0;
@@ -166,11 +170,22 @@ AsyncJpegStreamResponse::AsyncJpegStreamResponse(Camera *i_cam, Logs *i_log) {
   _sendContentLength = false;
   _chunked = true;
   _index = 0;
+  Request = NULL;
+  Stalled = false;
   lastAsyncRequest = 0;
   memset(&_frame, 0, sizeof(camera_frame_t));
+  PartHeaderLen = 0;
+  MaxFps = i_MaxFps;
+  MaxKbps = i_MaxKbps;
+  FrameStart = 0;
+  /* the cap check compares the time difference as signed, 0 would block the first frame while micros() >= 2^31 */
+  NextFrameTime = micros();
+  SendTime = 0;
+  Fps = 0.0;
+  Kbps = 0;
   camera = i_cam;
   log = i_log;
-  camera->SetStreamStatus(true);
+  SubscriberId = camera->Subscribe(CameraChannel_Stream, "Stream");
 }
 
 /**
@@ -178,8 +193,17 @@ AsyncJpegStreamResponse::AsyncJpegStreamResponse(Camera *i_cam, Logs *i_log) {
  * 
  */
 AsyncJpegStreamResponse::~AsyncJpegStreamResponse() {
-  camera->SetStreamStatus(false);
-  camera->CaptureReturnFrameBuffer();
+  /* the capture task can not resume the response after this point */
+  xSemaphoreTakeRecursive(StreamMutex, portMAX_DELAY);
+  for (uint8_t i = 0; i < STREAM_MAX_CLIENTS; i++) {
+    if (this == Responses[i]) {
+      Responses[i] = NULL;
+    }
+  }
+  xSemaphoreGiveRecursive(StreamMutex);
+
+  camera->ReleaseFrame(_frame.frame);
+  camera->Unsubscribe(SubscriberId);
 }
 
 /**
@@ -191,6 +215,67 @@ bool AsyncJpegStreamResponse::_sourceValid() const {
   return true;
 }
 
+/**
+ * @brief Start the response. The response is added to the list of responses resumed by the capture task
+ * 
+ * @param request 
+ */
+void AsyncJpegStreamResponse::_respond(AsyncWebServerRequest *request) {
+  xSemaphoreTakeRecursive(StreamMutex, portMAX_DELAY);
+  Request = request;
+  for (uint8_t i = 0; i < STREAM_MAX_CLIENTS; i++) {
+    if ((SubscriberId >= 0) && (NULL == Responses[i])) {
+      Responses[i] = this;
+      break;
+    }
+  }
+  xSemaphoreGiveRecursive(StreamMutex);
+
+  AsyncAbstractResponse::_respond(request);
+}
+
+/**
+ * @brief Send the next data after ack or poll. The stream data is sent by the async TCP task
+ *        or by the capture task, the mutex keeps one sender at a time
+ * 
+ * @param request 
+ * @param len - count of acked bytes
+ * @param time 
+ * @return size_t 
+ */
+size_t AsyncJpegStreamResponse::_ack(AsyncWebServerRequest *request, size_t len, uint32_t time) {
+  size_t ret = 0;
+
+  xSemaphoreTakeRecursive(StreamMutex, portMAX_DELAY);
+  ret = AsyncAbstractResponse::_ack(request, len, time);
+  xSemaphoreGiveRecursive(StreamMutex);
+
+  return ret;
+}
+
+/**
+ * @brief Resume responses stalled without a new frame. Called by the capture task after the stream frame is published.
+ *        Without resume, the async TCP task asks the stalled response again only on the next poll, every 500 ms
+ * 
+ * @return none
+ */
+void AsyncJpegStreamResponse::ResumeStalled() {
+  xSemaphoreTakeRecursive(StreamMutex, portMAX_DELAY);
+  for (uint8_t i = 0; i < STREAM_MAX_CLIENTS; i++) {
+    AsyncJpegStreamResponse *response = Responses[i];
+    if ((NULL == response) || (false == response->Stalled) || (NULL == response->Request)) {
+      continue;
+    }
+
+    /* same as the poll of the async TCP task */
+    AsyncClient *client = response->Request->client();
+    if ((NULL != client) && (client->canSend())) {
+      response->AsyncAbstractResponse::_ack(response->Request, 0, 0);
+    }
+  }
+  xSemaphoreGiveRecursive(StreamMutex);
+}
+
 /**
  * @brief Fill buffer
  * 
@@ -207,7 +292,57 @@ size_t AsyncJpegStreamResponse::_fillBuffer(uint8_t *buf, size_t maxLen) {
 }
 
 /**
- * @brief Content - get picture from camera and send it to client
+ * @brief Build part header for the frame from the templates. Boundary is sent before every frame except the first one
+ * 
+ * @param i_boundary - true = send boundary before the part header
+ * @return none
+ */
+void AsyncJpegStreamResponse::PreparePartHeader(bool i_boundary) {
+  PartHeaderLen = StreamPart_PrepareHeader(PartHeader, i_boundary, _frame.view.Len);
+}
+
+/**
+ * @brief Update rate of the client after the frame is sent. The send time of the frame is the link capacity,
+ *        the client caps set the earliest time for the next frame. Frames published in the meantime are skipped
+ * 
+ * @return none
+ */
+void AsyncJpegStreamResponse::UpdateRate() {
+  uint32_t end = micros();
+  uint32_t FrameBytes = PartHeaderLen + _frame.view.Len;
+  uint32_t FrameTime = (end - FrameStart) / 1000;
+  uint32_t interval = 0;
+
+  if (0 == FrameTime) {
+    FrameTime = 1;
+  }
+  SendTime = (0 == SendTime) ? FrameTime : ((SendTime + FrameTime) / 2);
+  Kbps = (Kbps + min((FrameBytes * 8) / FrameTime, (uint32_t)UINT16_MAX)) / 2;
+
+  if (0 != lastAsyncRequest) {
+    float fps = 1000000.0 / (end - (uint32_t)lastAsyncRequest);
+    Fps = (0.0 == Fps) ? fps : ((Fps + fps) / 2.0);
+    camera->StreamSetFrameFps(fps);
+  }
+  camera->StreamSetFrameSize(_frame.view.Len / 1024);
+  camera->SetSubscriberRate(SubscriberId, Fps, Kbps, (SendTime > STREAM_CONGESTED_FRAME_TIME));
+  lastAsyncRequest = end;
+
+  /* lower target frame rate by the client caps */
+  if (0 != MaxFps) {
+    interval = 1000000 / MaxFps;
+  }
+  if (0 != MaxKbps) {
+    interval = max(interval, (uint32_t)((FrameBytes * 8000) / MaxKbps));
+  }
+  NextFrameTime = FrameStart + interval;
+}
+
+/**
+ * @brief Content - send frames published by the capture task to the client.
+ *        The function runs in the async TCP task, or in the capture task when the stalled response is resumed.
+ *        It never blocks and never writes to the console. Part header and frame are sent as one sequence,
+ *        the chunk can end anywhere in it
  * 
  * @param buffer 
  * @param maxLen 
@@ -215,76 +350,56 @@ size_t AsyncJpegStreamResponse::_fillBuffer(uint8_t *buf, size_t maxLen) {
  * @return size_t 
  */
 size_t AsyncJpegStreamResponse::_content(uint8_t *buffer, size_t maxLen, size_t index) {
+  size_t len = 0;
 
-  if (!_frame.fb || _frame.index == _frame.fb->len) {
-    delay(1);
-
-    if (index && _frame.fb) {
-      uint64_t end = (uint64_t)micros();
-      int fp = (end - lastAsyncRequest) / 1000;
-      float fps = 1000.0 / fp;
-      char buf[50] = { '\0' };
-      camera->StreamSetFrameSize(_frame.fb->len / 1024);
-      camera->StreamSetFrameFps(fps);
-      ////sprintf(buf, "Size: %uKB, Time: %ums (%.1f fps)", _frame.fb->len / 1024, fp, fps);
-      sprintf(buf, "Size: %uKB, FPS: %.1f", _frame.fb->len / 1024, fps);
-      Serial.println(buf);
-      lastAsyncRequest = end;
-      camera->CaptureReturnFrameBuffer();
-      _frame.fb = NULL;
-    }
-
-    /* check space for headers */
-    if (maxLen < (strlen(STREAM_BOUNDARY) + strlen(STREAM_PART) + strlen(JPG_CONTENT_TYPE) + 8)) {
-      log->AddEvent(LogLevel_Error, F("Stream Not space for headers"));
-      return RESPONSE_TRY_AGAIN;
+  if ((NULL == _frame.frame) || (_frame.index == (PartHeaderLen + _frame.view.Len))) {
+    if (NULL != _frame.frame) {
+      UpdateRate();
+      camera->ReleaseFrame(_frame.frame);
+      _frame.frame = NULL;
     }
 
-    /* get frame */
-    _frame.index = 0;
-    camera->CaptureStream(&_dframe);
-    _frame.fb = &_dframe;
-
-    if (_frame.fb == NULL) {
-      log->AddEvent(LogLevel_Error, F("Stream capture frame failed"));
+    if (SubscriberId < 0) {
+      log->AddEvent(LogLevel_Error, F("Stream without camera subscription"));
       return 0;
     }
 
-    /* send boundary */
-    size_t blen = 0;
-    if (index) {
-      blen = strlen(STREAM_BOUNDARY);
-      memcpy(buffer, STREAM_BOUNDARY, blen);
-      buffer += blen;
+    /* the client caps are not reached yet, skip frames. The capture task resumes the response with the next frame */
+    if ((int32_t)(micros() - NextFrameTime) < 0) {
+      Stalled = true;
+      return RESPONSE_TRY_AGAIN;
     }
 
-    /* send header */
-    size_t hlen = sprintf((char *)buffer, STREAM_PART, JPG_CONTENT_TYPE, _frame.fb->len);
-    buffer += hlen;
-
-    /* send frame */
-    hlen = maxLen - hlen - blen;
-    if (hlen > _frame.fb->len) {
-      maxLen -= hlen - _frame.fb->len;
-      hlen = _frame.fb->len;
+    /* get frame published by the capture task */
+    _frame.frame = camera->GetSubscriberFrame(SubscriberId, true);
+    if (NULL == _frame.frame) {
+      Stalled = true;
+      return RESPONSE_TRY_AGAIN;
     }
 
-    memcpy(buffer, _frame.fb->buf, hlen);
-    _frame.index += hlen;
-    delay(1);
-    return maxLen;
+    Stalled = false;
+    _frame.index = 0;
+    FrameStart = micros();
+    CameraFrame_GetView(_frame.frame, &_frame.view);
+    PreparePartHeader(0 != index);
   }
 
-  /* check next send data */
-  size_t available = _frame.fb->len - _frame.index;
-  if (maxLen > available) {
-    maxLen = available;
+  /* send rest of the part header */
+  if (_frame.index < PartHeaderLen) {
+    len = min(maxLen, PartHeaderLen - _frame.index);
+    memcpy(buffer, PartHeader + _frame.index, len);
+    _frame.index += len;
   }
 
-  delay(1);
-  memcpy(buffer, _frame.fb->buf + _frame.index, maxLen);
-  _frame.index += maxLen;
-  return maxLen;
+  /* send frame */
+  if (len < maxLen) {
+    size_t flen = CameraFrame_CopyView(&_frame.view, buffer + len, _frame.index - PartHeaderLen, maxLen - len);
+    _frame.index += flen;
+    len += flen;
+  }
+
+  camera->StreamAddSentBytes(len);
+  return len;
 }
 
 /* EOF */
\ No newline at end of file
@@ -23,13 +23,15 @@
 #include "var.h"
 #include "log.h"
 #include "camera.h"
+#include "stream_part.h"
 
 class Camera;
 
 typedef struct {
-  camera_fb_t *fb;  ///< pointer to frame buffer
-  size_t index;     ///< index of frame
-} camera_frame_t;   ///< camera frame structure
+  CameraFrame_t *frame;   ///< pointer to shared camera frame
+  CameraFrameView_t view; ///< segmented view of the frame, exif header and jpeg data
+  size_t index;           ///< index of frame, part header and frame data
+} camera_frame_t;         ///< camera frame structure
 
 class AsyncBufferResponse : public AsyncAbstractResponse {
 private:
@@ -47,11 +49,13 @@ public:
 
 class AsyncFrameResponse : public AsyncAbstractResponse {
 private:
-  camera_fb_t *fb;    ///< pointer to frame buffer
-  size_t _index;      ///< index of frame 
+  CameraFrame_t *frame;   ///< pointer to shared camera frame
+  CameraFrameView_t view; ///< segmented view of the frame
+  Camera *camera;         ///< pointer to camera
+  size_t _index;          ///< index of frame 
 
 public:
-  AsyncFrameResponse(camera_fb_t *, const char *);
+  AsyncFrameResponse(Camera *, CameraFrame_t *, const char *);
   ~AsyncFrameResponse();
   bool _sourceValid() const;
   virtual size_t _fillBuffer(uint8_t *, size_t) override;
@@ -60,19 +64,39 @@ public:
 
 class AsyncJpegStreamResponse : public AsyncAbstractResponse {
 private:
+  static AsyncJpegStreamResponse *Responses[STREAM_MAX_CLIENTS];  ///< stream responses resumed by the capture task
+  static SemaphoreHandle_t StreamMutex;                           ///< recursive mutex for the list of responses and for sending of the stream data
+  AsyncWebServerRequest *Request;  ///< request of the response, used for resume from the capture task
+  volatile bool Stalled;      ///< no frame was ready, the response waits for the next published frame
   camera_frame_t _frame;      ///< camera frame
   size_t _index;              ///< index of frame
   uint64_t lastAsyncRequest;  ///< last async request
   Camera *camera;             ///< pointer to camera
   Logs *log;                  ///< pointer to logs
-  camera_fb_t _dframe;        ///< camera frame
+  int8_t SubscriberId;        ///< camera subscriber id
+  uint8_t MaxFps;             ///< frame rate cap of the client, 0 = no cap
+  uint16_t MaxKbps;           ///< throughput cap of the client [kbit/s], 0 = no cap
+  uint32_t FrameStart;        ///< time of the first byte of the current frame [us]
+  uint32_t NextFrameTime;     ///< earliest time for the next frame by the client caps [us]
+  uint32_t SendTime;          ///< average send time of one frame [ms]
+  float Fps;                  ///< average effective frame rate of the client
+  uint16_t Kbps;              ///< average send throughput of the client [kbit/s]
+  char PartHeader[STREAM_PART_HEADER_SIZE];  ///< boundary and part header of the current frame
+  size_t PartHeaderLen;       ///< part header length
+
+  void PreparePartHeader(bool);
+  void UpdateRate();
 
 public:
-  AsyncJpegStreamResponse(Camera *, Logs *);
+  AsyncJpegStreamResponse(Camera *, Logs *, uint8_t, uint16_t);
   ~AsyncJpegStreamResponse();
   bool _sourceValid() const;
+  virtual void _respond(AsyncWebServerRequest *) override;
+  virtual size_t _ack(AsyncWebServerRequest *, size_t, uint32_t) override;
   virtual size_t _fillBuffer(uint8_t *, size_t ) override;
   size_t _content(uint8_t *, size_t , size_t );
+
+  static void ResumeStalled();
 };
 
 /* EOF */
\ No newline at end of file
@@ -0,0 +1,480 @@
+/**
+   @file avi_writer.cpp
+
+   @brief Library for writing MJPEG AVI file incrementally to the SD card
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "avi_writer.h"
+
+/**
+   @brief Constructor for AviWriter class
+   @param none
+   @return none
+*/
+AviWriter::AviWriter() {
+  Fs = NULL;
+  IndexBuffered = 0;
+  FrameCount = 0;
+  WritePos = 0;
+  MaxFrameSize = 0;
+  Width = 0;
+  Height = 0;
+  Opened = false;
+}
+
+/**
+   @brief Open AVI file. A new file is created with the frame size. An existing file
+          with the sidecar file was not closed, it is recovered and the frames are appended
+   @param fs::FS & - file system
+   @param String - AVI file path
+   @param uint16_t - frame width, not used for the existing file
+   @param uint16_t - frame height, not used for the existing file
+   @return bool - true = file is opened
+*/
+bool AviWriter::Open(fs::FS &i_fs, String i_path, uint16_t i_width, uint16_t i_height) {
+  if (true == Opened) {
+    return false;
+  }
+
+  Fs = &i_fs;
+  Path = i_path;
+  IndexPath = i_path + TIMELAPS_AVI_INDEX_SUFFIX;
+  IndexBuffered = 0;
+  FrameCount = 0;
+  MaxFrameSize = 0;
+
+  if (true == Fs->exists(Path)) {
+    /* the closed file has no sidecar file, the frames can not be appended */
+    if (false == Fs->exists(IndexPath)) {
+      return false;
+    }
+
+    AviFile = Fs->open(Path, "r+");
+    if (!AviFile) {
+      return false;
+    }
+
+    if (false == Recover()) {
+      AviFile.close();
+      IndexFile.close();
+      return false;
+    }
+
+  } else {
+    AviFile = Fs->open(Path, "w+");
+    IndexFile = Fs->open(IndexPath, FILE_WRITE);
+    if ((!AviFile) || (!IndexFile)) {
+      AviFile.close();
+      IndexFile.close();
+      return false;
+    }
+
+    Width = i_width;
+    Height = i_height;
+    WriteHeader();
+    WritePos = AVI_HEADER_SIZE;
+  }
+
+  Opened = true;
+  return true;
+}
+
+/**
+   @brief Append frame as 00dc chunk. The index is flushed to the sidecar file periodically
+   @param const CameraFrameView_t * - segmented frame
+   @return bool - true = frame is written
+*/
+bool AviWriter::AddFrame(const CameraFrameView_t *i_frame) {
+  uint8_t header[AVI_CHUNK_HEADER_SIZE];
+  size_t written = 0;
+
+  if ((false == Opened) || (0 == i_frame->Len)) {
+    return false;
+  }
+
+  memcpy(header, "00dc", 4);
+  PutUint32(&header[4], i_frame->Len);
+
+  AviFile.seek(WritePos);
+  written += AviFile.write(header, sizeof(header));
+  for (uint8_t i = 0; i < i_frame->Count; i++) {
+    written += AviFile.write(i_frame->Segment[i].ptr, i_frame->Segment[i].len);
+  }
+
+  /* chunks are aligned to the word */
+  if (i_frame->Len & 1) {
+    uint8_t pad = 0;
+    written += AviFile.write(&pad, 1);
+  }
+
+  if (written != (sizeof(header) + i_frame->Len + (i_frame->Len & 1))) {
+    return false;
+  }
+
+  AddIndexEntry(WritePos - AVI_MOVI_OFFSET, i_frame->Len);
+  WritePos += written;
+  MaxFrameSize = max(MaxFrameSize, (uint32_t)i_frame->Len);
+
+  if (IndexBuffered >= TIMELAPS_AVI_INDEX_FLUSH) {
+    return FlushIndex();
+  }
+
+  return true;
+}
+
+/**
+   @brief Finalize the file. The sidecar index is copied to the idx1 chunk and the header is updated
+   @param none
+   @return bool - true = file is finalized
+*/
+bool AviWriter::Close() {
+  bool ret = false;
+  uint8_t header[AVI_CHUNK_HEADER_SIZE];
+
+  if (false == Opened) {
+    return false;
+  }
+
+  if (true == FlushIndex()) {
+    IndexFile.close();
+    IndexFile = Fs->open(IndexPath, FILE_READ);
+
+    memcpy(header, "idx1", 4);
+    PutUint32(&header[4], FrameCount * AVI_INDEX_ENTRY_SIZE);
+    AviFile.seek(WritePos);
+    size_t written = AviFile.write(header, sizeof(header));
+
+    /* the index buffer is empty after the flush, it is used for the copy */
+    while (IndexFile.available() > 0) {
+      size_t len = IndexFile.read(IndexBuffer, sizeof(IndexBuffer));
+      if (0 == len) {
+        break;
+      }
+      written += AviFile.write(IndexBuffer, len);
+    }
+
+    if ((written == (sizeof(header) + (FrameCount * AVI_INDEX_ENTRY_SIZE))) && (true == UpdateHeader(WritePos + written))) {
+      ret = true;
+    }
+  }
+
+  AviFile.close();
+  IndexFile.close();
+
+  /* the sidecar file is kept for the recovery, when the index was not written */
+  if (true == ret) {
+    Fs->remove(IndexPath);
+  }
+
+  Opened = false;
+  return ret;
+}
+
+/**
+   @brief Write the RIFF, hdrl and movi headers. The counters are updated later
+   @param none
+   @return none
+*/
+void AviWriter::WriteHeader() {
+  uint8_t h[AVI_HEADER_SIZE];
+  memset(h, 0, sizeof(h));
+
+  /* RIFF AVI */
+  memcpy(&h[0], "RIFF", 4);
+  memcpy(&h[8], "AVI ", 4);
+
+  /* LIST hdrl */
+  memcpy(&h[12], "LIST", 4);
+  PutUint32(&h[16], 192);
+  memcpy(&h[20], "hdrl", 4);
+
+  /* avih */
+  memcpy(&h[24], "avih", 4);
+  PutUint32(&h[28], 56);
+  PutUint32(&h[32], 1000000 / TIMELAPS_AVI_FPS);  /* microseconds per frame */
+  PutUint32(&h[44], 0x10);                        /* AVIF_HASINDEX */
+  PutUint32(&h[56], 1);                           /* streams */
+  PutUint32(&h[64], Width);
+  PutUint32(&h[68], Height);
+
+  /* LIST strl */
+  memcpy(&h[88], "LIST", 4);
+  PutUint32(&h[92], 116);
+  memcpy(&h[96], "strl", 4);
+
+  /* strh */
+  memcpy(&h[100], "strh", 4);
+  PutUint32(&h[104], 56);
+  memcpy(&h[108], "vids", 4);
+  memcpy(&h[112], "MJPG", 4);
+  PutUint32(&h[128], 1);                          /* scale */
+  PutUint32(&h[132], TIMELAPS_AVI_FPS);           /* rate */
+  PutUint16(&h[160], Width);
+  PutUint16(&h[162], Height);
+
+  /* strf, BITMAPINFOHEADER */
+  memcpy(&h[164], "strf", 4);
+  PutUint32(&h[168], 40);
+  PutUint32(&h[172], 40);
+  PutUint32(&h[176], Width);
+  PutUint32(&h[180], Height);
+  PutUint16(&h[184], 1);                          /* planes */
+  PutUint16(&h[186], 24);                         /* bit count */
+  memcpy(&h[188], "MJPG", 4);
+  PutUint32(&h[192], (uint32_t)Width * Height * 3);
+
+  /* LIST movi */
+  memcpy(&h[212], "LIST", 4);
+  PutUint32(&h[216], 4);
+  memcpy(&h[220], "movi", 4);
+
+  AviFile.seek(0);
+  AviFile.write(h, sizeof(h));
+}
+
+/**
+   @brief Update counters in the header. The file is playable without idx1 after each update
+   @param uint32_t - file size
+   @return bool - true = header is updated
+*/
+bool AviWriter::UpdateHeader(uint32_t i_fileSize) {
+  uint8_t value[4];
+  bool ret = true;
+
+  const struct {
+    uint32_t pos;
+    uint32_t value;
+  } fields[] = {
+    { 4, i_fileSize - 8 },                    /* RIFF size */
+    { 48, FrameCount },                       /* avih total frames */
+    { 60, MaxFrameSize },                     /* avih suggested buffer size */
+    { 140, FrameCount },                      /* strh length */
+    { 144, MaxFrameSize },                    /* strh suggested buffer size */
+    { 216, WritePos - AVI_MOVI_OFFSET },      /* movi size */
+  };
+
+  for (uint8_t i = 0; i < (sizeof(fields) / sizeof(fields[0])); i++) {
+    PutUint32(value, fields[i].value);
+    AviFile.seek(fields[i].pos);
+    if (sizeof(value) != AviFile.write(value, sizeof(value))) {
+      ret = false;
+    }
+  }
+  AviFile.flush();
+
+  return ret;
+}
+
+/**
+   @brief Flush buffered index entries to the sidecar file and update the header
+   @param none
+   @return bool - true = index is flushed
+*/
+bool AviWriter::FlushIndex() {
+  bool ret = true;
+
+  if (IndexBuffered > 0) {
+    size_t len = IndexBuffered * AVI_INDEX_ENTRY_SIZE;
+    if (len != IndexFile.write(IndexBuffer, len)) {
+      ret = false;
+    }
+    IndexFile.flush();
+    IndexBuffered = 0;
+  }
+
+  if (false == UpdateHeader(WritePos)) {
+    ret = false;
+  }
+
+  return ret;
+}
+
+/**
+   @brief Recover the file after power loss. The sidecar index is checked, and the complete chunks
+          written after the last flush are indexed again. The incomplete last chunk is overwritten by the next frame
+   @param none
+   @return bool - true = file is recovered
+*/
+bool AviWriter::Recover() {
+  uint8_t h[AVI_HEADER_SIZE];
+  uint8_t chunk[AVI_CHUNK_HEADER_SIZE];
+  uint32_t FileSize = AviFile.size();
+  uint32_t indexed = 0;
+
+  AviFile.seek(0);
+  if ((sizeof(h) != AviFile.read(h, sizeof(h))) || (0 != memcmp(&h[0], "RIFF", 4)) || (0 != memcmp(&h[8], "AVI ", 4)) || (0 != memcmp(&h[220], "movi", 4))) {
+    return false;
+  }
+  Width = GetUint32(&h[64]);
+  Height = GetUint32(&h[68]);
+  MaxFrameSize = GetUint32(&h[144]);
+  WritePos = AVI_HEADER_SIZE;
+
+  /* the last sidecar entry must point to a complete chunk, otherwise the whole file is indexed again */
+  IndexFile = Fs->open(IndexPath, FILE_READ);
+  if (IndexFile) {
+    uint32_t entries = IndexFile.size() / AVI_INDEX_ENTRY_SIZE;
+    uint8_t entry[AVI_INDEX_ENTRY_SIZE];
+    if (entries > 0) {
+      IndexFile.seek((entries - 1) * AVI_INDEX_ENTRY_SIZE);
+      if (sizeof(entry) == IndexFile.read(entry, sizeof(entry))) {
+        uint32_t pos = AVI_MOVI_OFFSET + GetUint32(&entry[8]);
+        uint32_t len = GetUint32(&entry[12]);
+        AviFile.seek(pos);
+        if ((sizeof(chunk) == AviFile.read(chunk, sizeof(chunk))) && (0 == memcmp(chunk, "00dc", 4)) && (GetUint32(&chunk[4]) == len) &&
+            ((pos + sizeof(chunk) + len) <= FileSize)) {
+          indexed = entries;
+          WritePos = pos + sizeof(chunk) + len + (len & 1);
+        }
+      }
+    }
+    IndexFile.close();
+  }
+
+  /* the valid entries are kept, the partial entry is dropped */
+  if (indexed > 0) {
+    IndexFile = Fs->open(IndexPath, "r+");
+    if (IndexFile) {
+      IndexFile.seek(indexed * AVI_INDEX_ENTRY_SIZE);
+    }
+  } else {
+    IndexFile = Fs->open(IndexPath, FILE_WRITE);
+  }
+  if (!IndexFile) {
+    return false;
+  }
+  FrameCount = indexed;
+
+  /* index the complete chunks written after the last flush */
+  while ((WritePos + sizeof(chunk)) <= FileSize) {
+    AviFile.seek(WritePos);
+    if ((sizeof(chunk) != AviFile.read(chunk, sizeof(chunk))) || (0 != memcmp(chunk, "00dc", 4))) {
+      break;
+    }
+    uint32_t len = GetUint32(&chunk[4]);
+    if ((WritePos + sizeof(chunk) + len) > FileSize) {
+      break;
+    }
+
+    AddIndexEntry(WritePos - AVI_MOVI_OFFSET, len);
+    MaxFrameSize = max(MaxFrameSize, len);
+    WritePos += sizeof(chunk) + len + (len & 1);
+
+    if ((IndexBuffered >= TIMELAPS_AVI_INDEX_FLUSH) && (false == FlushIndex())) {
+      return false;
+    }
+  }
+
+  return FlushIndex();
+}
+
+/**
+   @brief Add idx1 entry to the buffer
+   @param uint32_t - chunk offset from the movi fourcc
+   @param uint32_t - chunk data size
+   @return none
+*/
+void AviWriter::AddIndexEntry(uint32_t i_offset, uint32_t i_len) {
+  uint8_t *entry = &IndexBuffer[IndexBuffered * AVI_INDEX_ENTRY_SIZE];
+
+  memcpy(entry, "00dc", 4);
+  PutUint32(&entry[4], 0x10);   /* AVIIF_KEYFRAME */
+  PutUint32(&entry[8], i_offset);
+  PutUint32(&entry[12], i_len);
+  IndexBuffered++;
+  FrameCount++;
+}
+
+/**
+   @brief Store little endian uint16
+   @param uint8_t * - output
+   @param uint16_t - value
+   @return none
+*/
+void AviWriter::PutUint16(uint8_t *o_buf, uint16_t i_value) {
+  o_buf[0] = i_value & 0xFF;
+  o_buf[1] = (i_value >> 8) & 0xFF;
+}
+
+/**
+   @brief Store little endian uint32
+   @param uint8_t * - output
+   @param uint32_t - value
+   @return none
+*/
+void AviWriter::PutUint32(uint8_t *o_buf, uint32_t i_value) {
+  o_buf[0] = i_value & 0xFF;
+  o_buf[1] = (i_value >> 8) & 0xFF;
+  o_buf[2] = (i_value >> 16) & 0xFF;
+  o_buf[3] = (i_value >> 24) & 0xFF;
+}
+
+/**
+   @brief Load little endian uint32
+   @param const uint8_t * - input
+   @return uint32_t - value
+*/
+uint32_t AviWriter::GetUint32(const uint8_t *i_buf) {
+  return i_buf[0] | (i_buf[1] << 8) | (i_buf[2] << 16) | ((uint32_t)i_buf[3] << 24);
+}
+
+/**
+   @brief Get file status
+   @param none
+   @return bool - true = file is opened
+*/
+bool AviWriter::IsOpen() {
+  return Opened;
+}
+
+/**
+   @brief Get AVI file path
+   @param none
+   @return String - path
+*/
+String AviWriter::GetPath() {
+  return Path;
+}
+
+/**
+   @brief Get count of frames in the file
+   @param none
+   @return uint32_t - count of frames
+*/
+uint32_t AviWriter::GetFrameCount() {
+  return FrameCount;
+}
+
+/**
+   @brief Get size of the file without the index
+   @param none
+   @return uint32_t - size [bytes]
+*/
+uint32_t AviWriter::GetFileSize() {
+  return WritePos;
+}
+
+/**
+   @brief Get frame width
+   @param none
+   @return uint16_t - width
+*/
+uint16_t AviWriter::GetWidth() {
+  return Width;
+}
+
+/**
+   @brief Get frame height
+   @param none
+   @return uint16_t - height
+*/
+uint16_t AviWriter::GetHeight() {
+  return Height;
+}
+
+/* EOF */
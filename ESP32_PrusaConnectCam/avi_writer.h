@@ -0,0 +1,71 @@
+/**
+   @file avi_writer.h
+
+   @brief Library for writing MJPEG AVI file incrementally to the SD card
+
+   Each frame is appended as one 00dc chunk. The idx1 index is collected in
+   a sidecar file, and it is copied to the end of the AVI file when the file
+   is closed. After power loss, the index is rebuilt from the sidecar file
+   and from the chunks written after the last sidecar flush.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+#include "mcu_cfg.h"
+#include "camera_frame.h"
+
+#define AVI_HEADER_SIZE         224   ///< size of the RIFF, hdrl and movi headers
+#define AVI_MOVI_OFFSET         220   ///< position of the movi fourcc, idx1 offsets are relative to it
+#define AVI_CHUNK_HEADER_SIZE   8     ///< fourcc and size
+#define AVI_INDEX_ENTRY_SIZE    16    ///< size of one idx1 entry
+
+class AviWriter {
+private:
+  fs::FS *Fs;                     ///< file system
+  File AviFile;                   ///< AVI file
+  File IndexFile;                 ///< sidecar file with idx1 entries
+  String Path;                    ///< AVI file path
+  String IndexPath;               ///< sidecar file path
+  uint8_t IndexBuffer[TIMELAPS_AVI_INDEX_FLUSH * AVI_INDEX_ENTRY_SIZE]; ///< idx1 entries not flushed to the sidecar file
+  uint16_t IndexBuffered;         ///< count of entries in the buffer
+  uint32_t FrameCount;            ///< count of frames in the file
+  uint32_t WritePos;              ///< position of the next chunk
+  uint32_t MaxFrameSize;          ///< size of the biggest frame
+  uint16_t Width;                 ///< frame width
+  uint16_t Height;                ///< frame height
+  bool Opened;                    ///< file is opened
+
+  void WriteHeader();
+  bool UpdateHeader(uint32_t);
+  bool FlushIndex();
+  bool Recover();
+  void AddIndexEntry(uint32_t, uint32_t);
+  static void PutUint16(uint8_t *, uint16_t);
+  static void PutUint32(uint8_t *, uint32_t);
+  static uint32_t GetUint32(const uint8_t *);
+
+public:
+  AviWriter();
+  ~AviWriter(){};
+
+  bool Open(fs::FS &, String, uint16_t, uint16_t);
+  bool AddFrame(const CameraFrameView_t *);
+  bool Close();
+
+  bool IsOpen();
+  String GetPath();
+  uint32_t GetFrameCount();
+  uint32_t GetFileSize();
+  uint16_t GetWidth();
+  uint16_t GetHeight();
+};
+
+/* EOF */
@@ -29,26 +29,41 @@ Camera::Camera(Configuration* i_conf, Logs* i_log, int8_t i_FlashPin) {
   CameraFlashPin = i_FlashPin;
   StreamOnOff = false;
   frameBufferSemaphore = xSemaphoreCreateMutex();
+  FrameMutex = xSemaphoreCreateMutex();
 
-  /* Allocate memory for the frame buffer */
-  FrameBufferDuplicate = (camera_fb_t*)heap_caps_malloc(sizeof(camera_fb_t), MALLOC_CAP_SPIRAM);
-  if (FrameBufferDuplicate != NULL) {
-    memset(FrameBufferDuplicate, 0, sizeof(camera_fb_t)); 
-    FrameBufferDuplicate->buf = NULL;
-  }
-  /* Allocate memory for the frame buffer */
-  FrameBufferExif = (camera_fb_t*)heap_caps_malloc(sizeof(camera_fb_t), MALLOC_CAP_SPIRAM);
-  if (FrameBufferExif != NULL) {
-    memset(FrameBufferExif, 0, sizeof(camera_fb_t)); 
-    FrameBufferExif->buf = NULL;
-  }
-  StreamSendingPhoto = false;
-
-  PhotoExifData.header = NULL;
-  PhotoExifData.len = 0;
-  PhotoExifData.offset = 0;
-  PhotoSending = false;
+  PhotoFrame = NULL;
+  StreamFrame = NULL;
+  CameraCaptureSuccess = false;
   CameraCaptureFailedCounter = 0;
+  AllocatedFrameSize = FRAMESIZE_INVALID;
+  FbCount = CAMERA_FB_MIN_COUNT;
+  SensorFrameSize = FRAMESIZE_INVALID;
+  SensorQuality = 0;
+  ReconfigPending = false;
+  ReconfigTime = 0;
+  PhotoCaptureCount = 0;
+  PhotoStaleDiscards = 0;
+  PhotoBufferSkips = 0;
+  PhotoLatency = 0;
+  PhotoTruncatedFrames = 0;
+  PhotoCorruptFrames = 0;
+  StreamFailedCaptures = 0;
+  MotionSampleTime = 0;
+  MotionCadence = false;
+
+  memset(Subscribers, 0, sizeof(Subscribers));
+  memset(ChannelSequence, 0, sizeof(ChannelSequence));
+  StreamSubscribers = 0;
+  StreamSentBytes = 0;
+  StreamQualityDrop = 0;
+  StreamQualityChanged = 0;
+  CaptureTaskRunning = false;
+  PhotoRequest = false;
+  ReinitRequest = false;
+  SensorModeRequest = false;
+  ReinitWaitLog = 0;
+  PhotoRequestMutex = xSemaphoreCreateMutex();
+  PhotoDoneSemaphore = xSemaphoreCreateBinary();
 }
 
 /**
@@ -74,6 +89,10 @@ void Camera::Init() {
   InitCameraModule();
   ApplyCameraCfg();
   GetCameraModel();
+
+  if ((true == MotionCadence) && (false == Motion.Init())) {
+    log->AddEvent(LogLevel_Error, F("Motion detection: failed to allocate luma grid"));
+  }
 }
 
 /**
@@ -123,9 +142,9 @@ void Camera::InitCameraModule() {
     CAMERA_GRAB_LATEST     - Except when 1 frame buffer is used, queue will always contain the last 'fb_count' frames
   */
 
-  CameraConfig.frame_size = TFrameSize;             /* FRAMESIZE_ + QVGA|CIF|VGA|SVGA|XGA|SXGA|UXGA */
+  CameraConfig.frame_size = GetRequiredFrameSize(); /* FRAMESIZE_ + QVGA|CIF|VGA|SVGA|XGA|SXGA|UXGA. Larger of photo and stream */
   CameraConfig.jpeg_quality = PhotoQuality;         /* 10-63 lower number means higher quality */
-  CameraConfig.fb_count = 1;                        /* picture frame buffer alocation */
+  CameraConfig.fb_count = GetFrameBufferCount(CameraConfig.frame_size); /* picture frame buffer alocation. Frames are shared by CameraFrameRing */
   CameraConfig.grab_mode = CAMERA_GRAB_LATEST;      /* CAMERA_GRAB_WHEN_EMPTY or CAMERA_GRAB_LATEST */
 #if (true == ENABLE_PSRAM)
   CameraConfig.fb_location = CAMERA_FB_IN_PSRAM;    /* CAMERA_FB_IN_PSRAM or CAMERA_FB_IN_DRAM  */
@@ -146,8 +165,17 @@ void Camera::InitCameraModule() {
   if (err != ESP_OK) {
     log->AddEvent(LogLevel_Warning, F("Camera init failed. Error: "), String(err, HEX));
     log->AddEvent(LogLevel_Warning, F("Reset ESP32-cam!"));
+    log->Flush();
     ESP.restart();
   } 
+
+  /* smaller frame sizes are applied live to the allocated frame buffers */
+  AllocatedFrameSize = CameraConfig.frame_size;
+  FbCount = CameraConfig.fb_count;
+  log->AddEvent(LogLevel_Info, F("Camera frame buffers: "), String(FbCount) + " x " + String(((resolution[AllocatedFrameSize].width * resolution[AllocatedFrameSize].height) / CAMERA_JPEG_MAX_RATIO) / 1024) + " KB");
+  SystemFramePool.Init();
+  SensorFrameSize = CameraConfig.frame_size;
+  SensorQuality = CameraConfig.jpeg_quality;
 }
 
 /**
@@ -160,6 +188,9 @@ void Camera::LoadCameraCfgFromEeprom() {
   PhotoQuality = config->LoadPhotoQuality();
   FrameSize = config->LoadFrameSize();
   TFrameSize = TransformFrameSizeDataType(config->LoadFrameSize());
+  StreamFrameSize = config->LoadStreamFrameSize();
+  TStreamFrameSize = (CAMERA_STREAM_SAME_AS_PHOTO == StreamFrameSize) ? TFrameSize : TransformFrameSizeDataType(StreamFrameSize);
+  StreamQuality = config->LoadStreamQuality();
   brightness = config->LoadBrightness();
   contrast = config->LoadContrast();
   saturation = config->LoadSaturation();
@@ -181,6 +212,7 @@ void Camera::LoadCameraCfgFromEeprom() {
   CameraFlashEnable = config->LoadCameraFlashEnable();
   CameraFlashTime = config->LoadCameraFlashTime();
   imageExifRotation = config->LoadCameraImageExifRotation();
+  MotionCadence = config->LoadMotionCadence();
 }
 
 /**
@@ -221,15 +253,6 @@ framesize_t Camera::TransformFrameSizeDataType(uint8_t i_data) {
   return ret;
 }
 
-/**
-   @brief Function set photo sending status
-   @param bool i_data - true = on, false = off
-   @return none
-*/
-void Camera::SetPhotoSending(bool i_data) {
-  PhotoSending = i_data;
-}
-
 /**
    @brief Function set flash status
    @param bool i_data - true = on, false = off
@@ -325,11 +348,64 @@ void Camera::ApplyCameraCfg() {
 }
 
 /**
-   @brief Function for reinit camera module
+   @brief Request reinit of the camera module. The reinit is done by the capture task,
+          after all frames are released by the consumers
    @param none
    @return none
 */
 void Camera::ReinitCameraModule() {
+  if (false == ReinitRequest) {
+    log->AddEvent(LogLevel_Info, F("Camera reinit requested"));
+    ReinitWaitLog = millis();
+  }
+  ReinitRequest = true;
+
+  if ((true == CaptureTaskRunning) && (NULL != Task_CameraCapture)) {
+    if (xTaskGetCurrentTaskHandle() != Task_CameraCapture) {
+      xTaskNotifyGive(Task_CameraCapture);
+    }
+  } else {
+    /* the capture task is not running yet, the request stays pending while frames are held */
+    ProcessReinit();
+  }
+}
+
+/**
+   @brief Reinit the camera module. Frames are not published during the reinit and the camera driver
+          is deinitialized only when no frame is held, esp_camera_deinit() frees all frame buffers
+   @param none
+   @return bool - true = reinit done, false = waiting for held frames
+*/
+bool Camera::ProcessReinit() {
+  /* stop publishing, drop the references of the channels */
+  CameraFrame_t *photo = NULL;
+  CameraFrame_t *stream = NULL;
+  if (xSemaphoreTake(FrameMutex, portMAX_DELAY)) {
+    photo = PhotoFrame;
+    stream = StreamFrame;
+    PhotoFrame = NULL;
+    StreamFrame = NULL;
+    xSemaphoreGive(FrameMutex);
+  }
+  FrameRing.Release(photo);
+  FrameRing.Release(stream);
+  CameraCaptureSuccess = false;
+
+  /* stream clients, sinks and web handlers still hold frames, try it again in the next task cycle */
+  uint8_t held = FrameRing.GetFramesInUse();
+  if (held > 0) {
+    if ((millis() - ReinitWaitLog) >= CAMERA_FRAME_RELEASE_WAIT) {
+      ReinitWaitLog = millis();
+      log->AddEvent(LogLevel_Warning, F("Camera reinit waits for held frames: "), String(held));
+    }
+    return false;
+  }
+
+  xSemaphoreTake(frameBufferSemaphore, portMAX_DELAY);
+  log->AddEvent(LogLevel_Info, F("Camera reinit"));
+  StreamQualityDrop = 0;
+  StartReconfig();
+
   esp_err_t err = esp_camera_deinit();
   if (err != ESP_OK) {
     log->AddEvent(LogLevel_Warning, F("Camera error deinit camera module. Error: "), String(err, HEX));
@@ -337,6 +413,13 @@ void Camera::ReinitCameraModule() {
   delay(100);
   InitCameraModule();
   ApplyCameraCfg();
+  xSemaphoreGive(frameBufferSemaphore);
+
+  /* the new driver instance is initialized with the current resolution and quality */
+  SensorModeRequest = false;
+  ReinitRequest = false;
+
+  return true;
 }
 
 /**
@@ -368,105 +451,171 @@ void Camera::GetCameraModel() {
 }
 
 /**
-   @brief Capture Photo and Save it to string array
+   @brief Capture Photo. When the capture task is running, the photo is captured by the task
+          and the function waits for the result
    @param none
    @return none
 */
 void Camera::CapturePhoto() {
+  LATENCY_TIMESTAMP(RequestStart);
 
-  /* Check if photo is already sending */
-  if (true == PhotoSending) {
-    log->AddEvent(LogLevel_Info, F("Sending photo"));
-    return;
+  if ((true == CaptureTaskRunning) && (NULL != Task_CameraCapture) && (xTaskGetCurrentTaskHandle() != Task_CameraCapture)) {
+    xSemaphoreTake(PhotoRequestMutex, portMAX_DELAY);
+    xSemaphoreTake(PhotoDoneSemaphore, 0);  /* clear result of the timed out request */
+    PhotoRequest = true;
+    xTaskNotifyGive(Task_CameraCapture);
+
+    if (pdTRUE != xSemaphoreTake(PhotoDoneSemaphore, (CAMERA_PHOTO_REQUEST_WAIT + CameraFlashTime) / portTICK_PERIOD_MS)) {
+      log->AddEvent(LogLevel_Error, F("Camera capture task timeout"));
+    }
+    xSemaphoreGive(PhotoRequestMutex);
+
+  } else {
+    CapturePhotoFrame();
   }
 
-  /* Check if stream is on */
-  if (false == StreamOnOff) {
+  LATENCY_RECORD(LatencyStage_PhotoRequest, RequestStart);
+}
+
+/**
+   @brief Capture Photo by the camera driver and publish it to the photo channel
+   @param none
+   @return none
+*/
+void Camera::CapturePhotoFrame() {
+  /* Check if stream is on. Stream with other resolution or quality is switched to the photo mode for one frame */
+  if ((false == StreamOnOff) || (true == GetDualResolution())) {
+    /* all frame buffers are held by the stream clients and photo sinks, the camera driver would wait for a free buffer
+       until the capture timeout. The photo is skipped, it is not a camera failure */
+    if (FrameRing.GetFramesInUse() >= FbCount) {
+      CameraCaptureSuccess = false;
+      PhotoBufferSkips++;
+      log->AddEvent(LogLevel_Warning, F("Camera photo skipped, no free frame buffer. Frames in use: "), String(FrameRing.GetFramesInUse()));
+      return;
+    }
+
     if (!xSemaphoreTake(frameBufferSemaphore, portMAX_DELAY)) {
       log->AddEvent(LogLevel_Error, F("Failed to take frame buffer semaphore"));
       return;
     }
 
+    LATENCY_TIMESTAMP(PhotoStart);
+    uint32_t SwitchStart = millis();
+    if (false == ApplySensorMode(false)) {
+      log->AddEvent(LogLevel_Error, F("Camera failed to set photo mode"));
+    }
+    LATENCY_RECORD(LatencyStage_PhotoSensorMode, PhotoStart);
+
     CameraCaptureSuccess = false;
     /* check flash, and enable FLASH LED */
     if (true == CameraFlashEnable) {
+      LATENCY_TIMESTAMP(FlashStart);
       SetFlashStatus(true);
       delay(CameraFlashTime);
+      LATENCY_RECORD(LatencyStage_PhotoFlash, FlashStart);
     }
 
-    if (FrameBuffer) {
-      esp_camera_fb_return(FrameBuffer);
-    }
-
-    /* Capturing a training photo. Without this sequence, the camera will not obtain the current photo but photo from the previous cycle. */
-    FrameBuffer = esp_camera_fb_get();
-    if (FrameBuffer) {
-      esp_camera_fb_return(FrameBuffer);
-      log->AddEvent(LogLevel_Verbose, F("Camera capture training photo"));
-    } else {
-      esp_camera_fb_return(FrameBuffer);
-      log->AddEvent(LogLevel_Error, F("Camera capture failed training photo"));
-      //ReinitCameraModule();
-    }
-
+    /* frames captured before the request (and before the flash) are stale. The driver keeps the latest frames
+       in the frame buffers, so the first frame is often from the previous cycle. Only stale frames are discarded */
+    int64_t RequestTime = esp_timer_get_time();
+    camera_fb_t *fb = NULL;
     int attempts = 0;
     const int maxAttempts = 5;
-    PhotoExifData.header = NULL;
+    uint8_t StaleFrames = 0;
+    CameraFrame_t *frame = NULL;
     do {
       log->AddEvent(LogLevel_Info, F("Taking photo..."));
 
-      FrameBuffer = esp_camera_fb_get();
-      if (!FrameBuffer) {
+      LATENCY_TIMESTAMP(GrabStart);
+      fb = esp_camera_fb_get();
+      LATENCY_RECORD(LatencyStage_PhotoGrab, GrabStart);
+      if (!fb) {
         CameraCaptureFailedCounter++;
         log->AddEvent(LogLevel_Error, F("Camera capture failed! photo. Attempt: "), String(CameraCaptureFailedCounter));
-        xSemaphoreGive(frameBufferSemaphore);  // Release semaphore before returning
-        return;
+        break;
+      }
+
+      /* frame captured before the reconfiguration */
+      if (false == CheckReconfigFrame(fb)) {
+        esp_camera_fb_return(fb);
+        continue;
+      }
+
+      /* frame captured before the request. All frame buffers can hold an old frame */
+      if ((CameraFrame_GetCaptureTime(fb) < RequestTime) && (StaleFrames < FbCount)) {
+        esp_camera_fb_return(fb);
+        StaleFrames++;
+        PhotoStaleDiscards++;
+        continue;
       }
 
       char buf[150] = { '\0' };
-      uint8_t ControlFlag = (uint8_t)FrameBuffer->buf[15];
-      sprintf(buf, "The picture has been saved. Size: %d bytes, Photo resolution: %zu x %zu", FrameBuffer->len, FrameBuffer->width, FrameBuffer->height);
+      LATENCY_TIMESTAMP(ValidateStart);
+      JpegStatus_enum status = Jpeg_Check(fb->buf, fb->len, fb->width, fb->height);
+      LATENCY_RECORD(LatencyStage_PhotoValidate, ValidateStart);
+      sprintf(buf, "The picture has been saved. Size: %d bytes, Photo resolution: %zu x %zu", fb->len, fb->width, fb->height);
       log->AddEvent(LogLevel_Info, buf);
 
-      if (ControlFlag != 0x00) {
-        log->AddEvent(LogLevel_Error, "Camera capture failed! flag: " + String(ControlFlag, HEX));
-        FrameBuffer->len = 0;
+      /* truncated and corrupted frames are never published, the next frame is captured */
+      if (JpegStatus_Valid != status) {
+        if (JpegStatus_Truncated == status) {
+          PhotoTruncatedFrames++;
+        } else {
+          PhotoCorruptFrames++;
+        }
+        log->AddEvent(LogLevel_Error, F("Camera capture failed! jpeg: "), String(Jpeg_GetStatusName(status)));
+        esp_camera_fb_return(fb);
 
       } else {
-        log->AddEvent(LogLevel_Info, F("Photo OK! "), String(ControlFlag, HEX));
+        log->AddEvent(LogLevel_Info, F("Photo OK!"));
         CameraCaptureFailedCounter = 0;
-
-        /* generate exif header */
-        update_exif_from_cfg(imageExifRotation);
-        get_exif_header(FrameBuffer, &PhotoExifData.header, &PhotoExifData.len);
-        PhotoExifData.offset = get_jpeg_data_offset(FrameBuffer);
-        CameraCaptureSuccess = true;
-        
-        if (PhotoExifData.header != NULL) {
-          log->AddEvent(LogLevel_Info, F("Exif header OK! Len: "), String(PhotoExifData.len));
-        } else {
-          log->AddEvent(LogLevel_Error, F("Exif header failed! "), String(PhotoExifData.len));
-        }
+        frame = FrameRing.Publish(fb);
       }
 
       attempts++;
-      if (attempts >= maxAttempts) {
+      if ((NULL == frame) && (attempts >= maxAttempts)) {
         log->AddEvent(LogLevel_Error, F("Failed to capture a valid photo after max attempts"));
         break;
       }
-    } while (!(FrameBuffer->len > 100));
+    } while (NULL == frame);
+    LATENCY_RECORD(LatencyStage_PhotoCapture, RequestTime);
 
     /* Disable flash */
     if (true == CameraFlashEnable) {
       SetFlashStatus(false);
     }
+
+    /* replace the last photo. Consumers with their own reference keep the old frame */
+    if (NULL != frame) {
+      PhotoCaptureCount++;
+      PhotoLatency = (esp_timer_get_time() - RequestTime) / 1000;
+      log->AddEvent(LogLevel_Info, F("Photo latency: "), String(PhotoLatency) + " ms, stale frames: " + String(StaleFrames));
+      LATENCY_TIMESTAMP(ExifStart);
+      SetFrameExif(frame);
+      LATENCY_RECORD(LatencyStage_PhotoExif, ExifStart);
+      PublishFrame(CameraChannel_Photo, frame);
+      CameraCaptureSuccess = true;
+    }
+
+    /* the stream mode is applied back before the next stream frame */
+    if (true == StreamOnOff) {
+      log->AddEvent(LogLevel_Info, F("Camera snapshot from stream mode: "), String(millis() - SwitchStart) + " ms");
+    }
+    LATENCY_RECORD(LatencyStage_PhotoTotal, PhotoStart);
     xSemaphoreGive(frameBufferSemaphore);
 
   } else {
-    /* Stream is on, set flag for sending photo */
-    if (xSemaphoreTake(frameBufferSemaphore, portMAX_DELAY)) {
-      StreamSendingPhoto = true;
-      xSemaphoreGive(frameBufferSemaphore);
+    /* Stream is on, share the last stream frame without copy. The camera driver is not used */
+    CameraFrame_t *frame = NULL;
+    if (xSemaphoreTake(FrameMutex, portMAX_DELAY)) {
+      frame = StreamFrame;
+      FrameRing.Retain(frame);
+      xSemaphoreGive(FrameMutex);
+    }
+
+    if (NULL != frame) {
+      PublishFrame(CameraChannel_Photo, frame);
+      CameraCaptureSuccess = true;
     }
   }
 
@@ -479,153 +628,672 @@ void Camera::CapturePhoto() {
 }
 
 /**
-   @brief Capture Stream
-   @param camera_fb_t * - pointer to camera_fb_t
+   @brief Generate exif header for the frame
+   @param CameraFrame_t * - frame
    @return none
 */
-void Camera::CaptureStream(camera_fb_t* i_buf) {
+void Camera::SetFrameExif(CameraFrame_t *i_frame) {
+  const uint8_t *ExifHeader = NULL;
+  size_t ExifLen = 0;
+
+  update_exif_from_cfg(imageExifRotation);
+  get_exif_header(i_frame->fb, &ExifHeader, &ExifLen);
+
+  /* exif header is stored in the frame slot, jpeg data stay in the camera frame buffer */
+  if (true == FrameRing.SetExif(i_frame, ExifHeader, ExifLen, get_jpeg_data_offset(i_frame->fb))) {
+    log->AddEvent(LogLevel_Verbose, F("Exif header OK! Len: "), String(i_frame->ExifLen));
+  } else {
+    log->AddEvent(LogLevel_Error, F("Exif header failed! "), String(ExifLen));
+  }
+}
+
+/**
+   @brief Capture stream frame by the camera driver and publish it to the stream channel
+   @param none
+   @return none
+*/
+void Camera::CaptureStreamFrame() {
+  /* all frame buffers are held by the stream clients. Wait until a slow client finishes its frame, the camera driver has no free buffer */
+  if (FrameRing.GetFramesInUse() >= FbCount) {
+    return;
+  }
+
   if (xSemaphoreTake(frameBufferSemaphore, portMAX_DELAY)) {
+    LATENCY_TIMESTAMP(StreamStart);
+    camera_fb_t *fb = NULL;
+
+    /* switch back from the photo mode */
+    if (false == ApplySensorMode(true)) {
+      log->AddEvent(LogLevel_Error, F("Camera failed to set stream mode"));
+    }
+
+    int attempts = 0;
+    const int maxAttempts = 5;
     do {
       /* capture final photo */
-      FrameBuffer = esp_camera_fb_get();
-      if (!FrameBuffer) {
+      LATENCY_TIMESTAMP(GrabStart);
+      fb = esp_camera_fb_get();
+      LATENCY_RECORD(LatencyStage_StreamGrab, GrabStart);
+      if (!fb) {
         log->AddEvent(LogLevel_Error, F("Camera capture failed! stream"));
-        i_buf = NULL;
-        return;
+        break;
       }
 
       /* check if photo is correctly saved */
-    } while (!(FrameBuffer->len > 100));
+      if ((!(fb->len > 100)) || (false == CheckReconfigFrame(fb))) {
+        esp_camera_fb_return(fb);
+        fb = NULL;
+      }
 
-    /* check if the photo is rotated */
-    bool ExifStatus = false;
+      /* the next stream frame is captured in the next task cycle */
+      attempts++;
+      if ((NULL == fb) && (attempts >= maxAttempts)) {
+        log->AddEvent(LogLevel_Warning, F("Camera no valid stream frame after max attempts"));
+        break;
+      }
+    } while (NULL == fb);
+
+    if (NULL == fb) {
+      StreamFailedCaptures++;
+      xSemaphoreGive(frameBufferSemaphore);
+      return;
+    }
 
+    CameraFrame_t *frame = FrameRing.Publish(fb);
+    if (NULL != frame) {
 #if (true == CAMERA_EXIF_ROTATION_STREAM)
-    if (1 != imageExifRotation) { /* 1 = image rotation 0 degree */
-      /* generate exif header */
-      update_exif_from_cfg(imageExifRotation);
-      get_exif_header(FrameBuffer, &PhotoExifData.header, &PhotoExifData.len);
-      PhotoExifData.offset = get_jpeg_data_offset(FrameBuffer);
-      if (PhotoExifData.header != NULL) {
-        /* memory allocation release */
-        if (FrameBufferExif != NULL) {
-          if (FrameBufferExif->buf != NULL) {
-            free(FrameBufferExif->buf);
-            FrameBufferExif->buf = NULL; /* Set to NULL after freeing */
-          }
-
-          free(FrameBufferExif);
-          FrameBufferExif = NULL; /* Set to NULL after freeing */
-        }
+      /* check if the photo is rotated. 1 = image rotation 0 degree */
+      if (1 != imageExifRotation) {
+        LATENCY_TIMESTAMP(ExifStart);
+        SetFrameExif(frame);
+        LATENCY_RECORD(LatencyStage_StreamExif, ExifStart);
+      }
+#endif
+      /* the camera reference is moved to the latest stream frame */
+      PublishFrame(CameraChannel_Stream, frame);
+    }
 
-        /* Allocate memory for the duplicate frame structure */
-        FrameBufferExif = (camera_fb_t*)heap_caps_malloc(sizeof(camera_fb_t), MALLOC_CAP_SPIRAM);
+    LATENCY_RECORD(LatencyStage_StreamTotal, StreamStart);
+    xSemaphoreGive(frameBufferSemaphore);
+  }
+}
 
-        /* Calculate the total size of the buffer */
-        size_t totalSize = PhotoExifData.len + FrameBuffer->len - PhotoExifData.offset;
+/**
+   @brief Publish the frame as the latest frame of the channel. The caller's frame reference is moved to the channel.
+          The previous frame is released outside of the frame lock
+   @param CameraChannel_enum - channel
+   @param CameraFrame_t * - frame
+   @return none
+*/
+void Camera::PublishFrame(CameraChannel_enum i_channel, CameraFrame_t *i_frame) {
+  CameraFrame_t *old = NULL;
 
-        /* Allocate memory for the image data */
-        FrameBufferExif->buf = (uint8_t*)heap_caps_malloc(totalSize, MALLOC_CAP_SPIRAM);
-        if (FrameBufferExif->buf == NULL) {
-          log->AddEvent(LogLevel_Error, F("Failed to allocate memory for EXIF buffer"));
-          return;
-        }
+  if (xSemaphoreTake(FrameMutex, portMAX_DELAY)) {
+    CameraFrame_t **latest = (CameraChannel_Stream == i_channel) ? &StreamFrame : &PhotoFrame;
 
-        /* copy the EXIF data to the buffer */
-        memcpy(FrameBufferExif->buf, PhotoExifData.header, PhotoExifData.len);
+    /* the last stream client left during the capture, the frame is not stored */
+    if ((CameraChannel_Stream == i_channel) && (0 == StreamSubscribers)) {
+      old = i_frame;
+    } else {
+      old = *latest;
+      *latest = i_frame;
+      ChannelSequence[i_channel]++;
+    }
+    xSemaphoreGive(FrameMutex);
+  } else {
+    old = i_frame;
+  }
 
-        /* copy the image data to the buffer */
-        memcpy(FrameBufferExif->buf + PhotoExifData.len, FrameBuffer->buf + PhotoExifData.offset, FrameBuffer->len - PhotoExifData.offset);
+  FrameRing.Release(old);
+}
 
-        /* Set the length of the buffer */
-        FrameBufferExif->len = totalSize;
+/**
+   @brief Start measuring the time to the first valid frame after camera reconfiguration
+   @param none
+   @return none
+*/
+void Camera::StartReconfig() {
+  ReconfigTime = esp_timer_get_time();
+  ReconfigPending = true;
+}
 
-        *i_buf = *FrameBufferExif;
-        ExifStatus = true;
-        
-      } else {
-        /* copy the frame buffer to the buffer */
-        *i_buf = *FrameBuffer;
-      }
+/**
+   @brief Check frame after camera reconfiguration. Frames captured before the reconfiguration
+          or with the old resolution are not valid. The first valid frame ends the measurement
+   @param camera_fb_t * - frame buffer
+   @return bool - true = frame is valid
+*/
+bool Camera::CheckReconfigFrame(camera_fb_t *i_fb) {
+  if (false == ReconfigPending) {
+    return true;
+  }
 
-    } else {
-      /* copy the frame buffer to the buffer */
-      *i_buf = *FrameBuffer;
+  int64_t FrameTime = CameraFrame_GetCaptureTime(i_fb);
+  int64_t Elapsed = (esp_timer_get_time() - ReconfigTime) / 1000;
+
+  if (((FrameTime < ReconfigTime) || (i_fb->width != resolution[SensorFrameSize].width)) && (Elapsed < CAMERA_RECONFIG_TIMEOUT)) {
+    return false;
+  }
+
+  ReconfigPending = false;
+  if (Elapsed < CAMERA_RECONFIG_TIMEOUT) {
+    log->AddEvent(LogLevel_Info, F("Camera first valid frame after reconfiguration: "), String((uint32_t)Elapsed) + " ms");
+  } else {
+    log->AddEvent(LogLevel_Warning, F("Camera no valid frame after reconfiguration: "), String((uint32_t)Elapsed) + " ms");
+  }
+
+  return true;
+}
+
+/**
+   @brief Get frame size for the frame buffer allocation. Larger of the photo and stream frame size
+   @param none
+   @return framesize_t - frame size
+*/
+framesize_t Camera::GetRequiredFrameSize() {
+  return (TStreamFrameSize > TFrameSize) ? TStreamFrameSize : TFrameSize;
+}
+
+/**
+   @brief Get count of frame buffers for the frame size. The count is limited by the PSRAM budget,
+          five UXGA buffers would take 1.9 MB of PSRAM
+   @param framesize_t - frame size for the frame buffer allocation
+   @return uint8_t - count of frame buffers, CAMERA_FB_MIN_COUNT - CAMERA_FB_COUNT
+*/
+uint8_t Camera::GetFrameBufferCount(framesize_t i_size) {
+  uint32_t FbSize = (resolution[i_size].width * resolution[i_size].height) / CAMERA_JPEG_MAX_RATIO;
+  return constrain(CAMERA_FB_PSRAM_BUDGET / FbSize, CAMERA_FB_MIN_COUNT, CAMERA_FB_COUNT);
+}
+
+/**
+   @brief Get stream quality for the sensor, with the quality drop for the congested stream client
+   @param none
+   @return uint8_t - quality 10-63
+*/
+uint8_t Camera::GetStreamSensorQuality() {
+  uint8_t quality = (CAMERA_STREAM_SAME_AS_PHOTO == StreamQuality) ? PhotoQuality : StreamQuality;
+  return min(quality + StreamQualityDrop, 63);
+}
+
+/**
+   @brief Set photo or stream mode to the sensor. Only changed values are written to the sensor.
+          The caller must hold the frame buffer semaphore
+   @param bool - true = stream mode, false = photo mode
+   @return bool - true = mode is active
+*/
+bool Camera::ApplySensorMode(bool i_stream) {
+  framesize_t size = (true == i_stream) ? TStreamFrameSize : TFrameSize;
+  uint8_t quality = (true == i_stream) ? GetStreamSensorQuality() : PhotoQuality;
+
+  if (NULL == sensor) {
+    return false;
+  }
+
+  if ((size == SensorFrameSize) && (quality == SensorQuality)) {
+    return true;
+  }
+
+  StartReconfig();
+  if (size != SensorFrameSize) {
+    if (0 != sensor->set_framesize(sensor, size)) {
+      return false;
     }
-#else
-    *i_buf = *FrameBuffer;
+    SensorFrameSize = size;
+  }
+
+  /* quality is written after the frame size, the frame size change sets the jpeg registers */
+  if (0 != sensor->set_quality(sensor, quality)) {
+    return false;
+  }
+  SensorQuality = quality;
+
+  return true;
+}
+
+/**
+   @brief Request applying of changed resolution or quality. Called from the web server,
+          the camera driver is used only by the capture task
+   @param none
+   @return none
+*/
+void Camera::UpdateSensorMode() {
+  SensorModeRequest = true;
+
+  if ((true == CaptureTaskRunning) && (NULL != Task_CameraCapture)) {
+    xTaskNotifyGive(Task_CameraCapture);
+  } else {
+    ProcessSensorMode();
+  }
+}
+
+/**
+   @brief Apply changed resolution or quality live. Reinit is requested only for larger frame buffers or a sensor failure
+   @param none
+   @return none
+*/
+void Camera::ProcessSensorMode() {
+  bool ret = false;
+  SensorModeRequest = false;
+
+  if ((NULL != sensor) && (GetRequiredFrameSize() <= AllocatedFrameSize)) {
+    if (xSemaphoreTake(frameBufferSemaphore, portMAX_DELAY)) {
+      ret = ApplySensorMode(StreamOnOff);
+      xSemaphoreGive(frameBufferSemaphore);
+    }
+
+    if (false == ret) {
+      log->AddEvent(LogLevel_Warning, F("Camera live reconfiguration failed"));
+    }
+  }
+
+  if (false == ret) {
+    ReinitCameraModule();
+  }
+}
+
+/**
+   @brief Set status of the capture task. The task owns the camera driver
+   @param bool - true = task is running
+   @return none
+*/
+void Camera::SetCaptureTaskStatus(bool i_status) {
+  CaptureTaskRunning = i_status;
+}
+
+/**
+   @brief One step of the capture task. Capture requested photo, or the stream frame when a stream client is connected
+   @param none
+   @return none
+*/
+void Camera::CaptureTaskProcess() {
+  /* nothing is captured until the camera module is reinitialized */
+  if ((true == ReinitRequest) && (false == ProcessReinit())) {
+    if (true == PhotoRequest) {
+      log->AddEvent(LogLevel_Warning, F("Camera photo skipped, camera reinit is pending"));
+      PhotoRequest = false;
+      xSemaphoreGive(PhotoDoneSemaphore);
+    }
+    return;
+  }
+
+  if (true == SensorModeRequest) {
+    ProcessSensorMode();
+  }
+
+  AdaptStreamQuality();
+
+  if (true == PhotoRequest) {
+    CapturePhotoFrame();
+    PhotoRequest = false;
+    xSemaphoreGive(PhotoDoneSemaphore);
+
+  } else if (true == StreamOnOff) {
+    CaptureStreamFrame();
+  }
+
+  SampleScene();
+}
+
+/**
+   @brief Sample the scene for the change detection and for the pre-event ring. The last stream frame is used when the stream is running,
+          otherwise one frame is captured in the photo mode without flash. The photos are not used, the flash changes the scene
+   @param none
+   @return none
+*/
+void Camera::SampleScene() {
+  bool MotionDue = false;
+  bool PreEventDue = false;
+
+  /* the luma grid is allocated with the first sample, the pre-event ring is allocated after the camera init */
+  if ((true == GetMotionSampling()) && ((millis() - MotionSampleTime) >= MOTION_SAMPLE_INTERVAL)) {
+    MotionSampleTime = millis();
+    MotionDue = Motion.Init();
+  }
+#if (true == PREEVENT_ENABLE)
+  PreEventDue = SystemPreEvent.CheckFrameDue();
 #endif
 
-    /* copy the frame buffer to the duplicate frame buffer. For sending photo to Prusa Connect */
-    if (false == StreamSendingPhoto) {
-      /* memory allocation release */
-      if (FrameBufferDuplicate != NULL) {
-        if (FrameBufferDuplicate->buf != NULL) {
-          free(FrameBufferDuplicate->buf);
-          FrameBufferDuplicate->buf = NULL; /* Set to NULL after freeing */
-        }
+  if ((false == MotionDue) && (false == PreEventDue)) {
+    return;
+  }
 
-        free(FrameBufferDuplicate);
-        FrameBufferDuplicate = NULL; /* Set to NULL after freeing */
-      }
-      
-      /* Allocate memory for the duplicate frame structure */
-      FrameBufferDuplicate = (camera_fb_t*)heap_caps_malloc(sizeof(camera_fb_t), MALLOC_CAP_SPIRAM);
+  if (true == StreamOnOff) {
+    /* the stream frame is also released by Unsubscribe and reinit, hold own reference */
+    CameraFrame_t *frame = NULL;
+    if (xSemaphoreTake(FrameMutex, portMAX_DELAY)) {
+      frame = StreamFrame;
+      FrameRing.Retain(frame);
+      xSemaphoreGive(FrameMutex);
+    }
 
-      /* Copy the metadata */
-      if (true == ExifStatus) {
-        memcpy(FrameBufferDuplicate, FrameBufferExif, sizeof(camera_fb_t));
-      } else {
-        memcpy(FrameBufferDuplicate, FrameBuffer, sizeof(camera_fb_t));
+    if ((NULL != frame) && (NULL != frame->fb)) {
+      CameraFrameView_t view;
+      CameraFrame_GetView(frame, &view);
+      ProcessSceneFrame(&view, frame->fb, MotionDue, PreEventDue);
+    }
+    FrameRing.Release(frame);
+    return;
+  }
+
+  /* the camera driver has no free buffer */
+  if (FrameRing.GetFramesInUse() >= FbCount) {
+    return;
+  }
+
+  if (xSemaphoreTake(frameBufferSemaphore, portMAX_DELAY)) {
+    if (true == ApplySensorMode(false)) {
+      camera_fb_t *fb = esp_camera_fb_get();
+      if (NULL != fb) {
+        if (true == CheckReconfigFrame(fb)) {
+          CameraFrameView_t view;
+          view.Count = 1;
+          view.Segment[0].ptr = fb->buf;
+          view.Segment[0].len = fb->len;
+          view.Len = fb->len;
+          ProcessSceneFrame(&view, fb, MotionDue, PreEventDue);
+        }
+        esp_camera_fb_return(fb);
       }
+    }
+    xSemaphoreGive(frameBufferSemaphore);
+  }
+}
 
-      /* Allocate memory for the image data */
-      if (true == ExifStatus) {
-        FrameBufferDuplicate->buf = (uint8_t*)heap_caps_malloc(FrameBufferExif->len, MALLOC_CAP_SPIRAM);
-      } else {
-        FrameBufferDuplicate->buf = (uint8_t*)heap_caps_malloc(FrameBuffer->len, MALLOC_CAP_SPIRAM);
+/**
+   @brief Process the sampled frame. The frame is stored to the pre-event ring first, so the frame with the scene change is saved
+   @param const CameraFrameView_t * - segmented frame
+   @param camera_fb_t * - frame buffer
+   @param bool - true = analyse scene change
+   @param bool - true = store frame to the pre-event ring
+   @return none
+*/
+void Camera::ProcessSceneFrame(const CameraFrameView_t *i_view, camera_fb_t *i_fb, bool i_motion, bool i_preevent) {
+#if (true == PREEVENT_ENABLE)
+  if (true == i_preevent) {
+    SystemPreEvent.AddFrame(i_view, i_fb->width, i_fb->height, CameraFrame_GetCaptureTime(i_fb));
+  }
+#endif
+
+  if ((true == i_motion) && (true == Motion.Process(i_fb->buf, i_fb->len))) {
+#if (true == PREEVENT_ENABLE) && (PREEVENT_MOTION_SCORE > 0)
+    if (Motion.GetScore() >= PREEVENT_MOTION_SCORE) {
+      SystemPreEvent.Trigger(PreEventTrigger_Motion);
+    }
+#endif
+  }
+}
+
+/**
+   @brief Check if the scene is sampled. The scene is sampled only for the motion cadence enabled by the user,
+          and for the scene change trigger of the allocated pre-event ring
+   @param none
+   @return bool - true = scene is sampled
+*/
+bool Camera::GetMotionSampling() {
+#if (true == PREEVENT_ENABLE) && (PREEVENT_MOTION_SCORE > 0)
+  if (0 != SystemPreEvent.GetMemorySize()) {
+    return true;
+  }
+#endif
+
+  return MotionCadence;
+}
+
+/**
+   @brief Lower the jpeg quality, when the only stream client is congested. The quality is restored
+          step by step when the client catches up, and immediately when other clients connect or the stream stops
+   @param none
+   @return none
+*/
+void Camera::AdaptStreamQuality() {
+  uint8_t drop = StreamQualityDrop;
+  bool congested = false;
+
+  if (1 == StreamSubscribers) {
+    if ((millis() - StreamQualityChanged) < STREAM_QUALITY_ADAPT_PERIOD) {
+      return;
+    }
+
+    for (uint8_t i = 0; i < CAMERA_MAX_SUBSCRIBERS; i++) {
+      if ((true == Subscribers[i].Active) && (CameraChannel_Stream == Subscribers[i].Channel)) {
+        congested = Subscribers[i].Congested;
       }
+    }
 
-      /* Check if memory allocation was successful */
-      if (!FrameBufferDuplicate->buf) {
-        /* Handle error */
-        free(FrameBufferDuplicate);
-        Serial.println("Failed to allocate memory for the duplicate frame buffer");
-      } else {
-        /* Copy the image data */
-        if (true == ExifStatus) {
-          memcpy(FrameBufferDuplicate->buf, FrameBufferExif->buf, FrameBufferExif->len);
-          
-        } else {
-          memcpy(FrameBufferDuplicate->buf, FrameBuffer->buf, FrameBuffer->len);
+    if ((true == congested) && (drop < STREAM_QUALITY_MAX_DROP) && (GetStreamSensorQuality() < 63)) {
+      drop += STREAM_QUALITY_STEP;
+    } else if ((false == congested) && (drop > 0)) {
+      drop = (drop > STREAM_QUALITY_STEP) ? (drop - STREAM_QUALITY_STEP) : 0;
+    }
+  } else {
+    /* a lower quality for one slow client would be sent to all clients */
+    drop = 0;
+  }
+
+  /* the stream mode with the new quality is applied before the next stream frame */
+  if (drop != StreamQualityDrop) {
+    StreamQualityDrop = drop;
+    StreamQualityChanged = millis();
+    log->AddEvent(LogLevel_Info, F("Camera stream jpeg quality: "), String(GetStreamSensorQuality()));
+  }
+}
+
+/**
+   @brief Get the last captured photo. The caller must release the frame by ReleaseFrame
+   @param none
+   @return CameraFrame_t * - frame, NULL when no photo is available
+*/
+CameraFrame_t* Camera::GetPhotoFrame() {
+  CameraFrame_t *frame = NULL;
+
+  if (xSemaphoreTake(FrameMutex, portMAX_DELAY)) {
+    frame = PhotoFrame;
+    FrameRing.Retain(frame);
+    xSemaphoreGive(FrameMutex);
+  }
+
+  return frame;
+}
+
+/**
+   @brief Release frame reference
+   @param CameraFrame_t * - frame
+   @return none
+*/
+void Camera::ReleaseFrame(CameraFrame_t *i_frame) {
+  FrameRing.Release(i_frame);
+
+  /* the last held frame was released, the pending reinit can continue */
+  if ((true == ReinitRequest) && (0 == FrameRing.GetFramesInUse()) && (NULL != Task_CameraCapture)) {
+    xTaskNotifyGive(Task_CameraCapture);
+  }
+}
+
+/**
+   @brief Get count of frames held by consumers
+   @param none
+   @return uint8_t - count of frames
+*/
+uint8_t Camera::GetFramesInUse() {
+  return FrameRing.GetFramesInUse();
+}
+
+/**
+   @brief Get count of frame buffers allocated by the camera driver
+   @param none
+   @return uint8_t - count of frame buffers
+*/
+uint8_t Camera::GetFbCount() {
+  return FbCount;
+}
+
+/**
+   @brief Subscribe to the published frames
+   @param CameraChannel_enum - channel
+   @param const char * - subscriber name
+   @return int8_t - subscriber id, -1 when all slots are used
+*/
+int8_t Camera::Subscribe(CameraChannel_enum i_channel, const char *i_name) {
+  int8_t id = -1;
+
+  if (xSemaphoreTake(FrameMutex, portMAX_DELAY)) {
+    for (uint8_t i = 0; i < CAMERA_MAX_SUBSCRIBERS; i++) {
+      if (false == Subscribers[i].Active) {
+        id = i;
+        Subscribers[i].Active = true;
+        Subscribers[i].Channel = i_channel;
+        Subscribers[i].Name = i_name;
+        Subscribers[i].LastSequence = ChannelSequence[i_channel];
+        Subscribers[i].Delivered = 0;
+        Subscribers[i].Dropped = 0;
+        Subscribers[i].Fps = 0.0;
+        Subscribers[i].Kbps = 0;
+        Subscribers[i].Congested = false;
+
+        if (CameraChannel_Stream == i_channel) {
+          StreamSubscribers++;
+          StreamOnOff = true;
         }
+        break;
       }
     }
+    xSemaphoreGive(FrameMutex);
+  }
 
-    xSemaphoreGive(frameBufferSemaphore);
+  if (id < 0) {
+    log->AddEvent(LogLevel_Warning, F("Camera subscriber slots are full: "), String(i_name));
+  } else {
+    log->AddEvent(LogLevel_Info, F("Camera subscriber added: "), String(i_name) + ", id: " + String(id));
+  }
+
+  /* wake up the capture task for the stream */
+  if ((CameraChannel_Stream == i_channel) && (id >= 0) && (NULL != Task_CameraCapture)) {
+    log->AddEvent(LogLevel_Info, F("Camera video stream: "), String(StreamOnOff));
+    xTaskNotifyGive(Task_CameraCapture);
   }
+
+  return id;
 }
 
 /**
-   @brief Capture Return Frame Buffer
-   @param none
+   @brief Unsubscribe from the published frames
+   @param int8_t - subscriber id
    @return none
 */
-void Camera::CaptureReturnFrameBuffer() {
-  esp_camera_fb_return(FrameBuffer);
+void Camera::Unsubscribe(int8_t i_id) {
+  if ((i_id < 0) || (i_id >= CAMERA_MAX_SUBSCRIBERS)) {
+    return;
+  }
+
+  CameraSubscriber_t removed;
+  CameraFrame_t *frame = NULL;
+  bool Removed = false;
+  bool StreamStopped = false;
+
+  if (xSemaphoreTake(FrameMutex, portMAX_DELAY)) {
+    if (true == Subscribers[i_id].Active) {
+      removed = Subscribers[i_id];
+      Removed = true;
+      Subscribers[i_id].Active = false;
+
+      /* last stream client, stop the stream and return the frame */
+      if ((CameraChannel_Stream == Subscribers[i_id].Channel) && (StreamSubscribers > 0)) {
+        StreamSubscribers--;
+        if (0 == StreamSubscribers) {
+          StreamOnOff = false;
+          frame = StreamFrame;
+          StreamFrame = NULL;
+          StreamStopped = true;
+        }
+      }
+    }
+    xSemaphoreGive(FrameMutex);
+  }
+
+  FrameRing.Release(frame);
+  if (true == Removed) {
+    log->AddEvent(LogLevel_Info, F("Camera subscriber removed: "), String(removed.Name) + ", delivered: " + String(removed.Delivered) + ", dropped: " + String(removed.Dropped));
+  }
+  if (true == StreamStopped) {
+    log->AddEvent(LogLevel_Info, F("Camera video stream: "), String(StreamOnOff));
+  }
 }
 
 /**
-   @brief Set Stream Status
-   @param bool - true = on, false = off
+   @brief Get the latest frame of the subscribed channel. The caller must release the frame by ReleaseFrame
+   @param int8_t - subscriber id
+   @param bool - true = return only frame, which was not delivered to the subscriber yet
+   @return CameraFrame_t * - frame, NULL when no frame is available
+*/
+CameraFrame_t* Camera::GetSubscriberFrame(int8_t i_id, bool i_OnlyNew) {
+  CameraFrame_t *frame = NULL;
+
+  if ((i_id < 0) || (i_id >= CAMERA_MAX_SUBSCRIBERS)) {
+    return NULL;
+  }
+
+  if (xSemaphoreTake(FrameMutex, portMAX_DELAY)) {
+    CameraSubscriber_t *sub = &Subscribers[i_id];
+    CameraFrame_t *latest = (CameraChannel_Stream == sub->Channel) ? StreamFrame : PhotoFrame;
+    uint32_t sequence = ChannelSequence[sub->Channel];
+    bool NewFrame = (sequence != sub->LastSequence);
+
+    if ((true == sub->Active) && (NULL != latest) && ((true == NewFrame) || (false == i_OnlyNew))) {
+      FrameRing.Retain(latest);
+      frame = latest;
+
+      /* latest frame wins, frames published between two requests are dropped */
+      if (true == NewFrame) {
+        sub->Dropped += sequence - sub->LastSequence - 1;
+        sub->LastSequence = sequence;
+        sub->Delivered++;
+      }
+    }
+    xSemaphoreGive(FrameMutex);
+  }
+
+  return frame;
+}
+
+/**
+   @brief Set measured rate of the stream client. Used by the quality adaptation and telemetry
+   @param int8_t - subscriber id
+   @param float - effective frame rate
+   @param uint16_t - send throughput [kbit/s]
+   @param bool - true = client is congested
    @return none
 */
-void Camera::SetStreamStatus(bool i_status) {
-  StreamOnOff = i_status;
-  if (FrameBuffer) {
-    esp_camera_fb_return(FrameBuffer);
+void Camera::SetSubscriberRate(int8_t i_id, float i_fps, uint16_t i_kbps, bool i_congested) {
+  if ((i_id < 0) || (i_id >= CAMERA_MAX_SUBSCRIBERS)) {
+    return;
+  }
+
+  /* the subscriber is the only writer of its rate */
+  Subscribers[i_id].Fps = i_fps;
+  Subscribers[i_id].Kbps = i_kbps;
+  Subscribers[i_id].Congested = i_congested;
+}
+
+/**
+   @brief Get subscriber statistics
+   @param uint8_t - subscriber slot
+   @param CameraSubscriber_t * - output
+   @return bool - true = slot is used
+*/
+bool Camera::GetSubscriberInfo(uint8_t i_id, CameraSubscriber_t *o_info) {
+  bool ret = false;
+
+  if (i_id >= CAMERA_MAX_SUBSCRIBERS) {
+    return false;
   }
-  log->AddEvent(LogLevel_Info, F("Camera video stream: "), String(StreamOnOff));
+
+  if (xSemaphoreTake(FrameMutex, portMAX_DELAY)) {
+    *o_info = Subscribers[i_id];
+    ret = Subscribers[i_id].Active;
+    xSemaphoreGive(FrameMutex);
+  }
+
+  return ret;
 }
 
 /**
@@ -637,163 +1305,180 @@ bool Camera::GetStreamStatus() {
   return StreamOnOff;
 }
 
+/**
+   @brief Get count of the stream clients
+   @param none
+   @return uint8_t - count of clients
+*/
+uint8_t Camera::GetStreamClients() {
+  return StreamSubscribers;
+}
+
+/**
+   @brief Get count of frames captured for the stream
+   @param none
+   @return uint32_t - count of frames
+*/
+uint32_t Camera::GetStreamFrameCount() {
+  return ChannelSequence[CameraChannel_Stream];
+}
+
 bool Camera::GetCameraCaptureSuccess() {
   return CameraCaptureSuccess;
 }
 
 /**
-   @brief Set Frame Size
-   @param uint16_t - frame size
-   @return none
+   @brief Get count of photos captured by the camera driver
+   @param none
+   @return uint32_t - count of photos
 */
-void Camera::StreamSetFrameSize(uint16_t i_data) {
-  StreamAverageSize = (StreamAverageSize + i_data) / 2;
+uint32_t Camera::GetPhotoCaptureCount() {
+  return PhotoCaptureCount;
 }
 
 /**
-   @brief Set average Frame Fps
-   @param float - frame fps
-   @return none
+   @brief Get count of discarded stale frames. Frames captured before the photo request
+   @param none
+   @return uint32_t - count of frames
 */
-void Camera::StreamSetFrameFps(float i_data) {
-  StreamAverageFps = (StreamAverageFps + i_data) / 2.0;
+uint32_t Camera::GetPhotoStaleDiscards() {
+  return PhotoStaleDiscards;
 }
 
 /**
-   @brief Get average stream Frame Size
+   @brief Get count of photos skipped, because all frame buffers were held by consumers
    @param none
-   @return uint16_t - frame size
+   @return uint32_t - count of photos
 */
-uint16_t Camera::StreamGetFrameAverageSize() {
-  return StreamAverageSize;
+uint32_t Camera::GetPhotoBufferSkips() {
+  return PhotoBufferSkips;
 }
 
 /**
-   @brief Get average stream Frame Fps
+   @brief Get time from the last photo request to the captured frame
    @param none
-   @return float - frame fps
+   @return uint32_t - latency [ms]
 */
-float Camera::StreamGetFrameAverageFps() {
-  return StreamAverageFps;
+uint32_t Camera::GetPhotoLatency() {
+  return PhotoLatency;
 }
 
 /**
-   @brief Clear Frame Data
+   @brief Get count of truncated photo frames, frames without EOI
    @param none
-   @return none
+   @return uint32_t - count of frames
 */
-void Camera::StreamClearFrameData() {
-  StreamAverageFps = 0.0;
-  StreamAverageSize = 0;
+uint32_t Camera::GetPhotoTruncatedFrames() {
+  return PhotoTruncatedFrames;
 }
 
 /**
-   @brief Set Sending Photo for Stream
-   @param bool - sending photo
-   @return none
+   @brief Get count of corrupted photo frames, bad jpeg structure or dimensions
+   @param none
+   @return uint32_t - count of frames
 */
-void Camera::StreamSetSendingPhoto(bool i_data) {
-  StreamSendingPhoto = i_data;
+uint32_t Camera::GetPhotoCorruptFrames() {
+  return PhotoCorruptFrames;
 }
 
 /**
-   @brief Get Photo
+   @brief Get count of stream captures without a valid frame after max attempts
    @param none
-   @return String - photo
+   @return uint32_t - count of captures
 */
-String Camera::GetPhoto() {
-  Photo = "";
-  for (size_t i = 0; i < FrameBuffer->len; i++) {
-    Photo += (char)FrameBuffer->buf[i];
-  }
-  return Photo;
+uint32_t Camera::GetStreamFailedCaptures() {
+  return StreamFailedCaptures;
 }
 
 /**
-   @brief Get Photo Frame Buffer
+   @brief Get percentage of changed cells in the last motion sample
    @param none
-   @return camera_fb_t* - photo frame buffer
+   @return uint8_t - score 0-100
 */
-camera_fb_t* Camera::GetPhotoFb() {
-  return FrameBuffer;
+uint8_t Camera::GetMotionScore() {
+  return Motion.GetScore();
 }
 
 /**
-   @brief Get Photo Frame Buffer Duplicate
+   @brief Get count of motion samples with significant scene change
    @param none
-   @return camera_fb_t* - photo frame buffer duplicate
+   @return uint32_t - count of samples
 */
-camera_fb_t* Camera::GetPhotoFbDuplicate() {
-  return FrameBufferDuplicate;
+uint32_t Camera::GetMotionChangeCount() {
+  return Motion.GetChangeCount();
 }
 
 /**
-   @brief Get Photo Exif Data
+   @brief Get time of the last motion analysis
    @param none
-   @return PhotoExifData_t* - photo exif data
+   @return uint32_t - time [us]
 */
-PhotoExifData_t* Camera::GetPhotoExifData() {
-  return &PhotoExifData;
+uint32_t Camera::GetMotionAnalysisTime() {
+  return Motion.GetAnalysisTime();
 }
 
 /**
-   @brief Copy Photo
-   @param camera_fb_t* - pointer to camera_fb_t
+   @brief Set Frame Size
+   @param uint16_t - frame size
    @return none
 */
-void Camera::CopyPhoto(camera_fb_t* i_data) {
-  *i_data = *FrameBuffer;
+void Camera::StreamSetFrameSize(uint16_t i_data) {
+  StreamAverageSize = (StreamAverageSize + i_data) / 2;
 }
 
 /**
-   @brief Copy Photo
-   @param String* - pointer to string
+   @brief Set average Frame Fps
+   @param float - frame fps
    @return none
 */
-void Camera::CopyPhoto(String* i_data) {
-  Photo = "";
-  for (size_t i = 0; i < FrameBuffer->len; i++) {
-    Photo += (char)FrameBuffer->buf[i];
-  }
-  *i_data = Photo;
+void Camera::StreamSetFrameFps(float i_data) {
+  StreamAverageFps = (StreamAverageFps + i_data) / 2.0;
 }
 
 /**
- * @brief Copy photo from frame buffer to string array with range
- * 
- * @param i_data - pointer to string 
- * @param i_from - start index
- * @param i_to - end index
- */
-void Camera::CopyPhoto(String* i_data, int i_from, int i_to) {
-  *i_data = "";
+   @brief Get average stream Frame Size
+   @param none
+   @return uint16_t - frame size
+*/
+uint16_t Camera::StreamGetFrameAverageSize() {
+  return StreamAverageSize;
+}
 
-  for (int i = i_from; i < i_to; i++) {
-    *i_data += (char)FrameBuffer->buf[i];
-  }
+/**
+   @brief Get average stream Frame Fps
+   @param none
+   @return float - frame fps
+*/
+float Camera::StreamGetFrameAverageFps() {
+  return StreamAverageFps;
 }
 
 /**
- * @brief Copy photo from frame buffer to char array with range
- * 
- * @param i_data - pointer to char array
- * @param i_from - start index
- * @param i_to - end index
- */
-void Camera::CopyPhoto(char* i_data, int i_from, int i_to) {
-  int length = i_to - i_from;
-  memcpy(i_data, FrameBuffer->buf + i_from, length);
-  i_data[length + 1] = '\0';
+   @brief Clear Frame Data
+   @param none
+   @return none
+*/
+void Camera::StreamClearFrameData() {
+  StreamAverageFps = 0.0;
+  StreamAverageSize = 0;
 }
 
 /**
- * @brief Get Photo Size
- * 
- * @return int - photo size
- */
-int Camera::GetPhotoSize() {
-  log->AddEvent(LogLevel_Verbose, F("Photo size: "), String(FrameBuffer->len));
-  return (int)FrameBuffer->len;
+   @brief Add count of bytes sent to the stream client
+   @param uint32_t - count of bytes
+   @return none
+*/
+void Camera::StreamAddSentBytes(uint32_t i_data) {
+  StreamSentBytes += i_data;
+}
+
+/**
+   @brief Get count of bytes sent to all stream clients since boot
+   @param none
+   @return uint32_t - count of bytes
+*/
+uint32_t Camera::StreamGetSentBytes() {
+  return StreamSentBytes;
 }
 
 /**
@@ -804,7 +1489,8 @@ int Camera::GetPhotoSize() {
 void Camera::SetPhotoQuality(uint8_t i_data) {
   config->SavePhotoQuality(i_data);
   PhotoQuality = i_data;
-  ReinitCameraModule();
+  StreamQualityDrop = 0;
+  UpdateSensorMode();
 }
 
 /**
@@ -816,7 +1502,34 @@ void Camera::SetFrameSize(uint8_t i_data) {
   config->SaveFrameSize(i_data);
   FrameSize = i_data;
   TFrameSize = TransformFrameSizeDataType(i_data);
-  ReinitCameraModule();
+  if (CAMERA_STREAM_SAME_AS_PHOTO == StreamFrameSize) {
+    TStreamFrameSize = TFrameSize;
+  }
+  UpdateSensorMode();
+}
+
+/**
+   @brief Set stream Frame Size
+   @param uint8_t - frame size, CAMERA_STREAM_SAME_AS_PHOTO = photo frame size
+   @return none
+*/
+void Camera::SetStreamFrameSize(uint8_t i_data) {
+  config->SaveStreamFrameSize(i_data);
+  StreamFrameSize = i_data;
+  TStreamFrameSize = (CAMERA_STREAM_SAME_AS_PHOTO == StreamFrameSize) ? TFrameSize : TransformFrameSizeDataType(StreamFrameSize);
+  UpdateSensorMode();
+}
+
+/**
+   @brief Set stream Quality
+   @param uint8_t - quality, CAMERA_STREAM_SAME_AS_PHOTO = photo quality
+   @return none
+*/
+void Camera::SetStreamQuality(uint8_t i_data) {
+  config->SaveStreamQuality(i_data);
+  StreamQuality = i_data;
+  StreamQualityDrop = 0;
+  UpdateSensorMode();
 }
 
 /**
@@ -1037,6 +1750,20 @@ void Camera::SetCameraFlashTime(uint16_t i_data) {
   CameraFlashTime = i_data;
 }
 
+/**
+   @brief Set motion cadence. The static scene is uploaded with the longer interval, the scene change returns to the trigger interval
+   @param bool - motion cadence enable/disable
+   @return none
+*/
+void Camera::SetMotionCadence(bool i_data) {
+  config->SaveMotionCadence(i_data);
+  MotionCadence = i_data;
+
+  if ((true == MotionCadence) && (false == Motion.Init())) {
+    log->AddEvent(LogLevel_Error, F("Motion detection: failed to allocate luma grid"));
+  }
+}
+
 void Camera::SetCameraImageRotation(uint8_t i_data) {
   config->SaveCameraImageExifRotation(i_data);
   imageExifRotation = i_data;
@@ -1060,6 +1787,33 @@ uint8_t Camera::GetFrameSize() {
   return FrameSize;
 }
 
+/**
+   @brief Get stream Frame Size
+   @param none
+   @return uint8_t - frame size, CAMERA_STREAM_SAME_AS_PHOTO = photo frame size
+*/
+uint8_t Camera::GetStreamFrameSize() {
+  return StreamFrameSize;
+}
+
+/**
+   @brief Get stream Quality
+   @param none
+   @return uint8_t - quality, CAMERA_STREAM_SAME_AS_PHOTO = photo quality
+*/
+uint8_t Camera::GetStreamQuality() {
+  return StreamQuality;
+}
+
+/**
+   @brief Check if the stream uses other resolution or quality than the photo
+   @param none
+   @return bool - true = photo is captured in the own sensor mode
+*/
+bool Camera::GetDualResolution() {
+  return ((TStreamFrameSize != TFrameSize) || (GetStreamSensorQuality() != PhotoQuality));
+}
+
 /**
  * @brief transform framesize_t to uint16_t width
  * 
@@ -1322,6 +2076,15 @@ bool Camera::GetCameraFlashEnable() {
   return CameraFlashEnable;
 }
 
+/**
+   @brief Get motion cadence status
+   @param none
+   @return bool - motion cadence enable status
+*/
+bool Camera::GetMotionCadence() {
+  return MotionCadence;
+}
+
 /**
  * @brief Get camera flash time
  * @param none
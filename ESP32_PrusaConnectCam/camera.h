@@ -21,18 +21,17 @@
 #include "log.h"
 #include "cfg.h"
 #include "exif.h"
+#include "camera_frame.h"
+#include "jpeg_check.h"
+#include "motion.h"
+#include "preevent.h"
+#include "latency.h"
 #include "module_templates.h"
 #include "mcu_cfg.h"
 #include "var.h"
 
 class Configuration;
 
-struct PhotoExifData_t {
-  const uint8_t *header;
-  size_t len;
-  size_t offset;
-};
-
 class Camera {
 private:
   uint8_t PhotoQuality;      ///< photo quality
@@ -59,25 +58,54 @@ private:
   uint16_t CameraFlashTime;  ///< camera fash duration time
   int8_t CameraFlashPin;     ///< GPIO pin for LED
   framesize_t TFrameSize;    ///< framesize_t type for camera module
+  framesize_t AllocatedFrameSize; ///< frame size used for the frame buffer allocation
+  uint8_t FbCount;           ///< count of frame buffers allocated by the camera driver for the frame size
+  uint8_t StreamFrameSize;   ///< stream frame size from web, CAMERA_STREAM_SAME_AS_PHOTO = photo frame size
+  framesize_t TStreamFrameSize; ///< framesize_t type for the stream
+  uint8_t StreamQuality;     ///< stream quality, CAMERA_STREAM_SAME_AS_PHOTO = photo quality
+  framesize_t SensorFrameSize; ///< frame size active in the sensor
+  uint8_t SensorQuality;     ///< quality active in the sensor
+  bool ReconfigPending;      ///< waiting for the first valid frame after reconfiguration
+  uint32_t PhotoCaptureCount;   ///< count of captured photos
+  uint32_t PhotoStaleDiscards;  ///< count of discarded frames captured before the photo request
+  uint32_t PhotoBufferSkips;    ///< count of photos skipped, all frame buffers were held by consumers
+  uint32_t PhotoLatency;        ///< time from the photo request to the captured frame [ms]
+  uint32_t PhotoTruncatedFrames; ///< count of discarded photo frames without EOI
+  uint32_t PhotoCorruptFrames;  ///< count of discarded photo frames with bad jpeg structure
+  uint32_t StreamFailedCaptures; ///< count of stream captures without a valid frame after max attempts
+  int64_t ReconfigTime;      ///< time of the last reconfiguration [us]
   uint8_t imageExifRotation; ///< image rotation. 0 degree: value 1, 90 degree: value 6, 180 degree: value 3, 270 degree: value 8
 
   bool CameraCaptureSuccess; ///< camera capture success
-  bool PhotoSending;         ///< photo sending
 
   /* OV2640 camera module pinout and cfg*/
   camera_config_t CameraConfig;             ///< camera configuration
-  camera_fb_t *FrameBuffer;                 ///< frame buffer
-  camera_fb_t *FrameBufferDuplicate;        ///< frame buffer duplicate
-  camera_fb_t *FrameBufferExif;             ///< frame buffer with exif data
+  CameraFrameRing FrameRing;                ///< ref-counted frames shared between consumers
+  CameraFrame_t *PhotoFrame;                ///< last captured photo, camera holds one reference
+  CameraFrame_t *StreamFrame;               ///< last captured stream frame, camera holds one reference
+  CameraSubscriber_t Subscribers[CAMERA_MAX_SUBSCRIBERS]; ///< consumers of the published frames
+  uint32_t ChannelSequence[CameraChannel_Count];          ///< count of published frames for each channel
+  uint8_t StreamSubscribers;                ///< count of stream subscribers
+  bool CaptureTaskRunning;                  ///< camera driver is owned by the capture task
+  volatile bool PhotoRequest;               ///< photo requested from the capture task
+  volatile bool ReinitRequest;              ///< camera module reinit requested from the capture task
+  volatile bool SensorModeRequest;          ///< changed resolution or quality to be applied by the capture task
+  uint32_t ReinitWaitLog;                   ///< time of the last log about frames held during the reinit wait [ms]
+  SemaphoreHandle_t PhotoRequestMutex;      ///< one photo request at a time
+  SemaphoreHandle_t PhotoDoneSemaphore;     ///< photo request done by the capture task
   sensor_t* sensor;                         ///< sensor
-  String Photo;                             ///< photo in string format
   bool StreamOnOff;                         ///< stream on/off
-  bool StreamSendingPhoto;                  ///< sending photo to Prusa Connect during stream
-  SemaphoreHandle_t frameBufferSemaphore;   ///< semaphore for frame buffer
+  SemaphoreHandle_t frameBufferSemaphore;   ///< camera driver mutex, held by the capture task during capture and sensor changes
+  SemaphoreHandle_t FrameMutex;             ///< short lock for the latest frames, channel sequences and subscribers. Never held during camera driver calls
   float StreamAverageFps;                   ///< stream average fps
   uint16_t StreamAverageSize;               ///< stream average size
-  PhotoExifData_t PhotoExifData;            ///< photo exif data
+  uint32_t StreamSentBytes;                 ///< count of bytes sent to all stream clients
+  uint8_t StreamQualityDrop;                ///< jpeg quality drop for the congested single stream client
+  uint32_t StreamQualityChanged;            ///< time of the last jpeg quality change [ms]
   uint8_t CameraCaptureFailedCounter;       ///< camera capture failed counter
+  MotionDetector Motion;                    ///< scene change detection from the jpeg DC coefficients
+  bool MotionCadence;                       ///< slower photo upload for the static scene, the scene is sampled
+  uint32_t MotionSampleTime;                ///< time of the last motion sample [ms]
   camera_pid_t CameraType;                  ///< camera type
   String CameraName;                        ///< camera name
 
@@ -85,6 +113,23 @@ private:
   Logs *log;                                ///< pointer to Logs object
 
   void InitCameraModule();
+  void SetFrameExif(CameraFrame_t *);
+  void CapturePhotoFrame();
+  void CaptureStreamFrame();
+  void AdaptStreamQuality();
+  void SampleScene();
+  bool GetMotionSampling();
+  void ProcessSceneFrame(const CameraFrameView_t *, camera_fb_t *, bool, bool);
+  void StartReconfig();
+  framesize_t GetRequiredFrameSize();
+  uint8_t GetFrameBufferCount(framesize_t);
+  uint8_t GetStreamSensorQuality();
+  bool ApplySensorMode(bool);
+  void UpdateSensorMode();
+  bool ProcessReinit();
+  void ProcessSensorMode();
+  void PublishFrame(CameraChannel_enum, CameraFrame_t *);
+  bool CheckReconfigFrame(camera_fb_t *);
 
 public:
   Camera(Configuration*, Logs*, int8_t);
@@ -95,36 +140,50 @@ public:
   void ReinitCameraModule();
   void GetCameraModel();
   void CapturePhoto();
-  void CaptureStream(camera_fb_t *);
-  void CaptureReturnFrameBuffer();
-  void SetStreamStatus(bool);
+  void SetCaptureTaskStatus(bool);
+  void CaptureTaskProcess();
+  CameraFrame_t *GetPhotoFrame();
+  void ReleaseFrame(CameraFrame_t *);
+  uint8_t GetFramesInUse();
+  uint8_t GetFbCount();
+
+  int8_t Subscribe(CameraChannel_enum, const char *);
+  void Unsubscribe(int8_t);
+  CameraFrame_t *GetSubscriberFrame(int8_t, bool);
+  bool GetSubscriberInfo(uint8_t, CameraSubscriber_t *);
+  void SetSubscriberRate(int8_t, float, uint16_t, bool);
   bool GetStreamStatus();
+  uint8_t GetStreamClients();
+  uint32_t GetStreamFrameCount();
   bool GetCameraCaptureSuccess();
+  uint32_t GetPhotoCaptureCount();
+  uint32_t GetPhotoStaleDiscards();
+  uint32_t GetPhotoBufferSkips();
+  uint32_t GetPhotoLatency();
+  uint32_t GetPhotoTruncatedFrames();
+  uint32_t GetPhotoCorruptFrames();
+  uint32_t GetStreamFailedCaptures();
+  uint8_t GetMotionScore();
+  uint32_t GetMotionChangeCount();
+  uint32_t GetMotionAnalysisTime();
 
   void StreamSetFrameSize(uint16_t);
   void StreamSetFrameFps(float);
   uint16_t StreamGetFrameAverageSize();
   float StreamGetFrameAverageFps();
   void StreamClearFrameData();
-  void StreamSetSendingPhoto(bool);
-  
-  void CopyPhoto(camera_fb_t *);
-  void CopyPhoto(String*);
-  void CopyPhoto(String*, int, int);
-  void CopyPhoto(char*, int, int);
-  int GetPhotoSize();
-  String GetPhoto();
-  camera_fb_t *GetPhotoFb();
-  camera_fb_t* GetPhotoFbDuplicate();
-  PhotoExifData_t * GetPhotoExifData();
+  void StreamAddSentBytes(uint32_t);
+  uint32_t StreamGetSentBytes();
+
   framesize_t TransformFrameSizeDataType(uint8_t);
-  void SetPhotoSending(bool);
   
   void SetFlashStatus(bool);
   bool GetFlashStatus();
 
   void SetPhotoQuality(uint8_t);
   void SetFrameSize(uint8_t);
+  void SetStreamFrameSize(uint8_t);
+  void SetStreamQuality(uint8_t);
   void SetBrightness(int8_t);
   void SetContrast(int8_t);
   void SetSaturation(int8_t);
@@ -146,9 +205,13 @@ public:
   void SetCameraFlashEnable(bool);
   void SetCameraFlashTime(uint16_t);
   void SetCameraImageRotation(uint8_t);
+  void SetMotionCadence(bool);
 
   uint8_t GetPhotoQuality();
   uint8_t GetFrameSize();
+  uint8_t GetStreamFrameSize();
+  uint8_t GetStreamQuality();
+  bool GetDualResolution();
   uint16_t GetFrameSizeWidth();
   uint16_t GetFrameSizeHeight();
   int8_t GetBrightness();
@@ -172,6 +235,7 @@ public:
   bool GetCameraFlashEnable();
   uint16_t GetCameraFlashTime();
   uint8_t GetCameraImageRotation();
+  bool GetMotionCadence();
 };
 
 extern Camera SystemCamera; ///< Camera object
@@ -0,0 +1,231 @@
+/**
+   @file camera_frame.cpp
+
+   @brief Library for sharing camera frame buffers between consumers
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "camera_frame.h"
+
+/**
+   @brief Constructor for CameraFrameRing class
+   @param none
+   @return none
+*/
+CameraFrameRing::CameraFrameRing() {
+  RingMutex = xSemaphoreCreateMutex();
+  SequenceCounter = 0;
+  FramesInUse = 0;
+  memset(Frames, 0, sizeof(Frames));
+}
+
+/**
+   @brief Wrap a frame buffer from the camera driver into a free slot.
+          The caller receives the first reference.
+   @param camera_fb_t* - frame buffer from esp_camera_fb_get()
+   @return CameraFrame_t* - frame handle, or NULL when no slot is free
+*/
+CameraFrame_t *CameraFrameRing::Publish(camera_fb_t *i_fb) {
+  CameraFrame_t *ret = NULL;
+
+  if (NULL == i_fb) {
+    return NULL;
+  }
+
+  xSemaphoreTake(RingMutex, portMAX_DELAY);
+  for (uint8_t i = 0; i < CAMERA_FB_COUNT; i++) {
+    if (0 == Frames[i].RefCount) {
+      ret = &Frames[i];
+      ret->fb = i_fb;
+      ret->RefCount = 1;
+      ret->Sequence = ++SequenceCounter;
+      ret->CaptureTime = CameraFrame_GetCaptureTime(i_fb);
+      ret->ExifHeader = NULL;
+      ret->ExifLen = 0;
+      ret->ExifOffset = 0;
+      /* ExifBuffer is kept for the next frame in this slot */
+      FramesInUse++;
+      break;
+    }
+  }
+  xSemaphoreGive(RingMutex);
+
+  /* the driver never hands out more buffers than slots, but never leak a frame buffer */
+  if (NULL == ret) {
+    esp_camera_fb_return(i_fb);
+  }
+
+  return ret;
+}
+
+/**
+   @brief Add a reference to the frame
+   @param CameraFrame_t* - frame handle
+   @return none
+*/
+void CameraFrameRing::Retain(CameraFrame_t *i_frame) {
+  if (NULL == i_frame) {
+    return;
+  }
+
+  xSemaphoreTake(RingMutex, portMAX_DELAY);
+  if (i_frame->RefCount > 0) {
+    i_frame->RefCount++;
+  }
+  xSemaphoreGive(RingMutex);
+}
+
+/**
+   @brief Drop a reference to the frame. The last holder returns the buffer to the camera driver
+   @param CameraFrame_t* - frame handle
+   @return none
+*/
+void CameraFrameRing::Release(CameraFrame_t *i_frame) {
+  camera_fb_t *fb = NULL;
+
+  if (NULL == i_frame) {
+    return;
+  }
+
+  xSemaphoreTake(RingMutex, portMAX_DELAY);
+  if (i_frame->RefCount > 0) {
+    i_frame->RefCount--;
+    if (0 == i_frame->RefCount) {
+      fb = i_frame->fb;
+      i_frame->fb = NULL;
+      FramesInUse--;
+    }
+  }
+  xSemaphoreGive(RingMutex);
+
+  if (NULL != fb) {
+    esp_camera_fb_return(fb);
+  }
+}
+
+/**
+   @brief Store exif header to the frame slot. The header is copied once, the jpeg data is never copied
+   @param CameraFrame_t* - frame handle, held only by the caller
+   @param const uint8_t* - exif header
+   @param size_t - exif header length
+   @param size_t - offset of the first jpeg byte after the original header
+   @return bool - true = exif stored
+*/
+bool CameraFrameRing::SetExif(CameraFrame_t *i_frame, const uint8_t *i_header, size_t i_len, size_t i_offset) {
+  i_frame->ExifHeader = NULL;
+  i_frame->ExifLen = 0;
+  i_frame->ExifOffset = 0;
+
+  if ((NULL == i_header) || (0 == i_len) || (0 == i_offset)) {
+    return false;
+  }
+
+  /* the storage is taken from the frame pool once for each slot */
+  if (i_frame->ExifBufferSize < i_len) {
+    SystemFramePool.Free(i_frame->ExifBuffer);
+    i_frame->ExifBufferSize = 0;
+    i_frame->ExifBuffer = SystemFramePool.Alloc(i_len, &i_frame->ExifBufferSize);
+  }
+
+  if (NULL == i_frame->ExifBuffer) {
+    return false;
+  }
+
+  memcpy(i_frame->ExifBuffer, i_header, i_len);
+  i_frame->ExifHeader = i_frame->ExifBuffer;
+  i_frame->ExifLen = i_len;
+  i_frame->ExifOffset = i_offset;
+
+  return true;
+}
+
+/**
+   @brief Get count of frames held by consumers
+   @param none
+   @return uint8_t - count of frames
+*/
+uint8_t CameraFrameRing::GetFramesInUse() {
+  return FramesInUse;
+}
+
+/**
+   @brief Get sequence number of the last published frame
+   @param none
+   @return uint32_t - sequence number
+*/
+uint32_t CameraFrameRing::GetLastSequence() {
+  return SequenceCounter;
+}
+
+/**
+   @brief Get capture time of the frame buffer. The camera driver stores esp_timer time to the timestamp
+   @param const camera_fb_t* - frame buffer
+   @return int64_t - capture time [us]
+*/
+int64_t CameraFrame_GetCaptureTime(const camera_fb_t *i_fb) {
+  return ((int64_t)i_fb->timestamp.tv_sec * 1000000) + i_fb->timestamp.tv_usec;
+}
+
+/**
+   @brief Get segmented view of the frame. Exif header first, then jpeg data after the original header
+   @param const CameraFrame_t* - frame handle
+   @param CameraFrameView_t* - output view
+   @return none
+*/
+void CameraFrame_GetView(const CameraFrame_t *i_frame, CameraFrameView_t *o_view) {
+  o_view->Count = 0;
+  o_view->Len = 0;
+
+  if ((NULL == i_frame) || (NULL == i_frame->fb)) {
+    return;
+  }
+
+  if (NULL != i_frame->ExifHeader) {
+    o_view->Segment[o_view->Count].ptr = i_frame->ExifHeader;
+    o_view->Segment[o_view->Count].len = i_frame->ExifLen;
+    o_view->Len += i_frame->ExifLen;
+    o_view->Count++;
+
+    o_view->Segment[o_view->Count].ptr = i_frame->fb->buf + i_frame->ExifOffset;
+    o_view->Segment[o_view->Count].len = i_frame->fb->len - i_frame->ExifOffset;
+  } else {
+    o_view->Segment[o_view->Count].ptr = i_frame->fb->buf;
+    o_view->Segment[o_view->Count].len = i_frame->fb->len;
+  }
+  o_view->Len += o_view->Segment[o_view->Count].len;
+  o_view->Count++;
+}
+
+/**
+   @brief Copy range of the frame view to the buffer
+   @param const CameraFrameView_t* - frame view
+   @param uint8_t* - output buffer
+   @param size_t - position in the frame
+   @param size_t - maximum length
+   @return size_t - copied length
+*/
+size_t CameraFrame_CopyView(const CameraFrameView_t *i_view, uint8_t *o_buffer, size_t i_index, size_t i_maxLen) {
+  size_t copied = 0;
+  size_t SegmentStart = 0;
+
+  for (uint8_t i = 0; (i < i_view->Count) && (copied < i_maxLen); i++) {
+    const FrameSegment_t *segment = &i_view->Segment[i];
+    size_t position = i_index + copied;
+
+    if (position < (SegmentStart + segment->len)) {
+      size_t offset = position - SegmentStart;
+      size_t len = min(i_maxLen - copied, segment->len - offset);
+      memcpy(o_buffer + copied, segment->ptr + offset, len);
+      copied += len;
+    }
+    SegmentStart += segment->len;
+  }
+
+  return copied;
+}
+
+/* EOF */
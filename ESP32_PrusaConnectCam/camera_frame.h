@@ -0,0 +1,92 @@
+/**
+   @file camera_frame.h
+
+   @brief Library for sharing camera frame buffers between consumers
+
+   Frame buffers from the camera driver are wrapped into reference counted
+   handles. The stream, the web server, the Prusa Connect uploader and the
+   SD card writer hold a reference to the same frame, and the buffer is
+   returned to the camera driver after the last holder releases it.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "esp_camera.h"
+
+#include "mcu_cfg.h"
+#include "frame_pool.h"
+
+#define CAMERA_FRAME_MAX_SEGMENTS   2   ///< exif header and jpeg data
+
+struct CameraFrame_t {
+  camera_fb_t *fb;            ///< frame buffer from camera driver
+  uint8_t RefCount;           ///< count of frame holders
+  uint32_t Sequence;          ///< frame sequence number
+  int64_t CaptureTime;        ///< capture time of the frame from the camera driver [us]
+  const uint8_t *ExifHeader;  ///< exif header, NULL = frame without exif
+  size_t ExifLen;             ///< exif header length
+  size_t ExifOffset;          ///< offset of the first jpeg byte after the original header
+  uint8_t *ExifBuffer;        ///< exif header storage of the slot from the frame pool. The exif library uses one static header
+  size_t ExifBufferSize;      ///< exif header storage size
+};
+
+enum CameraChannel_enum {
+  CameraChannel_Stream = 0,   ///< continuous frames for the video stream
+  CameraChannel_Photo = 1,    ///< requested photos for Prusa Connect and timelapse
+  CameraChannel_Count = 2,    ///< count of channels
+};
+
+struct CameraSubscriber_t {
+  bool Active;                ///< slot is used
+  CameraChannel_enum Channel; ///< subscribed channel
+  const char *Name;           ///< subscriber name for logs and web API
+  uint32_t LastSequence;      ///< last delivered channel sequence
+  uint32_t Delivered;         ///< count of delivered frames
+  uint32_t Dropped;           ///< count of frames published to the channel, but never delivered to the subscriber
+  float Fps;                  ///< effective frame rate of the stream client
+  uint16_t Kbps;              ///< measured send throughput of the stream client [kbit/s]
+  bool Congested;             ///< stream client can not send frames in time
+};
+
+struct FrameSegment_t {
+  const uint8_t *ptr;         ///< pointer to data
+  size_t len;                 ///< data length
+};
+
+struct CameraFrameView_t {
+  FrameSegment_t Segment[CAMERA_FRAME_MAX_SEGMENTS];  ///< frame segments in output order
+  uint8_t Count;                                      ///< count of used segments
+  size_t Len;                                         ///< total length of the frame
+};
+
+class CameraFrameRing {
+private:
+  CameraFrame_t Frames[CAMERA_FB_COUNT];  ///< frame slots, one slot for each camera driver frame buffer
+  SemaphoreHandle_t RingMutex;            ///< mutex for reference counters
+  uint32_t SequenceCounter;               ///< last frame sequence number
+  uint8_t FramesInUse;                    ///< count of frames held by consumers
+
+public:
+  CameraFrameRing();
+  ~CameraFrameRing(){};
+
+  CameraFrame_t *Publish(camera_fb_t *);
+  void Retain(CameraFrame_t *);
+  void Release(CameraFrame_t *);
+  bool SetExif(CameraFrame_t *, const uint8_t *, size_t, size_t);
+
+  uint8_t GetFramesInUse();
+  uint32_t GetLastSequence();
+};
+
+int64_t CameraFrame_GetCaptureTime(const camera_fb_t *);
+void CameraFrame_GetView(const CameraFrame_t *, CameraFrameView_t *);
+size_t CameraFrame_CopyView(const CameraFrameView_t *, uint8_t *, size_t, size_t);
+
+/* EOF */
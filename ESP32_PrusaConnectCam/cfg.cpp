@@ -56,6 +56,8 @@ void Configuration::ReadCfg() {
   LoadFingerprint();
   LoadPhotoQuality();
   LoadFrameSize();
+  LoadStreamFrameSize();
+  LoadStreamQuality();
   LoadBrightness();
   LoadContrast();
   LoadSaturation();
@@ -90,6 +92,18 @@ void Configuration::ReadCfg() {
   LoadNetworkDns();
   LoadCameraImageExifRotation();
   LoadTimeLapseFunctionStatus();
+  LoadTimeLapseAviStatus();
+  LoadSinkHttpUrl();
+  LoadSinkHttpMethod();
+  LoadMqttEnable();
+  LoadMqttHost();
+  LoadMqttPort();
+  LoadMqttUser();
+  LoadMqttPassword();
+  LoadMqttTopic();
+  LoadMqttSnapshot();
+  LoadMqttQos();
+  LoadMotionCadence();
   Log->AddEvent(LogLevel_Info, F("Active WiFi client cfg: "), String(CheckActifeWifiCfgFlag() ? "true" : "false"));
   Log->AddEvent(LogLevel_Info, F("Load CFG from EEPROM done"));
 }
@@ -138,6 +152,8 @@ void Configuration::DefaultCfg() {
   GetFingerprint();
   SavePhotoQuality(FACTORY_CFG_PHOTO_QUALITY);
   SaveFrameSize(FACTORY_CFG_FRAME_SIZE);
+  SaveStreamFrameSize(FACTORY_CFG_STREAM_FRAME_SIZE);
+  SaveStreamQuality(FACTORY_CFG_STREAM_QUALITY);
   SaveBrightness(FACTORY_CFG_BRIGHTNESS);
   SaveContrast(FACTORY_CFG_CONTRAST);
   SaveSaturation(FACTORY_CFG_SATURATION);
@@ -175,6 +191,18 @@ void Configuration::DefaultCfg() {
   SaveNetworkDns(FACTORY_CFG_NETWORK_STATIC_DNS);
   SaveCameraImageExifRotation(FACTORY_CFG_IMAGE_EXIF_ROTATION);
   SaveTimeLapseFunctionStatus(FACTORY_CFG_TIMELAPS_ENABLE);
+  SaveTimeLapseAviStatus(FACTORY_CFG_TIMELAPS_AVI);
+  SaveSinkHttpUrl(FACTORY_CFG_SINK_HTTP_URL);
+  SaveSinkHttpMethod(FACTORY_CFG_SINK_HTTP_METHOD);
+  SaveMqttEnable(FACTORY_CFG_MQTT_ENABLE);
+  SaveMqttHost(FACTORY_CFG_MQTT_HOST);
+  SaveMqttPort(FACTORY_CFG_MQTT_PORT);
+  SaveMqttUser(FACTORY_CFG_MQTT_USER);
+  SaveMqttPassword(FACTORY_CFG_MQTT_PASSWORD);
+  SaveMqttTopic(FACTORY_CFG_MQTT_TOPIC);
+  SaveMqttSnapshot(FACTORY_CFG_MQTT_SNAPSHOT);
+  SaveMqttQos(FACTORY_CFG_MQTT_QOS);
+  SaveMotionCadence(FACTORY_CFG_MOTION_CADENCE);
   SaveExternalTemperatureSensorEnable(FACTORY_CFG_ENABLE_EXT_SENSOR);
   SaveExternalTemperatureSensorUnit(FACTORY_CFG_EXT_SENSOR_UNIT);
   Log->AddEvent(LogLevel_Warning, F("+++++++++++++++++++++++++++"));
@@ -235,6 +263,7 @@ void Configuration::CheckResetCfg() {
     digitalWrite(CFG_RESET_LED_PIN, !CFG_RESET_LED_LEVEL_ON);
 
     DefaultCfg();
+    Log->Flush();
     ESP.restart();
 
   } else {
@@ -481,6 +510,26 @@ void Configuration::SaveFrameSize(uint8_t i_data) {
   SaveUint8(EEPROM_ADDR_FRAMESIZE_START, i_data);
 }
 
+/**
+   @info save stream framesize to EEPROM
+   @param uint8_t - framesize, CAMERA_STREAM_SAME_AS_PHOTO = photo framesize
+   @return none
+*/
+void Configuration::SaveStreamFrameSize(uint8_t i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save stream FrameSize: "), String(i_data));
+  SaveUint8(EEPROM_ADDR_STREAM_FRAMESIZE_START, i_data);
+}
+
+/**
+   @info save stream quality to EEPROM
+   @param uint8_t - quality, CAMERA_STREAM_SAME_AS_PHOTO = photo quality
+   @return none
+*/
+void Configuration::SaveStreamQuality(uint8_t i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save stream quality: "), String(i_data));
+  SaveUint8(EEPROM_ADDR_STREAM_QUALITY_START, i_data);
+}
+
 /**
    @info save brightness to EEPROM
    @param uint8_t - brightness
@@ -854,6 +903,126 @@ void Configuration::SaveTimeLapseFunctionStatus(bool i_data) {
   SaveBool(EEPROM_ADDR_TIMELAPS_ENABLE_START, i_data);
 }
 
+/**
+   @info Save time lapse AVI format status
+   @param bool - value
+   @return none
+*/
+void Configuration::SaveTimeLapseAviStatus(bool i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save time lapse AVI status: "), String(i_data));
+  SaveBool(EEPROM_ADDR_TIMELAPS_AVI_START, i_data);
+}
+
+/**
+   @info Save URL of the local HTTP target
+   @param String - URL
+   @return none
+*/
+void Configuration::SaveSinkHttpUrl(String i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save HTTP target URL["), String(i_data.length()) + "]: " + i_data);
+  SaveString(EEPROM_ADDR_SINK_HTTP_URL_START, EEPROM_ADDR_SINK_HTTP_URL_LENGTH, i_data);
+}
+
+/**
+   @info Save HTTP method of the local HTTP target
+   @param uint8_t - value. 0 - disabled, 1 - POST, 2 - PUT
+   @return none
+*/
+void Configuration::SaveSinkHttpMethod(uint8_t i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save HTTP target method: "), String(i_data));
+  SaveUint8(EEPROM_ADDR_SINK_HTTP_METHOD_START, i_data);
+}
+
+/**
+   @info Save MQTT client enable
+   @param bool - value
+   @return none
+*/
+void Configuration::SaveMqttEnable(bool i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save MQTT enable: "), String(i_data));
+  SaveBool(EEPROM_ADDR_MQTT_ENABLE_START, i_data);
+}
+
+/**
+   @info Save MQTT broker hostname
+   @param String - hostname or IP
+   @return none
+*/
+void Configuration::SaveMqttHost(String i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save MQTT host["), String(i_data.length()) + "]: " + i_data);
+  SaveString(EEPROM_ADDR_MQTT_HOST_START, EEPROM_ADDR_MQTT_HOST_LENGTH, i_data);
+}
+
+/**
+   @info Save MQTT broker port
+   @param uint16_t - port
+   @return none
+*/
+void Configuration::SaveMqttPort(uint16_t i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save MQTT port: "), String(i_data));
+  SaveUint16(EEPROM_ADDR_MQTT_PORT_START, i_data);
+}
+
+/**
+   @info Save MQTT user name
+   @param String - user name
+   @return none
+*/
+void Configuration::SaveMqttUser(String i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save MQTT user["), String(i_data.length()) + "]: " + i_data);
+  SaveString(EEPROM_ADDR_MQTT_USER_START, EEPROM_ADDR_MQTT_USER_LENGTH, i_data);
+}
+
+/**
+   @info Save MQTT password
+   @param String - password
+   @return none
+*/
+void Configuration::SaveMqttPassword(String i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save MQTT password["), String(i_data.length()) + "]: ");
+  SaveString(EEPROM_ADDR_MQTT_PASSWORD_START, EEPROM_ADDR_MQTT_PASSWORD_LENGTH, i_data);
+}
+
+/**
+   @info Save MQTT base topic
+   @param String - topic
+   @return none
+*/
+void Configuration::SaveMqttTopic(String i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save MQTT topic["), String(i_data.length()) + "]: " + i_data);
+  SaveString(EEPROM_ADDR_MQTT_TOPIC_START, EEPROM_ADDR_MQTT_TOPIC_LENGTH, i_data);
+}
+
+/**
+   @info Save MQTT snapshot publishing enable
+   @param bool - value
+   @return none
+*/
+void Configuration::SaveMqttSnapshot(bool i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save MQTT snapshot: "), String(i_data));
+  SaveBool(EEPROM_ADDR_MQTT_SNAPSHOT_START, i_data);
+}
+
+/**
+   @info Save QoS of the MQTT messages
+   @param uint8_t - QoS, 0 or 1
+   @return none
+*/
+void Configuration::SaveMqttQos(uint8_t i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save MQTT QoS: "), String(i_data));
+  SaveUint8(EEPROM_ADDR_MQTT_QOS_START, i_data);
+}
+
+/**
+   @info Save motion cadence enable
+   @param bool - value
+   @return none
+*/
+void Configuration::SaveMotionCadence(bool i_data) {
+  Log->AddEvent(LogLevel_Verbose, F("Save motion cadence: "), String(i_data));
+  SaveBool(EEPROM_ADDR_MOTION_CADENCE_START, i_data);
+}
+
 /**
    @info Save external temperature sensor enable
    @param bool - value
@@ -933,6 +1102,28 @@ uint8_t Configuration::LoadFrameSize() {
   return ret;
 }
 
+/**
+   @info load stream framesize cfg from eeprom. Empty EEPROM is CAMERA_STREAM_SAME_AS_PHOTO
+   @param none
+   @return uint8_t - framesize
+*/
+uint8_t Configuration::LoadStreamFrameSize() {
+  uint8_t ret = EEPROM.read(EEPROM_ADDR_STREAM_FRAMESIZE_START);
+  Log->AddEvent(LogLevel_Info, F("Stream framesize: "), String(ret));
+  return ret;
+}
+
+/**
+   @info load stream quality cfg from eeprom. Empty EEPROM is CAMERA_STREAM_SAME_AS_PHOTO
+   @param none
+   @return uint8_t - quality
+*/
+uint8_t Configuration::LoadStreamQuality() {
+  uint8_t ret = EEPROM.read(EEPROM_ADDR_STREAM_QUALITY_START);
+  Log->AddEvent(LogLevel_Info, F("Stream quality: "), String(ret));
+  return ret;
+}
+
 /**
    @info load Brightness cfg from eeprom
    @param none
@@ -1385,6 +1576,178 @@ bool Configuration::LoadTimeLapseFunctionStatus() {
   return (bool) ret;
 }
 
+/**
+ * @brief Load time lapse AVI format status
+ * 
+ * @return bool - status
+ */
+bool Configuration::LoadTimeLapseAviStatus() {
+  uint8_t ret = EEPROM.read(EEPROM_ADDR_TIMELAPS_AVI_START);
+  Log->AddEvent(LogLevel_Info, F("Time lapse AVI status: "), String(ret));
+
+  if (ret == 255) {
+    ret = FACTORY_CFG_TIMELAPS_AVI;
+  }
+
+  return (bool) ret;
+}
+
+/**
+ * @brief Load URL of the local HTTP target
+ * 
+ * @return String - URL
+ */
+String Configuration::LoadSinkHttpUrl() {
+  Log->AddEvent(LogLevel_Info, F("HTTP target URL: "), false);
+  String ret = LoadString(EEPROM_ADDR_SINK_HTTP_URL_START, EEPROM_ADDR_SINK_HTTP_URL_LENGTH, true);
+
+  return ret;
+}
+
+/**
+ * @brief Load HTTP method of the local HTTP target
+ * 
+ * @return uint8_t - 0 - disabled, 1 - POST, 2 - PUT
+ */
+uint8_t Configuration::LoadSinkHttpMethod() {
+  uint8_t ret = EEPROM.read(EEPROM_ADDR_SINK_HTTP_METHOD_START);
+
+  if (ret == 255) {
+    ret = FACTORY_CFG_SINK_HTTP_METHOD;
+  }
+  Log->AddEvent(LogLevel_Info, F("HTTP target method: "), String(ret));
+
+  return ret;
+}
+
+/**
+ * @brief Load MQTT client enable
+ * 
+ * @return bool - status
+ */
+bool Configuration::LoadMqttEnable() {
+  uint8_t ret = EEPROM.read(EEPROM_ADDR_MQTT_ENABLE_START);
+
+  if (ret == 255) {
+    ret = FACTORY_CFG_MQTT_ENABLE;
+  }
+  Log->AddEvent(LogLevel_Info, F("MQTT enable: "), String(ret));
+
+  return (bool) ret;
+}
+
+/**
+ * @brief Load MQTT broker hostname
+ * 
+ * @return String - hostname or IP
+ */
+String Configuration::LoadMqttHost() {
+  Log->AddEvent(LogLevel_Info, F("MQTT host: "), false);
+  String ret = LoadString(EEPROM_ADDR_MQTT_HOST_START, EEPROM_ADDR_MQTT_HOST_LENGTH, true);
+
+  return ret;
+}
+
+/**
+ * @brief Load MQTT broker port
+ * 
+ * @return uint16_t - port
+ */
+uint16_t Configuration::LoadMqttPort() {
+  uint16_t ret = LoadUint16(EEPROM_ADDR_MQTT_PORT_START);
+
+  if ((ret == 0) || (ret == 0xFFFF)) {
+    ret = FACTORY_CFG_MQTT_PORT;
+  }
+  Log->AddEvent(LogLevel_Info, F("MQTT port: "), String(ret));
+
+  return ret;
+}
+
+/**
+ * @brief Load MQTT user name
+ * 
+ * @return String - user name
+ */
+String Configuration::LoadMqttUser() {
+  Log->AddEvent(LogLevel_Info, F("MQTT user: "), false);
+  String ret = LoadString(EEPROM_ADDR_MQTT_USER_START, EEPROM_ADDR_MQTT_USER_LENGTH, true);
+
+  return ret;
+}
+
+/**
+ * @brief Load MQTT password
+ * 
+ * @return String - password
+ */
+String Configuration::LoadMqttPassword() {
+  Log->AddEvent(LogLevel_Info, F("MQTT password: "), false);
+  String ret = LoadString(EEPROM_ADDR_MQTT_PASSWORD_START, EEPROM_ADDR_MQTT_PASSWORD_LENGTH, CONSOLE_VERBOSE_DEBUG);
+
+  return ret;
+}
+
+/**
+ * @brief Load MQTT base topic
+ * 
+ * @return String - topic
+ */
+String Configuration::LoadMqttTopic() {
+  Log->AddEvent(LogLevel_Info, F("MQTT topic: "), false);
+  String ret = LoadString(EEPROM_ADDR_MQTT_TOPIC_START, EEPROM_ADDR_MQTT_TOPIC_LENGTH, true);
+
+  return ret;
+}
+
+/**
+ * @brief Load MQTT snapshot publishing enable
+ * 
+ * @return bool - status
+ */
+bool Configuration::LoadMqttSnapshot() {
+  uint8_t ret = EEPROM.read(EEPROM_ADDR_MQTT_SNAPSHOT_START);
+
+  if (ret == 255) {
+    ret = FACTORY_CFG_MQTT_SNAPSHOT;
+  }
+  Log->AddEvent(LogLevel_Info, F("MQTT snapshot: "), String(ret));
+
+  return (bool) ret;
+}
+
+/**
+ * @brief Load QoS of the MQTT messages
+ * 
+ * @return uint8_t - QoS, 0 or 1
+ */
+uint8_t Configuration::LoadMqttQos() {
+  uint8_t ret = EEPROM.read(EEPROM_ADDR_MQTT_QOS_START);
+
+  if (ret > 1) {
+    ret = FACTORY_CFG_MQTT_QOS;
+  }
+  Log->AddEvent(LogLevel_Info, F("MQTT QoS: "), String(ret));
+
+  return ret;
+}
+
+/**
+ * @brief Load motion cadence enable
+ * 
+ * @return bool - status
+ */
+bool Configuration::LoadMotionCadence() {
+  uint8_t ret = EEPROM.read(EEPROM_ADDR_MOTION_CADENCE_START);
+
+  if (ret == 255) {
+    ret = FACTORY_CFG_MOTION_CADENCE;
+  }
+  Log->AddEvent(LogLevel_Info, F("Motion cadence: "), String(ret));
+
+  return (bool) ret;
+}
+
 /**
  * @brief Load external temperature sensor enable
  * 
@@ -37,6 +37,8 @@ public:
   void SaveFingerprint(String);
   void SavePhotoQuality(uint8_t);
   void SaveFrameSize(uint8_t);
+  void SaveStreamFrameSize(uint8_t);
+  void SaveStreamQuality(uint8_t);
   void SaveBrightness(int8_t);
   void SaveContrast(int8_t);
   void SaveSaturation(int8_t);
@@ -74,6 +76,18 @@ public:
   void SaveNetworkDns(String);
   void SaveCameraImageExifRotation(uint8_t);
   void SaveTimeLapseFunctionStatus(bool);
+  void SaveTimeLapseAviStatus(bool);
+  void SaveSinkHttpUrl(String);
+  void SaveSinkHttpMethod(uint8_t);
+  void SaveMqttEnable(bool);
+  void SaveMqttHost(String);
+  void SaveMqttPort(uint16_t);
+  void SaveMqttUser(String);
+  void SaveMqttPassword(String);
+  void SaveMqttTopic(String);
+  void SaveMqttSnapshot(bool);
+  void SaveMqttQos(uint8_t);
+  void SaveMotionCadence(bool);
   void SaveExternalTemperatureSensorEnable(bool);
   void SaveExternalTemperatureSensorUnit(uint8_t);
 
@@ -82,6 +96,8 @@ public:
   String LoadFingerprint();
   uint8_t LoadPhotoQuality();
   uint8_t LoadFrameSize();
+  uint8_t LoadStreamFrameSize();
+  uint8_t LoadStreamQuality();
   int8_t LoadBrightness();
   int8_t LoadContrast();
   int8_t LoadSaturation();
@@ -118,6 +134,18 @@ public:
   String LoadNetworkDns();
   uint8_t LoadCameraImageExifRotation();
   bool LoadTimeLapseFunctionStatus();
+  bool LoadTimeLapseAviStatus();
+  String LoadSinkHttpUrl();
+  uint8_t LoadSinkHttpMethod();
+  bool LoadMqttEnable();
+  String LoadMqttHost();
+  uint16_t LoadMqttPort();
+  String LoadMqttUser();
+  String LoadMqttPassword();
+  String LoadMqttTopic();
+  bool LoadMqttSnapshot();
+  uint8_t LoadMqttQos();
+  bool LoadMotionCadence();
   bool LoadExternalTemperatureSensorEnable();
   uint8_t LoadExternalTemperatureSensorUnit();
 
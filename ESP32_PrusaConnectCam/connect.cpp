@@ -27,6 +27,27 @@ PrusaConnect::PrusaConnect(Configuration *i_conf, Logs *i_log, Camera *i_camera,
   wifi = i_wifi;
   BackendAvailability = WaitForFirstConnection;
   SendDeviceInformationToBackend = true;
+  SendingIntervalStart = 0;
+  SendingIntervalForced = false;
+  MotionChangeCount = 0;
+  EnableTimelapsAvi = false;
+  TimelapseAviRecovered = false;
+  UploadHistoryIndex = 0;
+  UploadHistoryCount = 0;
+  UploadHistoryLock = portMUX_INITIALIZER_UNLOCKED;
+  memset(UploadHistory, 0, sizeof(UploadHistory));
+  BackendClientLastUse = 0;
+  TlsFullHandshakes = 0;
+  TlsResumedHandshakes = 0;
+  ConnectionReuses = 0;
+  TlsFullHandshakeTime = 0;
+  TlsResumedHandshakeTime = 0;
+  LastHttpCode = 0;
+  LastRetryAfter = 0;
+  CircuitOpenTime = 0;
+  CircuitOpenDelay = 0;
+  ResetCircuit();
+  SpoolDrainTime = 0;
 }
 
 /**
@@ -53,6 +74,7 @@ void PrusaConnect::LoadCfgFromEeprom() {
   RefreshInterval = config->LoadRefreshInterval();
   PrusaConnectHostname = config->LoadPrusaConnectHostname();
   EnableTimelapsPhotoSave = config->LoadTimeLapseFunctionStatus();
+  EnableTimelapsAvi = config->LoadTimeLapseAviStatus();
 }
 
 /**
@@ -73,50 +95,63 @@ void PrusaConnect::TakePicture() {
  * @param i_type - type of data for log message
  * @param i_url_path - url path for backend
  * @param i_fragmentation - flag for enable/disable data fragmentation
+ * @param i_frame - photo frame for SendPhoto, the caller holds the frame reference
+ * @param i_file - spooled photo file for SendSpoolPhoto
  * @return true - if data was sent successfully
  * @return false - if data was not sent successfully
  */
-bool PrusaConnect::SendDataToBackend(String *i_data, int i_data_length, String i_content_type, String i_type, String i_url_path, SendDataToBackendType i_data_type) {
-  WiFiClientSecure client;
+bool PrusaConnect::SendDataToBackend(String *i_data, int i_data_length, String i_content_type, String i_type, String i_url_path, SendDataToBackendType i_data_type, CameraFrame_t *i_frame, File *i_file) {
   BackendReceivedStatus = "";
+  LastHttpCode = 0;
+  LastRetryAfter = 0;
   bool ret = false;
   log->AddEvent(LogLevel_Info, "Sending " + i_type + " to PrusaConnect, " + String(i_data_length) + " bytes");
 
   /* check fingerprint and token length */
   if ((Fingerprint.length() > 0) && (Token.length() > 0)) {
-    client.setCACert(root_CAs);
-    //client.setInsecure();
-    client.setTimeout(1000);
-    client.setNoDelay(true);
-
-    log->AddEvent(LogLevel_Verbose, F("Connecting to server..."));
-
-    /* connecting to server */
-    if (!client.connect(PrusaConnectHostname.c_str(), 443)) {
-      char err_buf[200];
-      int last_error = client.lastError(err_buf, sizeof(err_buf));
-      int error = client.getWriteError();
-      if (BackendAvailability != WaitForFirstConnection) {
-        BackendAvailability = BackendUnavailable;
-      }
+    /* the server can close the kept connection at any time. Then the upload is repeated once on a new connection */
+    for (uint8_t attempt = 0; attempt < 2; attempt++) {
+      UploadTiming_t timing;
+      memset(&timing, 0, sizeof(timing));
+      timing.Time = millis();
+      timing.DataType = i_data_type;
+      timing.Bytes = i_data_length;
+      int64_t UploadStart = esp_timer_get_time();
+
+      log->AddEvent(LogLevel_Verbose, F("Connecting to server..."));
+
+      /* connecting to server */
+      if (false == ConnectToBackend(&timing)) {
+        char err_buf[200];
+        int last_error = BackendClient.lastError(err_buf, sizeof(err_buf));
+        int error = BackendClient.getWriteError();
+        CloseBackendConnection();
+        if (BackendAvailability != WaitForFirstConnection) {
+          BackendAvailability = BackendUnavailable;
+        }
 
-      BackendReceivedStatus = "Connetion failed to domain! Error: " + String(last_error) + " - " + String(err_buf) + " : " + String(error);
-      log->AddEvent(LogLevel_Info, BackendReceivedStatus + " ,BA:" + CovertBackendAvailabilitStatusToString(BackendAvailability));
-      return false;
+        BackendReceivedStatus = "Connetion failed to domain! Error: " + String(last_error) + " - " + String(err_buf) + " : " + String(error);
+        log->AddEvent(LogLevel_Info, BackendReceivedStatus + " ,BA:" + CovertBackendAvailabilitStatusToString(BackendAvailability));
+        timing.Total = esp_timer_get_time() - UploadStart;
+        AddUploadTiming(&timing);
+        return false;
+      }
+      bool reused = (UploadConnectionReused == timing.Connection);
 
-    } else {
-      /* send data to server */
+      /* send data to server. The header is sent in one TLS record */
       log->AddEvent(LogLevel_Verbose, F("Connected to server!"));
-      client.println("PUT https://" + PrusaConnectHostname + i_url_path + " HTTP/1.1");
-      client.println("Host: " + PrusaConnectHostname);
-      client.println("User-Agent: ESP32-CAM");
-      client.println("Connection: close");
-
-      client.println("Content-Type: " + i_content_type);
-      client.println("fingerprint: " + Fingerprint);
-      client.println("token: " + Token);
-      client.println("Content-Length: " + String(i_data_length));
-      client.println();
+      int64_t PhaseStart = esp_timer_get_time();
+      String header = "PUT https://" + PrusaConnectHostname + i_url_path + " HTTP/1.1\r\n";
+      header += "Host: " + PrusaConnectHostname + "\r\n";
+      header += "User-Agent: ESP32-CAM\r\n";
+      header += "Connection: keep-alive\r\n";
+      header += "Content-Type: " + i_content_type + "\r\n";
+      header += "fingerprint: " + Fingerprint + "\r\n";
+      header += "token: " + Token + "\r\n";
+      header += "Content-Length: " + String(i_data_length) + "\r\n\r\n";
+      BackendClient.print(header);
+      timing.Header = esp_timer_get_time() - PhaseStart;
+      PhaseStart = esp_timer_get_time();
 
       esp_task_wdt_reset();
       size_t sendet_data = 0;
@@ -124,42 +159,20 @@ bool PrusaConnect::SendDataToBackend(String *i_data, int i_data_length, String i
       if (SendPhoto == i_data_type) {
         log->AddEvent(LogLevel_Verbose, F("Sendig photo"));
 
-        /* get photo buffer */
-        bool SendWithExif = false;
-        uint8_t *fbBuf = NULL;
-        size_t fbLen = 0;
-        if (camera->GetStreamStatus() == true) {
-          /* get duplicate photo buffer from camera */
-          fbBuf = camera->GetPhotoFbDuplicate()->buf;
-          fbLen = camera->GetPhotoFbDuplicate()->len;
-        } else {
-          /* get original photo buffer from camera */
-          fbBuf = camera->GetPhotoFb()->buf;
-          fbLen = camera->GetPhotoFb()->len;
-        }
+        /* get photo segments, shared with the stream and web server. Exif header first, then photo data */
+        bool SendWithExif = (i_frame->ExifHeader != NULL);
+        CameraFrameView_t view;
+        CameraFrame_GetView(i_frame, &view);
 
-        /* sending exif data */
-        if ((camera->GetPhotoExifData()->header != NULL) && (camera->GetStreamStatus() == false)) {
-          SendWithExif = true;
-          sendet_data += client.write(camera->GetPhotoExifData()->header, camera->GetPhotoExifData()->len);
-          fbBuf += camera->GetPhotoExifData()->offset;
-          fbLen -= camera->GetPhotoExifData()->offset;
-        } else {
-          SendWithExif = false;
-        }
-
-        /* sending photo */
-        for (size_t i = 0; i < fbLen; i += PHOTO_FRAGMENT_SIZE) {
-          if ((i + PHOTO_FRAGMENT_SIZE) < fbLen) {
-            sendet_data += client.write(fbBuf, PHOTO_FRAGMENT_SIZE);
-            fbBuf += PHOTO_FRAGMENT_SIZE;
+        /* sending photo. Nothing is sent after the body, the next request follows on the same connection */
+        for (uint8_t seg = 0; seg < view.Count; seg++) {
+          const uint8_t *fbBuf = view.Segment[seg].ptr;
+          size_t fbLen = view.Segment[seg].len;
 
-          } else if ((fbLen % PHOTO_FRAGMENT_SIZE) > 0) {
-            size_t remainder = fbLen % PHOTO_FRAGMENT_SIZE;
-            sendet_data += client.write(fbBuf, remainder);
+          for (size_t i = 0; i < fbLen; i += PHOTO_FRAGMENT_SIZE) {
+            sendet_data += BackendClient.write(fbBuf + i, min((size_t) PHOTO_FRAGMENT_SIZE, fbLen - i));
           }
         }
-        client.println("\r\n");
 
         /* log message */
         if (SendWithExif) {
@@ -171,50 +184,113 @@ bool PrusaConnect::SendDataToBackend(String *i_data, int i_data_length, String i
         /* sending device information */
       } else if (SendInfo == i_data_type) {
         log->AddEvent(LogLevel_Verbose, F("Sending info"));
-        sendet_data = client.print(*i_data);
+        sendet_data = BackendClient.print(*i_data);
+
+        /* sending spooled photo from the SD card. The repeated upload reads the file again */
+      } else if ((SendSpoolPhoto == i_data_type) && (NULL != i_file)) {
+        log->AddEvent(LogLevel_Verbose, F("Sending spooled photo"));
+        size_t BufSize = 0;
+        uint8_t *buf = SystemFramePool.Alloc(PHOTO_FRAGMENT_SIZE, &BufSize);
+        if ((NULL != buf) && (true == i_file->seek(SPOOL_HEADER_SIZE))) {
+          while (sendet_data < (size_t) i_data_length) {
+            size_t len = i_file->read(buf, min(BufSize, (size_t) i_data_length - sendet_data));
+            size_t written = (len > 0) ? BackendClient.write(buf, len) : 0;
+            sendet_data += written;
+            if ((0 == len) || (written != len)) {
+              break;
+            }
+          }
+        }
+        SystemFramePool.Free(buf);
       }
 
-      client.flush();
+      BackendClient.flush();
+      timing.Body = esp_timer_get_time() - PhaseStart;
+      timing.SentBytes = sendet_data;
+      PhaseStart = esp_timer_get_time();
       log->AddEvent(LogLevel_Info, "Send done: " + String(i_data_length) + "/" + String(sendet_data) + " bytes");
 
       /* check if all data was sent */
       if (i_data_length != sendet_data) {
+        CloseBackendConnection();
+        if (true == reused) {
+          log->AddEvent(LogLevel_Info, F("Kept connection closed by server. Reconnecting"));
+          continue;
+        }
         BackendReceivedStatus = F("INCOMPLETE DATA SEND TO SERVER!");
         log->AddEvent(LogLevel_Error, F("ERROR SEND DATA TO SERVER! INCORRECT DATA LENGTH!"));
-        client.stop();
+        timing.Total = esp_timer_get_time() - UploadStart;
+        AddUploadTiming(&timing);
         return false;
       }
       //esp_task_wdt_reset();
 
-      /* read response from server */
-      String response = "";
-      String fullResponse = "";
-      delay(10); // wait for response
-      log->AddEvent(LogLevel_Verbose, F("Response:"));
-      while (client.connected()) {
-        if (client.available()) {
-          response = client.readStringUntil('\n');
-          fullResponse += response;
-          log->AddEvent(LogLevel_Verbose, response.c_str());
-
-          if (response.startsWith("HTTP/1.1")) {
-            int httpCode = response.substring(9, 12).toInt();
-            BackendReceivedStatus = i_type;
-            BackendReceivedStatus += ": ";
-            BackendReceivedStatus += ProcessHttpResponseCode(httpCode);
-            if (true == ProcessHttpResponseCodeBool(httpCode)) {
-              ret = true;
-            }
+      /* read response from server. The response is complete with its status line, headers and body, the connection stays open */
+      HttpResponseParser parser;
+      uint32_t ResponseStart = millis();
+      while ((false == parser.IsDone()) && (false == parser.IsError())) {
+        int available = BackendClient.available();
+        if (available > 0) {
+          if (0 == timing.Ttfb) {
+            timing.Ttfb = esp_timer_get_time() - PhaseStart;
+          }
+
+          uint8_t buf[128];
+          int len = BackendClient.read(buf, min(available, (int) sizeof(buf)));
+          if (len <= 0) {
+            parser.Finish();
+            break;
           }
+          parser.Parse(buf, len);
+
+        } else if (false == BackendClient.connected()) {
+          parser.Finish();
+
+        } else if ((millis() - ResponseStart) > CONNECT_RESPONSE_TIMEOUT) {
+          log->AddEvent(LogLevel_Warning, F("Timeout waiting for response from server"));
+          break;
+
+        } else {
+          delay(1);
+        }
+      }
+      log->AddEvent(LogLevel_Verbose, "Response: " + String(parser.GetStatusLine()) + ", body: " + String(parser.GetBody()));
+      int httpCode = parser.GetStatusCode();
+      LastRetryAfter = parser.GetRetryAfter();
+      bool KeepAlive = parser.GetKeepAlive();
+
+      if (0 == httpCode) {
+        CloseBackendConnection();
+        if (true == reused) {
+          log->AddEvent(LogLevel_Info, F("No response on kept connection. Reconnecting"));
+          continue;
+        }
+      } else {
+        timing.HttpCode = httpCode;
+        LastHttpCode = httpCode;
+        BackendReceivedStatus = i_type;
+        BackendReceivedStatus += ": ";
+        BackendReceivedStatus += ProcessHttpResponseCode(httpCode);
+        if (true == ProcessHttpResponseCodeBool(httpCode)) {
+          ret = true;
         }
       }
-      log->AddEvent(LogLevel_Verbose, "Full response: " + fullResponse);
+
+      /* keep the connection for the next upload, when the server allows it */
+      if (true == KeepAlive) {
+        BackendClientLastUse = millis();
+      } else {
+        CloseBackendConnection();
+      }
 
       BackendAvailability = BackendAvailable;
-      client.stop();
+      timing.Total = esp_timer_get_time() - UploadStart;
+      AddUploadTiming(&timing);
+      break;
     }
   } else {
     /* err message */
+    LastHttpCode = -1;
     log->AddEvent(LogLevel_Verbose, F("ERROR SEND DATA TO SERVER! INVALID DATA!"));
     log->AddEvent(LogLevel_Verbose, "Fingerprint: " + Fingerprint);
     log->AddEvent(LogLevel_Verbose, "Token: " + Token);
@@ -231,26 +307,332 @@ bool PrusaConnect::SendDataToBackend(String *i_data, int i_data_length, String i
 }
 
 /**
- * @brief Send photo to prusa connect backend
+ * @brief Open connection to backend, or use the kept connection.
+ *        DNS, TCP and TLS are done separately for the phase timing, the plain start postpones the TLS handshake to StartTls()
+ *
+ * @param UploadTiming_t* - phase timing of the upload
+ * @return bool - true = connected
+ */
+bool PrusaConnect::ConnectToBackend(UploadTiming_t *o_timing) {
+  /* the server closes idle connections, the connection is not used after CONNECT_KEEPALIVE_IDLE */
+  if (BackendClient.connected()) {
+    if ((millis() - BackendClientLastUse) < (CONNECT_KEEPALIVE_IDLE * 1000)) {
+      o_timing->Connection = UploadConnectionReused;
+      ConnectionReuses++;
+      return true;
+    }
+    log->AddEvent(LogLevel_Verbose, F("Closing idle connection to server"));
+  }
+  CloseBackendConnection();
+
+  BackendClient.setTimeout(1000);
+
+  int64_t PhaseStart = esp_timer_get_time();
+  IPAddress ServerIp;
+  if (!WiFi.hostByName(PrusaConnectHostname.c_str(), ServerIp)) {
+    return false;
+  }
+  o_timing->Dns = esp_timer_get_time() - PhaseStart;
+
+  PhaseStart = esp_timer_get_time();
+  BackendClient.setPlainStart();
+  if (!BackendClient.connect(ServerIp, 443, PrusaConnectHostname.c_str(), root_CAs, NULL, NULL)) {
+    return false;
+  }
+  o_timing->Tcp = esp_timer_get_time() - PhaseStart;
+  BackendClient.setNoDelay(true);
+
+  PhaseStart = esp_timer_get_time();
+  if (false == BackendClient.StartTls()) {
+    return false;
+  }
+  o_timing->Tls = esp_timer_get_time() - PhaseStart;
+
+  if (true == BackendClient.GetSessionResumed()) {
+    o_timing->Connection = UploadConnectionResumed;
+    TlsResumedHandshakes++;
+    TlsResumedHandshakeTime += o_timing->Tls;
+  } else {
+    o_timing->Connection = UploadConnectionFull;
+    TlsFullHandshakes++;
+    TlsFullHandshakeTime += o_timing->Tls;
+  }
+  BackendClientLastUse = millis();
+
+  return true;
+}
+
+/**
+ * @brief Close the connection to backend. The TLS session is kept for the next connection
  *
  * @param none
  * @return none
  */
-void PrusaConnect::SendPhotoToBackend() {
+void PrusaConnect::CloseBackendConnection() {
+  BackendClient.stop();
+}
+
+/**
+ * @brief Store phase timing of the upload to the history and log it
+ *
+ * @param UploadTiming_t* - phase timing of the upload
+ * @return none
+ */
+void PrusaConnect::AddUploadTiming(UploadTiming_t *i_timing) {
+  portENTER_CRITICAL(&UploadHistoryLock);
+  UploadHistory[UploadHistoryIndex] = *i_timing;
+  UploadHistoryIndex = (UploadHistoryIndex + 1) % UPLOAD_TIMING_HISTORY;
+  if (UploadHistoryCount < UPLOAD_TIMING_HISTORY) {
+    UploadHistoryCount++;
+  }
+  portEXIT_CRITICAL(&UploadHistoryLock);
+
+  /* body throughput in KB/s */
+  uint32_t throughput = (i_timing->Body > 0) ? (uint32_t)(((uint64_t)i_timing->SentBytes * 1000000) / i_timing->Body / 1024) : 0;
+  log->AddEvent(LogLevel_Info, "Upload timing dns/tcp/tls/header/body/ttfb/total: " + String(i_timing->Dns / 1000) + "/" + String(i_timing->Tcp / 1000) + "/" + String(i_timing->Tls / 1000) + "/" + String(i_timing->Header / 1000) + "/" + String(i_timing->Body / 1000) + "/" + String(i_timing->Ttfb / 1000) + "/" + String(i_timing->Total / 1000) + " ms, body " + String(throughput) + " KB/s");
+}
+
+/**
+ * @brief Send photo to prusa connect backend
+ *
+ * @param CameraFrame_t* - photo frame, the snapshot sink holds the frame reference
+ * @return bool - true = photo was sent
+ */
+bool PrusaConnect::SendPhotoToBackend(CameraFrame_t *frame) {
   log->AddEvent(LogLevel_Info, F("Start sending photo to prusaconnect"));
-  camera->SetPhotoSending(true);
   String Photo = "";
-  size_t total_len = 0;
+  bool sent = false;
+
+  /* the photo is spooled without the connection attempt, when the WiFi is down or the circuit is open */
+  if ((WL_CONNECTED != WiFi.status()) || (false == CheckCircuit())) {
+    if (false == CircuitAuthError) {
+      SpoolPhoto(frame);
+    } else {
+      BackendReceivedStatus = "Photo: " + ProcessHttpResponseCode(CircuitHttpCode);
+      log->AddEvent(LogLevel_Warning, F("Invalid token. Photo is not sent"));
+    }
 
-  if ((camera->GetPhotoExifData()->header != NULL) && (camera->GetStreamStatus() == false)) {
-    total_len = camera->GetPhotoExifData()->len + camera->GetPhotoFb()->len - camera->GetPhotoExifData()->offset;
-  } else if (camera->GetStreamStatus() == false) {
-    total_len = camera->GetPhotoFb()->len;
   } else {
-    total_len = camera->GetPhotoFbDuplicate()->len;
+    CameraFrameView_t view;
+    CameraFrame_GetView(frame, &view);
+    sent = SendDataToBackend(&Photo, view.Len, F("image/jpg"), F("Photo"), HOST_URL_CAM_PATH, SendPhoto, frame);
+    UpdateCircuit();
+    if ((false == sent) && (true == CheckBackendDown())) {
+      SpoolPhoto(frame);
+    }
+  }
+
+  return sent;
+}
+
+/**
+ * @brief Save the photo to the SD card spool, it is uploaded after the backend is available
+ *
+ * @param CameraFrame_t* - photo frame, the caller holds the frame reference
+ * @return none
+ */
+void PrusaConnect::SpoolPhoto(CameraFrame_t *i_frame) {
+  if (true == GetSpoolAvailable()) {
+    SystemSpool.Add(i_frame);
+  } else {
+    log->AddEvent(LogLevel_Warning, F("Backend is not available. Photo dropped"));
+  }
+}
+
+/**
+ * @brief Upload the oldest photo from the SD card spool. Called between the live photos,
+ *        one photo per SPOOL_DRAIN_INTERVAL at most
+ *
+ * @param none
+ * @return none
+ */
+void PrusaConnect::DrainSpool() {
+#if ((true == SPOOL_ENABLE) && (true == ENABLE_SD_CARD))
+  if ((0 == SystemSpool.GetCount()) || (WL_CONNECTED != WiFi.status()) || ((millis() - SpoolDrainTime) < SPOOL_DRAIN_INTERVAL)) {
+    return;
+  }
+
+  /* the backend is checked by the live photo first after boot and after the failure */
+  if ((BackendAvailable != BackendAvailability) || (CircuitClosed != CircuitState)) {
+    return;
+  }
+  SpoolDrainTime = millis();
+
+  File file;
+  SpoolRecord_t record;
+  if (false == SystemSpool.OpenHead(&file, &record)) {
+    return;
+  }
+
+  String Photo = "";
+  log->AddEvent(LogLevel_Info, F("Sending spooled photo, captured: "), String(record.CaptureTime) + ", in queue: " + String(SystemSpool.GetCount()));
+  bool sent = SendDataToBackend(&Photo, record.Length, F("image/jpg"), F("Spooled photo"), HOST_URL_CAM_PATH, SendSpoolPhoto, NULL, &file);
+  file.close();
+  UpdateCircuit();
+
+  if (true == sent) {
+    SystemSpool.RemoveHead(true);
+  } else if ((true == CheckBackendDown()) || (true == CircuitAuthError)) {
+    /* the photo is sent again after the circuit is closed */
+  } else {
+    /* the photo rejected by backend is not sent again */
+    SystemSpool.RemoveHead(false);
+  }
+#endif
+}
+
+/**
+ * @brief Check the result of the last upload. The backend is down without response, with the server error or with the rate limit
+ *
+ * @param none
+ * @return bool - true = backend is down
+ */
+bool PrusaConnect::CheckBackendDown() {
+  return ((0 == LastHttpCode) || (429 == LastHttpCode) || (LastHttpCode >= 500));
+}
+
+/**
+ * @brief Check the circuit breaker before the request to backend. After the delay, the open circuit is half-open
+ *        and the next request tests the backend
+ *
+ * @param none
+ * @return bool - true = request can be sent
+ */
+bool PrusaConnect::CheckCircuit() {
+  if ((CircuitOpen == CircuitState) && ((millis() - CircuitOpenTime) >= CircuitOpenDelay)) {
+    CircuitState = CircuitHalfOpen;
+    log->AddEvent(LogLevel_Info, F("Backend circuit half-open. Testing backend"));
+  }
+
+  return (CircuitOpen != CircuitState);
+}
+
+/**
+ * @brief Update the circuit breaker with the result of the last request. Connection errors, 429 and 5xx open
+ *        the circuit with exponential backoff and jitter, or with Retry-After. Invalid token opens it until the token is changed
+ *
+ * @param none
+ * @return none
+ */
+void PrusaConnect::UpdateCircuit() {
+  uint32_t next_attempt = 0;
+
+  if (LastHttpCode < 0) {
+    return;
+
+  } else if ((401 == LastHttpCode) || (403 == LastHttpCode)) {
+    /* the token is not valid, the same request fails again */
+    CircuitAuthError = true;
+    next_attempt = CIRCUIT_AUTH_DELAY * 1000UL;
+
+  } else if ((0 == LastHttpCode) || (429 == LastHttpCode) || (LastHttpCode >= 500)) {
+    CircuitBackoff = (0 == CircuitBackoff) ? (CIRCUIT_BACKOFF_MIN * 1000UL) : min(CircuitBackoff * 2, (uint32_t)(CIRCUIT_BACKOFF_MAX * 1000UL));
+    uint32_t jitter = (CircuitBackoff / 100) * CIRCUIT_BACKOFF_JITTER;
+    next_attempt = CircuitBackoff - jitter + (esp_random() % (2 * jitter + 1));
+
+    /* the delay requested by the server, the jitter spreads the cameras */
+    if (LastRetryAfter > 0) {
+      next_attempt = (min(LastRetryAfter, (uint32_t) CIRCUIT_BACKOFF_MAX) * 1000UL) + (esp_random() % (jitter + 1));
+    }
+
+  } else {
+    /* the backend answered, other errors are related to the request */
+    if (CircuitClosed != CircuitState) {
+      log->AddEvent(LogLevel_Info, F("Backend circuit closed"));
+    }
+    CircuitState = CircuitClosed;
+    CircuitAuthError = false;
+    CircuitBackoff = 0;
+    return;
+  }
+
+  CircuitState = CircuitOpen;
+  CircuitHttpCode = LastHttpCode;
+  CircuitOpenTime = millis();
+  CircuitOpenDelay = next_attempt;
+  if (BackendAvailability != WaitForFirstConnection) {
+    BackendAvailability = BackendUnavailable;
+  }
+  log->AddEvent(LogLevel_Warning, F("Backend circuit open. HTTP code: "), String(LastHttpCode) + ", next attempt in: " + String(next_attempt / 1000) + " s");
+}
+
+/**
+ * @brief Close the circuit breaker. Used after the change of the token or hostname
+ *
+ * @param none
+ * @return none
+ */
+void PrusaConnect::ResetCircuit() {
+  CircuitState = CircuitClosed;
+  CircuitHttpCode = 0;
+  CircuitAuthError = false;
+  CircuitBackoff = 0;
+}
+
+/**
+ * @brief Get state of the circuit breaker
+ *
+ * @param none
+ * @return CircuitState_enum - state
+ */
+CircuitState_enum PrusaConnect::GetCircuitState() {
+  return CircuitState;
+}
+
+/**
+ * @brief Get name of the circuit breaker state
+ *
+ * @param none
+ * @return const char* - state name
+ */
+const char *PrusaConnect::GetCircuitStateName() {
+  switch (CircuitState) {
+    case CircuitOpen:
+      return "open";
+    case CircuitHalfOpen:
+      return "half-open";
+    default:
+      return "closed";
   }
-  SendDataToBackend(&Photo, total_len, F("image/jpg"), F("Photo"), HOST_URL_CAM_PATH, SendPhoto);
-  camera->SetPhotoSending(false);
+}
+
+/**
+ * @brief Get http code, which opened the circuit breaker
+ *
+ * @param none
+ * @return int16_t - http code, 0 = connection error
+ */
+int16_t PrusaConnect::GetCircuitHttpCode() {
+  return CircuitHttpCode;
+}
+
+/**
+ * @brief Get remaining time to the next attempt of the open circuit breaker
+ *
+ * @param none
+ * @return uint32_t - remaining time [s]
+ */
+uint32_t PrusaConnect::GetCircuitNextAttempt() {
+  uint32_t elapsed = millis() - CircuitOpenTime;
+  if ((CircuitOpen != CircuitState) || (elapsed >= CircuitOpenDelay)) {
+    return 0;
+  }
+
+  return (CircuitOpenDelay - elapsed) / 1000;
+}
+
+/**
+ * @brief Check if the photos can be saved to the SD card spool
+ *
+ * @param none
+ * @return bool - true = spool is available
+ */
+bool PrusaConnect::GetSpoolAvailable() {
+#if ((true == SPOOL_ENABLE) && (true == ENABLE_SD_CARD))
+  return (Fingerprint.length() > 0) && (Token.length() > 0) && (true == log->GetCardDetectedStatus());
+#else
+  return false;
+#endif
 }
 
 /**
@@ -258,7 +640,7 @@ void PrusaConnect::SendPhotoToBackend() {
  * 
  */
 void PrusaConnect::SendInfoToBackend() {
-  if (false == SendDeviceInformationToBackend) {
+  if ((false == SendDeviceInformationToBackend) || (false == CheckCircuit())) {
     return;
 
   } else {
@@ -284,7 +666,8 @@ void PrusaConnect::SendInfoToBackend() {
 
     serializeJson(json_data, json_string);
     log->AddEvent(LogLevel_Info, "Data: " + json_string);
-    bool response = SendDataToBackend(&json_string, json_string.length(), F("application/json"), F("Info"), HOST_URL_INFO_PATH, SendInfo);
+    bool response = SendDataToBackend(&json_string, json_string.length(), F("application/json"), F("Info"), HOST_URL_INFO_PATH, SendInfo, NULL);
+    UpdateCircuit();
 
     if (true == response) {
       SendDeviceInformationToBackend = false;
@@ -293,34 +676,26 @@ void PrusaConnect::SendInfoToBackend() {
 }
 
 /**
- * @brief Take picture and send to backend
+ * @brief Take picture and pass it to the snapshot sinks: Prusa Connect, the local HTTP target and the SD card.
+ *        The next picture can be taken while this one is uploaded
  *
  * @param none
  * @return none
  */
-void PrusaConnect::TakePictureAndSendToBackend() {
+void PrusaConnect::TakePictureForBackend() {
+  /* the scene changes after this point trigger the next upload */
+  MotionChangeCount = camera->GetMotionChangeCount();
   camera->CapturePhoto();
 
   /* check if photo was captured */
   if (camera->GetCameraCaptureSuccess() == true) {
 
-    /* send photo to backend */
-    SendPhotoToBackend();
-
-    /* save photo to SD card */
-    if (false == camera->GetStreamStatus()) {
-      SavePhotoToSdCard();
-    }
+    /* each sink holds a reference to the same photo, in its own queue and task */
+    SnapshotSink_OfferAll();
 
   } else {
     log->AddEvent(LogLevel_Error, F("Error capturing photo. Stop sending to backend!"));
   }
-  
-  /* return frame buffer */
-  if (camera->GetStreamStatus() == true) {
-    /* set stream flag for sending photo to false */
-    camera->StreamSetSendingPhoto(false);
-  }
 }
 
 /**
@@ -447,6 +822,7 @@ void PrusaConnect::SetRefreshInterval(uint8_t i_data) {
 void PrusaConnect::SetToken(String i_data) {
   Token = i_data;
   config->SaveToken(Token);
+  ResetCircuit();
 }
 
 /**
@@ -467,6 +843,7 @@ void PrusaConnect::SetBackendAvailabilitStatus(BackendAvailabilitStatus i_data)
 void PrusaConnect::SetPrusaConnectHostname(String i_data) {
   PrusaConnectHostname = i_data;
   config->SavePrusaConnectHostname(PrusaConnectHostname);
+  ResetCircuit();
 }
 
 /**
@@ -480,12 +857,38 @@ void PrusaConnect::SetTimeLapsPhotoSaveStatus(bool i_data) {
 }
 
 /**
-   @brief Function for saving photo to SD card
+ * @brief Set time laps AVI format status. The open AVI file is finalized by the photo task
+ * 
+ * @param bool - status
+ */
+void PrusaConnect::SetTimeLapsAviStatus(bool i_data) {
+  EnableTimelapsAvi = i_data;
+  config->SaveTimeLapseAviStatus(EnableTimelapsAvi);
+}
+
+/**
+   @brief Finalize the AVI file, when the time laps or the AVI format is disabled
    @param none
    @return none
 */
-void PrusaConnect::SavePhotoToSdCard() {
+void PrusaConnect::CheckTimelapseAvi() {
+#if (ENABLE_SD_CARD == true)
+  if ((true == TimelapseAvi.IsOpen()) && ((false == EnableTimelapsPhotoSave) || (false == EnableTimelapsAvi))) {
+    CloseTimelapseAvi();
+  }
+#endif
+}
+
+/**
+   @brief Function for saving photo to SD card
+   @param CameraFrame_t * - photo frame, the snapshot sink holds the frame reference
+   @return bool - true = photo was saved
+*/
+bool PrusaConnect::SavePhotoToSdCard(CameraFrame_t *frame) {
+  bool ret = false;
 #if (ENABLE_SD_CARD == true)
+  CheckTimelapseAvi();
+
   /* check if time laps photo save is enabled */
   if (EnableTimelapsPhotoSave == true) {
     log->AddEvent(LogLevel_Info, F("Save TimeLaps photo to SD card"));
@@ -493,7 +896,7 @@ void PrusaConnect::SavePhotoToSdCard() {
     /* check if SD card is detected */
     if (log->GetCardDetectedStatus() == false) {
       log->AddEvent(LogLevel_Error, F("SD card not detected!"));
-      return;
+      return false;
     }
 
     /* check if folder for time laps photos exists */
@@ -502,29 +905,124 @@ void PrusaConnect::SavePhotoToSdCard() {
       log->CreateDir(SD_MMC, TIMELAPS_PHOTO_FOLDER);
     }
 
-    /* create file name */
-    String FileName = String(TIMELAPS_PHOTO_FOLDER) + "/" + String(TIMELAPS_PHOTO_PREFIX) + "_";
-    FileName += log->GetSystemTime();
-    FileName += TIMELAPS_PHOTO_SUFFIX;
-    log->AddEvent(LogLevel_Verbose, F("Saving file: "), FileName);
-
-    /* save photo to SD card */
-    if (camera->GetPhotoExifData()->header != NULL) {
-      if (log->WritePicture(FileName, camera->GetPhotoFb()->buf + camera->GetPhotoExifData()->offset, camera->GetPhotoFb()->len - camera->GetPhotoExifData()->offset, camera->GetPhotoExifData()->header, camera->GetPhotoExifData()->len) == true) {
-        log->AddEvent(LogLevel_Info, F("Photo saved to SD card. EXIF"));
-      } else {
-        log->AddEvent(LogLevel_Error, F("Error saving photo to SD card. EXIF"));
-      }
+    if (true == EnableTimelapsAvi) {
+      ret = SavePhotoToAvi(frame);
 
     } else {
-      if (log->WritePicture(FileName, camera->GetPhotoFb()->buf, camera->GetPhotoFb()->len) == true) {
-        log->AddEvent(LogLevel_Info, F("Photo saved to SD card"));
+      /* create file name */
+      String FileName = String(TIMELAPS_PHOTO_FOLDER) + "/" + String(TIMELAPS_PHOTO_PREFIX) + "_";
+      FileName += log->GetSystemTime();
+      FileName += TIMELAPS_PHOTO_SUFFIX;
+      log->AddEvent(LogLevel_Verbose, F("Saving file: "), FileName);
+
+      /* save photo to SD card */
+      CameraFrameView_t view;
+      CameraFrame_GetView(frame, &view);
+      ret = log->WritePicture(FileName, &view);
+      if (true == ret) {
+        log->AddEvent(LogLevel_Info, F("Photo saved to SD card. EXIF: "), String((frame->ExifHeader != NULL) ? "true" : "false"));
       } else {
         log->AddEvent(LogLevel_Error, F("Error saving photo to SD card"));
       }
     }
   }
 #endif
+  return ret;
+}
+
+/**
+   @brief Append photo to the AVI file of the time laps session. A new file is started
+          for the new frame size and after the file size limit
+   @param CameraFrame_t * - photo frame
+   @return bool - true = photo was saved
+*/
+bool PrusaConnect::SavePhotoToAvi(CameraFrame_t *i_frame) {
+  uint32_t start = millis();
+  CameraFrameView_t view;
+  CameraFrame_GetView(i_frame, &view);
+
+  /* finalize files from the previous session, the power could be lost during writing */
+  if (false == TimelapseAviRecovered) {
+    RecoverTimelapseAvi();
+    TimelapseAviRecovered = true;
+  }
+
+  if ((true == TimelapseAvi.IsOpen()) && ((i_frame->fb->width != TimelapseAvi.GetWidth()) || (i_frame->fb->height != TimelapseAvi.GetHeight()) ||
+                                          ((TimelapseAvi.GetFileSize() + view.Len) >= TIMELAPS_AVI_MAX_FILE_SIZE))) {
+    CloseTimelapseAvi();
+  }
+
+  if (false == TimelapseAvi.IsOpen()) {
+    String BaseName = String(TIMELAPS_PHOTO_FOLDER) + "/" + String(TIMELAPS_PHOTO_PREFIX) + "_" + log->GetSystemTime();
+    String FileName = BaseName + TIMELAPS_AVI_SUFFIX;
+
+    /* the time is not synchronized after boot without NTP */
+    for (uint8_t i = 1; (true == SD_MMC.exists(FileName)) && (i < UINT8_MAX); i++) {
+      FileName = BaseName + "_" + String(i) + TIMELAPS_AVI_SUFFIX;
+    }
+
+    if (false == TimelapseAvi.Open(SD_MMC, FileName, i_frame->fb->width, i_frame->fb->height)) {
+      log->AddEvent(LogLevel_Error, F("Error creating time laps AVI file: "), FileName);
+      return false;
+    }
+    log->AddEvent(LogLevel_Info, F("Time laps AVI file created: "), FileName);
+  }
+
+  if (true == TimelapseAvi.AddFrame(&view)) {
+    log->AddEvent(LogLevel_Info, F("Photo saved to AVI file. Frames: "), String(TimelapseAvi.GetFrameCount()) + ", time: " + String(millis() - start) + " ms");
+    return true;
+  }
+
+  log->AddEvent(LogLevel_Error, F("Error saving photo to AVI file"));
+  return false;
+}
+
+/**
+   @brief Finalize the AVI file of the time laps session
+   @param none
+   @return none
+*/
+void PrusaConnect::CloseTimelapseAvi() {
+  String FileName = TimelapseAvi.GetPath();
+  uint32_t frames = TimelapseAvi.GetFrameCount();
+
+  if (true == TimelapseAvi.Close()) {
+    log->AddEvent(LogLevel_Info, F("Time laps AVI file closed: "), FileName + ", frames: " + String(frames));
+  } else {
+    log->AddEvent(LogLevel_Error, F("Error closing time laps AVI file: "), FileName);
+  }
+}
+
+/**
+   @brief Finalize AVI files, which were not closed. The sidecar index file exists only for the open AVI file
+   @param none
+   @return none
+*/
+void PrusaConnect::RecoverTimelapseAvi() {
+  String IndexSuffix = String(TIMELAPS_AVI_SUFFIX) + TIMELAPS_AVI_INDEX_SUFFIX;
+
+  File dir = SD_MMC.open(TIMELAPS_PHOTO_FOLDER);
+  if ((!dir) || (!dir.isDirectory())) {
+    return;
+  }
+
+  File file = dir.openNextFile();
+  while (file) {
+    String IndexPath = String(file.path());
+    file.close();
+
+    if (true == IndexPath.endsWith(IndexSuffix)) {
+      String FileName = IndexPath.substring(0, IndexPath.length() - strlen(TIMELAPS_AVI_INDEX_SUFFIX));
+      log->AddEvent(LogLevel_Warning, F("Recovering time laps AVI file: "), FileName);
+      if (true == TimelapseAvi.Open(SD_MMC, FileName, 0, 0)) {
+        CloseTimelapseAvi();
+      } else {
+        log->AddEvent(LogLevel_Error, F("Error recovering time laps AVI file: "), FileName);
+      }
+    }
+    file = dir.openNextFile();
+  }
+  dir.close();
 }
 
 /**
@@ -616,47 +1114,162 @@ bool PrusaConnect::GetTimeLapsPhotoSaveStatus() {
 }
 
 /**
- * @brief Increase sending interval counter
+ * @brief Get time laps AVI format status
+ * 
+ * @return bool - status
+ */
+bool PrusaConnect::GetTimeLapsAviStatus() {
+  return EnableTimelapsAvi;
+}
+
+/**
+ * @brief Get count of uploads in the phase timing history
  *
  * @param none
- * @return none
+ * @return uint8_t - count of uploads
+ */
+uint8_t PrusaConnect::GetUploadHistoryCount() {
+  return UploadHistoryCount;
+}
+
+/**
+ * @brief Get phase timing of the upload from the history
+ *
+ * @param uint8_t - position in the history, 0 = last upload
+ * @param UploadTiming_t* - output timing
+ * @return bool - true = timing is valid
  */
-void PrusaConnect::IncreaseSendingIntervalCounter() {
-  SendingIntervalCounter++;
+bool PrusaConnect::GetUploadTiming(uint8_t i_index, UploadTiming_t *o_timing) {
+  bool ret = false;
+
+  portENTER_CRITICAL(&UploadHistoryLock);
+  if (i_index < UploadHistoryCount) {
+    *o_timing = UploadHistory[(UploadHistoryIndex + UPLOAD_TIMING_HISTORY - 1 - i_index) % UPLOAD_TIMING_HISTORY];
+    ret = true;
+  }
+  portEXIT_CRITICAL(&UploadHistoryLock);
+
+  return ret;
 }
 
 /**
- * @brief Set sending interval counter
+ * @brief Get count of full TLS handshakes to backend
  *
- * @param uint8_t i_data - counter
+ * @param none
+ * @return uint32_t - count of handshakes
+ */
+uint32_t PrusaConnect::GetTlsFullHandshakes() {
+  return TlsFullHandshakes;
+}
+
+/**
+ * @brief Get count of TLS handshakes with the resumed session
+ *
+ * @param none
+ * @return uint32_t - count of handshakes
+ */
+uint32_t PrusaConnect::GetTlsResumedHandshakes() {
+  return TlsResumedHandshakes;
+}
+
+/**
+ * @brief Get count of uploads on the kept connection, without the handshake
+ *
+ * @param none
+ * @return uint32_t - count of uploads
+ */
+uint32_t PrusaConnect::GetConnectionReuses() {
+  return ConnectionReuses;
+}
+
+/**
+ * @brief Get estimate of the handshake time saved by the kept connection and by the session resumption.
+ *        The saved time is compared with the average full handshake
+ *
+ * @param none
+ * @return uint32_t - saved time [ms]
+ */
+uint32_t PrusaConnect::GetTlsTimeSaved() {
+  if (0 == TlsFullHandshakes) {
+    return 0;
+  }
+
+  uint64_t average = TlsFullHandshakeTime / TlsFullHandshakes;
+  uint64_t saved = average * (ConnectionReuses + TlsResumedHandshakes);
+  saved = (saved > TlsResumedHandshakeTime) ? (saved - TlsResumedHandshakeTime) : 0;
+
+  return (uint32_t)(saved / 1000);
+}
+
+/**
+ * @brief Start the next sending interval. The next interval follows the expired one,
+ *        so the delay of the photo task does not accumulate. The forced or long overdue upload starts a new schedule
+ *
+ * @param none
  * @return none
  */
-void PrusaConnect::SetSendingIntervalCounter(uint8_t i_data) {
-  SendingIntervalCounter = i_data;
+void PrusaConnect::StartSendingInterval() {
+  uint32_t now = millis();
+  uint32_t interval = (uint32_t) GetSendingInterval() * 1000;
+  uint32_t elapsed = now - SendingIntervalStart;
+
+  if ((false == SendingIntervalForced) && (elapsed >= interval) && (elapsed < (interval + TASK_PHOTO_SEND))) {
+    SendingIntervalStart += interval;
+  } else {
+    SendingIntervalStart = now;
+  }
+  SendingIntervalForced = false;
 }
 
+/**
+ * @brief Set sending interval as expired, the photo is sent immediately
+ *
+ * @param none
+ * @return none
+ */
 void PrusaConnect::SetSendingIntervalExpired() {
-  SendingIntervalCounter = RefreshInterval;
+  SendingIntervalForced = true;
 }
 
 /**
- * @brief Get sending interval counter
+ * @brief Get time from the start of the sending interval
  * 
- * @return uint8_t - counter
+ * @return uint16_t - time [s]
+ */
+uint16_t PrusaConnect::GetSendingIntervalCounter() {
+  return (uint16_t) min((uint32_t)((millis() - SendingIntervalStart) / 1000), (uint32_t) UINT16_MAX);
+}
+
+/**
+ * @brief Get length of the sending interval. With the motion cadence enabled by the user, the static scene is sent
+ *        with the longer interval, and the scene change since the last photo returns to the trigger interval.
+ *        The interval is never shorter than the trigger interval
+ *
+ * @param none
+ * @return uint16_t - interval [s]
  */
-uint8_t PrusaConnect::GetSendingIntervalCounter() {
-  return SendingIntervalCounter;
+uint16_t PrusaConnect::GetSendingInterval() {
+  if ((true == camera->GetMotionCadence()) && (camera->GetMotionChangeCount() == MotionChangeCount)) {
+    uint16_t interval = min((uint16_t)(RefreshInterval * MOTION_STATIC_BACKOFF), (uint16_t)MOTION_STATIC_MAX_INTERVAL);
+    return max(interval, (uint16_t)RefreshInterval);
+  }
+
+  return RefreshInterval;
 }
 
 /**
  * @brief Check if sending interval is expired. and can I send the data to the backend. [seconds]
+ * With the motion cadence, the static scene is sent with the longer interval.
+ * Only the forced request sends the photo before the trigger interval
  * 
  * @return true 
  * @return false 
  */
 bool PrusaConnect::CheckSendingIntervalExpired() {
   bool ret = false;
-  if (SendingIntervalCounter >= RefreshInterval) {
+  uint32_t elapsed = millis() - SendingIntervalStart;
+
+  if ((true == SendingIntervalForced) || (elapsed >= ((uint32_t) GetSendingInterval() * 1000))) {
     ret = true;
   }
 
@@ -25,6 +25,11 @@
 #include "Certificate.h"
 #include "WebServer.h"
 #include "connect_types.h"
+#include "avi_writer.h"
+#include "tls_client.h"
+#include "http_response.h"
+#include "spool.h"
+#include "snapshot_sink.h"
 
 class WiFiMngt;
 class Configuration;
@@ -36,8 +41,46 @@ private:
   String BackendReceivedStatus;                   ///< status of backend response
   BackendAvailabilitStatus BackendAvailability;   ///< status of backend availability
   bool SendDeviceInformationToBackend;            ///< flag for sending device information to backend
-  uint8_t SendingIntervalCounter;                 ///< counter for sending interval, represents seconds
+  uint32_t SendingIntervalStart;                  ///< start of the sending interval [ms]
+  bool SendingIntervalForced;                     ///< photo is sent immediately, without waiting for the interval
+  uint32_t MotionChangeCount;                     ///< scene change count of the camera at the last photo upload
   bool EnableTimelapsPhotoSave;                   ///< flag for saving photo to SD card
+  bool EnableTimelapsAvi;                         ///< flag for saving time laps photos to one AVI file
+  bool TimelapseAviRecovered;                     ///< AVI files from the previous session are finalized
+  AviWriter TimelapseAvi;                         ///< AVI file of the current time laps session
+  UploadTiming_t UploadHistory[UPLOAD_TIMING_HISTORY]; ///< phase timing of the last uploads
+  uint8_t UploadHistoryIndex;                     ///< position of the next upload in the history
+  uint8_t UploadHistoryCount;                     ///< count of uploads in the history
+  portMUX_TYPE UploadHistoryLock;                 ///< history is read by the web server
+  TlsClient BackendClient;                        ///< connection to backend, kept open between uploads
+  uint32_t BackendClientLastUse;                  ///< time of the last request on the connection [ms]
+  uint32_t TlsFullHandshakes;                     ///< count of full TLS handshakes
+  uint32_t TlsResumedHandshakes;                  ///< count of TLS handshakes with the resumed session
+  uint32_t ConnectionReuses;                      ///< count of uploads on the kept connection
+  uint64_t TlsFullHandshakeTime;                  ///< sum of the full handshake durations [us]
+  uint64_t TlsResumedHandshakeTime;               ///< sum of the resumed handshake durations [us]
+  int16_t LastHttpCode;                           ///< http code of the last upload, 0 = no response, -1 = not sent
+  uint32_t LastRetryAfter;                        ///< Retry-After of the last upload [s]
+  CircuitState_enum CircuitState;                 ///< state of the circuit breaker
+  int16_t CircuitHttpCode;                        ///< http code, which opened the circuit
+  bool CircuitAuthError;                          ///< circuit is open after the invalid token
+  uint32_t CircuitOpenTime;                       ///< time of the circuit opening [ms]
+  uint32_t CircuitOpenDelay;                      ///< time from the opening to the next attempt [ms]
+  uint32_t CircuitBackoff;                        ///< delay without jitter, doubled after each failure [ms]
+  uint32_t SpoolDrainTime;                        ///< time of the last upload from the spool [ms]
+
+  bool SavePhotoToAvi(CameraFrame_t *);
+  void CloseTimelapseAvi();
+  void RecoverTimelapseAvi();
+  void AddUploadTiming(UploadTiming_t *);
+  uint16_t GetSendingInterval();
+  bool CheckBackendDown();
+  bool CheckCircuit();
+  void UpdateCircuit();
+  void ResetCircuit();
+  void SpoolPhoto(CameraFrame_t *);
+  bool ConnectToBackend(UploadTiming_t *);
+  void CloseBackendConnection();
 
   String Token;                                   ///< token for backend communication
   String Fingerprint;                             ///< fingerprint for backend communication 
@@ -48,7 +91,7 @@ private:
   Camera *camera;                                 ///< pointer to camera object
   WiFiMngt *wifi;                                 ///< pointer to wifi object
 
-  bool SendDataToBackend(String *, int, String, String, String, SendDataToBackendType);
+  bool SendDataToBackend(String *, int, String, String, String, SendDataToBackendType, CameraFrame_t *, File * = NULL);
 
 public:
   PrusaConnect(Configuration*, Logs*, Camera*, WiFiMngt*);
@@ -58,9 +101,10 @@ public:
   void LoadCfgFromEeprom();
 
   void TakePicture();
-  void SendPhotoToBackend();
+  bool SendPhotoToBackend(CameraFrame_t *);
   void SendInfoToBackend();
-  void TakePictureAndSendToBackend();
+  void DrainSpool();
+  void TakePictureForBackend();
   String ProcessHttpResponseCode(int);
   bool ProcessHttpResponseCodeBool(int);
   void UpdateDeviceInformation();
@@ -70,8 +114,10 @@ public:
   void SetBackendAvailabilitStatus(BackendAvailabilitStatus);
   void SetPrusaConnectHostname(String);
   void SetTimeLapsPhotoSaveStatus(bool);
+  void SetTimeLapsAviStatus(bool);
 
-  void SavePhotoToSdCard();
+  bool SavePhotoToSdCard(CameraFrame_t *);
+  void CheckTimelapseAvi();
 
   uint8_t GetRefreshInterval();
   String GetBackendReceivedStatus();
@@ -81,11 +127,22 @@ public:
   BackendAvailabilitStatus GetBackendAvailabilitStatus();
   String CovertBackendAvailabilitStatusToString(BackendAvailabilitStatus);
   bool GetTimeLapsPhotoSaveStatus();
-
-  void IncreaseSendingIntervalCounter();
-  void SetSendingIntervalCounter(uint8_t);
+  bool GetTimeLapsAviStatus();
+  uint8_t GetUploadHistoryCount();
+  bool GetUploadTiming(uint8_t, UploadTiming_t *);
+  uint32_t GetTlsFullHandshakes();
+  uint32_t GetTlsResumedHandshakes();
+  uint32_t GetConnectionReuses();
+  uint32_t GetTlsTimeSaved();
+  CircuitState_enum GetCircuitState();
+  const char *GetCircuitStateName();
+  int16_t GetCircuitHttpCode();
+  uint32_t GetCircuitNextAttempt();
+  bool GetSpoolAvailable();
+
+  void StartSendingInterval();
   void SetSendingIntervalExpired();
-  uint8_t GetSendingIntervalCounter();
+  uint16_t GetSendingIntervalCounter();
   bool CheckSendingIntervalExpired();
 };
 
@@ -21,6 +21,16 @@ enum BackendAvailabilitStatus {
   BackendUnavailable = 2,         ///< backend is unavailable
 };
 
+/**
+ * @brief CircuitState_enum enum
+ * state of the circuit breaker for the connection to backend
+ */
+enum CircuitState_enum {
+  CircuitClosed = 0,              ///< requests are sent to backend
+  CircuitOpen = 1,                ///< requests are not sent until the next attempt time
+  CircuitHalfOpen = 2,            ///< one request tests the backend
+};
+
 /**
  * @brief SendDataToBackendType enum
  * type of data to send to backend
@@ -28,4 +38,35 @@ enum BackendAvailabilitStatus {
 enum SendDataToBackendType {
   SendPhoto = 0,                  ///< send photo to backend
   SendInfo = 1,                   ///< send device information to backend
+  SendSpoolPhoto = 2,             ///< send photo from the SD card spool to backend
+};
+
+/**
+ * @brief UploadConnection_enum enum
+ * type of connection used for the upload
+ */
+enum UploadConnection_enum {
+  UploadConnectionFull = 0,       ///< new connection with full TLS handshake
+  UploadConnectionResumed = 1,    ///< new connection with resumed TLS session
+  UploadConnectionReused = 2,     ///< kept connection, without handshake
+};
+
+/**
+ * @brief UploadTiming_t struct
+ * duration of the phases of one upload to backend
+ */
+struct UploadTiming_t {
+  uint32_t Time;                  ///< start of the upload, time since boot [ms]
+  SendDataToBackendType DataType; ///< type of uploaded data
+  UploadConnection_enum Connection; ///< type of connection
+  uint32_t Bytes;                 ///< length of data [bytes]
+  uint32_t SentBytes;             ///< length of sent data [bytes]
+  int16_t HttpCode;               ///< http response code, 0 = no response
+  uint32_t Dns;                   ///< DNS resolution [us]
+  uint32_t Tcp;                   ///< TCP connect [us]
+  uint32_t Tls;                   ///< TLS handshake [us]
+  uint32_t Header;                ///< sending of the http header [us]
+  uint32_t Body;                  ///< sending of the body [us]
+  uint32_t Ttfb;                  ///< from the end of the body to the first byte of the response [us]
+  uint32_t Total;                 ///< whole upload [us]
 };
\ No newline at end of file
@@ -435,11 +435,12 @@ size_t get_jpeg_data_offset(camera_fb_t *fb)
   }
   size_t data_offset = 2; // Offset to first JPEG segment after header
 
-  // Check if JFIF header
-  if (fb->buf[2] == 0xff && fb->buf[3] == 0xe0) {
-    uint16_t jfif_len = fb->buf[4] << 8 | fb->buf[5];
+  // Skip all APPn headers (JFIF, Exif, ...)
+  while ((data_offset + 4) <= fb->len && fb->buf[data_offset] == 0xff &&
+         (fb->buf[data_offset + 1] & 0xf0) == 0xe0) {
+    uint16_t app_len = fb->buf[data_offset + 2] << 8 | fb->buf[data_offset + 3];
 
-    data_offset += 2 + jfif_len;
+    data_offset += 2 + app_len;
   }
 
   if (data_offset >= fb->len) {
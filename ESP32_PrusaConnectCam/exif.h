@@ -82,7 +82,7 @@ const uint8_t *get_exif_header(camera_fb_t *fb, const uint8_t **exif_buf, size_t
  * Get offset of first none header byte in buffer
  *
  * Get the offset of the first none JPEG header byte in capture buffer. This
- * can be used to strip the JPEG SOI and JFIF headers from an image.
+ * can be used to strip the JPEG SOI and all APPn headers (JFIF, Exif) from an image.
  *
  * @returns	offset of first non header byte, or 0 on error
  */
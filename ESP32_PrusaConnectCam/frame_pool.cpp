@@ -0,0 +1,155 @@
+/**
+   @file frame_pool.cpp
+
+   @brief Library with fixed pool of PSRAM blocks for frame copies
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "frame_pool.h"
+
+FramePool SystemFramePool;
+
+/**
+   @brief Constructor for FramePool class
+   @param none
+   @return none
+*/
+FramePool::FramePool() {
+  PoolMutex = xSemaphoreCreateMutex();
+  memset(Class, 0, sizeof(Class));
+}
+
+/**
+   @brief Allocate the pool. The classes are allocated once, the camera reinit keeps them
+   @param none
+   @return none
+*/
+void FramePool::Init() {
+  xSemaphoreTake(PoolMutex, portMAX_DELAY);
+  if (NULL == Class[FramePoolClass_Small].Memory) {
+    InitClass(FramePoolClass_Small, FRAME_POOL_SMALL_SIZE, FRAME_POOL_SMALL_COUNT);
+  }
+  xSemaphoreGive(PoolMutex);
+}
+
+/**
+   @brief Allocate memory of the size class. The caller must hold the pool mutex
+   @param FramePoolClass_enum - size class
+   @param size_t - block size
+   @param uint8_t - count of blocks, maximum 32
+   @return bool - true = class is allocated
+*/
+bool FramePool::InitClass(FramePoolClass_enum i_class, size_t i_size, uint8_t i_count) {
+  FramePoolClass_t *pool = &Class[i_class];
+
+  free(pool->Memory);
+  pool->Memory = (uint8_t *)heap_caps_malloc(i_size * i_count, MALLOC_CAP_SPIRAM);
+  if (NULL == pool->Memory) {
+    pool->BlockSize = 0;
+    pool->BlockCount = 0;
+    pool->FreeMask = 0;
+    return false;
+  }
+
+  pool->BlockSize = i_size;
+  pool->BlockCount = min(i_count, (uint8_t)32);
+  pool->FreeMask = (32 == pool->BlockCount) ? UINT32_MAX : ((1UL << pool->BlockCount) - 1);
+  pool->InUse = 0;
+
+  return true;
+}
+
+/**
+   @brief Get block from the smallest class with the free block
+   @param size_t - requested size
+   @param size_t* - size of the allocated block, can be NULL
+   @return uint8_t* - block, NULL when no block is free
+*/
+uint8_t *FramePool::Alloc(size_t i_size, size_t *o_size) {
+  uint8_t *ret = NULL;
+  FramePoolClass_t *fit = NULL;
+
+  xSemaphoreTake(PoolMutex, portMAX_DELAY);
+  for (uint8_t i = 0; (i < FramePoolClass_Count) && (NULL == ret); i++) {
+    FramePoolClass_t *pool = &Class[i];
+    if (pool->BlockSize < i_size) {
+      continue;
+    }
+
+    if (NULL == fit) {
+      fit = pool;
+    }
+
+    if (0 != pool->FreeMask) {
+      uint8_t block = __builtin_ctz(pool->FreeMask);
+      pool->FreeMask &= ~(1UL << block);
+      pool->InUse++;
+      if (pool->InUse > pool->HighWater) {
+        pool->HighWater = pool->InUse;
+      }
+      ret = pool->Memory + (block * pool->BlockSize);
+      if (NULL != o_size) {
+        *o_size = pool->BlockSize;
+      }
+    }
+  }
+
+  /* the failure is counted for the smallest class, which could hold the data, or for the largest class */
+  if ((NULL == ret) && (NULL != fit)) {
+    fit->Failures++;
+  } else if ((NULL == ret) && (NULL != Class[FramePoolClass_Count - 1].Memory)) {
+    Class[FramePoolClass_Count - 1].Failures++;
+  }
+  xSemaphoreGive(PoolMutex);
+
+  return ret;
+}
+
+/**
+   @brief Return block to the pool
+   @param uint8_t* - block from Alloc, NULL is ignored
+   @return none
+*/
+void FramePool::Free(uint8_t *i_block) {
+  if (NULL == i_block) {
+    return;
+  }
+
+  xSemaphoreTake(PoolMutex, portMAX_DELAY);
+  for (uint8_t i = 0; i < FramePoolClass_Count; i++) {
+    FramePoolClass_t *pool = &Class[i];
+    if ((NULL != pool->Memory) && (i_block >= pool->Memory) && (i_block < (pool->Memory + (pool->BlockSize * pool->BlockCount)))) {
+      uint8_t block = (i_block - pool->Memory) / pool->BlockSize;
+      if (0 == (pool->FreeMask & (1UL << block))) {
+        pool->FreeMask |= (1UL << block);
+        pool->InUse--;
+      }
+      break;
+    }
+  }
+  xSemaphoreGive(PoolMutex);
+}
+
+/**
+   @brief Get statistics of the size class
+   @param uint8_t - size class
+   @param FramePoolClass_t* - output
+   @return bool - true = class is allocated
+*/
+bool FramePool::GetClassInfo(uint8_t i_class, FramePoolClass_t *o_info) {
+  if (i_class >= FramePoolClass_Count) {
+    return false;
+  }
+
+  xSemaphoreTake(PoolMutex, portMAX_DELAY);
+  *o_info = Class[i_class];
+  xSemaphoreGive(PoolMutex);
+
+  return (NULL != o_info->Memory);
+}
+
+/* EOF */
@@ -0,0 +1,56 @@
+/**
+   @file frame_pool.h
+
+   @brief Library with fixed pool of PSRAM blocks for frame copies
+
+   Small frame buffers (exif headers, spool upload buffers) are taken from
+   blocks allocated once at camera init. Each size class is one continuous
+   PSRAM allocation, so long uptime does not fragment the PSRAM.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "mcu_cfg.h"
+
+enum FramePoolClass_enum {
+  FramePoolClass_Small = 0,   ///< exif headers and upload buffers
+  FramePoolClass_Count = 1,   ///< count of size classes
+};
+
+struct FramePoolClass_t {
+  uint8_t *Memory;            ///< memory of all blocks in the class
+  size_t BlockSize;           ///< size of one block
+  uint8_t BlockCount;         ///< count of blocks
+  uint32_t FreeMask;          ///< bit mask of free blocks
+  uint8_t InUse;              ///< count of used blocks
+  uint8_t HighWater;          ///< maximum count of used blocks
+  uint32_t Failures;          ///< count of failed allocations
+};
+
+class FramePool {
+private:
+  FramePoolClass_t Class[FramePoolClass_Count];  ///< size classes
+  SemaphoreHandle_t PoolMutex;                  ///< mutex for pool access
+
+  bool InitClass(FramePoolClass_enum, size_t, uint8_t);
+
+public:
+  FramePool();
+  ~FramePool(){};
+
+  void Init();
+  uint8_t *Alloc(size_t, size_t *);
+  void Free(uint8_t *);
+  bool GetClassInfo(uint8_t, FramePoolClass_t *);
+};
+
+extern FramePool SystemFramePool;  ///< frame pool object
+
+/* EOF */
@@ -0,0 +1,323 @@
+/**
+   @file http_response.cpp
+
+   @brief Incremental parser of the HTTP/1.1 response
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "http_response.h"
+
+/**
+   @brief Constructor for HttpResponseParser class
+   @param none
+   @return none
+*/
+HttpResponseParser::HttpResponseParser() {
+  Reset();
+}
+
+/**
+   @brief Prepare the parser for the next response
+   @param none
+   @return none
+*/
+void HttpResponseParser::Reset() {
+  State = HttpParser_StatusLine;
+  LineLen = 0;
+  Line[0] = '\0';
+  StatusLine[0] = '\0';
+  StatusCode = 0;
+  Http11 = false;
+  KeepAlive = false;
+  Chunked = false;
+  ContentLength = -1;
+  RetryAfter = 0;
+  Remaining = 0;
+  Body[0] = '\0';
+  BodyLen = 0;
+}
+
+/**
+   @brief Parse the received bytes. The bytes after the end of the response are not consumed
+   @param const uint8_t* - received data
+   @param size_t - length of data
+   @return size_t - count of consumed bytes
+*/
+size_t HttpResponseParser::Parse(const uint8_t *i_data, size_t i_len) {
+  size_t pos = 0;
+
+  while ((pos < i_len) && (HttpParser_Done != State) && (HttpParser_Error != State)) {
+    switch (State) {
+      case HttpParser_Body:
+      case HttpParser_BodyUntilClose:
+      case HttpParser_ChunkData:
+        pos += ProcessBody(i_data + pos, i_len - pos);
+        break;
+
+      default:
+        if (true == ReadLine(i_data[pos++])) {
+          if (HttpParser_StatusLine == State) {
+            ProcessStatusLine();
+          } else if (HttpParser_Header == State) {
+            if (0 == LineLen) {
+              ProcessHeaderEnd();
+            } else {
+              ProcessHeaderLine();
+            }
+          } else if (HttpParser_ChunkSize == State) {
+            ProcessChunkSize();
+          } else if (HttpParser_ChunkDataEnd == State) {
+            State = (0 == LineLen) ? HttpParser_ChunkSize : HttpParser_Error;
+          } else if ((HttpParser_Trailer == State) && (0 == LineLen)) {
+            State = HttpParser_Done;
+          }
+          LineLen = 0;
+        }
+        break;
+    }
+  }
+
+  return pos;
+}
+
+/**
+   @brief The connection was closed. The body without length ends here, any other state is incomplete
+   @param none
+   @return none
+*/
+void HttpResponseParser::Finish() {
+  if (HttpParser_BodyUntilClose == State) {
+    State = HttpParser_Done;
+  } else if (HttpParser_Done != State) {
+    State = HttpParser_Error;
+  }
+  KeepAlive = false;
+}
+
+/**
+   @brief Add byte to the current line
+   @param uint8_t - received byte
+   @return bool - true = the line is complete, CR and LF are removed
+*/
+bool HttpResponseParser::ReadLine(uint8_t i_byte) {
+  if ('\n' == i_byte) {
+    if ((LineLen > 0) && ('\r' == Line[LineLen - 1])) {
+      LineLen--;
+    }
+    Line[LineLen] = '\0';
+    return true;
+  }
+
+  /* the end of the long line is dropped, only the beginning is used */
+  if (LineLen < (sizeof(Line) - 1)) {
+    Line[LineLen++] = (char) i_byte;
+  }
+
+  return false;
+}
+
+/**
+   @brief Process the status line, "HTTP/1.1 204 No Content"
+   @param none
+   @return none
+*/
+void HttpResponseParser::ProcessStatusLine() {
+  /* empty lines before the status line are ignored */
+  if (0 == LineLen) {
+    return;
+  }
+
+  if ((LineLen < 12) || (0 != strncmp(Line, "HTTP/1.", 7)) || (' ' != Line[8])) {
+    State = HttpParser_Error;
+    return;
+  }
+
+  strcpy(StatusLine, Line);
+  Http11 = ('1' == Line[7]);
+  KeepAlive = Http11;
+  StatusCode = atoi(Line + 9);
+  State = HttpParser_Header;
+}
+
+/**
+   @brief Process one header line. Only the headers for the message length and the connection are used
+   @param none
+   @return none
+*/
+void HttpResponseParser::ProcessHeaderLine() {
+  char *value = strchr(Line, ':');
+  if (NULL == value) {
+    return;
+  }
+  *value++ = '\0';
+  while ((' ' == *value) || ('\t' == *value)) {
+    value++;
+  }
+
+  /* header names and the used values are case insensitive */
+  for (char *c = Line; *c != '\0'; c++) {
+    *c = tolower(*c);
+  }
+  for (char *c = value; *c != '\0'; c++) {
+    *c = tolower(*c);
+  }
+
+  if (0 == strcmp(Line, "content-length")) {
+    ContentLength = atol(value);
+  } else if (0 == strcmp(Line, "transfer-encoding")) {
+    Chunked = (NULL != strstr(value, "chunked"));
+  } else if (0 == strcmp(Line, "retry-after")) {
+    /* the http date format is not used, the delay is computed by the client */
+    if (isdigit(*value)) {
+      RetryAfter = strtoul(value, NULL, 10);
+    }
+  } else if (0 == strcmp(Line, "connection")) {
+    if (NULL != strstr(value, "close")) {
+      KeepAlive = false;
+    } else if (NULL != strstr(value, "keep-alive")) {
+      KeepAlive = true;
+    }
+  }
+}
+
+/**
+   @brief Headers are complete, find how the body ends
+   @param none
+   @return none
+*/
+void HttpResponseParser::ProcessHeaderEnd() {
+  /* informational response is followed by the final response */
+  if ((StatusCode >= 100) && (StatusCode < 200)) {
+    Reset();
+    return;
+  }
+
+  if ((204 == StatusCode) || (304 == StatusCode)) {
+    State = HttpParser_Done;
+  } else if (true == Chunked) {
+    State = HttpParser_ChunkSize;
+  } else if (ContentLength >= 0) {
+    Remaining = ContentLength;
+    State = (0 == Remaining) ? HttpParser_Done : HttpParser_Body;
+  } else {
+    /* without the length the connection can not be used again */
+    KeepAlive = false;
+    State = HttpParser_BodyUntilClose;
+  }
+}
+
+/**
+   @brief Process the chunk size line, the chunk extensions are ignored
+   @param none
+   @return none
+*/
+void HttpResponseParser::ProcessChunkSize() {
+  char *end = NULL;
+  Remaining = strtoul(Line, &end, 16);
+
+  if ((end == Line) || ((*end != '\0') && (*end != ';') && (*end != ' '))) {
+    State = HttpParser_Error;
+  } else if (0 == Remaining) {
+    State = HttpParser_Trailer;
+  } else {
+    State = HttpParser_ChunkData;
+  }
+}
+
+/**
+   @brief Consume the body bytes. The beginning of the body is stored for the log
+   @param const uint8_t* - received data
+   @param size_t - length of data
+   @return size_t - count of consumed bytes
+*/
+size_t HttpResponseParser::ProcessBody(const uint8_t *i_data, size_t i_len) {
+  size_t len = i_len;
+  if (HttpParser_BodyUntilClose != State) {
+    len = min((size_t) Remaining, i_len);
+    Remaining -= len;
+  }
+
+  size_t store = min(len, (size_t)(sizeof(Body) - 1 - BodyLen));
+  memcpy(Body + BodyLen, i_data, store);
+  BodyLen += store;
+  Body[BodyLen] = '\0';
+
+  if (0 == Remaining) {
+    if (HttpParser_Body == State) {
+      State = HttpParser_Done;
+    } else if (HttpParser_ChunkData == State) {
+      State = HttpParser_ChunkDataEnd;
+    }
+  }
+
+  return len;
+}
+
+/**
+   @brief Get status of the response
+   @param none
+   @return bool - true = response is complete
+*/
+bool HttpResponseParser::IsDone() {
+  return (HttpParser_Done == State);
+}
+
+/**
+   @brief Get error status of the response
+   @param none
+   @return bool - true = malformed or incomplete response
+*/
+bool HttpResponseParser::IsError() {
+  return (HttpParser_Error == State);
+}
+
+/**
+   @brief Get http status code
+   @param none
+   @return int16_t - status code, 0 = no status line
+*/
+int16_t HttpResponseParser::GetStatusCode() {
+  return StatusCode;
+}
+
+/**
+   @brief Get status of the connection after the response
+   @param none
+   @return bool - true = the connection can be used for the next request
+*/
+bool HttpResponseParser::GetKeepAlive() {
+  return KeepAlive && (HttpParser_Done == State);
+}
+
+/**
+   @brief Get delay requested by the server with the Retry-After header
+   @param none
+   @return uint32_t - delay [s], 0 = not requested
+*/
+uint32_t HttpResponseParser::GetRetryAfter() {
+  return RetryAfter;
+}
+
+/**
+   @brief Get status line of the response
+   @param none
+   @return const char* - status line
+*/
+const char *HttpResponseParser::GetStatusLine() {
+  return StatusLine;
+}
+
+/**
+   @brief Get beginning of the response body
+   @param none
+   @return const char* - body, HTTP_PARSER_BODY_SIZE - 1 bytes at most
+*/
+const char *HttpResponseParser::GetBody() {
+  return Body;
+}
+
+/* EOF */
@@ -0,0 +1,76 @@
+/**
+   @file http_response.h
+
+   @brief Incremental parser of the HTTP/1.1 response
+
+   The parser is fed with the received bytes. It reads the status line and
+   the headers, and it finds the end of the body from Content-Length, from
+   the chunked encoding, or from the closed connection. The body is not
+   stored, only its beginning is kept for the log.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "mcu_cfg.h"
+
+enum HttpParserState_enum {
+  HttpParser_StatusLine = 0,      ///< waiting for the status line
+  HttpParser_Header = 1,          ///< reading headers
+  HttpParser_Body = 2,            ///< body with Content-Length
+  HttpParser_BodyUntilClose = 3,  ///< body ends with the closed connection
+  HttpParser_ChunkSize = 4,       ///< chunk size line
+  HttpParser_ChunkData = 5,       ///< chunk data
+  HttpParser_ChunkDataEnd = 6,    ///< CRLF after the chunk data
+  HttpParser_Trailer = 7,         ///< trailer after the last chunk
+  HttpParser_Done = 8,            ///< response is complete
+  HttpParser_Error = 9,           ///< malformed response
+};
+
+class HttpResponseParser {
+private:
+  HttpParserState_enum State;     ///< parser state
+  char Line[HTTP_PARSER_LINE_SIZE];   ///< current line of the status, header or chunk size
+  uint16_t LineLen;               ///< length of the current line
+  char StatusLine[HTTP_PARSER_LINE_SIZE]; ///< status line for the log
+  int16_t StatusCode;             ///< http status code
+  bool Http11;                    ///< HTTP/1.1 response
+  bool KeepAlive;                 ///< server keeps the connection open
+  bool Chunked;                   ///< chunked transfer encoding
+  int32_t ContentLength;          ///< Content-Length, -1 = not present
+  uint32_t RetryAfter;            ///< Retry-After in seconds, 0 = not present or http date
+  uint32_t Remaining;             ///< remaining bytes of the body or of the chunk
+  char Body[HTTP_PARSER_BODY_SIZE];   ///< beginning of the body for the log
+  uint16_t BodyLen;               ///< length of the stored body
+
+  bool ReadLine(uint8_t);
+  void ProcessStatusLine();
+  void ProcessHeaderLine();
+  void ProcessHeaderEnd();
+  void ProcessChunkSize();
+  size_t ProcessBody(const uint8_t *, size_t);
+
+public:
+  HttpResponseParser();
+  ~HttpResponseParser(){};
+
+  void Reset();
+  size_t Parse(const uint8_t *, size_t);
+  void Finish();
+
+  bool IsDone();
+  bool IsError();
+  int16_t GetStatusCode();
+  bool GetKeepAlive();
+  uint32_t GetRetryAfter();
+  const char *GetStatusLine();
+  const char *GetBody();
+};
+
+/* EOF */
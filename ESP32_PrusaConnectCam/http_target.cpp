@@ -0,0 +1,74 @@
+/**
+   @file http_target.cpp
+
+   @brief URL and request header of the local HTTP target
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "http_target.h"
+
+/**
+   @brief Split the URL to the host, port and path
+   @param const String & - URL, http://host[:port][/path]
+   @param HttpTargetUrl_t * - output host, port and path. The host is empty for the invalid URL
+   @return bool - true = URL is valid
+*/
+bool HttpTarget_ParseUrl(const String &i_url, HttpTargetUrl_t *o_url) {
+  o_url->Host = "";
+  o_url->Port = HTTP_TARGET_DEFAULT_PORT;
+  o_url->Path = "/";
+
+  if (false == i_url.startsWith(HTTP_TARGET_SCHEME)) {
+    return false;
+  }
+
+  String tmp = i_url.substring(strlen(HTTP_TARGET_SCHEME));
+  String path = "/";
+  int PathStart = tmp.indexOf('/');
+  if (PathStart >= 0) {
+    path = tmp.substring(PathStart);
+    tmp = tmp.substring(0, PathStart);
+  }
+
+  long port = HTTP_TARGET_DEFAULT_PORT;
+  int PortStart = tmp.indexOf(':');
+  if (PortStart >= 0) {
+    port = tmp.substring(PortStart + 1).toInt();
+    tmp = tmp.substring(0, PortStart);
+  }
+
+  /* port out of the range is not truncated to the other port */
+  if ((0 == tmp.length()) || (port <= 0) || (port > UINT16_MAX)) {
+    return false;
+  }
+
+  o_url->Host = tmp;
+  o_url->Port = (uint16_t) port;
+  o_url->Path = path;
+
+  return true;
+}
+
+/**
+   @brief Get the request header for the photo. The connection is closed after each photo
+   @param bool - true = PUT, false = POST
+   @param const HttpTargetUrl_t * - target
+   @param size_t - photo length
+   @return String - request header with the empty line
+*/
+String HttpTarget_GetRequestHeader(bool i_put, const HttpTargetUrl_t *i_url, size_t i_len) {
+  String header = String((true == i_put) ? "PUT " : "POST ") + i_url->Path + " HTTP/1.1\r\n";
+  header += "Host: " + i_url->Host + ":" + String(i_url->Port) + "\r\n";
+  header += "User-Agent: ESP32-CAM\r\n";
+  header += "Content-Type: image/jpeg\r\n";
+  header += "Content-Length: " + String(i_len) + "\r\n";
+  header += "Connection: close\r\n\r\n";
+
+  return header;
+}
+
+/* EOF */
@@ -0,0 +1,35 @@
+/**
+   @file http_target.h
+
+   @brief URL and request header of the local HTTP target
+
+   The URL of the local target (NVR, Home Assistant webhook) is split to the
+   host, port and path once, after the URL is changed. Only the plain http
+   is supported, the target is in the local network. The functions do not
+   use the WiFi client, so they are tested on the host.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "mcu_cfg.h"
+
+#define HTTP_TARGET_SCHEME          "http://"               ///< supported URL scheme
+#define HTTP_TARGET_DEFAULT_PORT    80                      ///< port of the URL without the port
+
+struct HttpTargetUrl_t {
+  String Host;                      ///< host name or IPv4 address
+  uint16_t Port;                    ///< port
+  String Path;                      ///< path with the query, "/" when the URL has no path
+};
+
+bool HttpTarget_ParseUrl(const String &, HttpTargetUrl_t *);
+String HttpTarget_GetRequestHeader(bool, const HttpTargetUrl_t *, size_t);
+
+/* EOF */
@@ -0,0 +1,173 @@
+/**
+   @file jpeg_check.cpp
+
+   @brief Library for structural check of the jpeg frames from the camera
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "jpeg_check.h"
+
+#define JPEG_MARKER         0xFF    ///< marker prefix
+#define JPEG_SOI            0xD8    ///< start of image
+#define JPEG_EOI            0xD9    ///< end of image
+#define JPEG_SOS            0xDA    ///< start of scan
+#define JPEG_TEM            0x01    ///< temporary marker without length
+#define JPEG_RST0           0xD0    ///< first restart marker
+#define JPEG_RST7           0xD7    ///< last restart marker
+#define JPEG_SOF0           0xC0    ///< first start of frame marker
+#define JPEG_SOF15          0xCF    ///< last start of frame marker
+#define JPEG_DHT            0xC4    ///< huffman table, in the SOF range
+#define JPEG_JPG            0xC8    ///< reserved, in the SOF range
+#define JPEG_DAC            0xCC    ///< arithmetic coding, in the SOF range
+
+/**
+   @brief Check if the 32-bit word contains 0xFF byte
+   @param uint32_t - word
+   @return bool - true = word contains 0xFF
+*/
+static inline bool Jpeg_WordHasMarker(uint32_t i_word) {
+  uint32_t inv = ~i_word;
+  return (0 != ((inv - 0x01010101UL) & ~inv & 0x80808080UL));
+}
+
+/**
+   @brief Skip the entropy coded data after SOS. Inside the data 0xFF is followed only by
+          the stuffed 0x00 or the restart marker. The data is scanned word by word
+   @param const uint8_t* - frame
+   @param size_t - frame length
+   @param size_t - position of the entropy coded data
+   @return size_t - position of the marker after the data, frame length when no marker is found
+*/
+static size_t Jpeg_SkipScan(const uint8_t *i_buf, size_t i_len, size_t i_pos) {
+  while ((i_pos + 1) < i_len) {
+    /* skip words without 0xFF, the word access is aligned */
+    if ((0 == ((uintptr_t)(i_buf + i_pos) & 3)) && ((i_pos + 4) <= i_len)) {
+      if (false == Jpeg_WordHasMarker(*(const uint32_t *)(i_buf + i_pos))) {
+        i_pos += 4;
+        continue;
+      }
+    }
+
+    if (JPEG_MARKER != i_buf[i_pos]) {
+      i_pos++;
+      continue;
+    }
+
+    uint8_t marker = i_buf[i_pos + 1];
+    if ((0x00 == marker) || ((marker >= JPEG_RST0) && (marker <= JPEG_RST7))) {
+      i_pos += 2;
+    } else if (JPEG_MARKER == marker) {
+      /* fill byte before the marker */
+      i_pos++;
+    } else {
+      return i_pos;
+    }
+  }
+
+  return i_len;
+}
+
+/**
+   @brief Check structure of the jpeg frame
+   @param const uint8_t* - frame
+   @param size_t - frame length
+   @param uint16_t - expected width, 0 = not checked
+   @param uint16_t - expected height, 0 = not checked
+   @return JpegStatus_enum - frame status
+*/
+JpegStatus_enum Jpeg_Check(const uint8_t *i_buf, size_t i_len, uint16_t i_width, uint16_t i_height) {
+  size_t pos = 2;
+  bool sof = false;
+  bool sos = false;
+
+  if ((NULL == i_buf) || (i_len < 4)) {
+    return JpegStatus_Truncated;
+  }
+
+  if ((JPEG_MARKER != i_buf[0]) || (JPEG_SOI != i_buf[1])) {
+    return JpegStatus_Corrupt;
+  }
+
+  while (pos < i_len) {
+    if (JPEG_MARKER != i_buf[pos]) {
+      return JpegStatus_Corrupt;
+    }
+
+    /* skip fill bytes */
+    while ((pos < i_len) && (JPEG_MARKER == i_buf[pos])) {
+      pos++;
+    }
+    if (pos >= i_len) {
+      return JpegStatus_Truncated;
+    }
+
+    uint8_t marker = i_buf[pos++];
+    if ((JPEG_TEM == marker) || ((marker >= JPEG_RST0) && (marker <= JPEG_RST7))) {
+      continue;
+    } else if (JPEG_EOI == marker) {
+      /* data after EOI is padding of the frame buffer */
+      return (true == sos) ? JpegStatus_Valid : JpegStatus_Corrupt;
+    } else if ((JPEG_SOI == marker) || (0x00 == marker)) {
+      return JpegStatus_Corrupt;
+    }
+
+    /* segment with length */
+    if ((pos + 2) > i_len) {
+      return JpegStatus_Truncated;
+    }
+    size_t SegmentLen = (i_buf[pos] << 8) | i_buf[pos + 1];
+    if (SegmentLen < 2) {
+      return JpegStatus_Corrupt;
+    }
+    if ((pos + SegmentLen) > i_len) {
+      return JpegStatus_Truncated;
+    }
+
+    if ((marker >= JPEG_SOF0) && (marker <= JPEG_SOF15) && (JPEG_DHT != marker) && (JPEG_JPG != marker) && (JPEG_DAC != marker)) {
+      if (SegmentLen < 8) {
+        return JpegStatus_Corrupt;
+      }
+      uint16_t height = (i_buf[pos + 3] << 8) | i_buf[pos + 4];
+      uint16_t width = (i_buf[pos + 5] << 8) | i_buf[pos + 6];
+      if (((0 != i_width) && (width != i_width)) || ((0 != i_height) && (height != i_height))) {
+        return JpegStatus_Corrupt;
+      }
+      sof = true;
+
+    } else if (JPEG_SOS == marker) {
+      if (false == sof) {
+        return JpegStatus_Corrupt;
+      }
+      /* progressive frames have more scans, the walker continues from the marker after the data */
+      sos = true;
+      pos = Jpeg_SkipScan(i_buf, i_len, pos + SegmentLen);
+      continue;
+    }
+
+    pos += SegmentLen;
+  }
+
+  return JpegStatus_Truncated;
+}
+
+/**
+   @brief Get name of the frame status for logs
+   @param JpegStatus_enum - frame status
+   @return const char* - name
+*/
+const char *Jpeg_GetStatusName(JpegStatus_enum i_status) {
+  switch (i_status) {
+    case JpegStatus_Valid:
+      return "valid";
+    case JpegStatus_Truncated:
+      return "truncated";
+    default:
+      return "corrupt";
+  }
+}
+
+/* EOF */
@@ -0,0 +1,28 @@
+/**
+   @file jpeg_check.h
+
+   @brief Library for structural check of the jpeg frames from the camera
+
+   Single pass marker walker. Checks SOI, segment lengths, SOF dimensions,
+   SOS and the EOI after the entropy coded data.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+enum JpegStatus_enum {
+  JpegStatus_Valid = 0,       ///< complete jpeg frame
+  JpegStatus_Truncated = 1,   ///< frame ends before EOI
+  JpegStatus_Corrupt = 2,     ///< bad marker, segment or dimensions
+};
+
+JpegStatus_enum Jpeg_Check(const uint8_t *, size_t, uint16_t, uint16_t);
+const char *Jpeg_GetStatusName(JpegStatus_enum);
+
+/* EOF */
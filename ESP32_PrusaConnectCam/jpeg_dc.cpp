@@ -0,0 +1,437 @@
+/**
+   @file jpeg_dc.cpp
+
+   @brief Library for decoding DC coefficients of the baseline jpeg frame
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "jpeg_dc.h"
+
+/**
+   @brief Constructor for JpegDcDecoder class
+   @param none
+   @return none
+*/
+JpegDcDecoder::JpegDcDecoder() {
+  memset(DcTable, 0, sizeof(DcTable));
+  memset(AcTable, 0, sizeof(AcTable));
+  memset(DcQuant, 0, sizeof(DcQuant));
+  memset(Component, 0, sizeof(Component));
+  ComponentCount = 0;
+  Width = 0;
+  Height = 0;
+  RestartInterval = 0;
+  Data = NULL;
+  DataLen = 0;
+  DataPos = 0;
+  BitBuffer = 0;
+  BitCount = 0;
+  MarkerHit = false;
+}
+
+/**
+   @brief Build canonical huffman table from DHT segment
+   @param JpegHuffTable_t* - output table
+   @param const uint8_t* - count of codes for each length 1-16
+   @param const uint8_t* - symbols
+   @return bool - true = table is valid
+*/
+bool JpegDcDecoder::BuildTable(JpegHuffTable_t *o_table, const uint8_t *i_counts, const uint8_t *i_symbols) {
+  uint32_t code = 0;
+  uint16_t index = 0;
+
+  for (uint8_t len = 1; len <= 16; len++) {
+    uint8_t count = i_counts[len - 1];
+    o_table->ValPtr[len] = index;
+    o_table->MinCode[len] = code;
+    if (0 == count) {
+      o_table->MaxCode[len] = -1;
+    } else {
+      if ((index + count) > 256) {
+        return false;
+      }
+      memcpy(&o_table->Symbols[index], &i_symbols[index], count);
+      index += count;
+      code += count;
+      o_table->MaxCode[len] = code - 1;
+    }
+    code <<= 1;
+  }
+  o_table->MaxCode[17] = INT32_MAX;
+  o_table->Valid = true;
+
+  return true;
+}
+
+/**
+   @brief Fill the bit buffer from the entropy coded data. Stuffed 0x00 after 0xFF is removed,
+          the marker stops the filling and zero bits are added
+   @param none
+   @return none
+*/
+void JpegDcDecoder::FillBits() {
+  while (BitCount <= 24) {
+    uint8_t byte = 0;
+    if ((false == MarkerHit) && (DataPos < DataLen)) {
+      byte = Data[DataPos];
+      if (0xFF == byte) {
+        uint8_t next = ((DataPos + 1) < DataLen) ? Data[DataPos + 1] : 0xD9;
+        if (0x00 == next) {
+          DataPos += 2;
+        } else {
+          MarkerHit = true;
+          byte = 0;
+        }
+      } else {
+        DataPos++;
+      }
+    }
+    BitBuffer |= (uint32_t)byte << (24 - BitCount);
+    BitCount += 8;
+  }
+}
+
+/**
+   @brief Get bits from the bit buffer
+   @param uint8_t - count of bits 0-16
+   @return int32_t - bits
+*/
+int32_t JpegDcDecoder::GetBits(uint8_t i_count) {
+  if (0 == i_count) {
+    return 0;
+  }
+
+  if (BitCount < i_count) {
+    FillBits();
+  }
+  int32_t ret = BitBuffer >> (32 - i_count);
+  BitBuffer <<= i_count;
+  BitCount -= i_count;
+
+  return ret;
+}
+
+/**
+   @brief Decode one huffman symbol
+   @param const JpegHuffTable_t* - huffman table
+   @return int16_t - symbol, -1 = bad code
+*/
+int16_t JpegDcDecoder::DecodeSymbol(const JpegHuffTable_t *i_table) {
+  if (BitCount < 16) {
+    FillBits();
+  }
+
+  /* canonical decoding, the code of each length is compared with the maximum code */
+  for (uint8_t len = 1; len <= 16; len++) {
+    int32_t code = BitBuffer >> (32 - len);
+    if (code <= i_table->MaxCode[len]) {
+      BitBuffer <<= len;
+      BitCount -= len;
+      return i_table->Symbols[i_table->ValPtr[len] + code - i_table->MinCode[len]];
+    }
+  }
+
+  return -1;
+}
+
+/**
+   @brief Skip the restart marker and reset the DC predictors
+   @param none
+   @return bool - true = restart marker found
+*/
+bool JpegDcDecoder::SkipRestartMarker() {
+  BitBuffer = 0;
+  BitCount = 0;
+  MarkerHit = false;
+
+  if (((DataPos + 1) >= DataLen) || (0xFF != Data[DataPos]) || (0xD0 != (Data[DataPos + 1] & 0xF8))) {
+    return false;
+  }
+  DataPos += 2;
+
+  for (uint8_t i = 0; i < ComponentCount; i++) {
+    Component[i].Pred = 0;
+  }
+
+  return true;
+}
+
+/**
+   @brief Decode the interleaved scan. DC coefficient of each luma block is stored to the grid or to the color image
+   @param uint8_t* - luma grid, NULL = not used
+   @param uint8_t* - color image, NULL = not used
+   @param uint32_t - maximum count of grid cells
+   @param uint16_t* - grid width
+   @param uint16_t* - grid height
+   @return bool - true = scan is decoded
+*/
+bool JpegDcDecoder::DecodeScan(uint8_t *o_grid, uint8_t *o_rgb, uint32_t i_maxCells, uint16_t *o_width, uint16_t *o_height) {
+  uint8_t McuLuma[16];
+  int16_t chroma[JPEG_DC_MAX_COMPONENTS] = { 0, 128, 128 };
+  uint8_t Hmax = 1;
+  uint8_t Vmax = 1;
+
+  for (uint8_t i = 0; i < ComponentCount; i++) {
+    Hmax = max(Hmax, Component[i].H);
+    Vmax = max(Vmax, Component[i].V);
+  }
+
+  /* single component frame has one block in the MCU */
+  if (1 == ComponentCount) {
+    Hmax = Vmax = 1;
+    Component[0].H = Component[0].V = 1;
+  }
+
+  uint16_t McuX = (Width + (8 * Hmax) - 1) / (8 * Hmax);
+  uint16_t McuY = (Height + (8 * Vmax) - 1) / (8 * Vmax);
+  uint16_t GridW = McuX * Component[0].H;
+  uint16_t GridH = McuY * Component[0].V;
+
+  if ((((uint32_t)GridW * GridH) > i_maxCells) || ((Component[0].H * Component[0].V) > (int)sizeof(McuLuma))) {
+    return false;
+  }
+
+  uint32_t McuCount = (uint32_t)McuX * McuY;
+  for (uint32_t mcu = 0; mcu < McuCount; mcu++) {
+    if ((0 != RestartInterval) && (0 != mcu) && (0 == (mcu % RestartInterval))) {
+      if (false == SkipRestartMarker()) {
+        return false;
+      }
+    }
+
+    uint16_t mx = mcu % McuX;
+    uint16_t my = mcu / McuX;
+    for (uint8_t c = 0; c < ComponentCount; c++) {
+      JpegComponent_t *comp = &Component[c];
+      for (uint8_t v = 0; v < comp->V; v++) {
+        for (uint8_t h = 0; h < comp->H; h++) {
+          /* DC coefficient */
+          int16_t s = DecodeSymbol(&DcTable[comp->Td]);
+          if ((s < 0) || (s > 11)) {
+            return false;
+          }
+          int32_t diff = GetBits(s);
+          if ((0 != s) && (diff < (1 << (s - 1)))) {
+            diff -= (1 << s) - 1;
+          }
+          comp->Pred += diff;
+
+          /* AC coefficients are skipped */
+          for (uint8_t k = 1; k < 64;) {
+            int16_t rs = DecodeSymbol(&AcTable[comp->Ta]);
+            if (rs < 0) {
+              return false;
+            }
+            uint8_t r = rs >> 4;
+            uint8_t size = rs & 0x0F;
+            if (0 == size) {
+              if (15 != r) {
+                break;
+              }
+              k += 16;
+            } else {
+              k += r + 1;
+              GetBits(size);
+            }
+          }
+
+          int32_t value = ((comp->Pred * DcQuant[comp->Tq]) / 8) + 128;
+          value = constrain(value, 0, 255);
+          if (0 == c) {
+            McuLuma[(v * comp->H) + h] = value;
+            if (NULL != o_grid) {
+              o_grid[((my * comp->V) + v) * GridW + (mx * comp->H) + h] = value;
+            }
+          } else {
+            chroma[c] = value - 128;
+          }
+        }
+      }
+    }
+
+    /* the chroma DC of the MCU is used for all luma blocks of the MCU */
+    if (NULL != o_rgb) {
+      int16_t dr = (359 * chroma[2]) >> 8;
+      int16_t dg = ((88 * chroma[1]) + (183 * chroma[2])) >> 8;
+      int16_t db = (454 * chroma[1]) >> 8;
+      for (uint8_t v = 0; v < Component[0].V; v++) {
+        for (uint8_t h = 0; h < Component[0].H; h++) {
+          int16_t y = McuLuma[(v * Component[0].H) + h];
+          uint8_t *px = &o_rgb[3 * ((((my * Component[0].V) + v) * GridW) + (mx * Component[0].H) + h)];
+          /* RGB888 of the camera driver is stored as BGR */
+          px[0] = constrain(y + db, 0, 255);
+          px[1] = constrain(y - dg, 0, 255);
+          px[2] = constrain(y + dr, 0, 255);
+        }
+      }
+    }
+  }
+
+  *o_width = GridW;
+  *o_height = GridH;
+
+  return true;
+}
+
+/**
+   @brief Decode luma grid at 1/8 scale from the baseline jpeg frame
+   @param const uint8_t* - jpeg frame
+   @param size_t - frame length
+   @param uint8_t* - output luma grid
+   @param uint32_t - maximum count of grid cells
+   @param uint16_t* - grid width
+   @param uint16_t* - grid height
+   @return bool - true = grid is decoded
+*/
+bool JpegDcDecoder::Decode(const uint8_t *i_buf, size_t i_len, uint8_t *o_grid, uint32_t i_maxCells, uint16_t *o_width, uint16_t *o_height) {
+  return Parse(i_buf, i_len, o_grid, NULL, i_maxCells, o_width, o_height);
+}
+
+/**
+   @brief Decode color image at 1/8 scale from the baseline jpeg frame
+   @param const uint8_t* - jpeg frame
+   @param size_t - frame length
+   @param uint8_t* - output image, RGB888 in the camera driver byte order, 3 bytes for each cell
+   @param uint32_t - maximum count of image cells
+   @param uint16_t* - image width
+   @param uint16_t* - image height
+   @return bool - true = image is decoded
+*/
+bool JpegDcDecoder::DecodeRgb(const uint8_t *i_buf, size_t i_len, uint8_t *o_rgb, uint32_t i_maxCells, uint16_t *o_width, uint16_t *o_height) {
+  return Parse(i_buf, i_len, NULL, o_rgb, i_maxCells, o_width, o_height);
+}
+
+/**
+   @brief Parse jpeg headers and decode the scan to the luma grid or to the color image
+   @param const uint8_t* - jpeg frame
+   @param size_t - frame length
+   @param uint8_t* - output luma grid, NULL = not used
+   @param uint8_t* - output color image, NULL = not used
+   @param uint32_t - maximum count of cells
+   @param uint16_t* - width
+   @param uint16_t* - height
+   @return bool - true = frame is decoded
+*/
+bool JpegDcDecoder::Parse(const uint8_t *i_buf, size_t i_len, uint8_t *o_grid, uint8_t *o_rgb, uint32_t i_maxCells, uint16_t *o_width, uint16_t *o_height) {
+  size_t pos = 2;
+
+  if ((NULL == i_buf) || (i_len < 4) || (0xFF != i_buf[0]) || (0xD8 != i_buf[1])) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < JPEG_DC_MAX_TABLES; i++) {
+    DcTable[i].Valid = false;
+    AcTable[i].Valid = false;
+  }
+  ComponentCount = 0;
+  RestartInterval = 0;
+
+  while ((pos + 4) <= i_len) {
+    if (0xFF != i_buf[pos]) {
+      return false;
+    }
+    uint8_t marker = i_buf[pos + 1];
+    if (0xFF == marker) {
+      pos++;
+      continue;
+    }
+    size_t SegmentLen = (i_buf[pos + 2] << 8) | i_buf[pos + 3];
+    const uint8_t *seg = &i_buf[pos + 4];
+    size_t len = SegmentLen - 2;
+    if ((SegmentLen < 2) || ((pos + 2 + SegmentLen) > i_len)) {
+      return false;
+    }
+
+    if (0xDB == marker) {
+      /* DQT, only the DC value is used */
+      for (size_t i = 0; i < len;) {
+        uint8_t precision = seg[i] >> 4;
+        uint8_t id = seg[i] & 0x03;
+        DcQuant[id] = (0 == precision) ? seg[i + 1] : ((seg[i + 1] << 8) | seg[i + 2]);
+        i += 1 + ((0 == precision) ? 64 : 128);
+      }
+
+    } else if (0xC4 == marker) {
+      /* DHT */
+      for (size_t i = 0; (i + 17) <= len;) {
+        uint8_t TableClass = seg[i] >> 4;
+        uint8_t id = seg[i] & 0x03;
+        const uint8_t *counts = &seg[i + 1];
+        uint16_t total = 0;
+        for (uint8_t j = 0; j < 16; j++) {
+          total += counts[j];
+        }
+        if ((i + 17 + total) > len) {
+          return false;
+        }
+        if (false == BuildTable((0 == TableClass) ? &DcTable[id] : &AcTable[id], counts, &seg[i + 17])) {
+          return false;
+        }
+        i += 17 + total;
+      }
+
+    } else if ((0xC0 == marker) || (0xC1 == marker)) {
+      /* baseline SOF */
+      ComponentCount = seg[5];
+      if ((0 == ComponentCount) || (ComponentCount > JPEG_DC_MAX_COMPONENTS) || (len < (6 + (3 * (size_t)ComponentCount)))) {
+        return false;
+      }
+      Height = (seg[1] << 8) | seg[2];
+      Width = (seg[3] << 8) | seg[4];
+      for (uint8_t i = 0; i < ComponentCount; i++) {
+        Component[i].Id = seg[6 + (3 * i)];
+        Component[i].H = seg[7 + (3 * i)] >> 4;
+        Component[i].V = seg[7 + (3 * i)] & 0x0F;
+        Component[i].Tq = seg[8 + (3 * i)] & 0x03;
+        Component[i].Pred = 0;
+        if ((0 == Component[i].H) || (0 == Component[i].V)) {
+          return false;
+        }
+      }
+
+    } else if ((marker >= 0xC2) && (marker <= 0xCF) && (0xC4 != marker) && (0xC8 != marker) && (0xCC != marker)) {
+      /* progressive and arithmetic frames are not supported */
+      return false;
+
+    } else if (0xDD == marker) {
+      /* DRI */
+      RestartInterval = (seg[0] << 8) | seg[1];
+
+    } else if (0xDA == marker) {
+      /* SOS, only the interleaved scan with all components */
+      if ((0 == ComponentCount) || (seg[0] != ComponentCount)) {
+        return false;
+      }
+      for (uint8_t i = 0; i < ComponentCount; i++) {
+        uint8_t tables = seg[2 + (2 * i)];
+        Component[i].Td = tables >> 4 & 0x03;
+        Component[i].Ta = tables & 0x03;
+        if ((false == DcTable[Component[i].Td].Valid) || (false == AcTable[Component[i].Ta].Valid)) {
+          return false;
+        }
+      }
+
+      Data = i_buf;
+      DataLen = i_len;
+      DataPos = pos + 2 + SegmentLen;
+      BitBuffer = 0;
+      BitCount = 0;
+      MarkerHit = false;
+
+      return DecodeScan(o_grid, o_rgb, i_maxCells, o_width, o_height);
+
+    } else if (0xD9 == marker) {
+      return false;
+    }
+
+    pos += 2 + SegmentLen;
+  }
+
+  return false;
+}
+
+/* EOF */
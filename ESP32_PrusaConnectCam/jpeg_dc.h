@@ -0,0 +1,76 @@
+/**
+   @file jpeg_dc.h
+
+   @brief Library for decoding DC coefficients of the baseline jpeg frame
+
+   Only the entropy coded data is decoded, the AC coefficients are skipped
+   and no IDCT is calculated. The DC coefficient of each luma block is the
+   average of the 8x8 pixels, so the output is a luma grid at 1/8 scale.
+   The color image at 1/8 scale uses the chroma DC of the MCU.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#define JPEG_DC_MAX_COMPONENTS  3     ///< Y, Cb, Cr
+#define JPEG_DC_MAX_TABLES      4     ///< huffman and quantization tables
+
+struct JpegHuffTable_t {
+  int32_t MaxCode[18];        ///< maximum code of each length, -1 = no code
+  int32_t ValPtr[17];         ///< index of the first symbol of each length
+  uint16_t MinCode[17];       ///< minimum code of each length
+  uint8_t Symbols[256];       ///< symbols
+  bool Valid;                 ///< table is defined
+};
+
+struct JpegComponent_t {
+  uint8_t Id;                 ///< component id
+  uint8_t H;                  ///< horizontal sampling factor
+  uint8_t V;                  ///< vertical sampling factor
+  uint8_t Tq;                 ///< quantization table
+  uint8_t Td;                 ///< DC huffman table
+  uint8_t Ta;                 ///< AC huffman table
+  int16_t Pred;               ///< DC predictor
+};
+
+class JpegDcDecoder {
+private:
+  JpegHuffTable_t DcTable[JPEG_DC_MAX_TABLES];  ///< DC huffman tables
+  JpegHuffTable_t AcTable[JPEG_DC_MAX_TABLES];  ///< AC huffman tables
+  uint16_t DcQuant[JPEG_DC_MAX_TABLES];         ///< DC quantization values
+  JpegComponent_t Component[JPEG_DC_MAX_COMPONENTS]; ///< frame components
+  uint8_t ComponentCount;                       ///< count of frame components
+  uint16_t Width;                               ///< frame width
+  uint16_t Height;                              ///< frame height
+  uint16_t RestartInterval;                     ///< MCU count between restart markers, 0 = no restart
+
+  const uint8_t *Data;                          ///< entropy coded data
+  size_t DataLen;                               ///< frame length
+  size_t DataPos;                               ///< position in the frame
+  uint32_t BitBuffer;                           ///< bit buffer
+  int8_t BitCount;                              ///< count of bits in the buffer
+  bool MarkerHit;                               ///< marker reached in the entropy coded data
+
+  bool BuildTable(JpegHuffTable_t *, const uint8_t *, const uint8_t *);
+  void FillBits();
+  int32_t GetBits(uint8_t);
+  int16_t DecodeSymbol(const JpegHuffTable_t *);
+  bool SkipRestartMarker();
+  bool DecodeScan(uint8_t *, uint8_t *, uint32_t, uint16_t *, uint16_t *);
+  bool Parse(const uint8_t *, size_t, uint8_t *, uint8_t *, uint32_t, uint16_t *, uint16_t *);
+
+public:
+  JpegDcDecoder();
+  ~JpegDcDecoder(){};
+
+  bool Decode(const uint8_t *, size_t, uint8_t *, uint32_t, uint16_t *, uint16_t *);
+  bool DecodeRgb(const uint8_t *, size_t, uint8_t *, uint32_t, uint16_t *, uint16_t *);
+};
+
+/* EOF */
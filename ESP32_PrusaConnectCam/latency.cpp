@@ -0,0 +1,138 @@
+/**
+   @file latency.cpp
+
+   @brief Library for latency histograms of the capture stages
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "latency.h"
+
+LatencyStats SystemLatency;
+
+/* upper bounds of the buckets [us]. The last bucket has no upper bound */
+static const uint32_t LatencyBucketLimit[LATENCY_BUCKETS - 1] = {
+  100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 2000000, 5000000
+};
+
+static const char *LatencyStageName[LatencyStage_Count] = {
+  "photo_request", "photo_total", "photo_sensor_mode", "photo_flash", "photo_capture", "photo_grab",
+  "photo_validate", "photo_exif", "stream_total", "stream_grab", "stream_exif"
+};
+
+/**
+   @brief Constructor for LatencyStats class
+   @param none
+   @return none
+*/
+LatencyStats::LatencyStats() {
+  Lock = portMUX_INITIALIZER_UNLOCKED;
+  Reset();
+}
+
+/**
+   @brief Add sample to the stage histogram
+   @param LatencyStage_enum - stage
+   @param int64_t - duration [us]
+   @return none
+*/
+void LatencyStats::Record(LatencyStage_enum i_stage, int64_t i_time) {
+  uint32_t value = (i_time < 0) ? 0 : ((i_time > UINT32_MAX) ? UINT32_MAX : (uint32_t)i_time);
+  uint8_t bucket = 0;
+
+  if (i_stage >= LatencyStage_Count) {
+    return;
+  }
+
+  while ((bucket < (LATENCY_BUCKETS - 1)) && (value > LatencyBucketLimit[bucket])) {
+    bucket++;
+  }
+
+  portENTER_CRITICAL(&Lock);
+  LatencyHistogram_t *hist = &Histogram[i_stage];
+  if ((0 == hist->Count) || (value < hist->Min)) {
+    hist->Min = value;
+  }
+  if (value > hist->Max) {
+    hist->Max = value;
+  }
+  hist->Count++;
+  hist->Buckets[bucket]++;
+  portEXIT_CRITICAL(&Lock);
+}
+
+/**
+   @brief Clear all histograms
+   @param none
+   @return none
+*/
+void LatencyStats::Reset() {
+  portENTER_CRITICAL(&Lock);
+  memset(Histogram, 0, sizeof(Histogram));
+  portEXIT_CRITICAL(&Lock);
+}
+
+/**
+   @brief Get summary of the stage histogram
+   @param LatencyStage_enum - stage
+   @param LatencySummary_t * - output summary
+   @return bool - true = stage has samples
+*/
+bool LatencyStats::GetSummary(LatencyStage_enum i_stage, LatencySummary_t *o_summary) {
+  LatencyHistogram_t hist;
+
+  if (i_stage >= LatencyStage_Count) {
+    return false;
+  }
+
+  portENTER_CRITICAL(&Lock);
+  hist = Histogram[i_stage];
+  portEXIT_CRITICAL(&Lock);
+
+  o_summary->Count = hist.Count;
+  o_summary->Min = hist.Min;
+  o_summary->Max = hist.Max;
+  o_summary->P50 = GetPercentile(&hist, 50);
+  o_summary->P95 = GetPercentile(&hist, 95);
+
+  return (hist.Count > 0);
+}
+
+/**
+   @brief Estimate percentile from the buckets. The upper bound of the bucket is limited by the measured minimum and maximum
+   @param const LatencyHistogram_t * - histogram
+   @param uint8_t - percentile
+   @return uint32_t - value [us]
+*/
+uint32_t LatencyStats::GetPercentile(const LatencyHistogram_t *i_hist, uint8_t i_percentile) {
+  uint32_t rank = ((i_hist->Count * i_percentile) + 99) / 100;
+  uint32_t sum = 0;
+
+  if (0 == i_hist->Count) {
+    return 0;
+  }
+
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    sum += i_hist->Buckets[i];
+    if (sum >= rank) {
+      uint32_t value = (i < (LATENCY_BUCKETS - 1)) ? LatencyBucketLimit[i] : i_hist->Max;
+      return constrain(value, i_hist->Min, i_hist->Max);
+    }
+  }
+
+  return i_hist->Max;
+}
+
+/**
+   @brief Get stage name for the JSON and logs
+   @param LatencyStage_enum - stage
+   @return const char * - name
+*/
+const char *LatencyStats::GetStageName(LatencyStage_enum i_stage) {
+  return (i_stage < LatencyStage_Count) ? LatencyStageName[i_stage] : "unknown";
+}
+
+/* EOF */
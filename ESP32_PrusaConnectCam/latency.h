@@ -0,0 +1,82 @@
+/**
+   @file latency.h
+
+   @brief Library for latency histograms of the capture stages
+
+   Each stage has a histogram with fixed buckets in 1-2-5 steps. The
+   percentiles are estimated from the buckets. The timestamps are removed
+   by the compiler, when LATENCY_STATS_ENABLE is false.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "esp_timer.h"
+
+#include "mcu_cfg.h"
+
+#define LATENCY_BUCKETS   16    ///< count of histogram buckets
+
+#if (true == LATENCY_STATS_ENABLE)
+#define LATENCY_TIMESTAMP(name)       int64_t name = esp_timer_get_time()                           ///< start of the measured stage
+#define LATENCY_RECORD(stage, start)  SystemLatency.Record(stage, esp_timer_get_time() - (start))    ///< end of the measured stage
+#else
+#define LATENCY_TIMESTAMP(name)
+#define LATENCY_RECORD(stage, start)
+#endif
+
+enum LatencyStage_enum {
+  LatencyStage_PhotoRequest = 0,      ///< photo request from the caller, waiting for the capture task included
+  LatencyStage_PhotoTotal = 1,        ///< photo capture in the capture task
+  LatencyStage_PhotoSensorMode = 2,   ///< switch of the sensor to the photo mode
+  LatencyStage_PhotoFlash = 3,        ///< flash delay
+  LatencyStage_PhotoCapture = 4,      ///< capture loop with stale frames and retries
+  LatencyStage_PhotoGrab = 5,         ///< one esp_camera_fb_get() call
+  LatencyStage_PhotoValidate = 6,     ///< jpeg structure check
+  LatencyStage_PhotoExif = 7,         ///< exif header generation
+  LatencyStage_StreamTotal = 8,       ///< stream frame capture
+  LatencyStage_StreamGrab = 9,        ///< one esp_camera_fb_get() call for the stream
+  LatencyStage_StreamExif = 10,       ///< exif header generation for the stream
+  LatencyStage_Count = 11,            ///< count of stages
+};
+
+struct LatencyHistogram_t {
+  uint32_t Count;                     ///< count of samples
+  uint32_t Min;                       ///< minimum [us]
+  uint32_t Max;                       ///< maximum [us]
+  uint32_t Buckets[LATENCY_BUCKETS];  ///< count of samples in each bucket
+};
+
+struct LatencySummary_t {
+  uint32_t Count;                     ///< count of samples
+  uint32_t Min;                       ///< minimum [us]
+  uint32_t P50;                       ///< median, upper bound of the bucket [us]
+  uint32_t P95;                       ///< 95th percentile, upper bound of the bucket [us]
+  uint32_t Max;                       ///< maximum [us]
+};
+
+class LatencyStats {
+private:
+  LatencyHistogram_t Histogram[LatencyStage_Count];   ///< histogram of each stage
+  portMUX_TYPE Lock;                                  ///< spinlock, the stages are recorded from both cores
+
+  uint32_t GetPercentile(const LatencyHistogram_t *, uint8_t);
+
+public:
+  LatencyStats();
+  ~LatencyStats(){};
+
+  void Record(LatencyStage_enum, int64_t);
+  void Reset();
+  bool GetSummary(LatencyStage_enum, LatencySummary_t *);
+  const char *GetStageName(LatencyStage_enum);
+};
+
+extern LatencyStats SystemLatency;  ///< latency statistics object
+
+/* EOF */
@@ -23,8 +23,8 @@ Logs::Logs() {
   LogLevel = LogLevel_Verbose;
   FileMaxSize = 1024;
   NtpTimeSynced = false;
-  LogMsg = "";
   LogMutex = xSemaphoreCreateMutex();
+  InitQueue();
 }
 
 /**
@@ -39,8 +39,8 @@ Logs::Logs(String i_FilePath, String i_FileName) {
   LogLevel = LogLevel_Verbose;
   FileMaxSize = 1024;
   NtpTimeSynced = false;
-  LogMsg = "";
   LogMutex = xSemaphoreCreateMutex();
+  InitQueue();
 }
 
 /**
@@ -56,8 +56,8 @@ Logs::Logs(LogLevel_enum i_LogLevel, String i_FilePath, String i_FileName) {
   LogLevel = i_LogLevel;
   FileMaxSize = 1024;
   NtpTimeSynced = false;
-  LogMsg = "";
   LogMutex = xSemaphoreCreateMutex();
+  InitQueue();
 }
 
 /**
@@ -73,8 +73,8 @@ Logs::Logs(String i_FilePath, String i_FileName, uint16_t i_FileSize) {
   LogLevel = LogLevel_Verbose;
   FileMaxSize = i_FileSize;
   NtpTimeSynced = false;
-  LogMsg = "";
   LogMutex = xSemaphoreCreateMutex();
+  InitQueue();
 }
 
 /**
@@ -91,8 +91,28 @@ Logs::Logs(LogLevel_enum i_LogLevel, String i_FilePath, String i_FileName, uint1
   LogLevel = i_LogLevel;
   FileMaxSize = i_FileSize;
   NtpTimeSynced = false;
-  LogMsg = "";
   LogMutex = xSemaphoreCreateMutex();
+  InitQueue();
+}
+
+/**
+   @info Init queue of the log messages
+   @param none
+   @return none
+*/
+void Logs::InitQueue() {
+  for (uint32_t i = 0; i < LOGS_QUEUE_RECORDS; i++) {
+    Queue[i].Seq.store(i, std::memory_order_relaxed);
+  }
+  QueueHead.store(0, std::memory_order_relaxed);
+  QueueTail.store(0, std::memory_order_relaxed);
+  WriterTask = NULL;
+  Queued.store(0, std::memory_order_relaxed);
+  Dropped.store(0, std::memory_order_relaxed);
+  Truncated.store(0, std::memory_order_relaxed);
+  QueueHighWater = 0;
+  LogMsg = "";
+  LogMsg.reserve(LOGS_WRITE_BATCH_SIZE + LOGS_QUEUE_RECORD_SIZE + 32);
 }
 
 /**
@@ -116,19 +136,19 @@ void Logs::Init() {
     CheckMaxLogFileSize();
 
     /* added first message to log file after start MCU */
-    LogMsg = F("----------------------------------------------------------------\n");
-    LogMsg += F("Start MCU!\nSW Version: ");
-    LogMsg += String(SW_VERSION);
-    LogMsg += F(" ,Build: ");
-    LogMsg += String(SW_BUILD);
-    LogMsg += "\n";
-    LogMsg += F("Verbose mode: ");
-    LogMsg += (true == CONSOLE_VERBOSE_DEBUG) ? "true" : "false";
-    LogMsg += "\n";
-    LogMsg += F("Log level: ");
-    LogMsg += String(LogLevel);
-    LogMsg += "\n";
-    AppendFile(&LogFile, &LogMsg);
+    String msg = F("----------------------------------------------------------------\n");
+    msg += F("Start MCU!\nSW Version: ");
+    msg += String(SW_VERSION);
+    msg += F(" ,Build: ");
+    msg += String(SW_BUILD);
+    msg += "\n";
+    msg += F("Verbose mode: ");
+    msg += (true == CONSOLE_VERBOSE_DEBUG) ? "true" : "false";
+    msg += "\n";
+    msg += F("Log level: ");
+    msg += String(LogLevel);
+    msg += "\n";
+    AppendFile(&LogFile, &msg);
 
   } else {
     Serial.println(F("Micro-SD card not found! Disable logs"));
@@ -145,7 +165,9 @@ void Logs::Init() {
  */
 void Logs::LogOpenFile() {
 #if (true == ENABLE_SD_CARD)
+  xSemaphoreTake(LogMutex, portMAX_DELAY);
   LogFileOpened = OpenFile(&LogFile, FilePath + FileName);
+  xSemaphoreGive(LogMutex);
 #endif
 }
 
@@ -155,7 +177,9 @@ void Logs::LogOpenFile() {
  */
 void Logs::LogCloseFile() {
 #if (true == ENABLE_SD_CARD)
+  xSemaphoreTake(LogMutex, portMAX_DELAY);
   CloseFile(&LogFile);
+  xSemaphoreGive(LogMutex);
 #endif
 }
 
@@ -165,7 +189,9 @@ void Logs::LogCloseFile() {
  */
 void Logs::LogCheckOpenedFile() { 
 #if (true == ENABLE_SD_CARD)
+  xSemaphoreTake(LogMutex, portMAX_DELAY);
   LogFileOpened = CheckOpenFile(&LogFile);
+  xSemaphoreGive(LogMutex);
 #endif
 }
 
@@ -179,7 +205,7 @@ void Logs::SetLogLevel(LogLevel_enum level) {
 }
 
 /**
-   @info Add new log event
+   @info Add new log event. The message is only queued, it is written by the log writer task
    @param LogLevel_enum - log level
    @param String - log message
    @param bool - new line
@@ -187,48 +213,21 @@ void Logs::SetLogLevel(LogLevel_enum level) {
    @return none
 */
 void Logs::AddEvent(LogLevel_enum level, String msg, bool newLine, bool date) {
-  /* mutex for log */
-  xSemaphoreTake(LogMutex, portMAX_DELAY);
+  uint8_t flags = ((true == newLine) ? LogRecordFlag_NewLine : 0) | ((true == date) ? LogRecordFlag_Date : 0);
+
   /* check log level */
   if (LogLevel >= level) {
-
-    /* create log message */
-    LogMsg = "";
-    if (true == date) {
-      LogMsg += GetSystemTime();
-      LogMsg += " - ";
-    }
-    LogMsg += msg;
-    if (true == newLine) {
-      LogMsg += "\n";
-    }
-
-    /* print log message to console */
-    Serial.print(LogMsg);
-#if (true == ENABLE_SD_CARD)
-    /* append log message to log file */
-    if (true == LogFileOpened) {
-      LogFileOpened = AppendFile(&LogFile, &LogMsg);
-      if ((false == LogFileOpened) && (true == GetCardDetectedStatus())){
-        LogCloseFile();
-        LogOpenFile();
-        if (true == LogFileOpened) {
-          LogFileOpened = AppendFile(&LogFile, &LogMsg);
-        } 
-      }
-    }
-#endif
+    Enqueue(level, flags, msg.c_str(), msg.length(), NULL, 0);
   }
 #if (true == CONSOLE_VERBOSE_DEBUG)
   else {
-    Serial.println(msg);
+    Enqueue(level, LogRecordFlag_NewLine | LogRecordFlag_Console, msg.c_str(), msg.length(), NULL, 0);
   }
 #endif
-  xSemaphoreGive(LogMutex);
 }
 
 /**
-   @info Add new log event
+   @info Add new log event. The message is only queued, it is written by the log writer task
    @param LogLevel_enum - log level
    @param const __FlashStringHelper - log message
    @param String - parameters
@@ -237,50 +236,193 @@ void Logs::AddEvent(LogLevel_enum level, String msg, bool newLine, bool date) {
    @return none
 */
 void Logs::AddEvent(LogLevel_enum level, const __FlashStringHelper *msg, String parameters, bool newLine, bool date) {
-  /* mutex for log */
-  xSemaphoreTake(LogMutex, portMAX_DELAY);
+  const char *text = reinterpret_cast<const char *>(msg);
+  uint8_t flags = ((true == newLine) ? LogRecordFlag_NewLine : 0) | ((true == date) ? LogRecordFlag_Date : 0);
 
   /* check log level */
   if (LogLevel >= level) {
+    Enqueue(level, flags, text, strlen(text), parameters.c_str(), parameters.length());
+  }
+#if (true == CONSOLE_VERBOSE_DEBUG)
+  else {
+    Enqueue(level, LogRecordFlag_NewLine | LogRecordFlag_Console, text, strlen(text), NULL, 0);
+  }
+#endif
+}
+
+/**
+   @info Copy log message to the queue. The message and the parameters are copied without String concatenation.
+         Long message is split to more records. The function does not wait, the message is dropped in the full queue
+   @param LogLevel_enum - log level
+   @param uint8_t - LogRecordFlag_enum flags
+   @param const char * - message
+   @param size_t - message length
+   @param const char * - parameters, appended to the message
+   @param size_t - parameters length
+   @return none
+*/
+void Logs::Enqueue(LogLevel_enum level, uint8_t flags, const char *msg, size_t msg_len, const char *param, size_t param_len) {
+  size_t len = msg_len + param_len;
+  uint32_t count = (len + LOGS_QUEUE_RECORD_SIZE - 1) / LOGS_QUEUE_RECORD_SIZE;
+  if (0 == count) {
+    count = 1;
+  } else if (count > LOGS_QUEUE_RECORDS_PER_MSG) {
+    count = LOGS_QUEUE_RECORDS_PER_MSG;
+    len = count * LOGS_QUEUE_RECORD_SIZE;
+    Truncated.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /* reserve the records. When the last record is free, the previous records are free too, because the writer releases them in order */
+  uint32_t pos = QueueHead.load(std::memory_order_relaxed);
+  while (true) {
+    uint32_t last = pos + count - 1;
+    int32_t diff = (int32_t)(Queue[last & (LOGS_QUEUE_RECORDS - 1)].Seq.load(std::memory_order_acquire) - last);
+
+    if (0 == diff) {
+      if (QueueHead.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      /* queue is full */
+      Dropped.fetch_add(1, std::memory_order_relaxed);
+      if (NULL != WriterTask) {
+        xTaskNotifyGive(WriterTask);
+      }
+      return;
+    } else {
+      /* position was reserved by another task */
+      pos = QueueHead.load(std::memory_order_relaxed);
+    }
+  }
 
-    /* create log message */
-    LogMsg = "";
-    if (true == date) {
-      LogMsg += GetSystemTime();
-      LogMsg += " - ";
+  /* copy the message to the reserved records */
+  time_t now = (true == NtpTimeSynced) ? time(NULL) : 0;
+  size_t offset = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    LogRecord_t *record = &Queue[(pos + i) & (LOGS_QUEUE_RECORDS - 1)];
+    size_t part = min(len - offset, (size_t) LOGS_QUEUE_RECORD_SIZE);
+    size_t copied = 0;
+
+    if (offset < msg_len) {
+      copied = min(part, msg_len - offset);
+      memcpy(record->Msg, msg + offset, copied);
     }
-    LogMsg += msg;
-    LogMsg += parameters;
-    if (true == newLine) {
-      LogMsg += "\n";
+    if (copied < part) {
+      memcpy(record->Msg + copied, param + (offset + copied - msg_len), part - copied);
     }
+    offset += part;
+
+    record->Time = now;
+    record->Level = level;
+    record->Len = part;
+    record->Flags = flags & LogRecordFlag_Console;
+    record->Flags |= (0 == i) ? (flags & LogRecordFlag_Date) : LogRecordFlag_Continue;
+    record->Flags |= ((count - 1) == i) ? (flags & LogRecordFlag_NewLine) : 0;
+    record->Seq.store(pos + i + 1, std::memory_order_release);
+  }
+  Queued.fetch_add(1, std::memory_order_relaxed);
 
-    /* print log message to console */
-    Serial.print(LogMsg);
+  /* before the writer task is started, the message is written immediately */
+  if (NULL == WriterTask) {
+    Flush();
+  } else if ((pos + count - QueueTail.load(std::memory_order_relaxed)) >= (LOGS_QUEUE_RECORDS / 2)) {
+    xTaskNotifyGive(WriterTask);
+  }
+}
 
-#if (true == ENABLE_SD_CARD)
-    /* append log message to log file */
-    if (true == LogFileOpened) {
-      LogFileOpened = AppendFile(&LogFile, &LogMsg);
-      if ((false == LogFileOpened) && (true == GetCardDetectedStatus())){
-        LogCloseFile();
-        LogOpenFile();
-        if (true == LogFileOpened) {
-          AppendFile(&LogFile, &LogMsg);
-        } 
+/**
+   @info Write the queued log messages to the console and to the log file
+   @param none
+   @return none
+*/
+void Logs::Flush() {
+  xSemaphoreTake(LogMutex, portMAX_DELAY);
+  uint32_t pos = QueueTail.load(std::memory_order_relaxed);
+  uint32_t used = QueueHead.load(std::memory_order_relaxed) - pos;
+  if (used > QueueHighWater) {
+    QueueHighWater = used;
+  }
+
+  char time_string[20];
+  while (true) {
+    LogRecord_t *record = &Queue[pos & (LOGS_QUEUE_RECORDS - 1)];
+
+    /* queue is empty, or the message is still copied by the calling task */
+    if (record->Seq.load(std::memory_order_acquire) != (pos + 1)) {
+      break;
+    }
+
+    if (record->Flags & LogRecordFlag_Console) {
+      /* message under the log level, only for the console */
+      WriteBatch();
+      Serial.write((const uint8_t *) record->Msg, record->Len);
+      if (record->Flags & LogRecordFlag_NewLine) {
+        Serial.println();
+      }
+    } else {
+      if (record->Flags & LogRecordFlag_Date) {
+        FormatTime(record->Time, time_string, sizeof(time_string));
+        LogMsg += time_string;
+        LogMsg += " - ";
+      }
+      LogMsg.concat(record->Msg, record->Len);
+      if (record->Flags & LogRecordFlag_NewLine) {
+        LogMsg += "\n";
       }
     }
-#endif
+
+    /* release the record for the next round of the queue */
+    record->Seq.store(pos + LOGS_QUEUE_RECORDS, std::memory_order_release);
+    pos++;
+    QueueTail.store(pos, std::memory_order_relaxed);
+
+    if (LogMsg.length() >= LOGS_WRITE_BATCH_SIZE) {
+      WriteBatch();
+    }
   }
-#if (true == CONSOLE_VERBOSE_DEBUG)
-  else {
-    Serial.println(msg);
+
+  WriteBatch();
+  xSemaphoreGive(LogMutex);
+}
+
+/**
+   @info Write batch of the formatted log messages to the console and to the log file. LogMutex must be taken
+   @param none
+   @return none
+*/
+void Logs::WriteBatch() {
+  if (0 == LogMsg.length()) {
+    return;
+  }
+
+  /* print log message to console */
+  Serial.print(LogMsg);
+
+#if (true == ENABLE_SD_CARD)
+  /* append log message to log file */
+  if (true == LogFileOpened) {
+    LogFileOpened = AppendFile(&LogFile, &LogMsg);
+    if ((false == LogFileOpened) && (true == GetCardDetectedStatus())) {
+      CloseFile(&LogFile);
+      LogFileOpened = OpenFile(&LogFile, FilePath + FileName);
+      if (true == LogFileOpened) {
+        LogFileOpened = AppendFile(&LogFile, &LogMsg);
+      }
+    }
   }
 #endif
 
-  /* release mutex */
-  xSemaphoreGive(LogMutex);
- }
+  LogMsg = "";
+}
+
+/**
+   @info Set the calling task as log writer. Then the other tasks only queue the messages
+   @param none
+   @return none
+*/
+void Logs::SetWriterTask() {
+  WriterTask = xTaskGetCurrentTaskHandle();
+}
 
 /**
    @info Set file name
@@ -368,9 +510,14 @@ void Logs::CheckMaxLogFileSize() {
   if (FileSize >= LOGS_FILE_MAX_SIZE) {
     uint16_t file_count = FileCount(SD_MMC, FilePath, FileName);
     AddEvent(LogLevel_Info, F("Maximum log file size. File count: "), String(file_count));
-    LogCloseFile();
+
+    /* the queued messages are written to the old file */
+    Flush();
+    xSemaphoreTake(LogMutex, portMAX_DELAY);
+    CloseFile(&LogFile);
     RenameFile(SD_MMC, FilePath + FileName, FilePath + FileName + String(file_count));
-    LogOpenFile();
+    LogFileOpened = OpenFile(&LogFile, FilePath + FileName);
+    xSemaphoreGive(LogMutex);
   }
 #endif
 }
@@ -391,30 +538,70 @@ bool Logs::GetLogFileOpened() {
   return LogFileOpened;
 }
 
+/**
+   @info Get count of queued log messages
+   @param none
+   @return uint32_t - count
+*/
+uint32_t Logs::GetQueued() {
+  return Queued.load(std::memory_order_relaxed);
+}
+
+/**
+   @info Get count of log messages dropped in the full queue
+   @param none
+   @return uint32_t - count
+*/
+uint32_t Logs::GetDropped() {
+  return Dropped.load(std::memory_order_relaxed);
+}
+
+/**
+   @info Get count of truncated log messages
+   @param none
+   @return uint32_t - count
+*/
+uint32_t Logs::GetTruncated() {
+  return Truncated.load(std::memory_order_relaxed);
+}
+
+/**
+   @info Get maximum count of used records in the log queue
+   @param none
+   @return uint32_t - count
+*/
+uint32_t Logs::GetQueueHighWater() {
+  return QueueHighWater;
+}
+
+/**
+   @info Format time of the log message
+   @param time_t - time, 0 = NTP time is not synced
+   @param char * - output buffer
+   @param size_t - buffer size
+   @return none
+*/
+void Logs::FormatTime(time_t i_time, char *o_buf, size_t i_size) {
+  if (0 == i_time) {
+    strlcpy(o_buf, "0000-00-00_00-00-00", i_size);
+    return;
+  }
+
+  struct tm timeinfo;
+  localtime_r(&i_time, &timeinfo);
+  strftime(o_buf, i_size, "%Y-%m-%d_%H-%M-%S", &timeinfo);
+}
+
 /**
    @info Get system time
    @param none
    @return String - time
 */
 String Logs::GetSystemTime() {
-  String ret = "0000-00-00_00-00-00";
-  if (true == NtpTimeSynced) {
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
-#if (true == CONSOLE_VERBOSE_DEBUG)
-      Serial.println(F("Failed to obtain time"));
-#endif
-      return ret;
-    }
+  char time_string[20];
+  FormatTime((true == NtpTimeSynced) ? time(NULL) : 0, time_string, sizeof(time_string));
 
-    char timeString[20];
-    strftime(timeString, sizeof(timeString), "%Y-%m-%d_%H-%M-%S", &timeinfo);
-#if (true == CONSOLE_VERBOSE_DEBUG)
-    Serial.println(timeString);
-#endif
-    ret = String(timeString);
-  }
-  return ret;
+  return String(time_string);
 }
 
 /* EOF */
\ No newline at end of file
@@ -3,6 +3,12 @@
 
    @brief log library
 
+   The log message is only copied to the lock-free queue by the calling
+   task, with the log level and the timestamp. The log writer task formats
+   the queued messages and writes them to the console and to the SD card
+   in batches. Before the writer task is started, the messages are written
+   immediately by the calling task.
+
    @author Miroslav Pivovarsky
    Contact: miroslav.pivovarsky@gmail.com
 
@@ -12,10 +18,29 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
 
 #include "micro_sd.h"
 #include "log_level.h"
 
+static_assert(0 == (LOGS_QUEUE_RECORDS & (LOGS_QUEUE_RECORDS - 1)), "LOGS_QUEUE_RECORDS must be power of 2");
+
+enum LogRecordFlag_enum {
+  LogRecordFlag_NewLine = 0x01,     ///< new line after the message
+  LogRecordFlag_Date = 0x02,        ///< date before the message
+  LogRecordFlag_Continue = 0x04,    ///< record continues the message from the previous record
+  LogRecordFlag_Console = 0x08,     ///< message under the log level, only for the verbose debug console
+};
+
+struct LogRecord_t {
+  std::atomic<uint32_t> Seq;        ///< record sequence. Equal to the queue position = free, position + 1 = ready for writer
+  time_t Time;                      ///< message time, 0 = NTP time is not synced
+  uint8_t Level;                    ///< log level
+  uint8_t Flags;                    ///< LogRecordFlag_enum
+  uint8_t Len;                      ///< length of the message part
+  char Msg[LOGS_QUEUE_RECORD_SIZE]; ///< message part
+};
+
 class Logs : public MicroSd {
 private:
   LogLevel_enum LogLevel;     ///< LogLevel
@@ -23,10 +48,24 @@ private:
   String FilePath;            ///< log file patch
   uint16_t FileMaxSize;       ///< log file max size
   bool NtpTimeSynced;         ///< status NTP time sync
-  String LogMsg;              ///< log message
+  String LogMsg;              ///< batch of formatted log messages, used by writer
   File LogFile;               ///< log file object
   bool LogFileOpened;         ///< log file opened status
-  SemaphoreHandle_t LogMutex; ///< log mutex
+  SemaphoreHandle_t LogMutex; ///< log file and writer mutex
+
+  LogRecord_t Queue[LOGS_QUEUE_RECORDS];  ///< queue of the log messages
+  std::atomic<uint32_t> QueueHead;        ///< next position for the new message
+  std::atomic<uint32_t> QueueTail;        ///< next position for the writer
+  TaskHandle_t WriterTask;                ///< log writer task, NULL = messages are written by the calling task
+  std::atomic<uint32_t> Queued;           ///< count of queued messages
+  std::atomic<uint32_t> Dropped;          ///< count of messages dropped in the full queue
+  std::atomic<uint32_t> Truncated;        ///< count of messages longer than LOGS_QUEUE_RECORDS_PER_MSG records
+  uint32_t QueueHighWater;                ///< maximum count of used records
+
+  void InitQueue();
+  void Enqueue(LogLevel_enum, uint8_t, const char *, size_t, const char *, size_t);
+  void WriteBatch();
+  void FormatTime(time_t, char *, size_t);
 
 public:
   Logs();
@@ -42,6 +81,8 @@ public:
   void LogCheckOpenedFile();
   void AddEvent(LogLevel_enum, String, bool = true, bool = true);
   void AddEvent(LogLevel_enum, const __FlashStringHelper*, String, bool = true, bool = true);
+  void Flush();
+  void SetWriterTask();
   void SetLogLevel(LogLevel_enum);
   void SetFileName(String);
   void SetFilePath(String);
@@ -55,6 +96,10 @@ public:
   void CheckMaxLogFileSize();
   void CheckCardSpace();
   bool GetLogFileOpened();
+  uint32_t GetQueued();
+  uint32_t GetDropped();
+  uint32_t GetTruncated();
+  uint32_t GetQueueHighWater();
 
   String GetSystemTime();
 };
@@ -27,12 +27,53 @@
 #define CONSOLE_VERBOSE_DEBUG       false                   ///< enable/disable verbose debug log level for console
 #define DEVICE_HOSTNAME             "Prusa-ESP32cam"        ///< device hostname
 #define CAMERA_MAX_FAIL_CAPTURE     10                      ///< maximum count for failed capture
+#define CAMERA_FB_COUNT             (STREAM_MAX_CLIENTS + 3) ///< maximum count of camera frame buffers. One frame for each stream client, the latest stream frame, the latest photo shared by the photo sinks and one for the camera driver. Photo is skipped when the sinks hold all free buffers
+#define CAMERA_FB_MIN_COUNT         3                       ///< minimum count of camera frame buffers. The latest stream frame, the latest photo and one for the camera driver
+#define CAMERA_FB_PSRAM_BUDGET      (1280 * 1024)           ///< PSRAM for the camera frame buffers, one buffer is width * height / CAMERA_JPEG_MAX_RATIO. UXGA 3 x 375 KB, SXGA 5 x 256 KB, XGA and smaller CAMERA_FB_COUNT buffers [bytes]
+#define CAMERA_FRAME_RELEASE_WAIT   1000                    ///< log interval while the camera reinit waits for releasing of held frames [ms]
+#define CAMERA_MAX_SUBSCRIBERS      (STREAM_MAX_CLIENTS + 4) ///< maximum count of frame subscribers. Stream clients and photo sinks: Prusa Connect, HTTP target, MQTT, timelapse
+#define CAMERA_PHOTO_REQUEST_WAIT   10000                   ///< maximum time for capture photo by the capture task, without flash time [ms]
+#define CAMERA_RECONFIG_TIMEOUT     2000                    ///< maximum time for the first valid frame after camera reconfiguration [ms]
+#define CAMERA_STREAM_SAME_AS_PHOTO 255                     ///< stream resolution or quality is the same as the photo
+#define CAMERA_JPEG_MAX_RATIO       5                       ///< maximum jpeg size is width * height / ratio, the same estimate as the camera driver
+#define FRAME_POOL_SMALL_SIZE       4096                    ///< block size of the small frame pool class, exif headers [bytes]
+#define FRAME_POOL_SMALL_COUNT      (CAMERA_FB_COUNT + 4)   ///< count of small blocks. One exif header for each frame slot
 
 /* ------------ PRUSA BACKEND CFG  --------------*/
 #define HOST_URL_CAM_PATH           "/c/snapshot"           ///< path for sending photo to prusa connect
 #define HOST_URL_INFO_PATH          "/c/info"               ///< path for sending info to prusa connect
 #define REFRESH_INTERVAL_MIN        10                      ///< minimum refresh interval for sending photo to prusa connect [s]
 #define REFRESH_INTERVAL_MAX        240                     ///< maximum refresh interval for sending photo to prusa connect [s]
+#define UPLOAD_TIMING_HISTORY       10                      ///< count of the last uploads with the phase timing
+#define CONNECT_KEEPALIVE_IDLE      50                      ///< idle connection to prusa connect is closed before the server does it [s]
+#define CONNECT_RESPONSE_TIMEOUT    5000                    ///< timeout for the response from prusa connect [ms]
+#define HTTP_PARSER_LINE_SIZE       128                     ///< maximum used length of the status and header line [bytes]
+#define HTTP_PARSER_BODY_SIZE       256                     ///< beginning of the response body kept for the log [bytes]
+#define CIRCUIT_BACKOFF_MIN         10                      ///< circuit breaker, first delay after the connection error or server error [s]
+#define CIRCUIT_BACKOFF_MAX         600                     ///< circuit breaker, maximum delay between the attempts, also for Retry-After [s]
+#define CIRCUIT_BACKOFF_JITTER      25                      ///< circuit breaker, random change of the delay [%]
+#define CIRCUIT_AUTH_DELAY          3600                    ///< circuit breaker, delay after the invalid token, until the token is changed [s]
+
+/* ------------- SNAPSHOT SINK CFG --------------*/
+#define SINK_CONNECT_QUEUE_LENGTH   1                       ///< photos waiting for the upload to prusa connect. Each queued photo holds one camera frame buffer
+#define SINK_CONNECT_TIMEOUT        10000                   ///< expected time of the upload to prusa connect, with the info. Slower uploads are counted [ms]
+#define SINK_SDCARD_QUEUE_LENGTH    1                       ///< photos waiting for saving to the SD card
+#define SINK_SDCARD_TIMEOUT         3000                    ///< expected time of saving to the SD card. Slower saves are counted [ms]
+#define SINK_HTTP_QUEUE_LENGTH      1                       ///< photos waiting for the local HTTP target
+#define SINK_HTTP_TIMEOUT           3000                    ///< connection, sending and response timeout of the local HTTP target [ms]
+#define SINK_HTTP_STACK             3500                    ///< stack size of the local HTTP target task, created after the target is enabled [bytes]
+
+/* ------------------ MQTT CFG ------------------*/
+#define MQTT_QUEUE_LENGTH           1                       ///< snapshots waiting for publishing to the MQTT broker
+#define MQTT_TIMEOUT                3000                    ///< connection, CONNACK, PUBACK and ping response timeout [ms]
+#define MQTT_STACK                  4000                    ///< stack size of the MQTT client task, created after the client is enabled [bytes]
+#define MQTT_KEEPALIVE              60                      ///< keep alive interval sent to the broker, the ping is sent after half of the interval [s]
+#define MQTT_RECONNECT_MIN          2                       ///< first delay after the failed connection to the broker [s]
+#define MQTT_RECONNECT_MAX          300                     ///< maximum delay between the connection attempts [s]
+#define MQTT_RECONNECT_JITTER       25                      ///< random change of the reconnect delay [%]
+#define MQTT_STATUS_INTERVAL        5000                    ///< interval of the status check, only changed values are published [ms]
+#define MQTT_RSSI_STEP              10                      ///< WiFi signal is published rounded to this step [%]
+#define MQTT_TOPIC_PREFIX           "prusa_cam"             ///< base topic prefix, when the topic is not configured. The mDNS name is appended
 
 /* -------------- STATUS LED CFG ----------------*/
 #define STATUS_LED_ON_DURATION      100                     ///< time for blink status LED when is module in the ON state [ms]
@@ -47,9 +88,13 @@
 #define TASK_WIFI                   28000                   ///< wifi reconnect interval. Checking when is signal lost [ms]
 #define TASK_SERIAL_CFG             1000                    ///< serial cfg task interval [ms]
 #define TASK_SYSTEM_TELEMETRY       30000                   ///< stream telemetry task interval [ms]
+#define TASK_LOG_WRITER             100                     ///< log writer task interval. The task is woken up earlier, when the log queue is half full. The priority is above the telemetry and serial cfg tasks, so the wake up preempts them [ms]
 #define TASK_WIFI_WATCHDOG          20000                   ///< wifi watchdog task interval [ms]
 #define TASK_PHOTO_SEND             1000                    ///< photo send task interval [ms]
+#define TASK_SNAPSHOT_SINK_WAIT     1000                    ///< snapshot sink task waiting for the captured photo, then the idle work is done [ms]
 #define TASK_SDCARD_FILE_REMOVE     30000                   ///< sd card file remove task interval [ms]
+#define TASK_CAMERA_CAPTURE         40                      ///< camera capture task interval during stream. Maximum stream FPS [ms]
+#define TASK_CAMERA_CAPTURE_IDLE    1000                    ///< camera capture task waiting for photo request or stream client [ms]
 
 /* --------------- WEB SERVER CFG  --------------*/
 #define WEB_SERVER_PORT             80                      ///< WEB server port 
@@ -59,6 +104,11 @@
 #define LOOP_DELAY                  100                     ///< loop delay [ms]
 #define WIFI_CLIENT_WAIT_CON        false                   ///< wait for connecting to WiFi network
 #define WEB_CACHE_INTERVAL          86400                   ///< cache interval for browser [s] 86400s = 24h
+#define STREAM_MAX_CLIENTS          2                       ///< maximum count of the video stream clients. All clients share one captured frame
+#define STREAM_CONGESTED_FRAME_TIME 250                     ///< average send time of one frame, when the stream client is congested [ms]
+#define STREAM_QUALITY_STEP         5                       ///< jpeg quality step for the congested stream client
+#define STREAM_QUALITY_MAX_DROP     25                      ///< maximum jpeg quality drop for the congested stream client
+#define STREAM_QUALITY_ADAPT_PERIOD 2000                    ///< minimum time between two jpeg quality changes [ms]
 
 /* --------------- OTA UPDATE CFG  --------------*/
 #define OTA_UPDATE_API_SERVER       "api.github.com"        ///< OTA update server URL
@@ -72,6 +122,10 @@
 #define LOGS_FILE_NAME              "SysLog.log"            ///< syslog file name
 #define LOGS_FILE_PATH              "/"                     ///< directory for log files
 #define LOGS_FILE_MAX_SIZE          1024                    ///< maximum file size in the [kb]
+#define LOGS_QUEUE_RECORDS          64                      ///< count of records in the log queue, must be power of 2
+#define LOGS_QUEUE_RECORD_SIZE      96                      ///< message part stored in one record [bytes]
+#define LOGS_QUEUE_RECORDS_PER_MSG  8                       ///< long message is split to more records, the rest of the message is truncated
+#define LOGS_WRITE_BATCH_SIZE       1024                    ///< log messages are written to the console and the SD card in batches [bytes]
 #define FILE_REMOVE_MAX_COUNT       5                       ///< maximum count for remove files from sd card
 
 /* ---------------- AP MODE CFG  ----------------*/
@@ -102,17 +156,64 @@
 #define CAMERA_MAKE                 "OmniVision"            ///< Camera make string
 #define CAMERA_MODEL                "OV2640"                ///< Camera model string
 #define CAMERA_SOFTWARE             "Prusa ESP32-cam"       ///< Camera software string
-#define CAMERA_EXIF_ROTATION_STREAM false                   ///< enable camera exif rotation for stream
+#define CAMERA_EXIF_ROTATION_STREAM true                    ///< enable camera exif rotation for stream. Exif header is sent as separate segment without copy of the frame
 
 /* ---------------- TIMELAPS CFG ----------------*/
 #define TIMELAPS_PHOTO_FOLDER       "/timelapse"            ///< folder for timelaps photos
 #define TIMELAPS_PHOTO_PREFIX       "photo"                 ///< photo name for timelaps
 #define TIMELAPS_PHOTO_SUFFIX       ".jpg"                  ///< photo file type for timelaps
+#define TIMELAPS_AVI_SUFFIX         ".avi"                  ///< video file type for timelaps
+#define TIMELAPS_AVI_INDEX_SUFFIX   ".idx"                  ///< sidecar file with the AVI index, removed after the file is closed
+#define TIMELAPS_AVI_FPS            25                      ///< playback frame rate of the timelaps video
+#define TIMELAPS_AVI_INDEX_FLUSH    16                      ///< count of frames between the index flushes to the sidecar file
+#define TIMELAPS_AVI_MAX_FILE_SIZE  (1000UL * 1024 * 1024)  ///< maximum AVI file size, a new file is started after the limit [bytes]
+
+/* ----------------- MOTION CFG -----------------*/
+#define MOTION_SAMPLE_INTERVAL      5000                    ///< interval for the scene sampling, when the motion cadence is enabled in the web interface [ms]
+#define MOTION_GRID_MAX_CELLS       (200 * 150)             ///< maximum count of 8x8 luma cells. UXGA is 200x150 cells
+#define MOTION_CELL_THRESHOLD       12                      ///< minimum luma difference of the changed cell
+#define MOTION_SCORE_CHANGE         3                       ///< minimum percentage of the changed cells for the scene change
+#define MOTION_STATIC_BACKOFF       4                       ///< refresh interval multiplier for the static scene
+#define MOTION_STATIC_MAX_INTERVAL  600                     ///< maximum interval for the static scene [s]
+
+/* --------------- THUMBNAIL CFG ----------------*/
+#define THUMBNAIL_MAX_CELLS         (200 * 150)             ///< maximum thumbnail resolution, UXGA at 1/8 scale
+#define THUMBNAIL_JPEG_MAX_SIZE     (32 * 1024)             ///< maximum size of the encoded thumbnail [bytes]
+#define THUMBNAIL_JPEG_QUALITY      80                      ///< thumbnail jpeg quality for the encoder, 0-100, higher is better
+
+/* ---------------- LATENCY CFG -----------------*/
+#define LATENCY_STATS_ENABLE        true                    ///< latency histograms of the capture stages. false = timestamps are not compiled
+
+/* --------------- PRE-EVENT CFG ----------------*/
+#define PREEVENT_ENABLE             false                   ///< keep the last frames in PSRAM, and save them to the SD card after the trigger. The camera captures PREEVENT_FPS also without stream client
+#define PREEVENT_MEMORY_MAX         (1024 * 1024)           ///< maximum PSRAM memory for the frames [bytes]
+#define PREEVENT_PSRAM_RESERVE      (512 * 1024)            ///< free PSRAM left for the other modules after the ring allocation [bytes]
+#define PREEVENT_JPEG_RATIO         10                      ///< expected size of the stored frame is width * height / ratio, the memory is sized for PREEVENT_SECONDS of these frames
+#define PREEVENT_FPS                2                       ///< frame rate of the stored frames
+#define PREEVENT_SECONDS            20                      ///< maximum stored time before the event. Less time is stored, when the frames do not fit to the allocated memory [s]
+#define PREEVENT_MAX_FRAMES         (PREEVENT_FPS * PREEVENT_SECONDS) ///< maximum count of stored frames
+#define PREEVENT_FRAME_INTERVAL     (1000 / PREEVENT_FPS)   ///< interval between the stored frames [ms]
+#define PREEVENT_TRIGGER_GPIO       -1                      ///< GPIO for the trigger, falling edge. -1 = disabled
+#define PREEVENT_MOTION_SCORE       20                      ///< minimum motion score for the trigger, percentage of the changed cells. 0 = disabled
+#define PREEVENT_TRIGGER_COOLDOWN   60                      ///< minimum time between the GPIO and scene change triggers [s]
+#define PREEVENT_FOLDER             "/preevent"             ///< folder for the saved events
+#define PREEVENT_PREFIX             "event"                 ///< file name of the saved events
+
+/* ----------------- SPOOL CFG ------------------*/
+#define SPOOL_ENABLE                true                    ///< photos not uploaded to backend are saved to the SD card, and uploaded later
+#define SPOOL_FOLDER                "/spool"                ///< folder for the queue of photos
+#define SPOOL_SUFFIX                ".spl"                  ///< file type of the photo in the queue
+#define SPOOL_TMP_NAME              "spool.tmp"             ///< photo during writing, renamed after it is complete
+#define SPOOL_MAX_COUNT             1000                    ///< maximum count of photos in the queue
+#define SPOOL_MAX_SIZE              (200UL * 1024 * 1024)   ///< maximum size of the queue [bytes]
+#define SPOOL_DRAIN_INTERVAL        5000                    ///< minimum time between uploads of the queued photos, live photos are first [ms]
 
 /* ---------------- FACTORY CFG  ----------------*/
 #define FACTORY_CFG_PHOTO_REFRESH_INTERVAL    30                ///< in the second
 #define FACTORY_CFG_PHOTO_QUALITY             10                ///< 10-63, lower is better
 #define FACTORY_CFG_FRAME_SIZE                0                 ///< 0 - FRAMESIZE_QVGA, ..., 6 - FRAMESIZE_UXGA. Look function Cfg_TransformFrameSizeDataType
+#define FACTORY_CFG_STREAM_FRAME_SIZE         CAMERA_STREAM_SAME_AS_PHOTO ///< stream resolution. 0 - FRAMESIZE_QVGA, ..., 6 - FRAMESIZE_UXGA
+#define FACTORY_CFG_STREAM_QUALITY            CAMERA_STREAM_SAME_AS_PHOTO ///< stream quality. 10-63, lower is better
 #define FACTORY_CFG_BRIGHTNESS                0                 ///< from -2 to 2
 #define FACTORY_CFG_CONTRAST                  0                 ///< from -2 to 2
 #define FACTORY_CFG_SATURATION                0                 ///< from -2 to 2
@@ -146,8 +247,20 @@
 #define FACTORY_CFG_NETWORK_STATIC_DNS        F("255.255.255.255") ///< Static DNS
 #define FACTORY_CFG_IMAGE_EXIF_ROTATION       1                 ///< Image rotation 1 - 0°, 6 - 90°, 3 - 180°, 8 - 270°
 #define FACTORY_CFG_TIMELAPS_ENABLE           0                 ///< enable timelaps functionality
+#define FACTORY_CFG_TIMELAPS_AVI              0                 ///< save timelaps photos to one AVI file instead of the jpg files
 #define FACTORY_CFG_ENABLE_EXT_SENSOR         0                 ///< enable DHT22 sensor
 #define FACTORY_CFG_EXT_SENSOR_UNIT           0                 ///< 0 = celsius, 1 = fahrenheit
+#define FACTORY_CFG_SINK_HTTP_URL             F("")             ///< URL of the local HTTP target for photos
+#define FACTORY_CFG_SINK_HTTP_METHOD          0                 ///< 0 = disabled, 1 = POST, 2 = PUT
+#define FACTORY_CFG_MQTT_ENABLE               0                 ///< enable MQTT client
+#define FACTORY_CFG_MQTT_HOST                 F("")             ///< MQTT broker hostname or IP
+#define FACTORY_CFG_MQTT_PORT                 1883              ///< MQTT broker port
+#define FACTORY_CFG_MQTT_USER                 F("")             ///< MQTT user name
+#define FACTORY_CFG_MQTT_PASSWORD             F("")             ///< MQTT password
+#define FACTORY_CFG_MQTT_TOPIC                F("")             ///< MQTT base topic, empty = MQTT_TOPIC_PREFIX/mDNS name
+#define FACTORY_CFG_MQTT_SNAPSHOT             0                 ///< publish snapshots to MQTT
+#define FACTORY_CFG_MQTT_QOS                  0                 ///< QoS of the MQTT messages, 0 or 1
+#define FACTORY_CFG_MOTION_CADENCE            0                 ///< slower photo upload for the static scene, scene change returns to the trigger interval
 
 /* ---------------- CFG FLAGS  ------------------*/
 #define CFG_WIFI_SETTINGS_SAVED               0x0A              ///< flag saved config
@@ -292,6 +405,48 @@
 #define EEPROM_ADDR_EXT_SENS_UNIT_START           (EEPROM_ADDR_EXT_SENS_ENABLE_START + EEPROM_ADDR_EXT_SENS_ENABLE_LENGTH)
 #define EEPROM_ADDR_EXT_SENS_UNIT_LENGTH          1
 
+#define EEPROM_ADDR_STREAM_FRAMESIZE_START        (EEPROM_ADDR_EXT_SENS_UNIT_START + EEPROM_ADDR_EXT_SENS_UNIT_LENGTH)
+#define EEPROM_ADDR_STREAM_FRAMESIZE_LENGTH       1
+
+#define EEPROM_ADDR_STREAM_QUALITY_START          (EEPROM_ADDR_STREAM_FRAMESIZE_START + EEPROM_ADDR_STREAM_FRAMESIZE_LENGTH)
+#define EEPROM_ADDR_STREAM_QUALITY_LENGTH         1
+
+#define EEPROM_ADDR_TIMELAPS_AVI_START            (EEPROM_ADDR_STREAM_QUALITY_START + EEPROM_ADDR_STREAM_QUALITY_LENGTH)
+#define EEPROM_ADDR_TIMELAPS_AVI_LENGTH           1
+
+#define EEPROM_ADDR_SINK_HTTP_URL_START           (EEPROM_ADDR_TIMELAPS_AVI_START + EEPROM_ADDR_TIMELAPS_AVI_LENGTH)
+#define EEPROM_ADDR_SINK_HTTP_URL_LENGTH          101
+
+#define EEPROM_ADDR_SINK_HTTP_METHOD_START        (EEPROM_ADDR_SINK_HTTP_URL_START + EEPROM_ADDR_SINK_HTTP_URL_LENGTH)
+#define EEPROM_ADDR_SINK_HTTP_METHOD_LENGTH       1
+
+#define EEPROM_ADDR_MQTT_ENABLE_START             (EEPROM_ADDR_SINK_HTTP_METHOD_START + EEPROM_ADDR_SINK_HTTP_METHOD_LENGTH)
+#define EEPROM_ADDR_MQTT_ENABLE_LENGTH            1
+
+#define EEPROM_ADDR_MQTT_HOST_START               (EEPROM_ADDR_MQTT_ENABLE_START + EEPROM_ADDR_MQTT_ENABLE_LENGTH)
+#define EEPROM_ADDR_MQTT_HOST_LENGTH              51
+
+#define EEPROM_ADDR_MQTT_PORT_START               (EEPROM_ADDR_MQTT_HOST_START + EEPROM_ADDR_MQTT_HOST_LENGTH)
+#define EEPROM_ADDR_MQTT_PORT_LENGTH              2
+
+#define EEPROM_ADDR_MQTT_USER_START               (EEPROM_ADDR_MQTT_PORT_START + EEPROM_ADDR_MQTT_PORT_LENGTH)
+#define EEPROM_ADDR_MQTT_USER_LENGTH              33
+
+#define EEPROM_ADDR_MQTT_PASSWORD_START           (EEPROM_ADDR_MQTT_USER_START + EEPROM_ADDR_MQTT_USER_LENGTH)
+#define EEPROM_ADDR_MQTT_PASSWORD_LENGTH          33
+
+#define EEPROM_ADDR_MQTT_TOPIC_START              (EEPROM_ADDR_MQTT_PASSWORD_START + EEPROM_ADDR_MQTT_PASSWORD_LENGTH)
+#define EEPROM_ADDR_MQTT_TOPIC_LENGTH             51
+
+#define EEPROM_ADDR_MQTT_SNAPSHOT_START           (EEPROM_ADDR_MQTT_TOPIC_START + EEPROM_ADDR_MQTT_TOPIC_LENGTH)
+#define EEPROM_ADDR_MQTT_SNAPSHOT_LENGTH          1
+
+#define EEPROM_ADDR_MQTT_QOS_START                (EEPROM_ADDR_MQTT_SNAPSHOT_START + EEPROM_ADDR_MQTT_SNAPSHOT_LENGTH)
+#define EEPROM_ADDR_MQTT_QOS_LENGTH               1
+
+#define EEPROM_ADDR_MOTION_CADENCE_START          (EEPROM_ADDR_MQTT_QOS_START + EEPROM_ADDR_MQTT_QOS_LENGTH)
+#define EEPROM_ADDR_MOTION_CADENCE_LENGTH         1
+
 #define EEPROM_SIZE (EEPROM_ADDR_REFRESH_INTERVAL_LENGTH + EEPROM_ADDR_FINGERPRINT_LENGTH + EEPROM_ADDR_TOKEN_LENGTH + \
                      EEPROM_ADDR_FRAMESIZE_LENGTH + EEPROM_ADDR_BRIGHTNESS_LENGTH + EEPROM_ADDR_CONTRAST_LENGTH + \
                      EEPROM_ADDR_SATURATION_LENGTH + EEPROM_ADDR_HMIRROR_LENGTH + EEPROM_ADDR_VFLIP_LENGTH + \
@@ -307,7 +462,12 @@
                      EEPROM_ADDR_HOSTNAME_LENGTH + EEPROM_ADDR_SERVICE_AP_ENABLE_LENGTH + EEPROM_ADDR_NETWORK_IP_METHOD_LENGTH +\
                      EEPROM_ADDR_NETWORK_STATIC_IP_LENGTH + EEPROM_ADDR_NETWORK_STATIC_MASK_LENGTH + EEPROM_ADDR_NETWORK_STATIC_GATEWAY_LENGTH + \
                      EEPROM_ADDR_NETWORK_STATIC_DNS_LENGTH + EEPROM_ADDR_IMAGE_ROTATION_LENGTH + EEPROM_ADDR_TIMELAPS_ENABLE_LENGTH + \
-                     EEPROM_ADDR_EXT_SENS_ENABLE_LENGTH + EEPROM_ADDR_EXT_SENS_UNIT_LENGTH)    ///< how many bits do we need for eeprom memory
+                     EEPROM_ADDR_EXT_SENS_ENABLE_LENGTH + EEPROM_ADDR_EXT_SENS_UNIT_LENGTH + EEPROM_ADDR_STREAM_FRAMESIZE_LENGTH + \
+                     EEPROM_ADDR_STREAM_QUALITY_LENGTH + EEPROM_ADDR_TIMELAPS_AVI_LENGTH + EEPROM_ADDR_SINK_HTTP_URL_LENGTH + \
+                     EEPROM_ADDR_SINK_HTTP_METHOD_LENGTH + EEPROM_ADDR_MQTT_ENABLE_LENGTH + EEPROM_ADDR_MQTT_HOST_LENGTH + \
+                     EEPROM_ADDR_MQTT_PORT_LENGTH + EEPROM_ADDR_MQTT_USER_LENGTH + EEPROM_ADDR_MQTT_PASSWORD_LENGTH + \
+                     EEPROM_ADDR_MQTT_TOPIC_LENGTH + EEPROM_ADDR_MQTT_SNAPSHOT_LENGTH + EEPROM_ADDR_MQTT_QOS_LENGTH + \
+                     EEPROM_ADDR_MOTION_CADENCE_LENGTH)    ///< how many bits do we need for eeprom memory
 
 #endif
 
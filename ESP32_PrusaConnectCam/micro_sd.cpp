@@ -676,19 +676,15 @@ bool MicroSd::WritePicture(String i_PhotoName, uint8_t *i_PhotoData, size_t i_Ph
 }
 
 /**
-   @brief Write picture to the SD card with EXIF data
-   @param fs::FS - card
+   @brief Write picture to the SD card from the frame segments. EXIF header and photo data are written without merging to one buffer
    @param String - file name
-   @param uint8_t - data
-   @param size_t - data length
-   @param const uint8_t - EXIF data
-   @param size_t - EXIF data length
+   @param const CameraFrameView_t * - segmented frame
    @return bool - status
 */
-bool MicroSd::WritePicture(String i_PhotoName, uint8_t *i_PhotoData, size_t i_PhotoLen, const uint8_t *i_PtohoExif, size_t i_PhotoExifLen) {
+bool MicroSd::WritePicture(String i_PhotoName, const CameraFrameView_t *i_Photo) {
 
 #if (true == CONSOLE_VERBOSE_DEBUG)  
-  Serial.println(F("WritePicture EXIF"));
+  Serial.println(F("WritePicture segments"));
 #endif
   bool ret_stat = false;
 
@@ -697,9 +693,11 @@ bool MicroSd::WritePicture(String i_PhotoName, uint8_t *i_PhotoData, size_t i_Ph
   if (file) {
     size_t ret = 0;
 
-    ret = file.write(i_PtohoExif, i_PhotoExifLen);
-    ret += file.write(i_PhotoData, i_PhotoLen);
-    if (ret != (i_PhotoLen + i_PhotoExifLen)) {
+    for (uint8_t i = 0; i < i_Photo->Count; i++) {
+      ret += file.write(i_Photo->Segment[i].ptr, i_Photo->Segment[i].len);
+    }
+
+    if (ret != i_Photo->Len) {
 #if (true == CONSOLE_VERBOSE_DEBUG)        
       Serial.println(F("Failed. Error while writing to file"));
 #endif
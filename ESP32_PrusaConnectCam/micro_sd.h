@@ -30,6 +30,7 @@
 #include "mcu_cfg.h"
 #include "module_templates.h"
 #include "var.h"
+#include "camera_frame.h"
 
 class MicroSd {
 private:
@@ -70,7 +71,7 @@ public:
   int CountFilesInDir(fs::FS &, String );
 
   bool WritePicture(String, uint8_t *, size_t);
-  bool WritePicture(String, uint8_t *, size_t, const uint8_t *, size_t);
+  bool WritePicture(String, const CameraFrameView_t *);
 
   void CheckCardUsedStatus();
   bool isCardCorrupted();
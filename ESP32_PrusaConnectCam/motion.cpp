@@ -0,0 +1,154 @@
+/**
+   @file motion.cpp
+
+   @brief Library for scene change detection from the jpeg DC coefficients
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "motion.h"
+
+/**
+   @brief Constructor for MotionDetector class
+   @param none
+   @return none
+*/
+MotionDetector::MotionDetector() {
+  Grid[0] = NULL;
+  Grid[1] = NULL;
+  Current = 0;
+  GridWidth = 0;
+  GridHeight = 0;
+  PreviousValid = false;
+  Score = 0;
+  ChangeCount = 0;
+  AnalysisTime = 0;
+  AnalysisCount = 0;
+  AnalysisFailures = 0;
+}
+
+/**
+   @brief Allocate the luma grids. The grids are allocated once for the maximum frame size
+   @param none
+   @return bool - true = grids are allocated
+*/
+bool MotionDetector::Init() {
+  for (uint8_t i = 0; i < 2; i++) {
+    if (NULL == Grid[i]) {
+      Grid[i] = (uint8_t *)heap_caps_malloc(MOTION_GRID_MAX_CELLS, MALLOC_CAP_SPIRAM);
+    }
+  }
+
+  return (NULL != Grid[0]) && (NULL != Grid[1]);
+}
+
+/**
+   @brief Decode luma grid of the frame and compare it with the previous grid. The average luma
+          of both grids is subtracted, so the exposure change is not a scene change
+   @param const uint8_t* - jpeg frame
+   @param size_t - frame length
+   @return bool - true = frame is analysed
+*/
+bool MotionDetector::Process(const uint8_t *i_buf, size_t i_len) {
+  uint16_t width = 0;
+  uint16_t height = 0;
+  int64_t start = esp_timer_get_time();
+
+  if ((NULL == Grid[0]) || (NULL == Grid[1])) {
+    return false;
+  }
+
+  uint8_t next = Current ^ 1;
+  if (false == Decoder.Decode(i_buf, i_len, Grid[next], MOTION_GRID_MAX_CELLS, &width, &height)) {
+    AnalysisFailures++;
+    return false;
+  }
+
+  /* the grid with other resolution can not be compared */
+  uint32_t cells = (uint32_t)width * height;
+  if ((true == PreviousValid) && (width == GridWidth) && (height == GridHeight) && (cells > 0)) {
+    const uint8_t *cur = Grid[next];
+    const uint8_t *prev = Grid[Current];
+    uint32_t SumCur = 0;
+    uint32_t SumPrev = 0;
+    uint32_t changed = 0;
+
+    for (uint32_t i = 0; i < cells; i++) {
+      SumCur += cur[i];
+      SumPrev += prev[i];
+    }
+    int16_t offset = (int32_t)(SumCur - SumPrev) / (int32_t)cells;
+
+    for (uint32_t i = 0; i < cells; i++) {
+      if (abs((int16_t)cur[i] - prev[i] - offset) > MOTION_CELL_THRESHOLD) {
+        changed++;
+      }
+    }
+
+    Score = (changed * 100) / cells;
+    if (Score >= MOTION_SCORE_CHANGE) {
+      ChangeCount++;
+    }
+  } else {
+    Score = 0;
+  }
+
+  Current = next;
+  GridWidth = width;
+  GridHeight = height;
+  PreviousValid = true;
+  AnalysisCount++;
+  AnalysisTime = esp_timer_get_time() - start;
+
+  return true;
+}
+
+/**
+   @brief Get percentage of changed cells in the last sample
+   @param none
+   @return uint8_t - score 0-100
+*/
+uint8_t MotionDetector::GetScore() {
+  return Score;
+}
+
+/**
+   @brief Get count of samples with significant change
+   @param none
+   @return uint32_t - count of samples
+*/
+uint32_t MotionDetector::GetChangeCount() {
+  return ChangeCount;
+}
+
+/**
+   @brief Get time of the last analysis
+   @param none
+   @return uint32_t - time [us]
+*/
+uint32_t MotionDetector::GetAnalysisTime() {
+  return AnalysisTime;
+}
+
+/**
+   @brief Get count of analysed frames
+   @param none
+   @return uint32_t - count of frames
+*/
+uint32_t MotionDetector::GetAnalysisCount() {
+  return AnalysisCount;
+}
+
+/**
+   @brief Get count of frames, which can not be decoded
+   @param none
+   @return uint32_t - count of frames
+*/
+uint32_t MotionDetector::GetAnalysisFailures() {
+  return AnalysisFailures;
+}
+
+/* EOF */
@@ -0,0 +1,50 @@
+/**
+   @file motion.h
+
+   @brief Library for scene change detection from the jpeg DC coefficients
+
+   Luma grid at 1/8 scale is decoded from each sampled frame and compared
+   with the previous grid. The score is the percentage of changed cells.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#include "mcu_cfg.h"
+#include "jpeg_dc.h"
+
+class MotionDetector {
+private:
+  JpegDcDecoder Decoder;      ///< DC decoder
+  uint8_t *Grid[2];           ///< luma grids, current and previous
+  uint8_t Current;            ///< index of the current grid
+  uint16_t GridWidth;         ///< grid width
+  uint16_t GridHeight;        ///< grid height
+  bool PreviousValid;         ///< previous grid is valid for comparison
+  uint8_t Score;              ///< percentage of changed cells in the last sample
+  uint32_t ChangeCount;       ///< count of samples with significant change
+  uint32_t AnalysisTime;      ///< time of the last analysis [us]
+  uint32_t AnalysisCount;     ///< count of analysed frames
+  uint32_t AnalysisFailures;  ///< count of frames, which can not be decoded
+
+public:
+  MotionDetector();
+  ~MotionDetector(){};
+
+  bool Init();
+  bool Process(const uint8_t *, size_t);
+
+  uint8_t GetScore();
+  uint32_t GetChangeCount();
+  uint32_t GetAnalysisTime();
+  uint32_t GetAnalysisCount();
+  uint32_t GetAnalysisFailures();
+};
+
+/* EOF */
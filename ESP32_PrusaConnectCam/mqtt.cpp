@@ -0,0 +1,472 @@
+/**
+   @file mqtt.cpp
+
+   @brief Library with MQTT 3.1.1 client for the status and the snapshots
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "mqtt.h"
+#include "connect.h"
+#include "cfg.h"
+#include "wifi_mngt.h"
+#include "ExternalTemperatureSensor.h"
+
+MqttSnapshotSink SinkMqtt(&SystemConfig, &SystemCamera, &SystemLog);
+
+/* topic names of the status values, in the order of MqttStatus_enum */
+static const char *MqttStatusTopic[MqttStatus_Count] = {
+  "ip", "ssid", "rssi", "backend", "circuit", "last_upload", "photos",
+  "spool", "sd_free", "mcu_temp", "ext_temp", "ext_hum", "stream_clients", "sw_version",
+};
+
+/**
+   @brief Constructor for MqttSnapshotSink class
+   @param Configuration * - pointer to Configuration object
+   @param Camera * - pointer to Camera object
+   @param Logs * - pointer to Logs object
+   @return none
+*/
+MqttSnapshotSink::MqttSnapshotSink(Configuration *i_conf, Camera *i_camera, Logs *i_log)
+  : SnapshotSink("Mqtt", i_camera, i_log, MQTT_QUEUE_LENGTH, MQTT_TIMEOUT) {
+  config = i_conf;
+  Enable = false;
+  Cfg.Host = "";
+  Cfg.Port = FACTORY_CFG_MQTT_PORT;
+  Cfg.User = "";
+  Cfg.Password = "";
+  Cfg.Topic = "";
+  ActiveCfg = Cfg;
+  CfgMutex = xSemaphoreCreateMutex();
+  Snapshot = false;
+  Qos = 0;
+  ReconnectRequest = false;
+  ReconnectTime = 0;
+  ReconnectDelay = 0;
+  ReconnectBackoff = 0;
+  StatusTime = 0;
+  Connects = 0;
+  StatusPublished = 0;
+  TaskStack = MQTT_STACK;
+}
+
+/**
+   @brief Load configuration from EEPROM
+   @param none
+   @return none
+*/
+void MqttSnapshotSink::LoadCfgFromEeprom() {
+  log->AddEvent(LogLevel_Info, F("Load MQTT CFG from EEPROM"));
+  Enable = config->LoadMqttEnable();
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  Cfg.Host = config->LoadMqttHost();
+  Cfg.Port = config->LoadMqttPort();
+  Cfg.User = config->LoadMqttUser();
+  Cfg.Password = config->LoadMqttPassword();
+  Cfg.Topic = config->LoadMqttTopic();
+  ReconnectRequest = true;
+  xSemaphoreGive(CfgMutex);
+  Snapshot = config->LoadMqttSnapshot();
+  Qos = config->LoadMqttQos();
+}
+
+/**
+   @brief Publish the photo to the snapshot topic
+   @param CameraFrame_t * - photo frame
+   @return bool - true = photo was published
+*/
+bool MqttSnapshotSink::Deliver(CameraFrame_t *i_frame) {
+  if (false == CheckConnection()) {
+    return false;
+  }
+
+  CameraFrameView_t view;
+  CameraFrame_GetView(i_frame, &view);
+  bool ret = Client.Publish(GetBaseTopic(ActiveCfg.Topic) + "/snapshot", &view, Qos, false);
+  log->AddEvent((true == ret) ? LogLevel_Info : LogLevel_Warning, F("MQTT snapshot published: "), String(ret) + ", " + String(view.Len) + " bytes");
+
+  return ret;
+}
+
+/**
+   @brief Keep the connection alive and publish the changed status values
+   @param none
+   @return none
+*/
+void MqttSnapshotSink::Idle() {
+  if (false == CheckConnection()) {
+    return;
+  }
+
+  if (false == Client.Loop()) {
+    log->AddEvent(LogLevel_Warning, F("MQTT connection lost"));
+    return;
+  }
+
+  if ((millis() - StatusTime) >= MQTT_STATUS_INTERVAL) {
+    StatusTime = millis();
+    PublishStatus();
+  }
+}
+
+/**
+   @brief The task of the client is created, when the client is enabled. The status is published without the snapshots
+   @param none
+   @return bool - true = task is required
+*/
+bool MqttSnapshotSink::GetTaskRequired() {
+  return Enable;
+}
+
+/**
+   @brief Connect to broker. After each failure, the next attempt is delayed with exponential backoff and jitter
+   @param none
+   @return bool - true = client is connected
+*/
+bool MqttSnapshotSink::CheckConnection() {
+  /* the configuration was changed by the web server. The task uses its own copy, the web server can change it during the connection */
+  if (true == ReconnectRequest) {
+    xSemaphoreTake(CfgMutex, portMAX_DELAY);
+    ReconnectRequest = false;
+    ActiveCfg = Cfg;
+    xSemaphoreGive(CfgMutex);
+    Client.Disconnect();
+    ReconnectBackoff = 0;
+    ReconnectDelay = 0;
+  }
+
+  if (false == Enable) {
+    return false;
+  }
+
+  if (true == Client.GetConnected()) {
+    return true;
+  }
+
+  if ((WL_CONNECTED != WiFi.status()) || (0 == ActiveCfg.Host.length()) || ((millis() - ReconnectTime) < ReconnectDelay)) {
+    return false;
+  }
+  ReconnectTime = millis();
+
+  String mac = WiFi.macAddress();
+  mac.replace(":", "");
+  String id = "esp32cam-" + mac.substring(6);
+  String base = GetBaseTopic(ActiveCfg.Topic);
+
+  esp_task_wdt_reset();
+  if (true == Client.Connect(ActiveCfg.Host, ActiveCfg.Port, id, ActiveCfg.User, ActiveCfg.Password, base + "/status", "offline")) {
+    Connects++;
+    ReconnectBackoff = 0;
+    ReconnectDelay = 0;
+    log->AddEvent(LogLevel_Info, F("MQTT connected: "), ActiveCfg.Host + ":" + String(ActiveCfg.Port) + ", topic: " + base);
+
+    /* the session is clean, all status values are published again */
+    for (uint8_t i = 0; i < MqttStatus_Count; i++) {
+      StatusLast[i] = "";
+    }
+    StatusTime = millis() - MQTT_STATUS_INTERVAL;
+    return Client.Publish(base + "/status", (const uint8_t *) "online", 6, Qos, true);
+  }
+
+  ReconnectBackoff = (0 == ReconnectBackoff) ? (MQTT_RECONNECT_MIN * 1000UL) : min(ReconnectBackoff * 2, (uint32_t)(MQTT_RECONNECT_MAX * 1000UL));
+  uint32_t jitter = (ReconnectBackoff / 100) * MQTT_RECONNECT_JITTER;
+  ReconnectDelay = ReconnectBackoff - jitter + (esp_random() % (2 * jitter + 1));
+  log->AddEvent(LogLevel_Warning, F("MQTT connection failed: "), ActiveCfg.Host + ":" + String(ActiveCfg.Port) + ", next attempt in: " + String(ReconnectDelay / 1000) + " s");
+
+  return false;
+}
+
+/**
+   @brief Publish the status values, which were changed since the last publishing. The values are retained
+   @param none
+   @return none
+*/
+void MqttSnapshotSink::PublishStatus() {
+  String base = GetBaseTopic(ActiveCfg.Topic);
+
+  for (uint8_t i = 0; i < MqttStatus_Count; i++) {
+    String value = GetStatusValue((MqttStatus_enum) i);
+    if (value == StatusLast[i]) {
+      continue;
+    }
+
+    esp_task_wdt_reset();
+    if (false == Client.Publish(base + "/" + MqttStatusTopic[i], (const uint8_t *) value.c_str(), value.length(), Qos, true)) {
+      log->AddEvent(LogLevel_Warning, F("MQTT status publishing failed: "), String(MqttStatusTopic[i]));
+      return;
+    }
+    StatusLast[i] = value;
+    StatusPublished++;
+  }
+}
+
+/**
+   @brief Get base topic
+   @param const String & - configured topic
+   @return String - configured topic, or MQTT_TOPIC_PREFIX/mDNS name
+*/
+String MqttSnapshotSink::GetBaseTopic(const String &i_topic) {
+  if (i_topic.length() > 0) {
+    return i_topic;
+  }
+
+  return String(MQTT_TOPIC_PREFIX) + "/" + SystemWifiMngt.GetMdns();
+}
+
+/**
+   @brief Get current status value
+   @param MqttStatus_enum - status
+   @return String - value
+*/
+String MqttSnapshotSink::GetStatusValue(MqttStatus_enum i_status) {
+  switch (i_status) {
+    case MqttStatus_Ip:
+      return WiFi.localIP().toString();
+    case MqttStatus_Ssid:
+      return SystemWifiMngt.GetStaSsid();
+    case MqttStatus_Rssi:
+      /* the signal is rounded, the small changes are not published */
+      return String((SystemWifiMngt.Rssi2Percent(WiFi.RSSI()) / MQTT_RSSI_STEP) * MQTT_RSSI_STEP);
+    case MqttStatus_Backend:
+      return Connect.CovertBackendAvailabilitStatusToString(Connect.GetBackendAvailabilitStatus());
+    case MqttStatus_Circuit:
+      return Connect.GetCircuitStateName();
+    case MqttStatus_LastUpload:
+      return Connect.GetBackendReceivedStatus();
+    case MqttStatus_Photos:
+      return String(camera->GetPhotoCaptureCount());
+    case MqttStatus_Spool:
+      return String(SystemSpool.GetCount());
+    case MqttStatus_SdFree:
+      return String(log->GetFreeSpacePercent());
+    case MqttStatus_McuTemp:
+      return String((int) McuTemperature.TemperatureCelsius);
+    case MqttStatus_ExtTemp:
+      return (true == ExternalTemperatureSensor.GetUserEnableSensor()) ? ExternalTemperatureSensor.GetTemperatureString() : "";
+    case MqttStatus_ExtHum:
+      return (true == ExternalTemperatureSensor.GetUserEnableSensor()) ? ExternalTemperatureSensor.GetHumidityString() : "";
+    case MqttStatus_StreamClients:
+      return String(camera->GetStreamClients());
+    case MqttStatus_SwVersion:
+      return SW_VERSION;
+    default:
+      return "";
+  }
+}
+
+/**
+   @brief Enable or disable the MQTT client and save it to EEPROM
+   @param bool - true = enabled
+   @return none
+*/
+void MqttSnapshotSink::SetEnable(bool i_data) {
+  Enable = i_data;
+  config->SaveMqttEnable(Enable);
+  ReconnectRequest = true;
+  StartTask();
+}
+
+/**
+   @brief Set broker hostname and save it to EEPROM
+   @param String - hostname or IP
+   @return none
+*/
+void MqttSnapshotSink::SetHost(String i_data) {
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  Cfg.Host = i_data;
+  ReconnectRequest = true;
+  xSemaphoreGive(CfgMutex);
+  config->SaveMqttHost(i_data);
+}
+
+/**
+   @brief Set broker port and save it to EEPROM
+   @param uint16_t - port
+   @return none
+*/
+void MqttSnapshotSink::SetPort(uint16_t i_data) {
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  Cfg.Port = i_data;
+  ReconnectRequest = true;
+  xSemaphoreGive(CfgMutex);
+  config->SaveMqttPort(i_data);
+}
+
+/**
+   @brief Set user name and save it to EEPROM
+   @param String - user name, empty = without login
+   @return none
+*/
+void MqttSnapshotSink::SetUser(String i_data) {
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  Cfg.User = i_data;
+  ReconnectRequest = true;
+  xSemaphoreGive(CfgMutex);
+  config->SaveMqttUser(i_data);
+}
+
+/**
+   @brief Set password and save it to EEPROM
+   @param String - password
+   @return none
+*/
+void MqttSnapshotSink::SetPassword(String i_data) {
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  Cfg.Password = i_data;
+  ReconnectRequest = true;
+  xSemaphoreGive(CfgMutex);
+  config->SaveMqttPassword(i_data);
+}
+
+/**
+   @brief Set base topic and save it to EEPROM
+   @param String - topic, empty = MQTT_TOPIC_PREFIX/mDNS name
+   @return none
+*/
+void MqttSnapshotSink::SetTopic(String i_data) {
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  Cfg.Topic = i_data;
+  ReconnectRequest = true;
+  xSemaphoreGive(CfgMutex);
+  config->SaveMqttTopic(i_data);
+}
+
+/**
+   @brief Enable or disable the snapshot publishing and save it to EEPROM
+   @param bool - true = snapshots are published
+   @return none
+*/
+void MqttSnapshotSink::SetSnapshot(bool i_data) {
+  Snapshot = i_data;
+  config->SaveMqttSnapshot(Snapshot);
+}
+
+/**
+   @brief Set QoS of the published messages and save it to EEPROM
+   @param uint8_t - QoS, 0 or 1
+   @return none
+*/
+void MqttSnapshotSink::SetQos(uint8_t i_data) {
+  Qos = (i_data > 0) ? 1 : 0;
+  config->SaveMqttQos(Qos);
+}
+
+/**
+   @brief Snapshots are queued, when the snapshot publishing is enabled and the client is connected
+   @param none
+   @return bool - true = enabled
+*/
+bool MqttSnapshotSink::GetEnabled() {
+  return ((true == Enable) && (true == Snapshot) && (true == Client.GetConnected()));
+}
+
+/**
+   @brief Get MQTT client enable status
+   @param none
+   @return bool - true = enabled
+*/
+bool MqttSnapshotSink::GetEnable() {
+  return Enable;
+}
+
+/**
+   @brief Get broker hostname
+   @param none
+   @return String - hostname or IP
+*/
+String MqttSnapshotSink::GetHost() {
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  String ret = Cfg.Host;
+  xSemaphoreGive(CfgMutex);
+
+  return ret;
+}
+
+/**
+   @brief Get broker port
+   @param none
+   @return uint16_t - port
+*/
+uint16_t MqttSnapshotSink::GetPort() {
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  uint16_t ret = Cfg.Port;
+  xSemaphoreGive(CfgMutex);
+
+  return ret;
+}
+
+/**
+   @brief Get user name
+   @param none
+   @return String - user name
+*/
+String MqttSnapshotSink::GetUser() {
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  String ret = Cfg.User;
+  xSemaphoreGive(CfgMutex);
+
+  return ret;
+}
+
+/**
+   @brief Get base topic
+   @param none
+   @return String - topic, used by the client
+*/
+String MqttSnapshotSink::GetTopic() {
+  xSemaphoreTake(CfgMutex, portMAX_DELAY);
+  String topic = Cfg.Topic;
+  xSemaphoreGive(CfgMutex);
+
+  return GetBaseTopic(topic);
+}
+
+/**
+   @brief Get snapshot publishing status
+   @param none
+   @return bool - true = snapshots are published
+*/
+bool MqttSnapshotSink::GetSnapshot() {
+  return Snapshot;
+}
+
+/**
+   @brief Get QoS of the published messages
+   @param none
+   @return uint8_t - QoS
+*/
+uint8_t MqttSnapshotSink::GetQos() {
+  return Qos;
+}
+
+/**
+   @brief Get connection status
+   @param none
+   @return bool - true = client is connected
+*/
+bool MqttSnapshotSink::GetConnected() {
+  return Client.GetConnected();
+}
+
+/**
+   @brief Get count of successful connections
+   @param none
+   @return uint32_t - count
+*/
+uint32_t MqttSnapshotSink::GetConnects() {
+  return Connects;
+}
+
+/**
+   @brief Get count of published status values
+   @param none
+   @return uint32_t - count
+*/
+uint32_t MqttSnapshotSink::GetStatusPublished() {
+  return StatusPublished;
+}
+
+/* EOF */
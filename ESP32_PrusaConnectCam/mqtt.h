@@ -0,0 +1,119 @@
+/**
+   @file mqtt.h
+
+   @brief Library with MQTT 3.1.1 client for the status and the snapshots
+
+   The status values are published as retained topics, only after the value
+   is changed. The snapshots are published as binary JPEG payload, written
+   from the shared camera frame without copy. The client runs in its own
+   snapshot sink task, so the slow broker does not delay the other targets.
+   The task is created after the client is enabled.
+   QoS 0 and QoS 1 are supported. The packets are not resent after the lost
+   connection, the status values are published again after the reconnect.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_task_wdt.h>
+
+#include "mcu_cfg.h"
+#include "var.h"
+#include "log.h"
+#include "camera_frame.h"
+#include "snapshot_sink.h"
+#include "mqtt_client.h"
+
+class Configuration;
+class Camera;
+
+enum MqttStatus_enum {
+  MqttStatus_Ip = 0,                ///< IP address
+  MqttStatus_Ssid = 1,              ///< WiFi network
+  MqttStatus_Rssi = 2,              ///< WiFi signal [%]
+  MqttStatus_Backend = 3,           ///< Prusa Connect availability
+  MqttStatus_Circuit = 4,           ///< circuit breaker state
+  MqttStatus_LastUpload = 5,        ///< status of the last upload to Prusa Connect
+  MqttStatus_Photos = 6,            ///< count of captured photos
+  MqttStatus_Spool = 7,             ///< count of spooled photos
+  MqttStatus_SdFree = 8,            ///< free space on the SD card [%]
+  MqttStatus_McuTemp = 9,           ///< MCU temperature [°C]
+  MqttStatus_ExtTemp = 10,          ///< external sensor temperature
+  MqttStatus_ExtHum = 11,           ///< external sensor humidity
+  MqttStatus_StreamClients = 12,    ///< count of stream clients
+  MqttStatus_SwVersion = 13,        ///< firmware version
+  MqttStatus_Count = 14,            ///< count of status topics
+};
+
+struct MqttCfg_t {
+  String Host;                      ///< broker hostname or IP
+  uint16_t Port;                    ///< broker port
+  String User;                      ///< user name, empty = without login
+  String Password;                  ///< password
+  String Topic;                     ///< base topic, empty = MQTT_TOPIC_PREFIX/mDNS name
+};
+
+class MqttSnapshotSink : public SnapshotSink {
+private:
+  bool Enable;                      ///< MQTT client is enabled
+  MqttCfg_t Cfg;                    ///< connection configuration, written by the web server. Guarded by CfgMutex
+  MqttCfg_t ActiveCfg;              ///< copy of the configuration used by the sink task
+  SemaphoreHandle_t CfgMutex;       ///< mutex for the connection configuration
+  bool Snapshot;                    ///< snapshots are published
+  uint8_t Qos;                      ///< QoS of the published messages, 0 or 1
+  volatile bool ReconnectRequest;   ///< configuration was changed, the sink task copies it and closes the connection
+
+  MqttClient Client;                ///< MQTT protocol client
+  uint32_t ReconnectTime;           ///< time of the last connection attempt [ms]
+  uint32_t ReconnectDelay;          ///< delay of the next connection attempt [ms]
+  uint32_t ReconnectBackoff;        ///< delay without jitter, doubled after each failure [ms]
+  uint32_t StatusTime;              ///< time of the last status check [ms]
+  String StatusLast[MqttStatus_Count]; ///< last published status values
+  uint32_t Connects;                ///< count of successful connections
+  uint32_t StatusPublished;         ///< count of published status values
+
+  Configuration *config;            ///< pointer to Configuration object
+
+  bool Deliver(CameraFrame_t *);
+  void Idle();
+  bool GetTaskRequired();
+  bool CheckConnection();
+  void PublishStatus();
+  String GetBaseTopic(const String &);
+  String GetStatusValue(MqttStatus_enum);
+
+public:
+  MqttSnapshotSink(Configuration *, Camera *, Logs *);
+
+  void LoadCfgFromEeprom();
+  void SetEnable(bool);
+  void SetHost(String);
+  void SetPort(uint16_t);
+  void SetUser(String);
+  void SetPassword(String);
+  void SetTopic(String);
+  void SetSnapshot(bool);
+  void SetQos(uint8_t);
+
+  bool GetEnabled();
+  bool GetEnable();
+  String GetHost();
+  uint16_t GetPort();
+  String GetUser();
+  String GetTopic();
+  bool GetSnapshot();
+  uint8_t GetQos();
+  bool GetConnected();
+  uint32_t GetConnects();
+  uint32_t GetStatusPublished();
+};
+
+extern MqttSnapshotSink SinkMqtt;   ///< MQTT sink
+
+/* EOF */
@@ -0,0 +1,385 @@
+/**
+   @file mqtt_client.cpp
+
+   @brief Library with MQTT 3.1.1 client
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "mqtt_client.h"
+
+
+/**
+   @brief Constructor for MqttClient class
+   @param none
+   @return none
+*/
+MqttClient::MqttClient() {
+  PacketId = 0;
+  KeepAlive = MQTT_KEEPALIVE;
+  LastSend = 0;
+  PingTime = 0;
+  PingPending = false;
+  Connected = false;
+}
+
+/**
+   @brief Write fixed header of the packet with the remaining length
+   @param uint8_t - packet type and flags
+   @param uint32_t - remaining length
+   @return bool - true = header was written
+*/
+bool MqttClient::WriteHeader(uint8_t i_type, uint32_t i_len) {
+  uint8_t buf[5];
+  uint8_t pos = 0;
+  buf[pos++] = i_type;
+
+  /* variable length encoding, 7 bits per byte */
+  do {
+    uint8_t digit = i_len % 128;
+    i_len /= 128;
+    buf[pos++] = (i_len > 0) ? (digit | 0x80) : digit;
+  } while ((i_len > 0) && (pos < sizeof(buf)));
+
+  return (Client.write(buf, pos) == pos);
+}
+
+/**
+   @brief Write UTF-8 string with the length prefix
+   @param const char * - string
+   @param uint16_t - string length
+   @return bool - true = string was written
+*/
+bool MqttClient::WriteString(const char *i_data, uint16_t i_len) {
+  uint8_t len[2] = { (uint8_t)(i_len >> 8), (uint8_t)(i_len & 0xFF) };
+
+  if (Client.write(len, sizeof(len)) != sizeof(len)) {
+    return false;
+  }
+
+  return (Client.write((const uint8_t *) i_data, i_len) == i_len);
+}
+
+/**
+   @brief Read one byte from broker
+   @param uint32_t - deadline [ms]
+   @return int - byte, -1 after the timeout or lost connection
+*/
+int MqttClient::ReadByte(uint32_t i_deadline) {
+  while (Client.available() <= 0) {
+    if ((false == Client.connected()) || ((int32_t)(millis() - i_deadline) >= 0)) {
+      return -1;
+    }
+    delay(1);
+  }
+
+  return Client.read();
+}
+
+/**
+   @brief Read one packet from broker. The beginning of the packet is stored, the rest is skipped
+   @param uint8_t * - output packet type and flags
+   @param uint8_t * - output buffer
+   @param size_t - buffer size
+   @param uint32_t - deadline [ms]
+   @return int - remaining length of the packet, -1 after the timeout or lost connection
+*/
+int MqttClient::ReadPacket(uint8_t *o_type, uint8_t *o_buf, size_t i_size, uint32_t i_deadline) {
+  int data = ReadByte(i_deadline);
+  if (data < 0) {
+    return -1;
+  }
+  *o_type = (uint8_t) data;
+
+  uint32_t len = 0;
+  uint32_t multiplier = 1;
+  for (uint8_t i = 0; i < 4; i++) {
+    data = ReadByte(i_deadline);
+    if (data < 0) {
+      return -1;
+    }
+    len += (data & 0x7F) * multiplier;
+    multiplier *= 128;
+    if (0 == (data & 0x80)) {
+      break;
+    }
+  }
+
+  for (uint32_t i = 0; i < len; i++) {
+    data = ReadByte(i_deadline);
+    if (data < 0) {
+      return -1;
+    }
+    if (i < i_size) {
+      o_buf[i] = (uint8_t) data;
+    }
+  }
+
+  return len;
+}
+
+/**
+   @brief Wait for the packet from broker. Other packets are processed or skipped
+   @param uint8_t - packet type
+   @param uint16_t - packet id for PUBACK
+   @return bool - true = packet was received
+*/
+bool MqttClient::WaitPacket(uint8_t i_type, uint16_t i_id) {
+  uint32_t deadline = millis() + MQTT_TIMEOUT;
+  uint8_t buf[4];
+  uint8_t type = 0;
+
+  while (true) {
+    int len = ReadPacket(&type, buf, sizeof(buf), deadline);
+    if (len < 0) {
+      return false;
+    }
+
+    type &= 0xF0;
+    if (MqttPacketPingResp == type) {
+      PingPending = false;
+    }
+
+    if ((type == i_type) && ((MqttPacketPubAck != type) || ((len >= 2) && (i_id == ((buf[0] << 8) | buf[1]))))) {
+      return true;
+    }
+  }
+}
+
+/**
+   @brief Connect to broker with the clean session and the last will
+   @param String - broker hostname or IP
+   @param uint16_t - broker port
+   @param String - client id
+   @param String - user name, empty = without login
+   @param String - password
+   @param String - topic of the last will, retained
+   @param const char * - message of the last will
+   @return bool - true = broker accepted the connection
+*/
+bool MqttClient::Connect(const String &i_host, uint16_t i_port, const String &i_id, const String &i_user, const String &i_pass, const String &i_will_topic, const char *i_will_msg) {
+  Disconnect();
+
+  if (!Client.connect(i_host.c_str(), i_port, MQTT_TIMEOUT)) {
+    return false;
+  }
+  Client.setNoDelay(true);
+
+  /* clean session, the last will is retained with QoS 0 */
+  uint8_t flags = 0x02;
+  uint32_t len = 10 + 2 + i_id.length();
+  if (i_will_topic.length() > 0) {
+    flags |= 0x04 | 0x20;
+    len += 2 + i_will_topic.length() + 2 + strlen(i_will_msg);
+  }
+  if (i_user.length() > 0) {
+    flags |= 0x80;
+    len += 2 + i_user.length();
+    if (i_pass.length() > 0) {
+      flags |= 0x40;
+      len += 2 + i_pass.length();
+    }
+  }
+
+  uint8_t header[10] = { 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, flags, (uint8_t)(KeepAlive >> 8), (uint8_t)(KeepAlive & 0xFF) };
+  bool ret = WriteHeader(MqttPacketConnect, len) && (Client.write(header, sizeof(header)) == sizeof(header));
+  ret = ret && WriteString(i_id.c_str(), i_id.length());
+  if (flags & 0x04) {
+    ret = ret && WriteString(i_will_topic.c_str(), i_will_topic.length()) && WriteString(i_will_msg, strlen(i_will_msg));
+  }
+  if (flags & 0x80) {
+    ret = ret && WriteString(i_user.c_str(), i_user.length());
+  }
+  if (flags & 0x40) {
+    ret = ret && WriteString(i_pass.c_str(), i_pass.length());
+  }
+  LastSend = millis();
+
+  /* CONNACK: session present flag, return code */
+  uint8_t buf[2] = { 0, 0xFF };
+  uint8_t type = 0;
+  uint32_t deadline = millis() + MQTT_TIMEOUT;
+  int ack = (true == ret) ? ReadPacket(&type, buf, sizeof(buf), deadline) : -1;
+  if ((ack < 2) || (MqttPacketConnAck != (type & 0xF0)) || (0 != buf[1])) {
+    Client.stop();
+    return false;
+  }
+
+  Connected = true;
+  PingPending = false;
+  return true;
+}
+
+/**
+   @brief Write header of the PUBLISH packet
+   @param String - topic
+   @param size_t - payload length
+   @param uint8_t - QoS, 0 or 1
+   @param bool - retain flag
+   @param uint16_t * - output packet id for QoS 1
+   @return bool - true = header was written
+*/
+bool MqttClient::PublishBegin(const String &i_topic, size_t i_len, uint8_t i_qos, bool i_retain, uint16_t *o_id) {
+  if (false == Connected) {
+    return false;
+  }
+
+  uint8_t type = MqttPacketPublish | ((i_qos > 0) ? 0x02 : 0x00) | ((true == i_retain) ? 0x01 : 0x00);
+  uint32_t len = 2 + i_topic.length() + ((i_qos > 0) ? 2 : 0) + i_len;
+  bool ret = WriteHeader(type, len) && WriteString(i_topic.c_str(), i_topic.length());
+
+  if ((true == ret) && (i_qos > 0)) {
+    /* packet id 0 is not allowed */
+    if (0 == ++PacketId) {
+      PacketId = 1;
+    }
+    *o_id = PacketId;
+    uint8_t id[2] = { (uint8_t)(PacketId >> 8), (uint8_t)(PacketId & 0xFF) };
+    ret = (Client.write(id, sizeof(id)) == sizeof(id));
+  }
+
+  return ret;
+}
+
+/**
+   @brief Finish the PUBLISH packet. QoS 1 waits for PUBACK, the connection is closed without it
+   @param uint8_t - QoS, 0 or 1
+   @param uint16_t - packet id for QoS 1
+   @return bool - true = message was published
+*/
+bool MqttClient::PublishEnd(uint8_t i_qos, uint16_t i_id) {
+  LastSend = millis();
+
+  if ((i_qos > 0) && (false == WaitPacket(MqttPacketPubAck, i_id))) {
+    Disconnect();
+    return false;
+  }
+
+  return Client.connected();
+}
+
+/**
+   @brief Publish message
+   @param String - topic
+   @param const uint8_t * - payload
+   @param size_t - payload length
+   @param uint8_t - QoS, 0 or 1
+   @param bool - retain flag
+   @return bool - true = message was published
+*/
+bool MqttClient::Publish(const String &i_topic, const uint8_t *i_data, size_t i_len, uint8_t i_qos, bool i_retain) {
+  uint16_t id = 0;
+
+  if ((false == PublishBegin(i_topic, i_len, i_qos, i_retain, &id)) || (Client.write(i_data, i_len) != i_len)) {
+    Disconnect();
+    return false;
+  }
+
+  return PublishEnd(i_qos, id);
+}
+
+/**
+   @brief Publish photo as binary payload. The segments are written from the shared frame, the photo is not copied
+   @param String - topic
+   @param CameraFrameView_t * - photo view
+   @param uint8_t - QoS, 0 or 1
+   @param bool - retain flag
+   @return bool - true = message was published
+*/
+bool MqttClient::Publish(const String &i_topic, const CameraFrameView_t *i_view, uint8_t i_qos, bool i_retain) {
+  uint16_t id = 0;
+
+  if (false == PublishBegin(i_topic, i_view->Len, i_qos, i_retain, &id)) {
+    Disconnect();
+    return false;
+  }
+
+  for (uint8_t seg = 0; seg < i_view->Count; seg++) {
+    const uint8_t *buf = i_view->Segment[seg].ptr;
+    size_t len = i_view->Segment[seg].len;
+
+    for (size_t i = 0; i < len; i += PHOTO_FRAGMENT_SIZE) {
+      size_t chunk = min((size_t) PHOTO_FRAGMENT_SIZE, len - i);
+      if (Client.write(buf + i, chunk) != chunk) {
+        Disconnect();
+        return false;
+      }
+    }
+  }
+
+  return PublishEnd(i_qos, id);
+}
+
+/**
+   @brief Process packets from broker and keep the connection alive
+   @param none
+   @return bool - true = client is connected
+*/
+bool MqttClient::Loop() {
+  if (false == Connected) {
+    return false;
+  }
+
+  if (false == Client.connected()) {
+    Disconnect();
+    return false;
+  }
+
+  /* the client does not subscribe, only the responses are expected */
+  uint8_t buf[4];
+  uint8_t type = 0;
+  while (Client.available() > 0) {
+    if (ReadPacket(&type, buf, sizeof(buf), millis() + MQTT_TIMEOUT) < 0) {
+      Disconnect();
+      return false;
+    }
+    if (MqttPacketPingResp == (type & 0xF0)) {
+      PingPending = false;
+    }
+  }
+
+  if ((true == PingPending) && ((millis() - PingTime) > MQTT_TIMEOUT)) {
+    Disconnect();
+    return false;
+  }
+
+  if ((false == PingPending) && ((millis() - LastSend) >= (KeepAlive * 1000UL / 2))) {
+    if (false == WriteHeader(MqttPacketPingReq, 0)) {
+      Disconnect();
+      return false;
+    }
+    LastSend = millis();
+    PingTime = LastSend;
+    PingPending = true;
+  }
+
+  return true;
+}
+
+/**
+   @brief Disconnect from broker
+   @param none
+   @return none
+*/
+void MqttClient::Disconnect() {
+  if ((true == Connected) && (Client.connected())) {
+    WriteHeader(MqttPacketDisconnect, 0);
+  }
+  Client.stop();
+  Connected = false;
+  PingPending = false;
+}
+
+/**
+   @brief Get connection status
+   @param none
+   @return bool - true = client is connected
+*/
+bool MqttClient::GetConnected() {
+  return Connected;
+}
+
+/* EOF */
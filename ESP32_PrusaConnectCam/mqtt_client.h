@@ -0,0 +1,67 @@
+/**
+   @file mqtt_client.h
+
+   @brief Library with MQTT 3.1.1 client
+
+   The client only publishes, it does not subscribe. The packets are written
+   directly to the connection, the snapshot payload is written from the
+   shared camera frame without copy. QoS 0 and QoS 1 are supported, the
+   QoS 1 packet is finished after the matching PUBACK. The packets are not
+   resent after the lost connection.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#include "mcu_cfg.h"
+#include "camera_frame.h"
+
+
+enum MqttPacket_enum {
+  MqttPacketConnect = 0x10,         ///< client request to connect
+  MqttPacketConnAck = 0x20,         ///< connect acknowledgment
+  MqttPacketPublish = 0x30,         ///< publish message
+  MqttPacketPubAck = 0x40,          ///< publish acknowledgment, QoS 1
+  MqttPacketPingReq = 0xC0,         ///< ping request
+  MqttPacketPingResp = 0xD0,        ///< ping response
+  MqttPacketDisconnect = 0xE0,      ///< client is disconnecting
+};
+
+class MqttClient {
+private:
+  WiFiClient Client;                ///< connection to broker
+  uint16_t PacketId;                ///< id of the last QoS 1 packet
+  uint16_t KeepAlive;               ///< keep alive interval [s]
+  uint32_t LastSend;                ///< time of the last packet sent to broker [ms]
+  uint32_t PingTime;                ///< time of the ping request [ms]
+  bool PingPending;                 ///< ping request without response
+  bool Connected;                   ///< CONNACK was accepted
+
+  bool WriteHeader(uint8_t, uint32_t);
+  bool WriteString(const char *, uint16_t);
+  int ReadByte(uint32_t);
+  int ReadPacket(uint8_t *, uint8_t *, size_t, uint32_t);
+  bool WaitPacket(uint8_t, uint16_t);
+  bool PublishBegin(const String &, size_t, uint8_t, bool, uint16_t *);
+  bool PublishEnd(uint8_t, uint16_t);
+
+public:
+  MqttClient();
+  ~MqttClient(){};
+
+  bool Connect(const String &, uint16_t, const String &, const String &, const String &, const String &, const char *);
+  bool Publish(const String &, const uint8_t *, size_t, uint8_t, bool);
+  bool Publish(const String &, const CameraFrameView_t *, uint8_t, bool);
+  bool Loop();
+  void Disconnect();
+  bool GetConnected();
+};
+
+/* EOF */
@@ -0,0 +1,370 @@
+/**
+   @file preevent.cpp
+
+   @brief Library with PSRAM ring of the last frames before an event
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "preevent.h"
+
+PreEventRing SystemPreEvent(&SystemLog);
+
+static volatile bool PreEventGpioTriggered = false;  ///< GPIO edge detected by the interrupt
+
+/**
+   @brief Interrupt for the GPIO trigger. The event is saved by the photo task
+   @param none
+   @return none
+*/
+static void IRAM_ATTR PreEvent_GpioIsr() {
+  PreEventGpioTriggered = true;
+}
+
+/**
+   @brief Constructor for PreEventRing class
+   @param Logs* - pointer to Logs object
+   @return none
+*/
+PreEventRing::PreEventRing(Logs *i_log) {
+  log = i_log;
+  Memory = NULL;
+  MemorySize = 0;
+  Head = 0;
+  Count = 0;
+  WritePos = 0;
+  UsedBytes = 0;
+  LastFrameTime = 0;
+  DroppedFrames = 0;
+  DumpCount = 0;
+  LastDumpTime = 0;
+  Dumping = false;
+  PendingTrigger = PreEventTrigger_None;
+  Mutex = xSemaphoreCreateMutex();
+}
+
+/**
+   @brief Allocate the ring memory and enable the GPIO trigger. The memory is sized for PREEVENT_SECONDS of frames
+          with the photo resolution, and limited by PREEVENT_MEMORY_MAX and by the free PSRAM
+   @param uint16_t - frame width
+   @param uint16_t - frame height
+   @return none
+*/
+void PreEventRing::Init(uint16_t i_width, uint16_t i_height) {
+#if (true == PREEVENT_ENABLE)
+  uint32_t FrameSize = max(((uint32_t)i_width * i_height) / PREEVENT_JPEG_RATIO, (uint32_t)1);
+  uint32_t PsramFree = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+  uint32_t size = min(FrameSize * PREEVENT_MAX_FRAMES, (uint32_t)PREEVENT_MEMORY_MAX);
+
+  /* other modules allocate PSRAM later, keep the reserve. The ring is not used for less than one second of frames */
+  if ((size + PREEVENT_PSRAM_RESERVE) > PsramFree) {
+    size = (PsramFree > PREEVENT_PSRAM_RESERVE) ? (PsramFree - PREEVENT_PSRAM_RESERVE) : 0;
+    log->AddEvent(LogLevel_Warning, F("Pre-event ring: low PSRAM, free: "), String(PsramFree) + " B, ring: " + String(size) + " B");
+  }
+  if (size < (FrameSize * PREEVENT_FPS)) {
+    log->AddEvent(LogLevel_Warning, F("Pre-event ring: disabled, not enough PSRAM for one second of frames: "), String(FrameSize * PREEVENT_FPS) + " B");
+    return;
+  }
+
+  log->AddEvent(LogLevel_Info, F("Init pre-event ring. Memory: "), String(size) + " B, frames: " + String(PREEVENT_MAX_FRAMES) + ", expected time: " + String(min(size / FrameSize, (uint32_t)PREEVENT_MAX_FRAMES) / PREEVENT_FPS) + " s");
+  Memory = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+  if (NULL == Memory) {
+    log->AddEvent(LogLevel_Error, F("Pre-event ring: failed to allocate memory"));
+    return;
+  }
+  MemorySize = size;
+
+#if (PREEVENT_TRIGGER_GPIO >= 0)
+  pinMode(PREEVENT_TRIGGER_GPIO, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(PREEVENT_TRIGGER_GPIO), PreEvent_GpioIsr, FALLING);
+#endif
+#endif
+}
+
+/**
+   @brief Check if the next frame should be stored to the ring
+   @param none
+   @return bool - true = frame is expected
+*/
+bool PreEventRing::CheckFrameDue() {
+  return (NULL != Memory) && (false == Dumping) && ((millis() - LastFrameTime) >= PREEVENT_FRAME_INTERVAL);
+}
+
+/**
+   @brief Copy frame to the ring. The oldest frames are overwritten, when the memory or the frame slots are full
+   @param const CameraFrameView_t * - segmented frame
+   @param uint16_t - frame width
+   @param uint16_t - frame height
+   @param int64_t - capture time [us]
+   @return none
+*/
+void PreEventRing::AddFrame(const CameraFrameView_t *i_frame, uint16_t i_width, uint16_t i_height, int64_t i_time) {
+  if (NULL == Memory) {
+    return;
+  }
+
+  xSemaphoreTake(Mutex, portMAX_DELAY);
+  LastFrameTime = millis();
+  uint32_t len = i_frame->Len;
+  if ((true == Dumping) || (0 == len) || (len > MemorySize)) {
+    DroppedFrames++;
+    xSemaphoreGive(Mutex);
+    return;
+  }
+
+  /* the frame does not fit to the end of the memory. The frames at the end are the oldest */
+  if ((WritePos + len) > MemorySize) {
+    while ((Count > 0) && (Frames[Head].Offset >= WritePos)) {
+      Evict();
+    }
+    WritePos = 0;
+  }
+
+  /* the oldest frames are stored after the write position */
+  while ((Count > 0) && ((Count >= PREEVENT_MAX_FRAMES) ||
+                         ((Frames[Head].Offset < (WritePos + len)) && ((Frames[Head].Offset + Frames[Head].Len) > WritePos)))) {
+    Evict();
+  }
+
+  PreEventFrame_t *frame = &Frames[(Head + Count) % PREEVENT_MAX_FRAMES];
+  frame->Offset = WritePos;
+  frame->Len = len;
+  frame->CaptureTime = i_time;
+  frame->Width = i_width;
+  frame->Height = i_height;
+  CameraFrame_CopyView(i_frame, Memory + WritePos, 0, len);
+
+  /* the frames are word aligned for the faster copy */
+  WritePos += (len + 3) & ~3;
+  UsedBytes += len;
+  Count++;
+  xSemaphoreGive(Mutex);
+}
+
+/**
+   @brief Remove the oldest frame from the ring
+   @param none
+   @return none
+*/
+void PreEventRing::Evict() {
+  UsedBytes -= Frames[Head].Len;
+  Head = (Head + 1) % PREEVENT_MAX_FRAMES;
+  Count--;
+}
+
+/**
+   @brief Request saving of the ring. The ring is saved by the photo task
+   @param PreEventTrigger_enum - trigger source
+   @return none
+*/
+void PreEventRing::Trigger(PreEventTrigger_enum i_trigger) {
+  if ((NULL != Memory) && (PreEventTrigger_None == PendingTrigger)) {
+    PendingTrigger = i_trigger;
+  }
+}
+
+/**
+   @brief Save the ring after the trigger. The GPIO and scene change triggers are ignored during the cooldown
+   @param none
+   @return none
+*/
+void PreEventRing::Process() {
+  PreEventTrigger_enum trigger = PendingTrigger;
+
+  if (true == PreEventGpioTriggered) {
+    PreEventGpioTriggered = false;
+    if (PreEventTrigger_None == trigger) {
+      trigger = PreEventTrigger_Gpio;
+    }
+  }
+
+  if ((NULL == Memory) || (PreEventTrigger_None == trigger)) {
+    return;
+  }
+  PendingTrigger = PreEventTrigger_None;
+
+  if ((PreEventTrigger_Http != trigger) && (0 != DumpCount) && ((millis() - LastDumpTime) < (PREEVENT_TRIGGER_COOLDOWN * 1000UL))) {
+    log->AddEvent(LogLevel_Verbose, F("Pre-event trigger ignored, cooldown: "), GetTriggerName(trigger));
+    return;
+  }
+
+  Dump(trigger);
+}
+
+/**
+   @brief Create AVI file for the saved event
+   @param String - file name without suffix
+   @param uint16_t - frame width
+   @param uint16_t - frame height
+   @return bool - true = file is opened
+*/
+bool PreEventRing::OpenDumpFile(String i_name, uint16_t i_width, uint16_t i_height) {
+  String FileName = i_name + TIMELAPS_AVI_SUFFIX;
+
+  for (uint8_t i = 1; (true == SD_MMC.exists(FileName)) && (i < UINT8_MAX); i++) {
+    FileName = i_name + "_" + String(i) + TIMELAPS_AVI_SUFFIX;
+  }
+
+  if (false == Writer.Open(SD_MMC, FileName, i_width, i_height)) {
+    log->AddEvent(LogLevel_Error, F("Pre-event: error creating file: "), FileName);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+   @brief Save stored frames to the SD card from the oldest. A new file is started, when the frame size is changed.
+          The ring is not changed during saving, new frames are dropped
+   @param PreEventTrigger_enum - trigger source
+   @return none
+*/
+void PreEventRing::Dump(PreEventTrigger_enum i_trigger) {
+  uint32_t start = millis();
+  uint16_t saved = 0;
+
+  log->AddEvent(LogLevel_Info, F("Pre-event triggered: "), GetTriggerName(i_trigger));
+  if (false == log->GetCardDetectedStatus()) {
+    log->AddEvent(LogLevel_Error, F("Pre-event: SD card not detected!"));
+    return;
+  }
+
+  xSemaphoreTake(Mutex, portMAX_DELAY);
+  Dumping = true;
+  uint16_t head = Head;
+  uint16_t count = Count;
+  xSemaphoreGive(Mutex);
+
+  if (false == log->CheckDir(SD_MMC, PREEVENT_FOLDER)) {
+    log->CreateDir(SD_MMC, PREEVENT_FOLDER);
+  }
+  String BaseName = String(PREEVENT_FOLDER) + "/" + String(PREEVENT_PREFIX) + "_" + log->GetSystemTime();
+
+  for (uint16_t i = 0; i < count; i++) {
+    const PreEventFrame_t *frame = &Frames[(head + i) % PREEVENT_MAX_FRAMES];
+
+    if ((true == Writer.IsOpen()) && ((frame->Width != Writer.GetWidth()) || (frame->Height != Writer.GetHeight()))) {
+      Writer.Close();
+    }
+    if ((false == Writer.IsOpen()) && (false == OpenDumpFile(BaseName, frame->Width, frame->Height))) {
+      break;
+    }
+
+    CameraFrameView_t view;
+    view.Count = 1;
+    view.Segment[0].ptr = Memory + frame->Offset;
+    view.Segment[0].len = frame->Len;
+    view.Len = frame->Len;
+    if (true == Writer.AddFrame(&view)) {
+      saved++;
+    }
+    esp_task_wdt_reset();
+  }
+
+  if ((true == Writer.IsOpen()) && (false == Writer.Close())) {
+    log->AddEvent(LogLevel_Error, F("Pre-event: error closing file"));
+  }
+
+  xSemaphoreTake(Mutex, portMAX_DELAY);
+  Dumping = false;
+  xSemaphoreGive(Mutex);
+
+  DumpCount++;
+  LastDumpTime = millis();
+  log->AddEvent(LogLevel_Info, F("Pre-event saved: "), BaseName + ", frames: " + String(saved) + "/" + String(count) + ", time: " + String(LastDumpTime - start) + " ms");
+}
+
+/**
+   @brief Get count of stored frames
+   @param none
+   @return uint16_t - count of frames
+*/
+uint16_t PreEventRing::GetFrameCount() {
+  return Count;
+}
+
+/**
+   @brief Get bytes used by the stored frames
+   @param none
+   @return uint32_t - used bytes
+*/
+uint32_t PreEventRing::GetUsedBytes() {
+  return UsedBytes;
+}
+
+/**
+   @brief Get size of the ring memory
+   @param none
+   @return uint32_t - size [bytes], 0 = ring is not allocated
+*/
+uint32_t PreEventRing::GetMemorySize() {
+  return MemorySize;
+}
+
+/**
+   @brief Get time between the oldest and the newest stored frame
+   @param none
+   @return uint32_t - duration [ms]
+*/
+uint32_t PreEventRing::GetDuration() {
+  uint32_t ret = 0;
+
+  xSemaphoreTake(Mutex, portMAX_DELAY);
+  if (Count > 1) {
+    const PreEventFrame_t *oldest = &Frames[Head];
+    const PreEventFrame_t *newest = &Frames[(Head + Count - 1) % PREEVENT_MAX_FRAMES];
+    ret = (newest->CaptureTime - oldest->CaptureTime) / 1000;
+  }
+  xSemaphoreGive(Mutex);
+
+  return ret;
+}
+
+/**
+   @brief Get count of frames not stored to the ring
+   @param none
+   @return uint32_t - count of frames
+*/
+uint32_t PreEventRing::GetDroppedFrames() {
+  return DroppedFrames;
+}
+
+/**
+   @brief Get count of saved events
+   @param none
+   @return uint32_t - count of events
+*/
+uint32_t PreEventRing::GetDumpCount() {
+  return DumpCount;
+}
+
+/**
+   @brief Get trigger name for logs
+   @param PreEventTrigger_enum - trigger source
+   @return String - name
+*/
+String PreEventRing::GetTriggerName(PreEventTrigger_enum i_trigger) {
+  String ret = "";
+
+  switch (i_trigger) {
+    case PreEventTrigger_Http:
+      ret = F("web request");
+      break;
+    case PreEventTrigger_Gpio:
+      ret = F("GPIO");
+      break;
+    case PreEventTrigger_Motion:
+      ret = F("scene change");
+      break;
+    default:
+      ret = F("none");
+      break;
+  }
+
+  return ret;
+}
+
+/* EOF */
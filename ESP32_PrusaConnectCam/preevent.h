@@ -0,0 +1,87 @@
+/**
+   @file preevent.h
+
+   @brief Library with PSRAM ring of the last frames before an event
+
+   Frames from the capture task are copied to one continuous PSRAM buffer
+   with the set frame rate. The oldest frames are overwritten. After the
+   trigger (web request, GPIO edge or scene change), the frames are saved
+   to the SD card as MJPEG AVI file.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <esp_task_wdt.h>
+
+#include "mcu_cfg.h"
+#include "log.h"
+#include "camera_frame.h"
+#include "avi_writer.h"
+
+enum PreEventTrigger_enum {
+  PreEventTrigger_None = 0,     ///< no trigger
+  PreEventTrigger_Http = 1,     ///< web request
+  PreEventTrigger_Gpio = 2,     ///< GPIO edge
+  PreEventTrigger_Motion = 3,   ///< scene change
+};
+
+struct PreEventFrame_t {
+  uint32_t Offset;              ///< position of the frame in the ring memory
+  uint32_t Len;                 ///< frame length
+  int64_t CaptureTime;          ///< capture time of the frame [us]
+  uint16_t Width;               ///< frame width
+  uint16_t Height;              ///< frame height
+};
+
+class PreEventRing {
+private:
+  uint8_t *Memory;                                ///< ring memory in PSRAM
+  uint32_t MemorySize;                            ///< size of the ring memory [bytes]
+  PreEventFrame_t Frames[PREEVENT_MAX_FRAMES];    ///< stored frames, from the oldest
+  uint16_t Head;                                  ///< index of the oldest frame
+  uint16_t Count;                                 ///< count of stored frames
+  uint32_t WritePos;                              ///< position of the next frame in the ring memory
+  uint32_t UsedBytes;                             ///< bytes used by the stored frames
+  uint32_t LastFrameTime;                         ///< time of the last stored frame [ms]
+  uint32_t DroppedFrames;                         ///< count of frames not stored, bigger than the ring or during saving
+  uint32_t DumpCount;                             ///< count of saved events
+  uint32_t LastDumpTime;                          ///< time of the last saved event [ms]
+  bool Dumping;                                   ///< frames are saved to the SD card, the ring is not changed
+  volatile PreEventTrigger_enum PendingTrigger;   ///< trigger waiting for the photo task
+  SemaphoreHandle_t Mutex;                        ///< mutex for the ring
+  AviWriter Writer;                               ///< AVI writer for the saved event
+
+  Logs *log;                                      ///< pointer to Logs object
+
+  void Evict();
+  bool OpenDumpFile(String, uint16_t, uint16_t);
+  void Dump(PreEventTrigger_enum);
+
+public:
+  PreEventRing(Logs *);
+  ~PreEventRing(){};
+
+  void Init(uint16_t, uint16_t);
+  bool CheckFrameDue();
+  void AddFrame(const CameraFrameView_t *, uint16_t, uint16_t, int64_t);
+  void Trigger(PreEventTrigger_enum);
+  void Process();
+
+  uint16_t GetFrameCount();
+  uint32_t GetUsedBytes();
+  uint32_t GetMemorySize();
+  uint32_t GetDuration();
+  uint32_t GetDroppedFrames();
+  uint32_t GetDumpCount();
+  String GetTriggerName(PreEventTrigger_enum);
+};
+
+extern PreEventRing SystemPreEvent;  ///< pre-event ring object
+
+/* EOF */
@@ -0,0 +1,529 @@
+/**
+   @file snapshot_sink.cpp
+
+   @brief Library with the targets of the captured photos
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "snapshot_sink.h"
+#include "connect.h"
+#include "cfg.h"
+#include "mqtt.h"
+#include "system.h"
+
+ConnectSnapshotSink SinkConnect(&Connect, &SystemCamera, &SystemLog);
+HttpSnapshotSink SinkHttp(&SystemConfig, &SystemCamera, &SystemLog);
+#if (true == ENABLE_SD_CARD)
+SdCardSnapshotSink SinkSdCard(&Connect, &SystemCamera, &SystemLog);
+#endif
+
+static SnapshotSink *SnapshotSinks[] = {
+  &SinkConnect,
+  &SinkHttp,
+  &SinkMqtt,
+#if (true == ENABLE_SD_CARD)
+  &SinkSdCard,
+#endif
+};
+
+/**
+   @brief Constructor for SnapshotSink class
+   @param const char * - sink name
+   @param Camera * - pointer to Camera object
+   @param Logs * - pointer to Logs object
+   @param uint8_t - queue length
+   @param uint32_t - delivery timeout [ms]
+   @return none
+*/
+SnapshotSink::SnapshotSink(const char *i_name, Camera *i_camera, Logs *i_log, uint8_t i_queue_length, uint32_t i_timeout) {
+  Name = i_name;
+  camera = i_camera;
+  log = i_log;
+  QueueLength = i_queue_length;
+  Timeout = i_timeout;
+  SubscriberId = -1;
+  Queue = NULL;
+  StatsLock = portMUX_INITIALIZER_UNLOCKED;
+  Task = NULL;
+  TaskStack = 0;
+  TaskStarted = false;
+  memset(&Stats, 0, sizeof(Stats));
+}
+
+/**
+   @brief Init the sink. Subscribe to the photo channel of the camera and create the queue
+   @param none
+   @return none
+*/
+void SnapshotSink::Init() {
+  log->AddEvent(LogLevel_Info, F("Init snapshot sink: "), String(Name) + ", queue: " + String(QueueLength) + ", timeout: " + String(Timeout) + " ms");
+  Queue = xQueueCreate(QueueLength, sizeof(CameraFrame_t *));
+  SubscriberId = camera->Subscribe(CameraChannel_Photo, Name);
+}
+
+/**
+   @brief Create the task of the optional sink, when the sink is enabled. Called by setup and after the configuration is changed.
+          The task is not deleted after the sink is disabled, it only waits for the photos
+   @param none
+   @return none
+*/
+void SnapshotSink::StartTask() {
+  if ((0 == TaskStack) || (NULL == Queue) || (false == GetTaskRequired())) {
+    return;
+  }
+
+  /* setup and the web server can start the task at the same time */
+  portENTER_CRITICAL(&StatsLock);
+  bool start = (false == TaskStarted);
+  TaskStarted = true;
+  portEXIT_CRITICAL(&StatsLock);
+  if (false == start) {
+    return;
+  }
+
+  log->AddEvent(LogLevel_Info, F("Start snapshot sink task: "), String(Name) + ", stack: " + String(TaskStack) + " B");
+  xTaskCreatePinnedToCore(System_TaskSnapshotSink, Name, TaskStack, this, 2, &Task, 0); /*function, description, stack size, parameters, priority, task handle, core*/
+  ESP_ERROR_CHECK(esp_task_wdt_add(Task));
+}
+
+/**
+   @brief Add the new photo to the queue. Called by the capture task after the photo is captured.
+          The capture task is never blocked, the newest photo replaces the oldest one in the full queue
+   @param none
+   @return none
+*/
+void SnapshotSink::Offer() {
+  if ((NULL == Queue) || (false == GetEnabled())) {
+    return;
+  }
+
+  /* the sink holds a reference to the shared frame, the photo is not copied */
+  CameraFrame_t *frame = camera->GetSubscriberFrame(SubscriberId, true);
+  if (NULL == frame) {
+    return;
+  }
+
+  if (pdTRUE != xQueueSend(Queue, &frame, 0)) {
+    CameraFrame_t *oldest = NULL;
+    if (pdTRUE == xQueueReceive(Queue, &oldest, 0)) {
+      camera->ReleaseFrame(oldest);
+      portENTER_CRITICAL(&StatsLock);
+      Stats.Dropped++;
+      portEXIT_CRITICAL(&StatsLock);
+      log->AddEvent(LogLevel_Warning, F("Snapshot sink is busy, oldest photo dropped: "), String(Name));
+    }
+
+    if (pdTRUE != xQueueSend(Queue, &frame, 0)) {
+      camera->ReleaseFrame(frame);
+      portENTER_CRITICAL(&StatsLock);
+      Stats.Dropped++;
+      portEXIT_CRITICAL(&StatsLock);
+      return;
+    }
+  }
+
+  portENTER_CRITICAL(&StatsLock);
+  Stats.Queued++;
+  portEXIT_CRITICAL(&StatsLock);
+}
+
+/**
+   @brief Wait for the photo in the queue and deliver it. Called by the sink task in the loop
+   @param none
+   @return none
+*/
+void SnapshotSink::Process() {
+  CameraFrame_t *frame = NULL;
+
+  if ((NULL == Queue) || (pdTRUE != xQueueReceive(Queue, &frame, TASK_SNAPSHOT_SINK_WAIT / portTICK_PERIOD_MS))) {
+    if (false == FirmwareUpdate.Processing) {
+      esp_task_wdt_reset();
+      Idle();
+    }
+    return;
+  }
+
+  /* the photo is not delivered during the firmware update */
+  if (true == FirmwareUpdate.Processing) {
+    camera->ReleaseFrame(frame);
+    portENTER_CRITICAL(&StatsLock);
+    Stats.Dropped++;
+    portEXIT_CRITICAL(&StatsLock);
+    return;
+  }
+
+  esp_task_wdt_reset();
+  uint32_t start = millis();
+  bool ret = Deliver(frame);
+  uint32_t duration = millis() - start;
+  camera->ReleaseFrame(frame);
+
+  portENTER_CRITICAL(&StatsLock);
+  if (true == ret) {
+    Stats.Delivered++;
+  } else {
+    Stats.Failed++;
+  }
+  if (duration > Timeout) {
+    Stats.Slow++;
+  }
+  Stats.LastTime = duration;
+  Stats.MaxTime = max(Stats.MaxTime, duration);
+  portEXIT_CRITICAL(&StatsLock);
+
+  log->AddEvent(LogLevel_Verbose, F("Snapshot sink "), String(Name) + ": " + String((true == ret) ? "delivered" : "failed") + ", " + String(duration) + " ms");
+}
+
+/**
+   @brief Get sink name
+   @param none
+   @return const char * - name
+*/
+const char *SnapshotSink::GetName() {
+  return Name;
+}
+
+/**
+   @brief Get delivery timeout
+   @param none
+   @return uint32_t - timeout [ms]
+*/
+uint32_t SnapshotSink::GetTimeout() {
+  return Timeout;
+}
+
+/**
+   @brief Get count of photos waiting in the queue
+   @param none
+   @return uint8_t - count of photos
+*/
+uint8_t SnapshotSink::GetQueueCount() {
+  return (NULL != Queue) ? uxQueueMessagesWaiting(Queue) : 0;
+}
+
+/**
+   @brief Get delivery statistics
+   @param SnapshotSinkStats_t * - output statistics
+   @return none
+*/
+void SnapshotSink::GetStats(SnapshotSinkStats_t *o_stats) {
+  portENTER_CRITICAL(&StatsLock);
+  *o_stats = Stats;
+  portEXIT_CRITICAL(&StatsLock);
+}
+
+/**
+   @brief Constructor for ConnectSnapshotSink class
+   @param PrusaConnect * - pointer to PrusaConnect object
+   @param Camera * - pointer to Camera object
+   @param Logs * - pointer to Logs object
+   @return none
+*/
+ConnectSnapshotSink::ConnectSnapshotSink(PrusaConnect *i_connect, Camera *i_camera, Logs *i_log)
+  : SnapshotSink("PrusaConnect", i_camera, i_log, SINK_CONNECT_QUEUE_LENGTH, SINK_CONNECT_TIMEOUT) {
+  connect = i_connect;
+}
+
+/**
+   @brief Send the device information and the photo to Prusa Connect, or to the spool
+   @param CameraFrame_t * - photo frame
+   @return bool - true = photo was sent
+*/
+bool ConnectSnapshotSink::Deliver(CameraFrame_t *i_frame) {
+  /* send network information to backend */
+  if (WL_CONNECTED == WiFi.status()) {
+    log->AddEvent(LogLevel_Verbose, F("Task send photo. Start sending info"));
+    esp_task_wdt_reset();
+    connect->SendInfoToBackend();
+  }
+
+  /* send photo to backend, or to the spool when the backend is not available */
+  log->AddEvent(LogLevel_Verbose, F("Task send photo. Start sending photo"));
+  esp_task_wdt_reset();
+  return connect->SendPhotoToBackend(i_frame);
+}
+
+/**
+   @brief Upload the spooled photos, when there is no live photo
+   @param none
+   @return none
+*/
+void ConnectSnapshotSink::Idle() {
+  connect->DrainSpool();
+}
+
+/**
+   @brief Prusa Connect sink receives all photos, without the backend they are spooled
+   @param none
+   @return bool - true = enabled
+*/
+bool ConnectSnapshotSink::GetEnabled() {
+  return true;
+}
+
+/**
+   @brief Constructor for SdCardSnapshotSink class
+   @param PrusaConnect * - pointer to PrusaConnect object
+   @param Camera * - pointer to Camera object
+   @param Logs * - pointer to Logs object
+   @return none
+*/
+SdCardSnapshotSink::SdCardSnapshotSink(PrusaConnect *i_connect, Camera *i_camera, Logs *i_log)
+  : SnapshotSink("Timelapse", i_camera, i_log, SINK_SDCARD_QUEUE_LENGTH, SINK_SDCARD_TIMEOUT) {
+  connect = i_connect;
+}
+
+/**
+   @brief Save the time laps photo to the SD card
+   @param CameraFrame_t * - photo frame
+   @return bool - true = photo was saved
+*/
+bool SdCardSnapshotSink::Deliver(CameraFrame_t *i_frame) {
+  return connect->SavePhotoToSdCard(i_frame);
+}
+
+/**
+   @brief Finalize the AVI file after the time laps is disabled
+   @param none
+   @return none
+*/
+void SdCardSnapshotSink::Idle() {
+  connect->CheckTimelapseAvi();
+}
+
+/**
+   @brief Time laps sink receives photos, when the time laps is enabled
+   @param none
+   @return bool - true = enabled
+*/
+bool SdCardSnapshotSink::GetEnabled() {
+  return connect->GetTimeLapsPhotoSaveStatus();
+}
+
+/**
+   @brief Constructor for HttpSnapshotSink class
+   @param Configuration * - pointer to Configuration object
+   @param Camera * - pointer to Camera object
+   @param Logs * - pointer to Logs object
+   @return none
+*/
+HttpSnapshotSink::HttpSnapshotSink(Configuration *i_conf, Camera *i_camera, Logs *i_log)
+  : SnapshotSink("HttpTarget", i_camera, i_log, SINK_HTTP_QUEUE_LENGTH, SINK_HTTP_TIMEOUT) {
+  config = i_conf;
+  Url = "";
+  Method = SinkHttpDisabled;
+  HttpTarget_ParseUrl(Url, &Target);
+  LastHttpCode = 0;
+  TaskStack = SINK_HTTP_STACK;
+}
+
+/**
+   @brief Load configuration from EEPROM
+   @param none
+   @return none
+*/
+void HttpSnapshotSink::LoadCfgFromEeprom() {
+  log->AddEvent(LogLevel_Info, F("Load HTTP target CFG from EEPROM"));
+  Url = config->LoadSinkHttpUrl();
+  Method = (SinkHttpMethod_enum) config->LoadSinkHttpMethod();
+  ParseUrl();
+}
+
+/**
+   @brief Split the URL to the host, port and path. Only the plain http is supported, the target is in the local network
+   @param none
+   @return bool - true = URL is valid
+*/
+bool HttpSnapshotSink::ParseUrl() {
+  bool ret = HttpTarget_ParseUrl(Url, &Target);
+
+  if ((false == ret) && (Url.length() > 0)) {
+    log->AddEvent(LogLevel_Warning, F("HTTP target URL is not valid, use http://host[:port][/path] : "), Url);
+  }
+
+  return ret;
+}
+
+/**
+   @brief Send the photo to the local HTTP target. The connection is closed after each photo
+   @param CameraFrame_t * - photo frame
+   @return bool - true = target answered with 2xx
+*/
+bool HttpSnapshotSink::Deliver(CameraFrame_t *i_frame) {
+  LastHttpCode = 0;
+  if (WL_CONNECTED != WiFi.status()) {
+    return false;
+  }
+
+  CameraFrameView_t view;
+  CameraFrame_GetView(i_frame, &view);
+  uint32_t start = millis();
+
+  WiFiClient client;
+  if (!client.connect(Target.Host.c_str(), Target.Port, Timeout)) {
+    log->AddEvent(LogLevel_Warning, F("HTTP target connection failed: "), Target.Host + ":" + String(Target.Port));
+    return false;
+  }
+
+  client.print(HttpTarget_GetRequestHeader((SinkHttpPut == Method), &Target, view.Len));
+
+  /* the segments are sent from the shared frame, the photo is not copied */
+  size_t sent = 0;
+  for (uint8_t seg = 0; seg < view.Count; seg++) {
+    for (size_t i = 0; (i < view.Segment[seg].len) && ((millis() - start) < Timeout); i += PHOTO_FRAGMENT_SIZE) {
+      sent += client.write(view.Segment[seg].ptr + i, min((size_t) PHOTO_FRAGMENT_SIZE, view.Segment[seg].len - i));
+    }
+  }
+  client.flush();
+
+  if (sent != view.Len) {
+    log->AddEvent(LogLevel_Warning, F("HTTP target incomplete data: "), String(sent) + "/" + String(view.Len) + " bytes");
+    client.stop();
+    return false;
+  }
+
+  /* the rest of the timeout is used for the response */
+  HttpResponseParser parser;
+  while ((false == parser.IsDone()) && (false == parser.IsError())) {
+    int available = client.available();
+    if (available > 0) {
+      uint8_t buf[128];
+      int len = client.read(buf, min(available, (int) sizeof(buf)));
+      if (len <= 0) {
+        parser.Finish();
+        break;
+      }
+      parser.Parse(buf, len);
+
+    } else if (false == client.connected()) {
+      parser.Finish();
+
+    } else if ((millis() - start) > Timeout) {
+      log->AddEvent(LogLevel_Warning, F("HTTP target response timeout"));
+      break;
+
+    } else {
+      delay(1);
+    }
+  }
+  client.stop();
+
+  LastHttpCode = parser.GetStatusCode();
+  log->AddEvent(LogLevel_Info, F("Photo sent to HTTP target. Response: "), String(LastHttpCode) + ", " + String(millis() - start) + " ms");
+
+  return ((LastHttpCode >= 200) && (LastHttpCode < 300));
+}
+
+/**
+   @brief Set URL of the local target and save it to EEPROM
+   @param String - URL
+   @return none
+*/
+void HttpSnapshotSink::SetUrl(String i_data) {
+  Url = i_data;
+  config->SaveSinkHttpUrl(Url);
+  ParseUrl();
+  StartTask();
+}
+
+/**
+   @brief Set HTTP method of the local target and save it to EEPROM
+   @param SinkHttpMethod_enum - method, or disabled
+   @return none
+*/
+void HttpSnapshotSink::SetMethod(SinkHttpMethod_enum i_data) {
+  Method = i_data;
+  config->SaveSinkHttpMethod((uint8_t) Method);
+  StartTask();
+}
+
+/**
+   @brief Local target receives photos, when the method and valid URL are set
+   @param none
+   @return bool - true = enabled
+*/
+bool HttpSnapshotSink::GetEnabled() {
+  return ((SinkHttpDisabled != Method) && (Target.Host.length() > 0));
+}
+
+/**
+   @brief The task of the local target is created, when the target is enabled
+   @param none
+   @return bool - true = task is required
+*/
+bool HttpSnapshotSink::GetTaskRequired() {
+  return GetEnabled();
+}
+
+/**
+   @brief Get URL of the local target
+   @param none
+   @return String - URL
+*/
+String HttpSnapshotSink::GetUrl() {
+  return Url;
+}
+
+/**
+   @brief Get HTTP method of the local target
+   @param none
+   @return SinkHttpMethod_enum - method
+*/
+SinkHttpMethod_enum HttpSnapshotSink::GetMethod() {
+  return Method;
+}
+
+/**
+   @brief Get http code of the last delivery to the local target
+   @param none
+   @return int16_t - http code, 0 = no response
+*/
+int16_t HttpSnapshotSink::GetLastHttpCode() {
+  return LastHttpCode;
+}
+
+/**
+   @brief Init all sinks
+   @param none
+   @return none
+*/
+void SnapshotSink_InitAll() {
+  for (uint8_t i = 0; i < SnapshotSink_GetCount(); i++) {
+    SnapshotSinks[i]->Init();
+  }
+}
+
+/**
+   @brief Pass the captured photo to all enabled sinks
+   @param none
+   @return none
+*/
+void SnapshotSink_OfferAll() {
+  for (uint8_t i = 0; i < SnapshotSink_GetCount(); i++) {
+    SnapshotSinks[i]->Offer();
+  }
+}
+
+/**
+   @brief Get count of sinks
+   @param none
+   @return uint8_t - count of sinks
+*/
+uint8_t SnapshotSink_GetCount() {
+  return sizeof(SnapshotSinks) / sizeof(SnapshotSinks[0]);
+}
+
+/**
+   @brief Get sink
+   @param uint8_t - sink index
+   @return SnapshotSink * - sink, NULL for invalid index
+*/
+SnapshotSink *SnapshotSink_Get(uint8_t i_index) {
+  return (i_index < SnapshotSink_GetCount()) ? SnapshotSinks[i_index] : NULL;
+}
+
+/* EOF */
@@ -0,0 +1,152 @@
+/**
+   @file snapshot_sink.h
+
+   @brief Library with the targets of the captured photos
+
+   One captured photo is delivered to several sinks: Prusa Connect, the
+   local HTTP target (NVR, Home Assistant webhook) and the time laps on the
+   SD card. Each sink holds a reference to the same camera frame, the photo
+   is not captured or copied again. Each sink has its own queue, task,
+   timeout and statistics, so the slow sink does not delay the others.
+   The newest photo replaces the oldest one in the full queue. The task of
+   the optional sink (local HTTP target, MQTT) is created after the sink is
+   enabled, so the disabled sink does not allocate the task stack.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <esp_task_wdt.h>
+
+#include "mcu_cfg.h"
+#include "var.h"
+#include "log.h"
+#include "camera.h"
+#include "camera_frame.h"
+#include "http_response.h"
+#include "http_target.h"
+
+class Configuration;
+class Camera;
+class PrusaConnect;
+
+enum SinkHttpMethod_enum {
+  SinkHttpDisabled = 0,             ///< photos are not sent to the local target
+  SinkHttpPost = 1,                 ///< photo is sent by HTTP POST
+  SinkHttpPut = 2,                  ///< photo is sent by HTTP PUT
+};
+
+struct SnapshotSinkStats_t {
+  uint32_t Queued;                  ///< count of photos added to the queue
+  uint32_t Delivered;               ///< count of successfully delivered photos
+  uint32_t Failed;                  ///< count of photos, which were not delivered
+  uint32_t Dropped;                 ///< count of photos replaced in the full queue, or dropped during the firmware update
+  uint32_t Slow;                    ///< count of deliveries longer than the sink timeout
+  uint32_t LastTime;                ///< duration of the last delivery [ms]
+  uint32_t MaxTime;                 ///< maximum duration of the delivery [ms]
+};
+
+class SnapshotSink {
+protected:
+  const char *Name;                 ///< sink name for logs, camera subscriber and web API
+  int8_t SubscriberId;              ///< camera subscriber id
+  QueueHandle_t Queue;              ///< photos waiting for the delivery. Each queued photo holds one frame reference
+  uint8_t QueueLength;              ///< maximum count of the queued photos
+  uint32_t Timeout;                 ///< delivery timeout [ms]
+  SnapshotSinkStats_t Stats;        ///< delivery statistics
+  portMUX_TYPE StatsLock;           ///< statistics are read by the web server, also guards the task start
+  TaskHandle_t Task;                ///< task of the optional sink, NULL = not started
+  uint32_t TaskStack;               ///< stack size of the optional sink task, 0 = the task is created by setup [bytes]
+  bool TaskStarted;                 ///< task of the optional sink was created
+
+  Camera *camera;                   ///< pointer to Camera object
+  Logs *log;                        ///< pointer to Logs object
+
+  virtual bool Deliver(CameraFrame_t *) = 0;
+  virtual void Idle(){};
+  virtual bool GetTaskRequired() { return true; }
+
+public:
+  SnapshotSink(const char *, Camera *, Logs *, uint8_t, uint32_t);
+  virtual ~SnapshotSink(){};
+
+  void Init();
+  void StartTask();
+  void Offer();
+  void Process();
+  virtual bool GetEnabled() = 0;
+
+  const char *GetName();
+  uint32_t GetTimeout();
+  uint8_t GetQueueCount();
+  void GetStats(SnapshotSinkStats_t *);
+};
+
+class ConnectSnapshotSink : public SnapshotSink {
+private:
+  PrusaConnect *connect;            ///< pointer to PrusaConnect object
+
+  bool Deliver(CameraFrame_t *);
+  void Idle();
+
+public:
+  ConnectSnapshotSink(PrusaConnect *, Camera *, Logs *);
+  bool GetEnabled();
+};
+
+class SdCardSnapshotSink : public SnapshotSink {
+private:
+  PrusaConnect *connect;            ///< pointer to PrusaConnect object
+
+  bool Deliver(CameraFrame_t *);
+  void Idle();
+
+public:
+  SdCardSnapshotSink(PrusaConnect *, Camera *, Logs *);
+  bool GetEnabled();
+};
+
+class HttpSnapshotSink : public SnapshotSink {
+private:
+  String Url;                       ///< URL of the local target, only http://
+  SinkHttpMethod_enum Method;       ///< HTTP method, or disabled
+  HttpTargetUrl_t Target;           ///< host, port and path from the URL
+  int16_t LastHttpCode;             ///< http code of the last delivery, 0 = no response
+
+  Configuration *config;            ///< pointer to Configuration object
+
+  bool Deliver(CameraFrame_t *);
+  bool ParseUrl();
+  bool GetTaskRequired();
+
+public:
+  HttpSnapshotSink(Configuration *, Camera *, Logs *);
+
+  void LoadCfgFromEeprom();
+  void SetUrl(String);
+  void SetMethod(SinkHttpMethod_enum);
+
+  bool GetEnabled();
+  String GetUrl();
+  SinkHttpMethod_enum GetMethod();
+  int16_t GetLastHttpCode();
+};
+
+extern ConnectSnapshotSink SinkConnect;   ///< Prusa Connect sink
+extern HttpSnapshotSink SinkHttp;         ///< local HTTP target sink
+#if (true == ENABLE_SD_CARD)
+extern SdCardSnapshotSink SinkSdCard;     ///< time laps sink
+#endif
+
+void SnapshotSink_InitAll();
+void SnapshotSink_OfferAll();
+uint8_t SnapshotSink_GetCount();
+SnapshotSink *SnapshotSink_Get(uint8_t);
+
+/* EOF */
@@ -0,0 +1,297 @@
+/**
+   @file spool.cpp
+
+   @brief Library with SD card queue of the photos, which were not uploaded to backend
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "spool.h"
+
+UploadSpool SystemSpool(&SystemLog);
+
+/**
+   @brief Constructor for UploadSpool class
+   @param Logs* - pointer to Logs object
+   @return none
+*/
+UploadSpool::UploadSpool(Logs *i_log) {
+  log = i_log;
+  Scanned = false;
+  Head = 0;
+  Tail = 0;
+  Count = 0;
+  Bytes = 0;
+  HeadSize = 0;
+  Spooled = 0;
+  Drained = 0;
+  Dropped = 0;
+  DrainWindowStart = 0;
+  DrainWindowCount = 0;
+  DrainRate = 0;
+}
+
+/**
+   @brief Find the queue on the SD card after boot. The unfinished temporary file is removed
+   @param none
+   @return bool - true = queue is ready
+*/
+bool UploadSpool::CheckScan() {
+  if (true == Scanned) {
+    return true;
+  }
+
+  if (false == log->GetCardDetectedStatus()) {
+    return false;
+  }
+
+  if (false == log->CheckDir(SD_MMC, SPOOL_FOLDER)) {
+    log->CreateDir(SD_MMC, SPOOL_FOLDER);
+  }
+
+  File dir = SD_MMC.open(SPOOL_FOLDER);
+  if ((!dir) || (!dir.isDirectory())) {
+    return false;
+  }
+
+  uint32_t first = UINT32_MAX;
+  uint32_t last = 0;
+  File file = dir.openNextFile();
+  while (file) {
+    String name = String(file.name());
+    uint32_t size = file.size();
+    file.close();
+
+    if (true == name.endsWith(SPOOL_SUFFIX)) {
+      uint32_t sequence = strtoul(name.c_str(), NULL, 10);
+      first = min(first, sequence);
+      last = max(last, sequence);
+      Count++;
+      Bytes += size;
+    } else if (name == SPOOL_TMP_NAME) {
+      SD_MMC.remove(String(SPOOL_FOLDER) + "/" + name);
+    }
+    file = dir.openNextFile();
+  }
+  dir.close();
+
+  Head = (Count > 0) ? first : 0;
+  Tail = (Count > 0) ? (last + 1) : 0;
+  Scanned = true;
+
+  if (Count > 0) {
+    log->AddEvent(LogLevel_Info, F("Upload spool: "), String(Count) + " photos, " + String(Bytes) + " B");
+  }
+
+  return true;
+}
+
+/**
+   @brief Get file path of the photo in the queue
+   @param uint32_t - sequence number
+   @return String - file path
+*/
+String UploadSpool::GetPath(uint32_t i_sequence) {
+  char name[16];
+  snprintf(name, sizeof(name), "%08lu", (unsigned long) i_sequence);
+  return String(SPOOL_FOLDER) + "/" + String(name) + SPOOL_SUFFIX;
+}
+
+/**
+   @brief Append the photo to the queue
+   @param const CameraFrame_t* - photo frame, held by the caller
+   @return bool - true = photo is in the queue
+*/
+bool UploadSpool::Add(const CameraFrame_t *i_frame) {
+  CameraFrameView_t view;
+  CameraFrame_GetView(i_frame, &view);
+
+  if ((0 == view.Len) || (false == CheckScan())) {
+    Dropped++;
+    return false;
+  }
+
+  if ((Count >= SPOOL_MAX_COUNT) || ((Bytes + SPOOL_HEADER_SIZE + view.Len) > SPOOL_MAX_SIZE)) {
+    log->AddEvent(LogLevel_Warning, F("Upload spool is full. Photo dropped"));
+    Dropped++;
+    return false;
+  }
+
+  /* the capture time is converted from the esp_timer time to the unix time */
+  uint32_t age = (uint32_t)((esp_timer_get_time() - i_frame->CaptureTime) / 1000000);
+  uint32_t header[SPOOL_HEADER_SIZE / sizeof(uint32_t)] = { SPOOL_MAGIC, Tail, (uint32_t) time(NULL) - age, view.Len };
+
+  String TmpPath = String(SPOOL_FOLDER) + "/" + SPOOL_TMP_NAME;
+  File file = SD_MMC.open(TmpPath, FILE_WRITE);
+  if (!file) {
+    log->AddEvent(LogLevel_Error, F("Upload spool: error creating file"));
+    Dropped++;
+    return false;
+  }
+
+  size_t written = file.write((const uint8_t *) header, sizeof(header));
+  for (uint8_t i = 0; i < view.Count; i++) {
+    written += file.write(view.Segment[i].ptr, view.Segment[i].len);
+  }
+  file.close();
+
+  /* the photo is in the queue after the rename */
+  if ((written != (SPOOL_HEADER_SIZE + view.Len)) || (false == SD_MMC.rename(TmpPath, GetPath(Tail)))) {
+    log->AddEvent(LogLevel_Error, F("Upload spool: error writing file"));
+    SD_MMC.remove(TmpPath);
+    Dropped++;
+    return false;
+  }
+
+  if (0 == Count) {
+    Head = Tail;
+  }
+  Tail++;
+  Count++;
+  Spooled++;
+  Bytes += written;
+  log->AddEvent(LogLevel_Info, F("Photo added to upload spool. Photos: "), String(Count));
+
+  return true;
+}
+
+/**
+   @brief Open the oldest photo in the queue. The damaged files are removed
+   @param File* - output file, positioned after the header
+   @param SpoolRecord_t* - output photo information
+   @return bool - true = photo is opened
+*/
+bool UploadSpool::OpenHead(File *o_file, SpoolRecord_t *o_record) {
+  if (false == CheckScan()) {
+    return false;
+  }
+
+  while (Head < Tail) {
+    String path = GetPath(Head);
+    HeadSize = 0;
+    if (true == SD_MMC.exists(path)) {
+      *o_file = SD_MMC.open(path, FILE_READ);
+      if (*o_file) {
+        uint32_t header[SPOOL_HEADER_SIZE / sizeof(uint32_t)] = { 0 };
+        HeadSize = o_file->size();
+        o_file->read((uint8_t *) header, sizeof(header));
+
+        if ((SPOOL_MAGIC == header[0]) && ((header[3] + SPOOL_HEADER_SIZE) == HeadSize)) {
+          o_record->Sequence = header[1];
+          o_record->CaptureTime = header[2];
+          o_record->Length = header[3];
+          return true;
+        }
+        o_file->close();
+      }
+
+      log->AddEvent(LogLevel_Warning, F("Upload spool: damaged file removed: "), path);
+      RemoveHead(false);
+      continue;
+    }
+
+    /* the file was removed outside of the spool */
+    Head++;
+  }
+
+  Count = 0;
+  Bytes = 0;
+
+  return false;
+}
+
+/**
+   @brief Remove the oldest photo from the queue
+   @param bool - true = photo was uploaded, false = photo was rejected or damaged
+   @return none
+*/
+void UploadSpool::RemoveHead(bool i_uploaded) {
+  SD_MMC.remove(GetPath(Head));
+  Head++;
+  Count = (Count > 0) ? (Count - 1) : 0;
+  Bytes = (Bytes > HeadSize) ? (Bytes - HeadSize) : 0;
+  HeadSize = 0;
+
+  if (true == i_uploaded) {
+    Drained++;
+    UpdateDrainRate();
+    DrainWindowCount++;
+  } else {
+    Dropped++;
+  }
+}
+
+/**
+   @brief Close the drain rate window after one minute
+   @param none
+   @return none
+*/
+void UploadSpool::UpdateDrainRate() {
+  uint32_t elapsed = millis() - DrainWindowStart;
+  if (elapsed >= 60000) {
+    /* the window without uploads is longer */
+    DrainRate = (elapsed < 120000) ? (uint16_t)((DrainWindowCount * 60000UL) / elapsed) : 0;
+    DrainWindowStart = millis();
+    DrainWindowCount = 0;
+  }
+}
+
+/**
+   @brief Get count of photos in the queue
+   @param none
+   @return uint16_t - count of photos
+*/
+uint16_t UploadSpool::GetCount() {
+  return Count;
+}
+
+/**
+   @brief Get size of photos in the queue
+   @param none
+   @return uint32_t - size [bytes]
+*/
+uint32_t UploadSpool::GetBytes() {
+  return Bytes;
+}
+
+/**
+   @brief Get count of photos added to the queue
+   @param none
+   @return uint32_t - count of photos
+*/
+uint32_t UploadSpool::GetSpooled() {
+  return Spooled;
+}
+
+/**
+   @brief Get count of photos uploaded from the queue
+   @param none
+   @return uint32_t - count of photos
+*/
+uint32_t UploadSpool::GetDrained() {
+  return Drained;
+}
+
+/**
+   @brief Get count of photos not added to the queue, or rejected by backend
+   @param none
+   @return uint32_t - count of photos
+*/
+uint32_t UploadSpool::GetDropped() {
+  return Dropped;
+}
+
+/**
+   @brief Get drain rate of the queue
+   @param none
+   @return uint16_t - uploaded photos in the last minute [photos/min]
+*/
+uint16_t UploadSpool::GetDrainRate() {
+  UpdateDrainRate();
+  return DrainRate;
+}
+
+/* EOF */
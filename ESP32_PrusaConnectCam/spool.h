@@ -0,0 +1,77 @@
+/**
+   @file spool.h
+
+   @brief Library with SD card queue of the photos, which were not uploaded to backend
+
+   Each photo is appended to the queue as one file with increasing sequence
+   number. The file starts with a header with the capture time, the photo
+   with the EXIF header follows. The file is written under a temporary
+   name and renamed after it is complete, so the power loss does not leave
+   a partial photo in the queue. The photos are uploaded from the oldest.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+#include <SD_MMC.h>
+#include "esp_timer.h"
+
+#include "mcu_cfg.h"
+#include "log.h"
+#include "camera_frame.h"
+
+#define SPOOL_HEADER_SIZE   16            ///< magic, sequence, capture time, photo length
+#define SPOOL_MAGIC         0x314C5053    ///< "SPL1"
+
+struct SpoolRecord_t {
+  uint32_t Sequence;                ///< sequence number in the queue
+  uint32_t CaptureTime;             ///< capture time, unix time [s]
+  uint32_t Length;                  ///< photo length [bytes]
+};
+
+class UploadSpool {
+private:
+  bool Scanned;                     ///< queue on the SD card was scanned after boot
+  uint32_t Head;                    ///< sequence number of the oldest photo
+  uint32_t Tail;                    ///< sequence number of the next photo
+  uint16_t Count;                   ///< count of photos in the queue
+  uint32_t Bytes;                   ///< size of photos in the queue [bytes]
+  uint32_t HeadSize;                ///< file size of the opened oldest photo [bytes]
+  uint32_t Spooled;                 ///< count of photos added to the queue
+  uint32_t Drained;                 ///< count of photos uploaded from the queue
+  uint32_t Dropped;                 ///< count of photos not added, or rejected by backend
+  uint32_t DrainWindowStart;        ///< start of the drain rate window [ms]
+  uint16_t DrainWindowCount;        ///< count of uploaded photos in the window
+  uint16_t DrainRate;               ///< uploaded photos in the last window [photos/min]
+
+  Logs *log;                        ///< pointer to Logs object
+
+  bool CheckScan();
+  String GetPath(uint32_t);
+  void UpdateDrainRate();
+
+public:
+  UploadSpool(Logs *);
+  ~UploadSpool(){};
+
+  bool Add(const CameraFrame_t *);
+  bool OpenHead(File *, SpoolRecord_t *);
+  void RemoveHead(bool);
+
+  uint16_t GetCount();
+  uint32_t GetBytes();
+  uint32_t GetSpooled();
+  uint32_t GetDrained();
+  uint32_t GetDropped();
+  uint16_t GetDrainRate();
+};
+
+extern UploadSpool SystemSpool;     ///< upload spool object
+
+/* EOF */
@@ -0,0 +1,42 @@
+/**
+   @file stream_part.cpp
+
+   @brief Part header of the MJPEG stream
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "stream_part.h"
+
+static const char STREAM_BOUNDARY[] = "\r\n--" PART_BOUNDARY "\r\n";                           ///< boundary for stream
+static const char STREAM_PART[] = "Content-Type: image/jpeg\r\nContent-Length: ";              ///< part header template, frame length follows
+static const char STREAM_PART_END[] = "\r\n\r\n";                                               ///< end of part header
+
+/**
+   @brief Build part header for the frame from the templates. Boundary is sent before every frame except the first one
+   @param char * - output buffer, STREAM_PART_HEADER_SIZE bytes
+   @param bool - true = send boundary before the part header
+   @param size_t - frame length
+   @return size_t - part header length
+*/
+size_t StreamPart_PrepareHeader(char *o_buffer, bool i_boundary, size_t i_len) {
+  char *ptr = o_buffer;
+
+  if (i_boundary) {
+    memcpy(ptr, STREAM_BOUNDARY, sizeof(STREAM_BOUNDARY) - 1);
+    ptr += sizeof(STREAM_BOUNDARY) - 1;
+  }
+  memcpy(ptr, STREAM_PART, sizeof(STREAM_PART) - 1);
+  ptr += sizeof(STREAM_PART) - 1;
+  utoa(i_len, ptr, 10);
+  ptr += strlen(ptr);
+  memcpy(ptr, STREAM_PART_END, sizeof(STREAM_PART_END) - 1);
+  ptr += sizeof(STREAM_PART_END) - 1;
+
+  return ptr - o_buffer;
+}
+
+/* EOF */
@@ -0,0 +1,26 @@
+/**
+   @file stream_part.h
+
+   @brief Part header of the MJPEG stream
+
+   Every frame of the multipart stream is sent after the boundary and the part
+   header with the frame length. The header is built from the templates for
+   each frame, without the String class. The function does not use the web
+   server, so the stream fill path is tested on the host.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+#define PART_BOUNDARY             "123456789000000000000987654321"  ///< Must be unique for each stream
+#define STREAM_PART_HEADER_SIZE   128                               ///< boundary and part header of one frame
+
+size_t StreamPart_PrepareHeader(char *, bool, size_t);
+
+/* EOF */
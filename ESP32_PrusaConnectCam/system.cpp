@@ -495,7 +495,8 @@ void System_TaskMain(void *pvParameters) {
 }
 
 /**
- * @brief Function for capture and send photo task
+ * @brief Function for capture photo task. The photo is captured at the sending interval,
+ *        the upload and the saving to SD card run in their own tasks
  * 
  * @param void *pvParameters
  * @return none
@@ -506,25 +507,23 @@ void System_TaskCaptureAndSendPhoto(void *pvParameters) {
 
   while (1) {
     if (Connect.CheckSendingIntervalExpired()) {
-      Connect.SetSendingIntervalCounter(0);
-      /* send network information to backend */
-      if ((WL_CONNECTED == WiFi.status()) && (false == FirmwareUpdate.Processing)) {
-        SystemLog.AddEvent(LogLevel_Verbose, F("Task photo processing. Start sending info"));
-        esp_task_wdt_reset();
-        Connect.SendInfoToBackend();
-      }
+      Connect.StartSendingInterval();
 
-      /* send photo to backend*/
-      if ((WL_CONNECTED == WiFi.status()) && (false == FirmwareUpdate.Processing)) {
-        SystemLog.AddEvent(LogLevel_Verbose, F("Task photo processing. Start sending photo"));
+      /* capture photo for backend. The previous photo can be still uploading. Without WiFi, the photo is spooled to the SD card */
+      if (((WL_CONNECTED == WiFi.status()) || (true == Connect.GetSpoolAvailable())) && (false == FirmwareUpdate.Processing)) {
+        SystemLog.AddEvent(LogLevel_Verbose, F("Task photo processing. Start capture photo"));
         esp_task_wdt_reset();
-        Connect.TakePictureAndSendToBackend();
+        Connect.TakePictureForBackend();
       }
+    }
 
-    } else {
-      /* update counter */
-      Connect.IncreaseSendingIntervalCounter();
+#if (true == PREEVENT_ENABLE)
+    /* save the pre-event ring after the trigger */
+    if (false == FirmwareUpdate.Processing) {
+      esp_task_wdt_reset();
+      SystemPreEvent.Process();
     }
+#endif
     
     SystemLog.AddEvent(LogLevel_Verbose, F("Photo processing task. Stack free size: "), String(uxTaskGetStackHighWaterMark(NULL)) + "B");
 
@@ -536,6 +535,27 @@ void System_TaskCaptureAndSendPhoto(void *pvParameters) {
   }
 }
 
+/**
+ * @brief Function for snapshot sink task. Waiting for the photo from the capture task and delivering it
+ *        to one target: Prusa Connect, the local HTTP target or the SD card
+ * 
+ * @param void *pvParameters - pointer to SnapshotSink object
+ * @return none
+ */
+void System_TaskSnapshotSink(void *pvParameters) {
+  SnapshotSink *sink = (SnapshotSink *) pvParameters;
+  SystemLog.AddEvent(LogLevel_Info, "Task snapshot sink " + String(sink->GetName()) + ". core: " + String(xPortGetCoreID()));
+
+  while (1) {
+    /* photos captured during the delivery replace the queued photo, the idle work runs without the photo */
+    sink->Process();
+    SystemLog.AddEvent(LogLevel_Verbose, "Snapshot sink " + String(sink->GetName()) + " task. Stack free size: " + String(uxTaskGetStackHighWaterMark(NULL)) + "B");
+
+    /* reset wdg */
+    esp_task_wdt_reset();
+  }
+}
+
 /**
  * @brief Function for micro SD card check task
  * 
@@ -620,20 +640,69 @@ void System_TaskSerialCfg(void *pvParameters) {
 void System_TaskSystemTelemetry(void *pvParameters) {
   SystemLog.AddEvent(LogLevel_Info, F("SystemTelemetry task. core: "), String(xPortGetCoreID()));
   TickType_t xLastWakeTime = xTaskGetTickCount();
+  uint32_t LastStreamFrameCount = SystemCamera.GetStreamFrameCount();
+  uint32_t LastStreamSentBytes = SystemCamera.StreamGetSentBytes();
 
   while (1) {
     esp_task_wdt_reset();
     SystemLog.AddEvent(LogLevel_Verbose, F("SystemTelemetry task. Stack free size: "), String(uxTaskGetStackHighWaterMark(NULL)) + "B");
+    uint32_t StreamFrameCount = SystemCamera.GetStreamFrameCount();
+    uint32_t StreamSentBytes = SystemCamera.StreamGetSentBytes();
     if (SystemCamera.GetStreamStatus()) {
-      char buf[80] = { '\0' };
-      sprintf(buf, "Stream, average data in %dsec. FPS: %.1f, Size: %uKB", (TASK_SYSTEM_TELEMETRY / SECOND_TO_MILISECOND), SystemCamera.StreamGetFrameAverageFps(), SystemCamera.StreamGetFrameAverageSize());
+      /* camera FPS is shared by all clients, client FPS is the average of the clients */
+      char buf[120] = { '\0' };
+      float CameraFps = (float)(StreamFrameCount - LastStreamFrameCount) / (TASK_SYSTEM_TELEMETRY / SECOND_TO_MILISECOND);
+      sprintf(buf, "Stream, average data in %dsec. Clients: %u, Camera FPS: %.1f, Client FPS: %.1f, Size: %uKB", (TASK_SYSTEM_TELEMETRY / SECOND_TO_MILISECOND), SystemCamera.GetStreamClients(), CameraFps, SystemCamera.StreamGetFrameAverageFps(), SystemCamera.StreamGetFrameAverageSize());
       SystemLog.AddEvent(LogLevel_Info, buf);
+      SystemLog.AddEvent(LogLevel_Info, F("Stream throughput: "), String((StreamSentBytes - LastStreamSentBytes) / (TASK_SYSTEM_TELEMETRY / SECOND_TO_MILISECOND)) + " B/s");
       SystemCamera.StreamClearFrameData();
     }
-
+    LastStreamFrameCount = StreamFrameCount;
+    LastStreamSentBytes = StreamSentBytes;
+
+    SystemLog.AddEvent(LogLevel_Info, F("Camera frames in use: "), String(SystemCamera.GetFramesInUse()) + "/" + String(SystemCamera.GetFbCount()));
+    SystemLog.AddEvent(LogLevel_Info, F("Camera photos: "), String(SystemCamera.GetPhotoCaptureCount()) + ", stale frames discarded: " + String(SystemCamera.GetPhotoStaleDiscards()) + ", skipped without buffer: " + String(SystemCamera.GetPhotoBufferSkips()) + ", last latency: " + String(SystemCamera.GetPhotoLatency()) + " ms, truncated: " + String(SystemCamera.GetPhotoTruncatedFrames()) + ", corrupt: " + String(SystemCamera.GetPhotoCorruptFrames()) + ", stream failed: " + String(SystemCamera.GetStreamFailedCaptures()));
+    SystemLog.AddEvent(LogLevel_Info, F("Camera motion score: "), String(SystemCamera.GetMotionScore()) + " %, scene changes: " + String(SystemCamera.GetMotionChangeCount()) + ", analysis time: " + String(SystemCamera.GetMotionAnalysisTime()) + " us");
+    for (uint8_t i = 0; i < CAMERA_MAX_SUBSCRIBERS; i++) {
+      CameraSubscriber_t sub;
+      if (SystemCamera.GetSubscriberInfo(i, &sub)) {
+        String rate = "";
+        if (CameraChannel_Stream == sub.Channel) {
+          rate = ", FPS: " + String(sub.Fps, 1) + ", kbps: " + String(sub.Kbps) + ((true == sub.Congested) ? ", congested" : "");
+        }
+        SystemLog.AddEvent(LogLevel_Info, "Camera subscriber " + String(sub.Name) + ", delivered: " + String(sub.Delivered) + ", dropped: " + String(sub.Dropped) + rate);
+      }
+    }
+    for (uint8_t i = 0; i < FramePoolClass_Count; i++) {
+      FramePoolClass_t pool;
+      if (SystemFramePool.GetClassInfo(i, &pool)) {
+        SystemLog.AddEvent(LogLevel_Info, "Frame pool " + String(pool.BlockSize) + "B, used: " + String(pool.InUse) + "/" + String(pool.BlockCount) + ", max: " + String(pool.HighWater) + ", failed: " + String(pool.Failures));
+      }
+    }
+    for (uint8_t i = 0; i < SnapshotSink_GetCount(); i++) {
+      SnapshotSink *sink = SnapshotSink_Get(i);
+      SnapshotSinkStats_t stats;
+      sink->GetStats(&stats);
+      SystemLog.AddEvent(LogLevel_Info, "Snapshot sink " + String(sink->GetName()) + ", queued: " + String(stats.Queued) + ", delivered: " + String(stats.Delivered) + ", failed: " + String(stats.Failed) + ", dropped: " + String(stats.Dropped) + ", slow: " + String(stats.Slow) + ", last: " + String(stats.LastTime) + " ms, max: " + String(stats.MaxTime) + " ms");
+    }
+#if ((true == SPOOL_ENABLE) && (true == ENABLE_SD_CARD))
+    SystemLog.AddEvent(LogLevel_Info, F("Upload spool photos: "), String(SystemSpool.GetCount()) + ", size: " + String(SystemSpool.GetBytes()) + " B, spooled: " + String(SystemSpool.GetSpooled()) + ", drained: " + String(SystemSpool.GetDrained()) + ", drain rate: " + String(SystemSpool.GetDrainRate()) + "/min, dropped: " + String(SystemSpool.GetDropped()) + ", circuit: " + String(Connect.GetCircuitStateName()) + ", next attempt: " + String(Connect.GetCircuitNextAttempt()) + " s");
+#endif
+    SystemLog.AddEvent(LogLevel_Info, F("Connect TLS full handshakes: "), String(Connect.GetTlsFullHandshakes()) + ", resumed: " + String(Connect.GetTlsResumedHandshakes()) + ", reused connections: " + String(Connect.GetConnectionReuses()) + ", handshake time saved: " + String(Connect.GetTlsTimeSaved()) + " ms");
+#if (true == LATENCY_STATS_ENABLE)
+    for (uint8_t i = 0; i < LatencyStage_Count; i++) {
+      LatencySummary_t summary;
+      if (SystemLatency.GetSummary((LatencyStage_enum)i, &summary)) {
+        /* the request and the stream frame are the summary, the other stages are details */
+        LogLevel_enum level = ((LatencyStage_PhotoRequest == i) || (LatencyStage_StreamTotal == i)) ? LogLevel_Info : LogLevel_Verbose;
+        SystemLog.AddEvent(level, "Latency " + String(SystemLatency.GetStageName((LatencyStage_enum)i)) + ": n=" + String(summary.Count) + ", min/p50/p95/max: " + String(summary.Min) + "/" + String(summary.P50) + "/" + String(summary.P95) + "/" + String(summary.Max) + " us");
+      }
+    }
+#endif
     SystemLog.AddEvent(LogLevel_Info, "Free RAM: " + String(ESP.getFreeHeap()) + " B" + ", Min: " + String(ESP.getMinFreeHeap()));
     SystemLog.AddEvent(LogLevel_Info, "Free PSRAM: " + String(ESP.getFreePsram()) + " B" + ", Min: " + String(ESP.getMinFreePsram()));
     SystemLog.AddEvent(LogLevel_Info, "MCU Temperature: " + String(McuTemperature.TemperatureCelsius) + " *C");
+    SystemLog.AddEvent(LogLevel_Info, F("Log queue messages: "), String(SystemLog.GetQueued()) + ", dropped: " + String(SystemLog.GetDropped()) + ", truncated: " + String(SystemLog.GetTruncated()) + ", max used: " + String(SystemLog.GetQueueHighWater()) + "/" + String(LOGS_QUEUE_RECORDS));
 
     ExternalTemperatureSensor.ReadSensorData();
 
@@ -645,6 +714,25 @@ void System_TaskSystemTelemetry(void *pvParameters) {
   }
 }
 
+/**
+ * @brief Function for log writer task. The queued log messages are written to the console and to the SD card
+ * 
+ * @param void *pvParameters
+ * @return none
+ */
+void System_TaskLogWriter(void *pvParameters) {
+  SystemLog.AddEvent(LogLevel_Info, F("Log writer task. core: "), String(xPortGetCoreID()));
+  SystemLog.SetWriterTask();
+
+  while (1) {
+    esp_task_wdt_reset();
+    SystemLog.Flush();
+
+    /* the task is woken up earlier, when the queue is half full */
+    ulTaskNotifyTake(pdTRUE, TASK_LOG_WRITER / portTICK_PERIOD_MS);
+  }
+}
+
 /**
  * @brief Function for system led task
  * 
@@ -729,4 +817,40 @@ void System_TaskSdCardRemove(void *pvParameters) {
   }
 }
 
+/**
+ * @brief Function for camera capture task. The task owns the camera driver and publishes frames to subscribers
+ * 
+ * @param void *pvParameters
+ * @return none
+ */
+void System_TaskCameraCapture(void *pvParameters) {
+  SystemLog.AddEvent(LogLevel_Info, F("Camera capture task. core: "), String(xPortGetCoreID()));
+  TickType_t xLastWakeTime = xTaskGetTickCount();
+  SystemCamera.SetCaptureTaskStatus(true);
+
+  while (1) {
+    esp_task_wdt_reset();
+    SystemCamera.CaptureTaskProcess();
+
+    if (SystemCamera.GetStreamStatus()) {
+      /* the new stream frame is sent to the waiting clients without waiting for the async TCP poll */
+      AsyncJpegStreamResponse::ResumeStalled();
+
+      /* stream client is connected, capture frames with the configured rate */
+      vTaskDelayUntil(&xLastWakeTime, TASK_CAMERA_CAPTURE / portTICK_PERIOD_MS);
+
+    } else {
+      /* wait for photo request or stream client */
+      SystemLog.AddEvent(LogLevel_Verbose, F("Camera capture task. Stack free size: "), String(uxTaskGetStackHighWaterMark(NULL)) + "B");
+#if (true == PREEVENT_ENABLE)
+      /* the pre-event ring is filled also without stream client */
+      ulTaskNotifyTake(pdTRUE, min(TASK_CAMERA_CAPTURE_IDLE, PREEVENT_FRAME_INTERVAL) / portTICK_PERIOD_MS);
+#else
+      ulTaskNotifyTake(pdTRUE, TASK_CAMERA_CAPTURE_IDLE / portTICK_PERIOD_MS);
+#endif
+      xLastWakeTime = xTaskGetTickCount();
+    }
+  }
+}
+
 /* EOF */
\ No newline at end of file
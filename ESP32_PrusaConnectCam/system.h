@@ -65,11 +65,14 @@ String System_printMcuResetReasonSimple();
 void System_TaskWifiManagement(void *);
 void System_TaskMain(void *);
 void System_TaskCaptureAndSendPhoto(void *);
+void System_TaskSnapshotSink(void *);
 void System_TaskSdCardCheck(void *);
 void System_TaskSerialCfg(void *);
 void System_TaskSystemTelemetry(void *);
 void System_TaskSysLed(void *);
 void System_TaskWiFiWatchdog(void *);
 void System_TaskSdCardRemove(void *);
+void System_TaskCameraCapture(void *);
+void System_TaskLogWriter(void *);
 
 /* EOF */
\ No newline at end of file
@@ -0,0 +1,149 @@
+/**
+   @file thumbnail.cpp
+
+   @brief Library for the small preview of the last photo
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "thumbnail.h"
+
+Thumbnail SystemThumbnail(&SystemCamera, &SystemLog);
+
+/**
+   @brief Constructor for Thumbnail class
+   @param Camera* - pointer to Camera object
+   @param Logs* - pointer to Logs object
+   @return none
+*/
+Thumbnail::Thumbnail(Camera *i_camera, Logs *i_log) {
+  camera = i_camera;
+  log = i_log;
+  Image = NULL;
+  Jpeg = NULL;
+  JpegLen = 0;
+  JpegOverflow = false;
+  Sequence = 0;
+  GenerateTime = 0;
+  CacheHits = 0;
+  Mutex = xSemaphoreCreateMutex();
+}
+
+/**
+   @brief Write thumbnail of the last photo to the output. The thumbnail is generated once for each photo
+   @param Print* - output
+   @return bool - true = thumbnail is written
+*/
+bool Thumbnail::Write(Print *o_out) {
+  bool ret = false;
+
+  CameraFrame_t *frame = camera->GetPhotoFrame();
+  if ((false == camera->GetCameraCaptureSuccess()) || (NULL == frame) || (NULL == frame->fb)) {
+    camera->ReleaseFrame(frame);
+    return false;
+  }
+
+  xSemaphoreTake(Mutex, portMAX_DELAY);
+  if (frame->Sequence == Sequence) {
+    CacheHits++;
+    ret = true;
+  } else {
+    ret = Generate(frame);
+  }
+
+  if (true == ret) {
+    o_out->write(Jpeg, JpegLen);
+  }
+  xSemaphoreGive(Mutex);
+
+  camera->ReleaseFrame(frame);
+
+  return ret;
+}
+
+/**
+   @brief Decode the photo at 1/8 scale and encode the thumbnail. The buffers are allocated once in PSRAM
+   @param const CameraFrame_t* - photo frame
+   @return bool - true = thumbnail is generated
+*/
+bool Thumbnail::Generate(const CameraFrame_t *i_frame) {
+  uint16_t width = 0;
+  uint16_t height = 0;
+  int64_t start = esp_timer_get_time();
+
+  Sequence = 0;
+  if (NULL == Image) {
+    Image = (uint8_t *)heap_caps_malloc(THUMBNAIL_MAX_CELLS * 3, MALLOC_CAP_SPIRAM);
+  }
+  if (NULL == Jpeg) {
+    Jpeg = (uint8_t *)heap_caps_malloc(THUMBNAIL_JPEG_MAX_SIZE, MALLOC_CAP_SPIRAM);
+  }
+  if ((NULL == Image) || (NULL == Jpeg)) {
+    log->AddEvent(LogLevel_Error, F("Thumbnail: failed to allocate buffers"));
+    return false;
+  }
+
+  /* the exif header is not needed, the raw frame from the camera driver is decoded */
+  if (false == Decoder.DecodeRgb(i_frame->fb->buf, i_frame->fb->len, Image, THUMBNAIL_MAX_CELLS, &width, &height)) {
+    log->AddEvent(LogLevel_Warning, F("Thumbnail: failed to decode photo"));
+    return false;
+  }
+
+  JpegLen = 0;
+  JpegOverflow = false;
+  if ((false == fmt2jpg_cb(Image, (size_t)width * height * 3, width, height, PIXFORMAT_RGB888, THUMBNAIL_JPEG_QUALITY, JpegOutput, this)) || (true == JpegOverflow)) {
+    log->AddEvent(LogLevel_Warning, F("Thumbnail: failed to encode jpeg"));
+    return false;
+  }
+
+  Sequence = i_frame->Sequence;
+  GenerateTime = esp_timer_get_time() - start;
+  log->AddEvent(LogLevel_Verbose, F("Thumbnail: "), String(width) + "x" + String(height) + ", " + String(JpegLen) + " bytes, " + String(GenerateTime) + " us");
+
+  return true;
+}
+
+/**
+   @brief Output callback of the jpeg encoder. The encoded data are stored to the thumbnail buffer
+   @param void* - pointer to Thumbnail object
+   @param size_t - position in the output
+   @param const void* - data
+   @param size_t - data length
+   @return size_t - count of stored bytes
+*/
+size_t Thumbnail::JpegOutput(void *i_arg, size_t i_index, const void *i_data, size_t i_len) {
+  Thumbnail *thumb = (Thumbnail *)i_arg;
+
+  if ((i_index + i_len) > THUMBNAIL_JPEG_MAX_SIZE) {
+    thumb->JpegOverflow = true;
+    return 0;
+  }
+
+  memcpy(thumb->Jpeg + i_index, i_data, i_len);
+  thumb->JpegLen = i_index + i_len;
+
+  return i_len;
+}
+
+/**
+   @brief Get time of the last thumbnail generation
+   @param none
+   @return uint32_t - time [us]
+*/
+uint32_t Thumbnail::GetGenerateTime() {
+  return GenerateTime;
+}
+
+/**
+   @brief Get count of requests served from the cache
+   @param none
+   @return uint32_t - count of requests
+*/
+uint32_t Thumbnail::GetCacheHits() {
+  return CacheHits;
+}
+
+/* EOF */
@@ -0,0 +1,55 @@
+/**
+   @file thumbnail.h
+
+   @brief Library for the small preview of the last photo
+
+   The thumbnail is decoded from the DC coefficients of the last photo at
+   1/8 scale and encoded again to jpeg. The thumbnail is cached for the
+   capture sequence of the photo.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include "img_converters.h"
+
+#include "mcu_cfg.h"
+#include "log.h"
+#include "camera.h"
+#include "jpeg_dc.h"
+
+class Thumbnail {
+private:
+  JpegDcDecoder Decoder;        ///< DC decoder
+  uint8_t *Image;               ///< decoded image at 1/8 scale, RGB888
+  uint8_t *Jpeg;                ///< cached thumbnail
+  size_t JpegLen;               ///< cached thumbnail length
+  bool JpegOverflow;            ///< encoded thumbnail is bigger than the buffer
+  uint32_t Sequence;            ///< capture sequence of the cached thumbnail, 0 = no thumbnail
+  uint32_t GenerateTime;        ///< time of the last thumbnail generation [us]
+  uint32_t CacheHits;           ///< count of requests served from the cache
+  SemaphoreHandle_t Mutex;      ///< mutex for the cached thumbnail
+
+  Camera *camera;               ///< pointer to Camera object
+  Logs *log;                    ///< pointer to Logs object
+
+  bool Generate(const CameraFrame_t *);
+  static size_t JpegOutput(void *, size_t, const void *, size_t);
+
+public:
+  Thumbnail(Camera *, Logs *);
+  ~Thumbnail(){};
+
+  bool Write(Print *);
+  uint32_t GetGenerateTime();
+  uint32_t GetCacheHits();
+};
+
+extern Thumbnail SystemThumbnail;  ///< thumbnail object
+
+/* EOF */
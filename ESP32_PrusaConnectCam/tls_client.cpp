@@ -0,0 +1,119 @@
+/**
+   @file tls_client.cpp
+
+   @brief TLS client with session resumption
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include "tls_client.h"
+
+/**
+   @brief Constructor for TlsClient class
+   @param none
+   @return none
+*/
+TlsClient::TlsClient() {
+  mbedtls_ssl_session_init(&Session);
+  SessionValid = false;
+  SessionResumed = false;
+}
+
+/**
+   @brief Destructor for TlsClient class
+   @param none
+   @return none
+*/
+TlsClient::~TlsClient() {
+  mbedtls_ssl_session_free(&Session);
+}
+
+/**
+   @brief Make TLS handshake on the connection opened with setPlainStart().
+          The stored session is offered to the server, and the new session is stored after the handshake
+   @param none
+   @return bool - true = handshake done
+*/
+bool TlsClient::StartTls() {
+  SessionResumed = false;
+
+  /* the session must be set after the ssl setup and before the handshake */
+  if ((true == SessionValid) && (sslclient)) {
+    if (0 != mbedtls_ssl_set_session(&sslclient->ssl_ctx, &Session)) {
+      ClearSession();
+    }
+  }
+
+  if (0 == startTLS()) {
+    /* the server may reject the stored session on the next attempt again */
+    ClearSession();
+    return false;
+  }
+
+  SessionResumed = StoreSession();
+
+  return true;
+}
+
+/**
+   @brief Store the session of the current connection
+   @param none
+   @return bool - true = the session is the same as the stored one, the handshake was resumed
+*/
+bool TlsClient::StoreSession() {
+  bool resumed = false;
+  mbedtls_ssl_session NewSession;
+  mbedtls_ssl_session_init(&NewSession);
+
+  if (0 != mbedtls_ssl_get_session(&sslclient->ssl_ctx, &NewSession)) {
+    mbedtls_ssl_session_free(&NewSession);
+    ClearSession();
+    return false;
+  }
+
+  /* the server echoes the offered session id, when it accepts the session */
+  size_t IdLen = mbedtls_ssl_session_get_id_len(&NewSession);
+  if ((true == SessionValid) && (IdLen > 0) && (IdLen == mbedtls_ssl_session_get_id_len(&Session))) {
+    resumed = (0 == memcmp(*mbedtls_ssl_session_get_id(&NewSession), *mbedtls_ssl_session_get_id(&Session), IdLen));
+  }
+
+  mbedtls_ssl_session_free(&Session);
+  Session = NewSession;
+  SessionValid = true;
+
+  return resumed;
+}
+
+/**
+   @brief Forget the stored session, the next handshake is full
+   @param none
+   @return none
+*/
+void TlsClient::ClearSession() {
+  mbedtls_ssl_session_free(&Session);
+  mbedtls_ssl_session_init(&Session);
+  SessionValid = false;
+}
+
+/**
+   @brief Get status of the stored session
+   @param none
+   @return bool - true = session is stored
+*/
+bool TlsClient::GetSessionValid() {
+  return SessionValid;
+}
+
+/**
+   @brief Get status of the last handshake
+   @param none
+   @return bool - true = the last handshake resumed the stored session
+*/
+bool TlsClient::GetSessionResumed() {
+  return SessionResumed;
+}
+
+/* EOF */
@@ -0,0 +1,41 @@
+/**
+   @file tls_client.h
+
+   @brief TLS client with session resumption
+
+   WiFiClientSecure makes a full TLS handshake for each connection. This
+   client stores the TLS session after the handshake, and offers it to the
+   server in the next handshake. The server accepting the session (session
+   ID or session ticket) skips the certificate exchange and key agreement.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include "mbedtls/ssl.h"
+
+class TlsClient : public WiFiClientSecure {
+private:
+  mbedtls_ssl_session Session;    ///< TLS session from the last handshake
+  bool SessionValid;              ///< session is stored
+  bool SessionResumed;            ///< last handshake resumed the stored session
+
+  bool StoreSession();
+
+public:
+  TlsClient();
+  ~TlsClient();
+
+  bool StartTls();
+  void ClearSession();
+  bool GetSessionValid();
+  bool GetSessionResumed();
+};
+
+/* EOF */
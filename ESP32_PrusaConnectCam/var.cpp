@@ -16,13 +16,17 @@ struct FirmwareUpdate_struct FirmwareUpdate = { "Ready", false, 0, 0, 0, false,
 struct McuTemperature_struct McuTemperature = {0.0};
 
 TaskHandle_t Task_CapturePhotoAndSend;
+TaskHandle_t Task_SendPhoto;
+TaskHandle_t Task_SdCardWriter;
 TaskHandle_t Task_WiFiManagement;
 TaskHandle_t Task_SystemMain;
 TaskHandle_t Task_SdCardCheck;
 TaskHandle_t Task_SerialCfg;
 TaskHandle_t Task_SystemTelemetry;
 TaskHandle_t Task_SysLed;
+TaskHandle_t Task_LogWriter;
 TaskHandle_t Task_WiFiWatchdog;
+TaskHandle_t Task_CameraCapture;
 //TaskHandle_t Task_SdCardFileRemove;
 
 uint8_t StartRemoveSdCard = 0;
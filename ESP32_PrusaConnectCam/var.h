@@ -45,13 +45,17 @@ extern struct FirmwareUpdate_struct FirmwareUpdate;  ///< firmware update status
 extern struct McuTemperature_struct McuTemperature;  ///< MCU temperature
 
 extern TaskHandle_t Task_CapturePhotoAndSend;        ///< task handle for capture photo and send
+extern TaskHandle_t Task_SendPhoto;                  ///< task handle for send photo
+extern TaskHandle_t Task_SdCardWriter;               ///< task handle for saving photo to sd card
 extern TaskHandle_t Task_WiFiManagement;             ///< task handle for wifi management
 extern TaskHandle_t Task_SystemMain;                 ///< task handle for system main
 extern TaskHandle_t Task_SdCardCheck;                ///< task handle for sd card check  
 extern TaskHandle_t Task_SerialCfg;                  ///< task handle for serial configuration
 extern TaskHandle_t Task_SystemTelemetry;            ///< task handle for system telemetry
 extern TaskHandle_t Task_SysLed;                     ///< task handle for system led
+extern TaskHandle_t Task_LogWriter;                  ///< task handle for log writer
 extern TaskHandle_t Task_WiFiWatchdog;               ///< task handle for wifi watchdog
+extern TaskHandle_t Task_CameraCapture;              ///< task handle for camera capture
 //extern TaskHandle_t Task_SdCardFileRemove;           ///< task handle for remove file from sd card  
 
 extern uint8_t StartRemoveSdCard;
@@ -0,0 +1,317 @@
+/**
+   @file http_response_test.cpp
+
+   @brief Host test of the incremental HTTP response parser
+
+   Responses in the form returned by the Prusa Connect backend are parsed
+   whole, in 128 B reads like SendDataToBackend, and byte by byte.
+   With --bench the parser is timed against the previous line based
+   reading of the response, which used readStringUntil per header line.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include <cstdio>
+#include <string>
+#include <chrono>
+
+#include "http_response.h"
+
+static int Failed = 0;    ///< count of failed checks
+static int Checked = 0;   ///< count of checks
+
+#define CHECK(cond)                                                        \
+  do {                                                                     \
+    Checked++;                                                             \
+    if (!(cond)) {                                                         \
+      Failed++;                                                            \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);             \
+    }                                                                      \
+  } while (0)
+
+struct TestCase_t {
+  const char *Name;       ///< test name
+  std::string Response;   ///< raw response from the server
+  bool Close;             ///< server closes the connection after the response
+  bool Done;              ///< expected complete response
+  int16_t StatusCode;     ///< expected status code
+  bool KeepAlive;         ///< expected status of the connection
+  uint32_t RetryAfter;    ///< expected Retry-After
+  const char *Body;       ///< expected beginning of the body
+};
+
+/* bytes of the next response on the same connection, they must not be consumed */
+static const std::string NextResponse = "HTTP/1.1 204 No Content\r\n\r\n";
+
+static const TestCase_t TestCases[] = {
+  { "204 keep-alive",
+    "HTTP/1.1 204 No Content\r\n"
+    "Server: nginx\r\n"
+    "Date: Sat, 17 Oct 2026 10:12:45 GMT\r\n"
+    "Connection: keep-alive\r\n"
+    "Strict-Transport-Security: max-age=31536000; includeSubDomains\r\n"
+    "\r\n",
+    false, true, 204, true, 0, "" },
+
+  { "401 with Content-Length",
+    "HTTP/1.1 401 Unauthorized\r\n"
+    "Server: nginx\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 61\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "{\"message\":\"Unauthorized\",\"code\":\"UNAUTHORIZED\",\"status\":401}",
+    false, true, 401, true, 0, "{\"message\":\"Unauthorized\",\"code\":\"UNAUTHORIZED\",\"status\":401}" },
+
+  { "429 Retry-After, connection close",
+    "HTTP/1.1 429 Too Many Requests\r\n"
+    "Content-Type: application/json\r\n"
+    "CONTENT-LENGTH: 19\r\n"
+    "Retry-After: 30\r\n"
+    "Connection: close\r\n"
+    "\r\n"
+    "{\"code\":\"THROTTLE\"}",
+    false, true, 429, false, 30, "{\"code\":\"THROTTLE\"}" },
+
+  { "chunked",
+    "HTTP/1.1 400 Bad Request\r\n"
+    "Content-Type: application/json\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "1a\r\n"
+    "{\"message\":\"Invalid token\"\r\n"
+    "7;ext=1\r\n"
+    ",\"c\":1}\r\n"
+    "0\r\n"
+    "X-Trailer: 1\r\n"
+    "\r\n",
+    false, true, 400, true, 0, "{\"message\":\"Invalid token\",\"c\":1}" },
+
+  { "100-continue",
+    "HTTP/1.1 100 Continue\r\n"
+    "\r\n"
+    "HTTP/1.1 204 No Content\r\n"
+    "Server: nginx\r\n"
+    "\r\n",
+    false, true, 204, true, 0, "" },
+
+  { "close-delimited HTTP/1.0",
+    "HTTP/1.0 200 OK\r\n"
+    "Content-Type: text/plain\r\n"
+    "\r\n"
+    "body ends with the connection",
+    true, true, 200, false, 0, "body ends with the connection" },
+
+  { "close-delimited HTTP/1.1 without length",
+    "HTTP/1.1 502 Bad Gateway\r\n"
+    "Content-Type: text/html\r\n"
+    "\r\n"
+    "<html>502</html>",
+    true, true, 502, false, 0, "<html>502</html>" },
+
+  { "truncated body",
+    "HTTP/1.1 401 Unauthorized\r\n"
+    "Content-Length: 100\r\n"
+    "\r\n"
+    "{\"message\":",
+    true, false, 401, false, 0, "{\"message\":" },
+
+  { "malformed status line",
+    "HTTP 204\r\n"
+    "\r\n",
+    false, false, 0, false, 0, "" },
+};
+
+/**
+   @brief Parse the response in reads of the given size
+   @param HttpResponseParser& - parser
+   @param const TestCase_t& - test case
+   @param size_t - size of one read
+   @return size_t - count of consumed bytes
+*/
+static size_t ParseInReads(HttpResponseParser &parser, const TestCase_t &test, size_t step) {
+  std::string data = test.Response;
+  size_t consumed = 0;
+
+  /* a keep-alive response is followed by the next one */
+  if (false == test.Close) {
+    data += NextResponse;
+  }
+
+  parser.Reset();
+  for (size_t pos = 0; pos < data.size(); pos += step) {
+    size_t len = min(step, data.size() - pos);
+    consumed += parser.Parse((const uint8_t *)data.data() + pos, len);
+    if (parser.IsDone() || parser.IsError()) {
+      break;
+    }
+  }
+
+  if (true == test.Close) {
+    parser.Finish();
+  }
+
+  return consumed;
+}
+
+/**
+   @brief Check one test case with the given read size
+   @param const TestCase_t& - test case
+   @param size_t - size of one read
+   @return none
+*/
+static void CheckCase(const TestCase_t &test, size_t step) {
+  HttpResponseParser parser;
+  size_t consumed = ParseInReads(parser, test, step);
+
+  CHECK(parser.IsDone() == test.Done);
+  CHECK(parser.IsError() == !test.Done);
+  CHECK(parser.GetStatusCode() == test.StatusCode);
+  CHECK(parser.GetKeepAlive() == test.KeepAlive);
+  CHECK(parser.GetRetryAfter() == test.RetryAfter);
+  CHECK(0 == strcmp(parser.GetBody(), test.Body));
+
+  /* the next response on the connection stays in the client buffer */
+  if ((true == test.Done) && (false == test.Close)) {
+    CHECK(consumed == test.Response.size());
+  }
+}
+
+/**
+   @brief Run all test cases whole, in 128 B reads and byte by byte
+   @param none
+   @return none
+*/
+static void RunTests() {
+  const size_t steps[] = { SIZE_MAX, 128, 1 };
+
+  for (const TestCase_t &test : TestCases) {
+    for (size_t step : steps) {
+      int before = Failed;
+      CheckCase(test, (SIZE_MAX == step) ? test.Response.size() + NextResponse.size() : step);
+      printf("%-4s %s, read %s\n", (before == Failed) ? "ok" : "FAIL", test.Name,
+             (SIZE_MAX == step) ? "whole" : (128 == step) ? "128 B" : "byte by byte");
+    }
+  }
+
+  /* long header and body are cut, the rest of the response is still parsed */
+  HttpResponseParser parser;
+  std::string body(1000, 'x');
+  std::string data = "HTTP/1.1 200 OK\r\nX-Long: " + std::string(500, 'a') + "\r\nContent-Length: 1000\r\n\r\n" + body;
+  parser.Parse((const uint8_t *)data.data(), data.size());
+  CHECK(parser.IsDone());
+  CHECK(strlen(parser.GetBody()) == (HTTP_PARSER_BODY_SIZE - 1));
+  printf("%-4s long header and body\n", parser.IsDone() ? "ok" : "FAIL");
+}
+
+/**
+   @brief Previous reading of the response. Header lines are collected byte by byte like readStringUntil,
+          trimmed and compared in lower case. The body is skipped by Content-Length
+   @param const std::string& - response
+   @return int - status code
+*/
+static int ParseLineBased(const std::string &data) {
+  int code = 0;
+  long ContentLength = 0;
+  bool HeaderDone = false;
+  size_t pos = 0;
+
+  while ((pos < data.size()) && ((false == HeaderDone) || (ContentLength > 0))) {
+    if (false == HeaderDone) {
+      std::string line;
+      while ((pos < data.size()) && ('\n' != data[pos])) {
+        line += data[pos++];
+      }
+      pos++;
+      while ((false == line.empty()) && isspace((unsigned char)line.back())) {
+        line.pop_back();
+      }
+
+      if (line.empty()) {
+        HeaderDone = true;
+      } else if (0 == line.compare(0, 7, "HTTP/1.")) {
+        code = atoi(line.substr(9, 3).c_str());
+      } else {
+        for (char &c : line) {
+          c = tolower(c);
+        }
+        if (0 == line.compare(0, 15, "content-length:")) {
+          ContentLength = atol(line.substr(15).c_str());
+        }
+      }
+    } else {
+      size_t len = min((size_t)ContentLength, min((size_t)64, data.size() - pos));
+      pos += len;
+      ContentLength -= len;
+    }
+  }
+
+  return code;
+}
+
+/**
+   @brief Parse the response from the buffer in reads of the given size, without copy
+   @param HttpResponseParser& - parser
+   @param const std::string& - response
+   @param size_t - size of one read
+   @return int - status code
+*/
+static int ParseBuffer(HttpResponseParser &parser, const std::string &data, size_t step) {
+  parser.Reset();
+  for (size_t pos = 0; (pos < data.size()) && (false == parser.IsDone()); pos += step) {
+    parser.Parse((const uint8_t *)data.data() + pos, min(step, data.size() - pos));
+  }
+
+  return parser.GetStatusCode();
+}
+
+/**
+   @brief Time the parser and the previous line based reading. The best of several rounds is reported
+   @param none
+   @return none
+*/
+static void RunBench() {
+  const int iterations = 100000;
+  const int rounds = 5;
+  const TestCase_t *cases[] = { &TestCases[0], &TestCases[1] };
+  volatile int sink = 0;
+
+  printf("\n%-26s %14s %14s %14s\n", "response [ns]", "parser whole", "parser 128 B", "line based");
+  for (const TestCase_t *test : cases) {
+    HttpResponseParser parser;
+    double result[3] = { 1e9, 1e9, 1e9 };
+
+    for (int round = 0; round < rounds; round++) {
+      for (int mode = 0; mode < 3; mode++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+          if (2 == mode) {
+            sink += ParseLineBased(test->Response);
+          } else {
+            sink += ParseBuffer(parser, test->Response, (0 == mode) ? test->Response.size() : 128);
+          }
+        }
+        auto end = std::chrono::steady_clock::now();
+        result[mode] = min(result[mode], std::chrono::duration<double, std::nano>(end - start).count() / iterations);
+      }
+    }
+    printf("%-26s %14.0f %14.0f %14.0f\n", test->Name, result[0], result[1], result[2]);
+  }
+}
+
+int main(int argc, char **argv) {
+  RunTests();
+  printf("\n%d checks, %d failed\n", Checked, Failed);
+
+  if ((argc > 1) && (0 == strcmp(argv[1], "--bench"))) {
+    RunBench();
+  }
+
+  return (0 == Failed) ? 0 : 1;
+}
+
+/* EOF */
@@ -0,0 +1,203 @@
+/**
+   @file http_target_test.cpp
+
+   @brief Host test of the URL and request header of the local HTTP target
+
+   The URL is split with the default and the explicit port, with and without
+   the path, with the host name and the IPv4 address. URLs of other schemes
+   and with an invalid host or port are rejected. With --post or --put the
+   photo is sent to the local server like HttpSnapshotSink::Deliver, with
+   the same request header and response parser, over a host TCP socket.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include <cstdio>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <netdb.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "http_target.h"
+#include "http_response.h"
+
+static int Failed = 0;    ///< count of failed checks
+static int Checked = 0;   ///< count of checks
+
+#define CHECK(cond)                                                        \
+  do {                                                                     \
+    Checked++;                                                             \
+    if (!(cond)) {                                                         \
+      Failed++;                                                            \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);             \
+    }                                                                      \
+  } while (0)
+
+struct UrlCase_t {
+  const char *Url;        ///< URL from the web page
+  bool Valid;             ///< expected result
+  const char *Host;       ///< expected host
+  uint16_t Port;          ///< expected port
+  const char *Path;       ///< expected path
+};
+
+static const UrlCase_t UrlCases[] = {
+  { "http://nvr.local", true, "nvr.local", 80, "/" },
+  { "http://nvr.local/", true, "nvr.local", 80, "/" },
+  { "http://nvr.local/upload/cam1.jpg", true, "nvr.local", 80, "/upload/cam1.jpg" },
+  { "http://192.168.1.10:8123/api/webhook/cam?x=1", true, "192.168.1.10", 8123, "/api/webhook/cam?x=1" },
+  { "http://10.0.0.5:8080", true, "10.0.0.5", 8080, "/" },
+  { "http://10.0.0.5:65535/", true, "10.0.0.5", 65535, "/" },
+  { "https://nvr.local/upload", false, "", 80, "/" },
+  { "ftp://nvr.local/upload", false, "", 80, "/" },
+  { "nvr.local/upload", false, "", 80, "/" },
+  { "", false, "", 80, "/" },
+  { "http://", false, "", 80, "/" },
+  { "http:///upload", false, "", 80, "/" },
+  { "http://:8080/upload", false, "", 80, "/" },
+  { "http://nvr.local:0/upload", false, "", 80, "/" },
+  { "http://nvr.local:70000/upload", false, "", 80, "/" },
+  { "http://nvr.local:port/upload", false, "", 80, "/" },
+};
+
+/**
+   @brief Split all test URLs. The invalid URL leaves the empty host, so the target is disabled
+   @param none
+   @return none
+*/
+static void TestParseUrl() {
+  for (const UrlCase_t &test : UrlCases) {
+    int before = Failed;
+    HttpTargetUrl_t url;
+    url.Host = "old";
+    url.Port = 1;
+    url.Path = "/old";
+
+    CHECK(HttpTarget_ParseUrl(test.Url, &url) == test.Valid);
+    CHECK(url.Host == test.Host);
+    CHECK(url.Port == test.Port);
+    CHECK(url.Path == test.Path);
+    printf("%-4s url \"%s\"\n", (before == Failed) ? "ok" : "FAIL", test.Url);
+  }
+}
+
+/**
+   @brief Request header for POST and PUT
+   @param none
+   @return none
+*/
+static void TestRequestHeader() {
+  int before = Failed;
+  HttpTargetUrl_t url;
+  CHECK(HttpTarget_ParseUrl("http://192.168.1.10:8123/api/webhook/cam", &url));
+
+  String post = HttpTarget_GetRequestHeader(false, &url, 123456);
+  CHECK(post == "POST /api/webhook/cam HTTP/1.1\r\n"
+                "Host: 192.168.1.10:8123\r\n"
+                "User-Agent: ESP32-CAM\r\n"
+                "Content-Type: image/jpeg\r\n"
+                "Content-Length: 123456\r\n"
+                "Connection: close\r\n\r\n");
+
+  CHECK(HttpTarget_ParseUrl("http://nvr.local", &url));
+  String put = HttpTarget_GetRequestHeader(true, &url, 0);
+  CHECK(put.startsWith("PUT / HTTP/1.1\r\nHost: nvr.local:80\r\n"));
+  printf("%-4s request header, POST and PUT\n", (before == Failed) ? "ok" : "FAIL");
+}
+
+/**
+   @brief Send the photo to the local server like HttpSnapshotSink::Deliver
+   @param bool - true = PUT, false = POST
+   @param const char * - URL
+   @param const char * - jpeg file
+   @return bool - true = server answered with 2xx
+*/
+static bool SendPhoto(bool i_put, const char *i_url, const char *i_file) {
+  HttpTargetUrl_t url;
+  if (false == HttpTarget_ParseUrl(i_url, &url)) {
+    printf("invalid URL: %s\n", i_url);
+    return false;
+  }
+
+  std::ifstream in(i_file, std::ios::binary);
+  std::vector<uint8_t> photo((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  if (photo.empty()) {
+    printf("empty photo: %s\n", i_file);
+    return false;
+  }
+
+  addrinfo hints = {};
+  addrinfo *res = NULL;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  if (0 != getaddrinfo(url.Host.c_str(), std::to_string(url.Port).c_str(), &hints, &res)) {
+    printf("host not found: %s\n", url.Host.c_str());
+    return false;
+  }
+  int sock = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+  bool connected = (sock >= 0) && (0 == connect(sock, res->ai_addr, res->ai_addrlen));
+  freeaddrinfo(res);
+  if (false == connected) {
+    printf("connection failed: %s:%u\n", url.Host.c_str(), url.Port);
+    if (sock >= 0) {
+      close(sock);
+    }
+    return false;
+  }
+
+  /* header, then the photo in PHOTO_FRAGMENT_SIZE parts */
+  auto start = std::chrono::steady_clock::now();
+  String header = HttpTarget_GetRequestHeader(i_put, &url, photo.size());
+  size_t sent = 0;
+  bool ret = (send(sock, header.c_str(), header.length(), 0) == (ssize_t) header.length());
+  for (size_t i = 0; (true == ret) && (i < photo.size()); i += PHOTO_FRAGMENT_SIZE) {
+    size_t len = min((size_t) PHOTO_FRAGMENT_SIZE, photo.size() - i);
+    ret = (send(sock, photo.data() + i, len, 0) == (ssize_t) len);
+    sent += (true == ret) ? len : 0;
+  }
+
+  HttpResponseParser parser;
+  while ((true == ret) && (false == parser.IsDone()) && (false == parser.IsError())) {
+    uint8_t buf[128];
+    ssize_t len = recv(sock, buf, sizeof(buf), 0);
+    if (len <= 0) {
+      parser.Finish();
+      break;
+    }
+    parser.Parse(buf, len);
+  }
+  close(sock);
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  printf("%s %s:%u%s, %zu/%zu B, response: %d, %.1f ms, body: %s\n", (true == i_put) ? "PUT" : "POST", url.Host.c_str(), url.Port, url.Path.c_str(),
+         sent, photo.size(), parser.GetStatusCode(), ms, parser.GetBody());
+
+  return (sent == photo.size()) && (parser.GetStatusCode() >= 200) && (parser.GetStatusCode() < 300);
+}
+
+int main(int argc, char **argv) {
+  TestParseUrl();
+  TestRequestHeader();
+  printf("\n%d checks, %d failed\n", Checked, Failed);
+
+  /* --post URL FILE, --put URL FILE */
+  for (int i = 1; i < argc; i += 3) {
+    bool put = (0 == strcmp(argv[i], "--put"));
+    if (((i + 2) >= argc) || ((false == put) && (0 != strcmp(argv[i], "--post")))) {
+      printf("usage: %s [--post|--put URL FILE]...\n", argv[0]);
+      return 1;
+    }
+    CHECK(SendPhoto(put, argv[i + 1], argv[i + 2]));
+  }
+
+  return (0 == Failed) ? 0 : 1;
+}
+
+/* EOF */
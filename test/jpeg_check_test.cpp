@@ -0,0 +1,231 @@
+/**
+   @file jpeg_check_test.cpp
+
+   @brief Host test of the jpeg structure check with the jpeg files from the doc directory
+
+   Every jpeg file of the corpus is checked as it is, cut at 2/3 of the length,
+   with the EOI marker removed, with wrong expected dimensions and with a bad
+   SOF segment length. With --bench the check is timed on the corpus.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+#include "jpeg_check.h"
+
+static int Failed = 0;    ///< count of failed checks
+static int Checked = 0;   ///< count of checks
+
+#define CHECK(cond)                                                        \
+  do {                                                                     \
+    Checked++;                                                             \
+    if (!(cond)) {                                                         \
+      Failed++;                                                            \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);             \
+    }                                                                      \
+  } while (0)
+
+struct JpegFile_t {
+  std::string Name;           ///< file path
+  std::vector<uint8_t> Data;  ///< file content
+  size_t SofPos;              ///< position of the SOF segment length, 0 = not found
+  uint16_t Width;             ///< width from SOF
+  uint16_t Height;            ///< height from SOF
+  size_t EoiPos;              ///< position of the last EOI marker
+};
+
+/**
+   @brief Find the SOF segment by the segment lengths before the first SOS. Independent of the tested walker
+   @param JpegFile_t& - file
+   @return bool - true = SOF found
+*/
+static bool FindSof(JpegFile_t &file) {
+  const std::vector<uint8_t> &d = file.Data;
+  size_t pos = 2;
+
+  while ((pos + 4) < d.size()) {
+    if (0xFF != d[pos]) {
+      return false;
+    }
+    uint8_t marker = d[pos + 1];
+    if (0xFF == marker) {
+      pos++;
+      continue;
+    }
+    size_t len = (d[pos + 2] << 8) | d[pos + 3];
+    if ((marker >= 0xC0) && (marker <= 0xCF) && (0xC4 != marker) && (0xC8 != marker) && (0xCC != marker)) {
+      file.SofPos = pos + 2;
+      file.Height = (d[pos + 5] << 8) | d[pos + 6];
+      file.Width = (d[pos + 7] << 8) | d[pos + 8];
+      return true;
+    }
+    if (0xDA == marker) {
+      return false;
+    }
+    pos += 2 + len;
+  }
+
+  return false;
+}
+
+/**
+   @brief Load the jpeg files of the corpus
+   @param const char* - corpus directory
+   @return std::vector<JpegFile_t> - files
+*/
+static std::vector<JpegFile_t> LoadCorpus(const char *dir) {
+  std::vector<JpegFile_t> files;
+
+  for (const auto &entry : std::filesystem::recursive_directory_iterator(dir)) {
+    std::string ext = entry.path().extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if ((false == entry.is_regular_file()) || ((".jpg" != ext) && (".jpeg" != ext))) {
+      continue;
+    }
+
+    JpegFile_t file;
+    std::ifstream in(entry.path(), std::ios::binary);
+    file.Name = entry.path().string();
+    file.Data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    file.SofPos = 0;
+    file.Width = 0;
+    file.Height = 0;
+    file.EoiPos = 0;
+    FindSof(file);
+    for (size_t i = file.Data.size() - 1; i > 0; i--) {
+      if ((0xFF == file.Data[i - 1]) && (0xD9 == file.Data[i])) {
+        file.EoiPos = i - 1;
+        break;
+      }
+    }
+    files.push_back(file);
+  }
+
+  std::sort(files.begin(), files.end(), [](const JpegFile_t &a, const JpegFile_t &b) { return a.Name < b.Name; });
+  return files;
+}
+
+/**
+   @brief Check the data on all alignments, the entropy coded data is scanned word by word
+   @param const std::vector<uint8_t>& - data
+   @param size_t - length
+   @param uint16_t - expected width
+   @param uint16_t - expected height
+   @param JpegStatus_enum - expected status
+   @return none
+*/
+static void CheckAligned(const std::vector<uint8_t> &data, size_t len, uint16_t width, uint16_t height, JpegStatus_enum expected) {
+  std::vector<uint8_t> buf(len + 4);
+
+  for (size_t offset = 0; offset < 4; offset++) {
+    std::copy(data.begin(), data.begin() + len, buf.begin() + offset);
+    CHECK(Jpeg_Check(buf.data() + offset, len, width, height) == expected);
+  }
+}
+
+/**
+   @brief Run the checks on all corpus files
+   @param const std::vector<JpegFile_t>& - files
+   @return none
+*/
+static void RunTests(const std::vector<JpegFile_t> &files) {
+  for (const JpegFile_t &file : files) {
+    int before = Failed;
+    const std::vector<uint8_t> &d = file.Data;
+
+    CHECK(0 != file.SofPos);
+    CHECK(0 != file.EoiPos);
+
+    /* valid, with and without the expected dimensions */
+    CheckAligned(d, d.size(), 0, 0, JpegStatus_Valid);
+    CheckAligned(d, d.size(), file.Width, file.Height, JpegStatus_Valid);
+
+    /* truncated, cut at 2/3 of the file */
+    CheckAligned(d, (d.size() * 2) / 3, 0, 0, JpegStatus_Truncated);
+
+    /* missing EOI, the file ends with the entropy coded data */
+    CheckAligned(d, file.EoiPos, 0, 0, JpegStatus_Truncated);
+
+    /* wrong SOF size, other resolution than expected */
+    CHECK(Jpeg_Check(d.data(), d.size(), file.Width + 16, file.Height) == JpegStatus_Corrupt);
+    CHECK(Jpeg_Check(d.data(), d.size(), file.Width, file.Height + 16) == JpegStatus_Corrupt);
+
+    /* wrong SOF size, segment length too short for the dimensions */
+    std::vector<uint8_t> bad = d;
+    bad[file.SofPos] = 0;
+    bad[file.SofPos + 1] = 5;
+    CHECK(Jpeg_Check(bad.data(), bad.size(), 0, 0) == JpegStatus_Corrupt);
+
+    /* missing SOI */
+    bad = d;
+    bad[1] = 0x00;
+    CHECK(Jpeg_Check(bad.data(), bad.size(), 0, 0) == JpegStatus_Corrupt);
+
+    printf("%-4s %s (%ux%u, %zu B)\n", (before == Failed) ? "ok" : "FAIL", file.Name.c_str(), file.Width, file.Height, d.size());
+  }
+}
+
+/**
+   @brief Time the check on the corpus. The best of several rounds is reported
+   @param const std::vector<JpegFile_t>& - files
+   @return none
+*/
+static void RunBench(const std::vector<JpegFile_t> &files) {
+  const int rounds = 5;
+  const size_t target = 200 * 1024 * 1024;
+  volatile int sink = 0;
+
+  printf("\n%-62s %10s %10s %10s\n", "file", "size [B]", "us/frame", "MB/s");
+  for (const JpegFile_t &file : files) {
+    int iterations = max((size_t)1, target / file.Data.size());
+    double best = 1e12;
+
+    for (int round = 0; round < rounds; round++) {
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        sink += Jpeg_Check(file.Data.data(), file.Data.size(), file.Width, file.Height);
+      }
+      auto end = std::chrono::steady_clock::now();
+      best = min(best, std::chrono::duration<double, std::micro>(end - start).count() / iterations);
+    }
+    printf("%-62s %10zu %10.1f %10.0f\n", file.Name.c_str(), file.Data.size(), best, file.Data.size() / best);
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *dir = "../doc";
+  bool bench = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], "--bench")) {
+      bench = true;
+    } else {
+      dir = argv[i];
+    }
+  }
+
+  std::vector<JpegFile_t> files = LoadCorpus(dir);
+  CHECK(false == files.empty());
+
+  RunTests(files);
+  printf("\n%zu files, %d checks, %d failed\n", files.size(), Checked, Failed);
+
+  if (true == bench) {
+    RunBench(files);
+  }
+
+  return (0 == Failed) ? 0 : 1;
+}
+
+/* EOF */
@@ -0,0 +1,357 @@
+/**
+   @file mqtt_test.cpp
+
+   @brief Host test of the MQTT client packets
+
+   The client writes to the WiFiClient from the stub directory. The written
+   packets are checked byte by byte, and the broker responses are prepared
+   before each call. The remaining length is checked on the limits of the
+   variable length encoding, the CONNECT flags with all combinations of the
+   user, password and last will, the QoS 1 packet id, and the CONNACK and
+   PUBACK handling.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "mqtt_client.h"
+
+static int Failed = 0;    ///< count of failed checks
+static int Checked = 0;   ///< count of checks
+
+#define CHECK(cond)                                                        \
+  do {                                                                     \
+    Checked++;                                                             \
+    if (!(cond)) {                                                         \
+      Failed++;                                                            \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);             \
+    }                                                                      \
+  } while (0)
+
+static const std::string ConnAckAccepted = std::string("\x20\x02\x00\x00", 4);  ///< CONNACK, connection accepted
+
+/**
+   @brief Prepare the connection and the response of the broker
+   @param const std::string& - bytes from the broker
+   @return none
+*/
+static void BrokerReset(const std::string &i_rx) {
+  WiFiClient::ConnectResult = true;
+  WiFiClient::Open = false;
+  WiFiClient::Tx.clear();
+  WiFiClient::Rx = i_rx;
+  WiFiClient::RxPos = 0;
+}
+
+/**
+   @brief Decode the fixed header of the packet written by the client
+   @param const std::string& - packet
+   @param size_t* - output length of the fixed header
+   @return uint32_t - remaining length
+*/
+static uint32_t DecodeRemainingLength(const std::string &i_packet, size_t *o_header) {
+  uint32_t len = 0;
+  uint32_t multiplier = 1;
+  size_t pos = 1;
+
+  while (pos < i_packet.size()) {
+    uint8_t digit = (uint8_t) i_packet[pos++];
+    len += (digit & 0x7F) * multiplier;
+    multiplier *= 128;
+    if (0 == (digit & 0x80)) {
+      break;
+    }
+  }
+  *o_header = pos;
+
+  return len;
+}
+
+/**
+   @brief Connect the client to the broker without user and last will
+   @param MqttClient& - client
+   @return bool - true = connected
+*/
+static bool ConnectClient(MqttClient &client) {
+  BrokerReset(ConnAckAccepted);
+  bool ret = client.Connect("broker", 1883, "cam", "", "", "", "");
+  WiFiClient::Tx.clear();
+
+  return ret;
+}
+
+/**
+   @brief Remaining length on the limits of the 1, 2 and 3 byte encoding
+   @param none
+   @return none
+*/
+static void TestRemainingLength() {
+  struct {
+    uint32_t Len;               ///< remaining length
+    std::vector<uint8_t> Bytes; ///< expected encoding
+  } cases[] = {
+    { 127, { 0x7F } },
+    { 128, { 0x80, 0x01 } },
+    { 16383, { 0xFF, 0x7F } },
+    { 16384, { 0x80, 0x80, 0x01 } },
+  };
+
+  for (const auto &test : cases) {
+    int before = Failed;
+    MqttClient client;
+    CHECK(ConnectClient(client));
+
+    /* QoS 0 PUBLISH, remaining length = topic length + topic + payload */
+    std::vector<uint8_t> payload(test.Len - 2 - 1, 'x');
+    CHECK(client.Publish("t", payload.data(), payload.size(), 0, false));
+
+    const std::string &tx = WiFiClient::Tx;
+    size_t header = 0;
+    CHECK(tx.size() == 1 + test.Bytes.size() + test.Len);
+    CHECK((uint8_t) tx[0] == MqttPacketPublish);
+    CHECK(DecodeRemainingLength(tx, &header) == test.Len);
+    CHECK(header == 1 + test.Bytes.size());
+    CHECK(0 == memcmp(tx.data() + 1, test.Bytes.data(), test.Bytes.size()));
+    printf("%-4s remaining length %u\n", (before == Failed) ? "ok" : "FAIL", test.Len);
+  }
+}
+
+/**
+   @brief CONNECT flags and payload with and without the user, password and last will
+   @param none
+   @return none
+*/
+static void TestConnectFlags() {
+  struct {
+    const char *Name;   ///< test name
+    const char *User;   ///< user name
+    const char *Pass;   ///< password
+    const char *Will;   ///< topic of the last will
+    uint8_t Flags;      ///< expected connect flags
+  } cases[] = {
+    { "clean session only", "", "", "", 0x02 },
+    { "user", "user", "", "", 0x82 },
+    { "user and password", "user", "secret", "", 0xC2 },
+    { "password without user", "", "secret", "", 0x02 },
+    { "last will", "", "", "cam/status", 0x26 },
+    { "user, password and last will", "user", "secret", "cam/status", 0xE6 },
+  };
+
+  for (const auto &test : cases) {
+    int before = Failed;
+    MqttClient client;
+    BrokerReset(ConnAckAccepted);
+    CHECK(client.Connect("broker", 1883, "cam-01", test.User, test.Pass, test.Will, "offline"));
+    CHECK(client.GetConnected());
+
+    const std::string &tx = WiFiClient::Tx;
+    size_t header = 0;
+    uint32_t len = DecodeRemainingLength(tx, &header);
+    CHECK((uint8_t) tx[0] == MqttPacketConnect);
+    CHECK(tx.size() == header + len);
+
+    /* variable header: protocol name, level 4, flags, keep alive */
+    std::string var = tx.substr(header, 10);
+    CHECK(var.substr(0, 7) == std::string("\x00\x04MQTT\x04", 7));
+    CHECK((uint8_t) var[7] == test.Flags);
+    CHECK((((uint8_t) var[8] << 8) | (uint8_t) var[9]) == MQTT_KEEPALIVE);
+
+    /* payload: client id, will topic, will message, user, password */
+    std::string expected = std::string("\x00\x06", 2) + "cam-01";
+    if (test.Flags & 0x04) {
+      expected += std::string(1, '\0') + (char) strlen(test.Will) + test.Will + std::string("\x00\x07", 2) + "offline";
+    }
+    if (test.Flags & 0x80) {
+      expected += std::string(1, '\0') + (char) strlen(test.User) + test.User;
+    }
+    if (test.Flags & 0x40) {
+      expected += std::string(1, '\0') + (char) strlen(test.Pass) + test.Pass;
+    }
+    CHECK(tx.substr(header + 10) == expected);
+    printf("%-4s connect flags, %s\n", (before == Failed) ? "ok" : "FAIL", test.Name);
+  }
+}
+
+/**
+   @brief CONNACK handling. Only the accepted CONNACK connects the client
+   @param none
+   @return none
+*/
+static void TestConnAck() {
+  struct {
+    const char *Name;   ///< test name
+    std::string Rx;     ///< response of the broker
+    bool Connected;     ///< expected result
+    bool Timeout;       ///< response is incomplete, the client waits for the timeout
+  } cases[] = {
+    { "accepted", ConnAckAccepted, true, false },
+    { "accepted, session present", std::string("\x20\x02\x01\x00", 4), true, false },
+    { "refused, not authorized", std::string("\x20\x02\x00\x05", 4), false, false },
+    { "other packet", std::string("\x40\x02\x00\x00", 4), false, false },
+    { "short CONNACK", std::string("\x20\x01\x00", 3), false, false },
+    { "cut CONNACK", std::string("\x20\x02\x00", 3), false, true },
+    { "no response", "", false, true },
+  };
+
+  for (const auto &test : cases) {
+    MqttClient client;
+    BrokerReset(test.Rx);
+    uint32_t start = millis();
+    bool ret = client.Connect("broker", 1883, "cam", "", "", "", "");
+    CHECK(ret == test.Connected);
+    CHECK(client.GetConnected() == test.Connected);
+    CHECK(WiFiClient::Open == test.Connected);
+
+    /* the incomplete response ends after the timeout */
+    CHECK(((millis() - start) >= MQTT_TIMEOUT) == test.Timeout);
+    printf("%-4s connack, %s\n", (ret == test.Connected) ? "ok" : "FAIL", test.Name);
+  }
+
+  /* the connection is refused */
+  MqttClient client;
+  BrokerReset(ConnAckAccepted);
+  WiFiClient::ConnectResult = false;
+  CHECK(false == client.Connect("broker", 1883, "cam", "", "", "", ""));
+  CHECK(WiFiClient::Tx.empty());
+  printf("%-4s connack, connection refused\n", (false == client.GetConnected()) ? "ok" : "FAIL");
+}
+
+/**
+   @brief Check the QoS 1 PUBLISH packet with the packet id
+   @param const std::string& - packet
+   @param uint8_t - expected type and flags
+   @param uint16_t - expected packet id
+   @return none
+*/
+static void CheckQos1Publish(const std::string &i_packet, uint8_t i_type, uint16_t i_id) {
+  size_t header = 0;
+  uint32_t len = DecodeRemainingLength(i_packet, &header);
+
+  CHECK((uint8_t) i_packet[0] == i_type);
+  CHECK(i_packet.size() == header + len);
+  CHECK(i_packet.substr(header, 7) == std::string("\x00\x05", 2) + "cam/x");
+  CHECK((uint8_t) i_packet[header + 7] == (i_id >> 8));
+  CHECK((uint8_t) i_packet[header + 8] == (i_id & 0xFF));
+  CHECK(i_packet.substr(header + 9) == "on");
+}
+
+/**
+   @brief Get PUBACK packet
+   @param uint16_t - packet id
+   @return std::string - packet
+*/
+static std::string PubAck(uint16_t i_id) {
+  return std::string("\x40\x02", 2) + (char)(i_id >> 8) + (char)(i_id & 0xFF);
+}
+
+/**
+   @brief QoS 1 PUBLISH with the packet id, and the PUBACK matching
+   @param none
+   @return none
+*/
+static void TestPublishQos1() {
+  int before = Failed;
+  MqttClient client;
+  CHECK(ConnectClient(client));
+
+  /* the first packet id is 1, the next packets increment it */
+  WiFiClient::Rx += PubAck(1) + PubAck(2);
+  CHECK(client.Publish("cam/x", (const uint8_t *) "on", 2, 1, false));
+  CheckQos1Publish(WiFiClient::Tx, MqttPacketPublish | 0x02, 1);
+  WiFiClient::Tx.clear();
+  CHECK(client.Publish("cam/x", (const uint8_t *) "on", 2, 1, true));
+  CheckQos1Publish(WiFiClient::Tx, MqttPacketPublish | 0x02 | 0x01, 2);
+  printf("%-4s publish qos 1, packet id and retain flag\n", (before == Failed) ? "ok" : "FAIL");
+
+  /* PUBACK of the other packet and the PINGRESP are skipped */
+  before = Failed;
+  WiFiClient::Tx.clear();
+  WiFiClient::Rx += PubAck(2) + std::string("\xD0\x00", 2) + PubAck(3);
+  CHECK(client.Publish("cam/x", (const uint8_t *) "on", 2, 1, false));
+  CheckQos1Publish(WiFiClient::Tx, MqttPacketPublish | 0x02, 3);
+  CHECK(WiFiClient::RxPos == WiFiClient::Rx.size());
+  printf("%-4s publish qos 1, other packets before PUBACK\n", (before == Failed) ? "ok" : "FAIL");
+
+  /* long packet from the broker with 2 byte remaining length is skipped */
+  before = Failed;
+  WiFiClient::Tx.clear();
+  WiFiClient::Rx += std::string("\x30\xC8\x01", 3) + std::string(200, 'p') + PubAck(4);
+  CHECK(client.Publish("cam/x", (const uint8_t *) "on", 2, 1, false));
+  CHECK(WiFiClient::RxPos == WiFiClient::Rx.size());
+  printf("%-4s publish qos 1, long packet before PUBACK\n", (before == Failed) ? "ok" : "FAIL");
+
+  /* without PUBACK the connection is closed after the timeout */
+  before = Failed;
+  uint32_t start = millis();
+  CHECK(false == client.Publish("cam/x", (const uint8_t *) "on", 2, 1, false));
+  CHECK((millis() - start) >= MQTT_TIMEOUT);
+  CHECK(false == client.GetConnected());
+  CHECK(false == WiFiClient::Open);
+  CHECK(false == client.Publish("cam/x", (const uint8_t *) "on", 2, 0, false));
+  printf("%-4s publish qos 1, missing PUBACK\n", (before == Failed) ? "ok" : "FAIL");
+
+  /* packet id 0 is not allowed, the id continues with 1 after 65535 */
+  before = Failed;
+  MqttClient wrap;
+  CHECK(ConnectClient(wrap));
+  for (uint32_t id = 1; id <= 65536; id++) {
+    uint16_t expected = (id > 65535) ? 1 : id;
+    WiFiClient::Tx.clear();
+    WiFiClient::Rx += PubAck(expected);
+    if (false == wrap.Publish("cam/x", (const uint8_t *) "on", 2, 1, false)) {
+      CHECK(false);
+      break;
+    }
+    if (id >= 65535) {
+      CheckQos1Publish(WiFiClient::Tx, MqttPacketPublish | 0x02, expected);
+    }
+  }
+  printf("%-4s publish qos 1, packet id wraps to 1\n", (before == Failed) ? "ok" : "FAIL");
+}
+
+/**
+   @brief QoS 0 PUBLISH of the segmented frame and the PUBACK is not expected
+   @param none
+   @return none
+*/
+static void TestPublishFrame() {
+  int before = Failed;
+  MqttClient client;
+  CHECK(ConnectClient(client));
+
+  /* the segments are longer than PHOTO_FRAGMENT_SIZE and written in parts */
+  std::string exif(100, 'e');
+  std::string jpeg(PHOTO_FRAGMENT_SIZE * 2 + 10, 'j');
+  CameraFrameView_t view;
+  view.Segment[0] = { (const uint8_t *) exif.data(), exif.size() };
+  view.Segment[1] = { (const uint8_t *) jpeg.data(), jpeg.size() };
+  view.Count = 2;
+  view.Len = exif.size() + jpeg.size();
+
+  CHECK(client.Publish("cam/snapshot", &view, 0, false));
+  const std::string &tx = WiFiClient::Tx;
+  size_t header = 0;
+  CHECK(DecodeRemainingLength(tx, &header) == 2 + 12 + view.Len);
+  CHECK(tx.substr(header + 2 + 12) == exif + jpeg);
+  CHECK(client.GetConnected());
+  printf("%-4s publish qos 0, segmented frame\n", (before == Failed) ? "ok" : "FAIL");
+}
+
+int main() {
+  TestRemainingLength();
+  TestConnectFlags();
+  TestConnAck();
+  TestPublishQos1();
+  TestPublishFrame();
+  printf("\n%d checks, %d failed\n", Checked, Failed);
+
+  return (0 == Failed) ? 0 : 1;
+}
+
+/* EOF */
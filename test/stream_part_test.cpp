@@ -0,0 +1,332 @@
+/**
+   @file stream_part_test.cpp
+
+   @brief Host test of the stream fill path with the jpeg files from the doc directory
+
+   Every jpeg file of the corpus is published to the frame ring with the exif
+   header, like the capture task does, and sent as two stream parts in the
+   chunks of the given size, like AsyncJpegStreamResponse::_content. The sent
+   data must be the part header, the exif header and the jpeg data after the
+   original header. With --bench the part header and the copy of the segmented
+   view are timed in TCP segment sized chunks.
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+#include "stream_part.h"
+#include "camera_frame.h"
+
+#define STREAM_TEST_CHUNK   1436    ///< TCP segment size of the stream client [bytes]
+#define STREAM_TEST_EXIF    220     ///< size of the exif header from the exif library [bytes]
+
+static int Failed = 0;            ///< count of failed checks
+static int Checked = 0;           ///< count of checks
+static int ReturnedFrames = 0;    ///< count of frame buffers returned to the camera driver
+
+#define CHECK(cond)                                                        \
+  do {                                                                     \
+    Checked++;                                                             \
+    if (!(cond)) {                                                         \
+      Failed++;                                                            \
+      printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);             \
+    }                                                                      \
+  } while (0)
+
+/**
+   @brief Return the frame buffer to the camera driver
+   @param camera_fb_t* - frame buffer
+   @return none
+*/
+void esp_camera_fb_return(camera_fb_t *) {
+  ReturnedFrames++;
+}
+
+struct JpegFile_t {
+  std::string Name;           ///< file path
+  std::vector<uint8_t> Data;  ///< file content
+  size_t DataOffset;          ///< offset of the first jpeg byte after the APPn segments
+};
+
+struct StreamClient_t {
+  CameraFrameView_t View;                   ///< segmented view of the frame
+  char PartHeader[STREAM_PART_HEADER_SIZE]; ///< boundary and part header of the frame
+  size_t PartHeaderLen;                     ///< part header length
+  size_t Index;                             ///< index of part header and frame data
+};
+
+/**
+   @brief Load the jpeg files of the corpus, the jpeg data starts after the APPn segments like get_jpeg_data_offset
+   @param const char* - corpus directory
+   @return std::vector<JpegFile_t> - files
+*/
+static std::vector<JpegFile_t> LoadCorpus(const char *dir) {
+  std::vector<JpegFile_t> files;
+
+  for (const auto &entry : std::filesystem::recursive_directory_iterator(dir)) {
+    std::string ext = entry.path().extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if ((false == entry.is_regular_file()) || ((".jpg" != ext) && (".jpeg" != ext))) {
+      continue;
+    }
+
+    JpegFile_t file;
+    std::ifstream in(entry.path(), std::ios::binary);
+    file.Name = entry.path().string();
+    file.Data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    file.DataOffset = 2;
+    while (((file.DataOffset + 4) <= file.Data.size()) && (0xFF == file.Data[file.DataOffset]) && (0xE0 == (file.Data[file.DataOffset + 1] & 0xF0))) {
+      file.DataOffset += 2 + ((file.Data[file.DataOffset + 2] << 8) | file.Data[file.DataOffset + 3]);
+    }
+    files.push_back(file);
+  }
+
+  std::sort(files.begin(), files.end(), [](const JpegFile_t &a, const JpegFile_t &b) { return a.Name < b.Name; });
+  return files;
+}
+
+/**
+   @brief Exif header with the SOI and the APP1 segment, the content is not parsed by the stream
+   @param none
+   @return std::vector<uint8_t> - exif header
+*/
+static std::vector<uint8_t> GetExifHeader() {
+  std::vector<uint8_t> exif(STREAM_TEST_EXIF);
+  const uint8_t app1[] = { 0xFF, 0xD8, 0xFF, 0xE1, 0x00, STREAM_TEST_EXIF - 4, 'E', 'x', 'i', 'f', 0x00, 0x00 };
+
+  for (size_t i = 0; i < exif.size(); i++) {
+    exif[i] = (i < sizeof(app1)) ? app1[i] : (uint8_t)i;
+  }
+
+  return exif;
+}
+
+/**
+   @brief Start the next part of the stream, like the frame from GetSubscriberFrame
+   @param StreamClient_t* - stream client
+   @param const CameraFrame_t* - frame
+   @param bool - true = send boundary before the part header
+   @return none
+*/
+static void StartPart(StreamClient_t *client, const CameraFrame_t *frame, bool boundary) {
+  CameraFrame_GetView(frame, &client->View);
+  client->PartHeaderLen = StreamPart_PrepareHeader(client->PartHeader, boundary, client->View.Len);
+  client->Index = 0;
+}
+
+/**
+   @brief Fill one chunk of the response, like AsyncJpegStreamResponse::_content
+   @param StreamClient_t* - stream client
+   @param uint8_t* - output buffer
+   @param size_t - maximum length
+   @return size_t - length of the chunk, 0 = part is sent
+*/
+static size_t FillChunk(StreamClient_t *client, uint8_t *buffer, size_t maxLen) {
+  size_t len = 0;
+
+  if (client->Index < client->PartHeaderLen) {
+    len = min(maxLen, client->PartHeaderLen - client->Index);
+    memcpy(buffer, client->PartHeader + client->Index, len);
+    client->Index += len;
+  }
+
+  if (len < maxLen) {
+    size_t flen = CameraFrame_CopyView(&client->View, buffer + len, client->Index - client->PartHeaderLen, maxLen - len);
+    client->Index += flen;
+    len += flen;
+  }
+
+  return len;
+}
+
+/**
+   @brief Send the whole part in chunks of the given size
+   @param StreamClient_t* - stream client
+   @param size_t - chunk size
+   @return std::string - sent data
+*/
+static std::string SendPart(StreamClient_t *client, size_t step) {
+  std::string sent;
+  std::vector<uint8_t> buf(step);
+  size_t len = 0;
+
+  while (0 != (len = FillChunk(client, buf.data(), step))) {
+    sent.append((const char *)buf.data(), len);
+  }
+
+  return sent;
+}
+
+/**
+   @brief Part header with and without the boundary, frame length 0 and the maximum length
+   @param none
+   @return none
+*/
+static void TestPartHeader() {
+  int before = Failed;
+  char header[STREAM_PART_HEADER_SIZE];
+
+  size_t len = StreamPart_PrepareHeader(header, false, 123456);
+  CHECK(std::string(header, len) == "Content-Type: image/jpeg\r\nContent-Length: 123456\r\n\r\n");
+
+  len = StreamPart_PrepareHeader(header, true, 0);
+  CHECK(std::string(header, len) == "\r\n--" PART_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: 0\r\n\r\n");
+
+  len = StreamPart_PrepareHeader(header, true, UINT32_MAX);
+  CHECK(std::string(header, len) == "\r\n--" PART_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: 4294967295\r\n\r\n");
+  CHECK(len < STREAM_PART_HEADER_SIZE);
+  printf("%-4s part header\n", (before == Failed) ? "ok" : "FAIL");
+}
+
+/**
+   @brief Send every corpus file as two parts, with and without the exif header, in chunks of several sizes
+   @param const std::vector<JpegFile_t>& - files
+   @return none
+*/
+static void RunTests(const std::vector<JpegFile_t> &files) {
+  const size_t steps[] = { 1, 7, 500, STREAM_TEST_CHUNK, 5744 };
+  std::vector<uint8_t> exif = GetExifHeader();
+  CameraFrameRing ring;
+
+  for (const JpegFile_t &file : files) {
+    int before = Failed;
+    int returned = ReturnedFrames;
+    std::vector<uint8_t> data = file.Data;
+    camera_fb_t fb = {};
+    fb.buf = data.data();
+    fb.len = data.size();
+
+    /* expected frame, the exif header replaces the original header */
+    std::string jpeg((const char *)data.data() + file.DataOffset, data.size() - file.DataOffset);
+    std::string expected = std::string((const char *)exif.data(), exif.size()) + jpeg;
+    std::string original((const char *)data.data(), data.size());
+    std::string boundary = "\r\n--" PART_BOUNDARY "\r\n";
+
+    for (int WithExif = 1; WithExif >= 0; WithExif--) {
+      const std::string &frame = (1 == WithExif) ? expected : original;
+      std::string header = "Content-Type: image/jpeg\r\nContent-Length: " + std::to_string(frame.size()) + "\r\n\r\n";
+
+      CameraFrame_t *published = ring.Publish(&fb);
+      CHECK(NULL != published);
+      if (NULL == published) {
+        continue;
+      }
+      if (1 == WithExif) {
+        CHECK(ring.SetExif(published, exif.data(), exif.size(), file.DataOffset));
+      }
+
+      for (size_t step : steps) {
+        StreamClient_t client;
+        StartPart(&client, published, false);
+        CHECK(client.View.Len == frame.size());
+        CHECK(SendPart(&client, step) == (header + frame));
+
+        StartPart(&client, published, true);
+        CHECK(SendPart(&client, step) == (boundary + header + frame));
+      }
+      ring.Release(published);
+    }
+
+    CHECK(0 == ring.GetFramesInUse());
+    CHECK((returned + 2) == ReturnedFrames);
+    printf("%-4s %s (%zu B, jpeg data at %zu)\n", (before == Failed) ? "ok" : "FAIL", file.Name.c_str(), data.size(), file.DataOffset);
+  }
+}
+
+/**
+   @brief Time the part header and the copy of the view with the exif header in TCP segment sized chunks.
+          The best of several rounds is reported
+   @param const std::vector<JpegFile_t>& - files
+   @return none
+*/
+static void RunBench(const std::vector<JpegFile_t> &files) {
+  const int rounds = 5;
+  const size_t target = 500 * 1024 * 1024;
+  std::vector<uint8_t> exif = GetExifHeader();
+  std::vector<uint8_t> buf(STREAM_TEST_CHUNK);
+  CameraFrameRing ring;
+  volatile size_t sink = 0;
+
+  printf("\n%-62s %10s %10s %10s %10s\n", "file, chunk " "1436 B", "size [B]", "chunks", "us/frame", "MB/s");
+  for (const JpegFile_t &file : files) {
+    std::vector<uint8_t> data = file.Data;
+    camera_fb_t fb = {};
+    fb.buf = data.data();
+    fb.len = data.size();
+
+    CameraFrame_t *published = ring.Publish(&fb);
+    if ((NULL == published) || (false == ring.SetExif(published, exif.data(), exif.size(), file.DataOffset))) {
+      printf("FAIL %s, frame is not published\n", file.Name.c_str());
+      Failed++;
+      ring.Release(published);
+      continue;
+    }
+
+    StreamClient_t client;
+    size_t chunks = 0;
+    size_t bytes = 0;
+    int iterations = max((size_t)1, target / data.size());
+    double best = 1e12;
+
+    for (int round = 0; round < rounds; round++) {
+      auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; i++) {
+        size_t len = 0;
+        chunks = 0;
+        bytes = 0;
+        StartPart(&client, published, 0 != i);
+        while (0 != (len = FillChunk(&client, buf.data(), buf.size()))) {
+          bytes += len;
+          chunks++;
+        }
+        sink += buf[0];
+      }
+      auto end = std::chrono::steady_clock::now();
+      best = min(best, std::chrono::duration<double, std::micro>(end - start).count() / iterations);
+    }
+    ring.Release(published);
+    printf("%-62s %10zu %10zu %10.1f %10.0f\n", file.Name.c_str(), bytes, chunks, best, bytes / best);
+  }
+}
+
+int main(int argc, char **argv) {
+  const char *dir = "../doc";
+  bool bench = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (0 == strcmp(argv[i], "--bench")) {
+      bench = true;
+    } else {
+      dir = argv[i];
+    }
+  }
+
+  /* the exif headers are stored to the small blocks of the frame pool */
+  SystemFramePool.Init();
+
+  std::vector<JpegFile_t> files = LoadCorpus(dir);
+  CHECK(false == files.empty());
+
+  TestPartHeader();
+  RunTests(files);
+  printf("\n%zu files, %d checks, %d failed\n", files.size(), Checked, Failed);
+
+  if (true == bench) {
+    RunBench(files);
+  }
+
+  return (0 == Failed) ? 0 : 1;
+}
+
+/* EOF */
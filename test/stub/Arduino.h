@@ -0,0 +1,111 @@
+/**
+   @file Arduino.h
+
+   @brief Minimal Arduino.h for the host tests. Only the C library, utoa, min/max, String, the time and
+          the FreeRTOS mutex used by the tested modules. The time is moved only by delay(), so the
+          timeouts are tested without waiting. The tests are single threaded, the mutex does nothing
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+/* ------------------ time ------------------*/
+inline uint32_t StubMillis = 0;   ///< time of the host tests [ms]
+
+inline uint32_t millis() {
+  return StubMillis;
+}
+
+inline void delay(uint32_t i_ms) {
+  StubMillis += i_ms;
+}
+
+/* ------------- C library ------------------*/
+inline char *utoa(unsigned int i_value, char *o_buffer, int i_base) {
+  char tmp[33];
+  int len = 0;
+
+  do {
+    tmp[len++] = "0123456789abcdefghijklmnopqrstuvwxyz"[i_value % i_base];
+    i_value /= i_base;
+  } while (0 != i_value);
+  for (int i = 0; i < len; i++) {
+    o_buffer[i] = tmp[len - 1 - i];
+  }
+  o_buffer[len] = '\0';
+
+  return o_buffer;
+}
+
+/* ---------------- FreeRTOS ----------------*/
+typedef void *SemaphoreHandle_t;
+#define portMAX_DELAY               0xFFFFFFFF
+#define pdTRUE                      1
+#define MALLOC_CAP_SPIRAM           0
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+  return (SemaphoreHandle_t) 1;
+}
+
+inline int xSemaphoreTake(SemaphoreHandle_t, uint32_t) {
+  return pdTRUE;
+}
+
+inline int xSemaphoreGive(SemaphoreHandle_t) {
+  return pdTRUE;
+}
+
+inline void *heap_caps_malloc(size_t i_size, uint32_t) {
+  return malloc(i_size);
+}
+
+/* ----------------- String -----------------*/
+class String {
+private:
+  std::string Data;   ///< string content
+
+public:
+  String() {}
+  String(const char *i_data) : Data((NULL != i_data) ? i_data : "") {}
+  String(const std::string &i_data) : Data(i_data) {}
+  String(char i_data) : Data(1, i_data) {}
+  String(int i_data) : Data(std::to_string(i_data)) {}
+  String(unsigned int i_data) : Data(std::to_string(i_data)) {}
+  String(long i_data) : Data(std::to_string(i_data)) {}
+  String(unsigned long i_data) : Data(std::to_string(i_data)) {}
+
+  unsigned int length() const { return Data.length(); }
+  const char *c_str() const { return Data.c_str(); }
+  bool startsWith(const String &i_prefix) const { return 0 == Data.compare(0, i_prefix.Data.length(), i_prefix.Data); }
+  int indexOf(char i_ch, unsigned int i_from = 0) const {
+    size_t pos = Data.find(i_ch, i_from);
+    return (std::string::npos == pos) ? -1 : (int) pos;
+  }
+  String substring(unsigned int i_from) const { return (i_from < Data.length()) ? Data.substr(i_from) : ""; }
+  String substring(unsigned int i_from, unsigned int i_to) const { return (i_from < i_to) ? substring(i_from).Data.substr(0, i_to - i_from) : ""; }
+  long toInt() const { return atol(Data.c_str()); }
+
+  String &operator+=(const String &i_data) { Data += i_data.Data; return *this; }
+  bool operator==(const String &i_data) const { return Data == i_data.Data; }
+  bool operator!=(const String &i_data) const { return Data != i_data.Data; }
+  friend String operator+(const String &a, const String &b) { return a.Data + b.Data; }
+  friend String operator+(const String &a, const char *b) { return a.Data + b; }
+  friend String operator+(const char *a, const String &b) { return a + b.Data; }
+};
+
+/* EOF */
@@ -0,0 +1,56 @@
+/**
+   @file WiFi.h
+
+   @brief WiFiClient for the host tests. The written bytes are stored, the read bytes are prepared by the test
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <Arduino.h>
+
+class WiFiClient {
+public:
+  inline static bool ConnectResult = true;  ///< result of the next connect
+  inline static bool Open = false;          ///< connection is open
+  inline static std::string Tx;             ///< bytes written by the client
+  inline static std::string Rx;             ///< bytes from the server
+  inline static size_t RxPos = 0;           ///< next byte from the server
+
+  int connect(const char *, uint16_t, int32_t) {
+    Open = ConnectResult;
+    return (true == Open) ? 1 : 0;
+  }
+
+  void setNoDelay(bool) {}
+
+  size_t write(const uint8_t *i_buf, size_t i_len) {
+    if (false == Open) {
+      return 0;
+    }
+    Tx.append((const char *) i_buf, i_len);
+    return i_len;
+  }
+
+  int available() {
+    return (true == Open) ? (int)(Rx.size() - RxPos) : 0;
+  }
+
+  int read() {
+    return (RxPos < Rx.size()) ? (uint8_t) Rx[RxPos++] : -1;
+  }
+
+  uint8_t connected() {
+    return (true == Open) ? 1 : 0;
+  }
+
+  void stop() {
+    Open = false;
+  }
+};
+
+/* EOF */
@@ -0,0 +1,29 @@
+/**
+   @file esp_camera.h
+
+   @brief Camera frame buffer of the camera driver for the host tests
+
+   @author Miroslav Pivovarsky
+   Contact: miroslav.pivovarsky@gmail.com
+
+   @bug: no know bug
+*/
+
+#pragma once
+
+#include <sys/time.h>
+
+#include <Arduino.h>
+
+struct camera_fb_t {
+  uint8_t *buf;               ///< frame data
+  size_t len;                 ///< frame length
+  size_t width;               ///< frame width
+  size_t height;              ///< frame height
+  int format;                 ///< pixel format
+  struct timeval timestamp;   ///< capture time
+};
+
+void esp_camera_fb_return(camera_fb_t *);
+
+/* EOF */
@@ -48,6 +48,7 @@ function get_data(val) {
 				document.getElementById("flash_time_value").innerText = obj.flash_time;
 				document.getElementById("aec_value_value").innerText = obj.aec_value;
 				document.getElementById('timelapsid').checked = obj.timelaps;
+				document.getElementById('motion_cadenceid').checked = obj.motion_cadence;
 				$("#status_hmirror").text((obj.hmirror == "true") ? "On" : "Off");
 				$("#status_vflip").text((obj.vflip == "true") ? "On" : "Off");
 				$("#status_lensc").text((obj.lensc == "true") ? "On" : "Off");
@@ -62,6 +63,7 @@ function get_data(val) {
 				$("#status_aec2").text((obj.aec2 == "true") ? "On" : "Off");
 				$("#status_gain_ctrl").text((obj.gain_ctrl == "true") ? "On" : "Off");
 				$("#status_timelaps").text((obj.timelaps == "true") ? "On" : "Off");
+				$("#status_motion_cadence").text((obj.motion_cadence == "true") ? "On" : "Off");
 				sliderCheck();
 			}
 